@@ -0,0 +1,263 @@
+#include "main.h"
+#include "blackbox.h"
+#include <string.h>
+
+// 飞行记录器, 格式见blackbox.h
+// blackbox_log在TIM2节拍中生产, blackbox_poll在主循环中消费;
+// head只由生产者修改, tail只由消费者修改, 环形缓冲区不需要关中断.
+// 每次写入Flash前先把数据拷到bb_stage, 编程期间环形缓冲区可以继续写.
+
+typedef enum {
+    BB_IDLE = 0, // 未记录
+    BB_RUN,      // 记录中
+    BB_STOPPING, // 已停止, 正在写入剩余数据
+    BB_ERASING   // 正在擦除日志扇区
+} bb_state_t;
+
+static const char *bb_state_names[] = {"idle", "run", "stopping", "erasing"};
+
+static CCM_LOG uint8_t bb_ring[BLACKBOX_RING_SIZE];
+static volatile uint32_t bb_head, bb_tail; // 自由递增, 取模后为下标
+static uint32_t bb_stage[BLACKBOX_FLUSH_SIZE / 4];
+static uint32_t bb_pending;                // 正在编程的字数, 0表示没有
+static uint8_t bb_erase_submitted;
+
+static uint8_t bb_state = BB_IDLE;
+static uintptr_t bb_base, bb_end, bb_addr; // 日志扇区范围和写入位置
+static int32_t bb_prev[BLACKBOX_FIELD_NUM];
+static uint32_t bb_frame_idx;
+static uint8_t bb_force_i;
+static uint32_t bb_frames, bb_dropped, bb_ring_peak;
+
+static int32_t bb_round(float v){
+    return (int32_t)(v + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+// zigzag + varint, 返回写入的字节数 (1~5)
+static uint32_t bb_put_varint(uint8_t *p, int32_t v){
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    uint32_t n = 0;
+    while (z >= 0x80) {
+        p[n++] = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    p[n++] = (uint8_t)z;
+    return n;
+}
+
+static int bb_push(const uint8_t *p, uint32_t n){
+    uint32_t head = bb_head;
+    if (BLACKBOX_RING_SIZE - (head - bb_tail) < n) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        bb_ring[(head + i) & (BLACKBOX_RING_SIZE - 1)] = p[i];
+    }
+    bb_head = head + n;
+    if (bb_head - bb_tail > bb_ring_peak) {
+        bb_ring_peak = bb_head - bb_tail;
+    }
+    return 0;
+}
+
+// 从扇区末尾向前找到最后一个已写入的字, 之后即为写入位置
+int blackbox_init(void){
+    bb_base = flash_sector_addr(BLACKBOX_SECTOR);
+    bb_end = bb_base + flash_sector_size(BLACKBOX_SECTOR);
+    bb_addr = bb_end;
+    while (bb_addr > bb_base && *(const uint32_t *)(bb_addr - 4) == 0xFFFFFFFF) {
+        bb_addr -= 4;
+    }
+    return 0;
+}
+
+void blackbox_log(const sensor_record_t *rec, const control_input_t *in, const control_output_t *out,
+                  const adc1_sample_t *adc){
+    int32_t f[BLACKBOX_FIELD_NUM];
+    uint8_t buf[BLACKBOX_FRAME_MAX];
+    uint32_t n = 1;
+
+    if (bb_state != BB_RUN) {
+        return;
+    }
+
+    f[0] = (int32_t)rec->t_us;
+    for (int i = 0; i < CONTROL_AXIS_NUM; i++) {
+        f[1 + i] = rec->gyro[i];
+        f[4 + i] = bb_round(in->setpoint[i] * 100.0f);
+        f[7 + i] = bb_round(out->p[i] * 100.0f);
+        f[10 + i] = bb_round(out->i[i] * 100.0f);
+        f[13 + i] = bb_round(out->d[i] * 100.0f);
+    }
+    for (int m = 0; m < CONTROL_MOTOR_NUM; m++) {
+        f[16 + m] = bb_round(out->motor[m] * 1000.0f);
+    }
+    f[20] = (int32_t)out->pwm_period;
+    f[21] = (int32_t)adc->period;
+    f[22] = adc->value[ADC1_CH_VBAT];
+    f[23] = adc->value[ADC1_CH_CURRENT];
+
+    // I帧写绝对值, P帧写差值; 差值按无符号相减, 时间戳回绕时也正确
+    uint8_t iframe = bb_force_i || (bb_frame_idx % BLACKBOX_I_INTERVAL) == 0;
+    buf[0] = iframe ? 'I' : 'P';
+    for (int k = 0; k < BLACKBOX_FIELD_NUM; k++) {
+        int32_t v = iframe ? f[k] : (int32_t)((uint32_t)f[k] - (uint32_t)bb_prev[k]);
+        n += bb_put_varint(&buf[n], v);
+    }
+
+    if (bb_push(buf, n) != 0) {
+        bb_dropped++;
+        bb_force_i = 1; // 上一帧丢了, 差值没有基准
+        return;
+    }
+    memcpy(bb_prev, f, sizeof(bb_prev));
+    bb_force_i = 0;
+    bb_frame_idx++;
+    bb_frames++;
+}
+
+static int bb_start(void){
+    static const uint8_t header[] = {'B', 'B', 'X', '1', BLACKBOX_FIELD_NUM, BLACKBOX_I_INTERVAL};
+
+    if (bb_state != BB_IDLE) {
+        return -1;
+    }
+    if (bb_end - bb_addr < BLACKBOX_FLUSH_SIZE) {
+        printf("blackbox full, erase first\n");
+        return -1;
+    }
+    bb_head = bb_tail = 0;
+    bb_frame_idx = 0;
+    bb_frames = bb_dropped = bb_ring_peak = 0;
+    bb_force_i = 1;
+    bb_push(header, sizeof(header));
+    bb_state = BB_RUN;
+    return 0;
+}
+
+static void bb_stop(void){
+    static const uint8_t end = 'E';
+
+    if (bb_state == BB_RUN) {
+        bb_push(&end, 1); // 缓冲区满时丢掉结束标记, 解码端读到0xFF同样结束
+        bb_state = BB_STOPPING;
+    }
+}
+
+// 推进擦除和写入, 主循环中调用; 返回1表示还有工作未完成
+int blackbox_poll(void){
+    int ret = flash_status(FLASH_OWNER_BLACKBOX);
+
+    if (ret == 1) {
+        return 1;
+    }
+
+    if (bb_state == BB_ERASING) {
+        if (!bb_erase_submitted) {
+            bb_erase_submitted = flash_erase_start(BLACKBOX_SECTOR, FLASH_OWNER_BLACKBOX) == 0;
+            return 1;
+        }
+        bb_erase_submitted = 0;
+        bb_state = BB_IDLE;
+        if (ret != 0) {
+            DLOG("blackbox erase failed\n");
+            return 0;
+        }
+        bb_addr = bb_base;
+        DLOG("blackbox erased\n");
+        return 0;
+    }
+
+    if (bb_pending) {
+        if (ret != 0) {
+            DLOG("blackbox write failed at %08lX\n", bb_addr);
+            bb_pending = 0;
+            bb_state = BB_IDLE;
+            return 0;
+        }
+        bb_addr += bb_pending * 4;
+        bb_pending = 0;
+    }
+
+    // 记录中凑满一块再写, 停止后把剩余数据全部写完
+    uint32_t used = bb_head - bb_tail;
+    if (used == 0) {
+        if (bb_state == BB_STOPPING) {
+            bb_state = BB_IDLE;
+        }
+        return 0;
+    }
+    if (bb_state == BB_RUN && used < BLACKBOX_FLUSH_SIZE) {
+        return 0;
+    }
+
+    uint32_t n = (used < BLACKBOX_FLUSH_SIZE) ? used : BLACKBOX_FLUSH_SIZE;
+    uint32_t words = (n + 3) / 4;
+    if (bb_addr + words * 4 > bb_end) {
+        DLOG("blackbox full, %lu frames\n", bb_frames);
+        bb_tail = bb_head;
+        bb_state = BB_IDLE;
+        return 0;
+    }
+
+    uint8_t *stage = (uint8_t *)bb_stage;
+    uint32_t tail = bb_tail;
+    for (uint32_t i = 0; i < n; i++) {
+        stage[i] = bb_ring[(tail + i) & (BLACKBOX_RING_SIZE - 1)];
+    }
+    memset(stage + n, 0xFF, words * 4 - n); // 最后一块补齐到字边界
+
+    // 本使用者的上一个任务未完成时提交失败, 下次再试 (参数保存有自己的任务槽, 不会挡住这里)
+    if (flash_program_start(bb_addr, bb_stage, words, FLASH_OWNER_BLACKBOX) != 0) {
+        return 1;
+    }
+    bb_tail = tail + n;
+    bb_pending = words;
+    return 1;
+}
+
+// 以十六进制输出扇区中已写入的数据, 每行32字节
+static void bb_dump(void){
+    for (uintptr_t a = bb_base; a < bb_addr; a += 32) {
+        const uint8_t *p = (const uint8_t *)a;
+        uint32_t n = (bb_addr - a < 32) ? bb_addr - a : 32;
+        for (uint32_t i = 0; i < n; i++) {
+            printf("%02X", p[i]);
+        }
+        printf("\n");
+    }
+}
+
+void blackbox_cmd(int argc, void **argv){
+    if (argc < 1) {
+        printf("blackbox %s, flash %lu/%lu bytes\n", bb_state_names[bb_state], (unsigned long)(bb_addr - bb_base),
+               (unsigned long)(bb_end - bb_base));
+        printf("frames %lu, dropped %lu, ring %lu/%d bytes (peak %lu)\n", (unsigned long)bb_frames,
+               (unsigned long)bb_dropped, (unsigned long)(bb_head - bb_tail), BLACKBOX_RING_SIZE,
+               (unsigned long)bb_ring_peak);
+        printf("Usage: blackbox <start|stop|erase|dump>\n");
+        return;
+    }
+    if (!strcmp(argv[0], "start")) {
+        if (bb_start() != 0) {
+            printf("blackbox: cannot start (%s)\n", bb_state_names[bb_state]);
+            return;
+        }
+    } else if (!strcmp(argv[0], "stop")) {
+        bb_stop();
+    } else if (!strcmp(argv[0], "erase")) {
+        // 擦除128KB扇区期间中断被推迟, 只在未解锁时进行
+        if (bb_state != BB_IDLE || pwm_armed()) {
+            printf("blackbox: stop and disarm first\n");
+            return;
+        }
+        bb_state = BB_ERASING;
+        bb_erase_submitted = 0;
+    } else if (!strcmp(argv[0], "dump")) {
+        bb_dump();
+        return;
+    }
+    printf("blackbox %s\n", bb_state_names[bb_state]);
+}
+
+ENV_EXPORT(blackbox, blackbox_cmd);
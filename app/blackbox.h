@@ -0,0 +1,45 @@
+#ifndef __BLACKBOX_H
+#define __BLACKBOX_H
+
+#include <stdint.h>
+#include "sensor.h"
+#include "control.h"
+#include <driver.h>
+
+// 飞行记录器: 每个控制步编码一帧写入CCM中的环形缓冲区, 主循环把缓冲区
+// 按块写入Flash扇区7. 解锁时引擎只编程不擦除, 扇区须在地面预先擦除.
+//
+// 字节流格式 (主机端按此解码, 见tools/blackbox_decode.c):
+//   会话头  'B' 'B' 'X' '1' | 字段数 | I帧间隔
+//   I帧     'I' | 各字段绝对值
+//   P帧     'P' | 各字段与上一帧之差
+//   结束    'E', 之后到下一个4字节边界为0xFF填充
+// 字段值先做zigzag映射 ((v << 1) ^ (v >> 31)), 再按varint编码:
+// 每字节低7位为数据, 最高位为1表示后面还有字节, 低位在前.
+// 缓冲区满时丢弃当前帧, 下一帧强制为I帧, 解码端不会错位.
+//
+// 字段顺序:
+//   0      t_us                 时间戳 (us)
+//   1~3    gyro roll/pitch/yaw  陀螺仪原始值 (16.4 LSB/(deg/s))
+//   4~6    setpoint             目标值 (0.01deg, yaw为0.01deg/s)
+//   7~9    P                    PID分项 (0.01‰油门)
+//   10~12  I
+//   13~15  D
+//   16~19  motor 1~4            电机输出 (‰)
+//   20     pwm_period           输出算完时的PWM周期号, 非PWM同步采样时为0
+//   21     adc_period           最近一次同步采样所属的PWM周期号, 与20之差即采样到输出的周期数
+//   22~23  vbat/current         该次采样的原始值 (12位)
+
+#define BLACKBOX_SECTOR     7    // 日志扇区 0x08060000, 128KB, 不放代码
+#define BLACKBOX_RING_SIZE  8192 // 环形缓冲区字节数, 必须是2的幂; 1kHz约300ms
+#define BLACKBOX_FLUSH_SIZE 256  // 每次写入Flash的字节数
+#define BLACKBOX_I_INTERVAL 32   // I帧间隔 (帧)
+#define BLACKBOX_FIELD_NUM  24
+#define BLACKBOX_FRAME_MAX  (1 + BLACKBOX_FIELD_NUM * 5) // 单帧最大字节数
+
+int blackbox_init(void);
+void blackbox_log(const sensor_record_t *rec, const control_input_t *in, const control_output_t *out,
+                  const adc1_sample_t *adc);
+int blackbox_poll(void);
+
+#endif
@@ -1,3 +1,155 @@
-void control(){
-    
-}
\ No newline at end of file
+#include "control.h"
+#include <param.h>
+#include <bench.h>
+
+#define CONTROL_DT        0.01f  // 控制周期 (s), 与TIM2周期一致
+#define CONTROL_PID_SCALE 0.001f // PID输出单位: 千分之一油门
+#define CONTROL_I_LIMIT   100.0f // 积分项限幅 (deg*s)
+#define CONTROL_I_MIN_THR 0.05f  // 油门低于此值时不积分 (在地面)
+#define CONTROL_PI        3.14159265f
+
+// 姿态PID增益
+PARAM_FLOAT(PARAM_PID_ROLL_P, pid_roll_p, 0.0f, 20.0f, 1.2f);
+PARAM_FLOAT(PARAM_PID_ROLL_I, pid_roll_i, 0.0f, 5.0f, 0.02f);
+PARAM_FLOAT(PARAM_PID_ROLL_D, pid_roll_d, 0.0f, 5.0f, 0.05f);
+PARAM_FLOAT(PARAM_PID_PITCH_P, pid_pitch_p, 0.0f, 20.0f, 1.2f);
+PARAM_FLOAT(PARAM_PID_PITCH_I, pid_pitch_i, 0.0f, 5.0f, 0.02f);
+PARAM_FLOAT(PARAM_PID_PITCH_D, pid_pitch_d, 0.0f, 5.0f, 0.05f);
+PARAM_FLOAT(PARAM_PID_YAW_P, pid_yaw_p, 0.0f, 20.0f, 2.0f);
+PARAM_FLOAT(PARAM_PID_YAW_I, pid_yaw_i, 0.0f, 5.0f, 0.01f);
+PARAM_FLOAT(PARAM_PID_YAW_D, pid_yaw_d, 0.0f, 5.0f, 0.0f);
+
+// 滤波器截止频率 (Hz)
+PARAM_U32(PARAM_GYRO_LPF_HZ, gyro_lpf_hz, 5, 500, 80);
+PARAM_U32(PARAM_ACCEL_LPF_HZ, accel_lpf_hz, 1, 200, 20);
+
+// 一阶低通滤波器
+typedef struct {
+    float k;     // 滤波系数 dt / (RC + dt)
+    float state; // 上一次输出
+} pt1_filter_t;
+
+// PID控制器状态, 增益从参数表读取
+typedef struct {
+    float integral;
+} pid_state_t;
+
+// X型四轴混控: 每个电机对 roll/pitch/yaw 的系数, 顺序同PWM通道, 需与机架一致
+static const float control_mix[CONTROL_MOTOR_NUM][CONTROL_AXIS_NUM] = {
+    {-1.0f, +1.0f, -1.0f}, // PE13 右后
+    {-1.0f, -1.0f, +1.0f}, // PD14 右前
+    {+1.0f, +1.0f, +1.0f}, // PB7  左后
+    {+1.0f, -1.0f, -1.0f}, // PE6  左前
+};
+
+static CCM_STATE pt1_filter_t control_gyro_lpf[CONTROL_AXIS_NUM];
+static CCM_STATE pid_state_t control_pid[CONTROL_AXIS_NUM];
+static CCM_STATE float control_lpf_hz, control_lpf_dt; // 计算滤波系数时用的截止频率和步长
+
+static void pt1_init(pt1_filter_t *f, float cutoff_hz, float dt){
+    float rc = 1.0f / (2.0f * CONTROL_PI * cutoff_hz);
+    f->k = dt / (rc + dt);
+}
+
+static float pt1_apply(pt1_filter_t *f, float in){
+    f->state += f->k * (in - f->state);
+    return f->state;
+}
+
+// p_id为P增益的参数ID, I/D增益紧随其后; 微分取测量角速度, 避免目标突变时的冲击
+// term输出P/I/D三个分项
+static float pid_step(pid_state_t *s, uint16_t p_id, float err, float rate, float dt, int integrate, float term[3]){
+    float kp = param_get_f(p_id);
+    float ki = param_get_f(p_id + 1);
+    float kd = param_get_f(p_id + 2);
+
+    if (integrate) {
+        s->integral += err * dt;
+        if (s->integral > CONTROL_I_LIMIT) {
+            s->integral = CONTROL_I_LIMIT;
+        } else if (s->integral < -CONTROL_I_LIMIT) {
+            s->integral = -CONTROL_I_LIMIT;
+        }
+    }
+    term[0] = kp * err;
+    term[1] = ki * s->integral;
+    term[2] = -kd * rate;
+    return term[0] + term[1] + term[2];
+}
+
+void control_reset(void){
+    for (int i = 0; i < CONTROL_AXIS_NUM; i++) {
+        control_gyro_lpf[i].state = 0.0f;
+        control_pid[i].integral = 0.0f;
+    }
+    control_lpf_hz = 0.0f;
+}
+
+void control_step(const control_input_t *in, control_output_t *out){
+    float axis[CONTROL_AXIS_NUM];
+    float lpf_hz = (float)param_get_u(PARAM_GYRO_LPF_HZ);
+    int integrate = in->throttle >= CONTROL_I_MIN_THR;
+
+    // 截止频率或步长变化时才重算滤波系数
+    if (lpf_hz != control_lpf_hz || in->dt != control_lpf_dt) {
+        for (int i = 0; i < CONTROL_AXIS_NUM; i++) {
+            pt1_init(&control_gyro_lpf[i], lpf_hz, in->dt);
+        }
+        control_lpf_hz = lpf_hz;
+        control_lpf_dt = in->dt;
+    }
+
+    // roll/pitch为角度环, yaw为角速度环
+    for (int i = 0; i < CONTROL_AXIS_NUM; i++) {
+        float rate = pt1_apply(&control_gyro_lpf[i], in->gyro[i]);
+        uint16_t p_id = PARAM_PID_ROLL_P + i * 3;
+        float term[3];
+        if (i < 2) {
+            axis[i] = pid_step(&control_pid[i], p_id, in->setpoint[i] - in->angle[i], rate, in->dt, integrate, term);
+        } else {
+            axis[i] = pid_step(&control_pid[i], p_id, in->setpoint[i] - rate, 0.0f, in->dt, integrate, term);
+        }
+        out->p[i] = term[0];
+        out->i[i] = term[1];
+        out->d[i] = term[2];
+        axis[i] *= CONTROL_PID_SCALE;
+    }
+
+    for (int m = 0; m < CONTROL_MOTOR_NUM; m++) {
+        float v = in->throttle;
+        for (int i = 0; i < CONTROL_AXIS_NUM; i++) {
+            v += control_mix[m][i] * axis[i];
+        }
+        out->motor[m] = (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v;
+    }
+}
+
+// 基准测试: 单次滤波、单轴PID和完整控制步
+static CCM_STATE pt1_filter_t bench_pt1;
+static CCM_STATE pid_state_t bench_pid;
+static volatile float bench_in = 1.0f, bench_out;
+
+static void bench_pt1_apply(void){
+    if (bench_pt1.k == 0.0f) {
+        pt1_init(&bench_pt1, (float)param_get_u(PARAM_GYRO_LPF_HZ), CONTROL_DT);
+    }
+    bench_out = pt1_apply(&bench_pt1, bench_in);
+}
+
+static void bench_pid_step(void){
+    float term[3];
+    bench_out = pid_step(&bench_pid, PARAM_PID_ROLL_P, bench_in, bench_in, CONTROL_DT, 1, term);
+}
+
+static void bench_control_step(void){
+    static control_input_t in = {.throttle = 0.5f, .dt = CONTROL_DT};
+    static control_output_t out;
+
+    in.angle[0] = bench_in;
+    control_step(&in, &out);
+    bench_out = out.motor[0];
+}
+
+BENCH_EXPORT(pt1_filter, bench_pt1_apply);
+BENCH_EXPORT(pid_step, bench_pid_step);
+BENCH_EXPORT(control_step, bench_control_step);
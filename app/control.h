@@ -0,0 +1,32 @@
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#include <stdint.h>
+
+// 控制层只依赖参数表, 不访问外设: 传感器数据由调用者填入,
+// 电机输出以0~1归一化给出, 由调用者换算成PWM占空比.
+// 同一份代码既能在TIM2节拍中运行, 也能被主机仿真按固定步长驱动.
+
+#define CONTROL_AXIS_NUM  3 // 0:roll 1:pitch 2:yaw
+#define CONTROL_MOTOR_NUM 4
+
+typedef struct {
+    float angle[CONTROL_AXIS_NUM];    // 姿态角 (deg)
+    float gyro[CONTROL_AXIS_NUM];     // 角速度 (deg/s)
+    float setpoint[CONTROL_AXIS_NUM]; // 目标姿态角 (deg), yaw为目标角速度 (deg/s)
+    float throttle;                   // 油门 0~1
+    float dt;                         // 距上次调用的时间 (s)
+} control_input_t;
+
+typedef struct {
+    float motor[CONTROL_MOTOR_NUM]; // 电机输出 0~1, 顺序同PWM通道
+    float p[CONTROL_AXIS_NUM];      // 各轴PID分项 (千分之一油门), 只用于记录
+    float i[CONTROL_AXIS_NUM];
+    float d[CONTROL_AXIS_NUM];
+    uint32_t pwm_period;            // 输出算完时的PWM周期号 (adc1_period_count), 由调用者填写, 只用于记录
+} control_output_t;
+
+void control_reset(void);
+void control_step(const control_input_t *in, control_output_t *out);
+
+#endif
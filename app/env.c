@@ -5,19 +5,210 @@
 #include <string.h>
 #include <stdlib.h>
 extern Cmd_PointerTypeDef Cmd;
+extern shell Shell;
+extern Sysfpoint Shell_Sysfpoint;
+extern DeviceFamily STM32F103C8T6_Device;
+extern volatile uint8_t motor_arm;
+
+#define ENV_LINE_MAX 32 // 命令行副本长度, 只需容纳命令名和少量参数
+
+typedef void (*env_cmd_fn)(int argc, void **argv);
+
+// 系统命令表: 名称、实现、Cmd中对应的槽位, help据此生成; 按名称排序
+// exit由Shell框架自己处理, 没有槽位, 只出现在help和补全中
+static const struct {
+    const char *name;
+    env_cmd_fn fn;
+    env_cmd_fn *slot;
+} sys_cmds[] = {
+    {"clear", _clear, &Cmd.clear},
+    {"exit", NULL, NULL},
+    {"help", _help, &Cmd.help},
+    {"ls", _ls, &Cmd.ls},
+    {"poweroff", _poweroff, &Cmd.poweroff},
+    {"reset", _reset, &Cmd.reset},
+    {"test", _test, &Cmd.test},
+};
+
+static int env_count = 0;    // 命令表中有效命令数 (不含结束标志)
+static uint8_t env_sorted = 1; // 命令表有序时才能二分查找
+
+static char env_line[ENV_LINE_MAX]; // 当前输入行的副本, 与框架的行缓冲同步更新
+static uint8_t env_line_len;
+static EnvVar env_hit[2];           // 交给BIE_UART的命令表: 查到的命令 (或空) 加结束标志
+
+static int env_cmp(const void *a, const void *b){
+    return strcmp(((const EnvVar *)a)->name, ((const EnvVar *)b)->name);
+}
 
 void Sys_cmd_Init(){
-    Cmd.ls = _ls;
-    Cmd.reset = _reset;
-    Cmd.poweroff = _poweroff;
-    Cmd.help = _help;
-    Cmd.clear = _clear;
-    Cmd.test = _test;
+    for (unsigned i = 0; i < sizeof(sys_cmds) / sizeof(sys_cmds[0]); i++) {
+        if (sys_cmds[i].slot != NULL) {
+            *sys_cmds[i].slot = sys_cmds[i].fn;
+        }
+    }
+    env_table_init();
+}
+
+void env_table_init(void){
+    // 命令表由链接器按段名 (即命令名) 排序后放在Flash中, 这里只做校验;
+    // 链接脚本没有排序时退回顺序查找, 补全不可用
+    env_sorted = 1;
+    for (env_count = 0; env_vars[env_count].name != NULL; env_count++) {
+        if (env_count > 0 && env_cmp(&env_vars[env_count - 1], &env_vars[env_count]) > 0 && env_sorted) {
+            printf("env table not sorted at %s, using linear lookup\n", env_vars[env_count].name);
+            env_sorted = 0;
+        }
+    }
+}
+
+// 二分查找第一个不小于key的位置, 比较只看前n个字符 (n为0时比较整个字符串)
+static int env_lower_bound(const char *key, size_t n){
+    int lo = 0, hi = env_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = n ? strncmp(env_vars[mid].name, key, n) : strcmp(env_vars[mid].name, key);
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+EnvVar *env_find(const char *name){
+    if (!env_sorted) {
+        for (int i = 0; i < env_count; i++) {
+            if (!strcmp(env_vars[i].name, name)) {
+                return &env_vars[i];
+            }
+        }
+        return NULL;
+    }
+    int i = env_lower_bound(name, 0);
+    if (i < env_count && !strcmp(env_vars[i].name, name)) {
+        return &env_vars[i];
+    }
+    return NULL;
+}
+
+int env_complete(const char *prefix, EnvVar **first){
+    // 有序表中同前缀的命令连续存放, 二分找到起点后向后扫描该区间
+    size_t n = strlen(prefix);
+    if (!env_sorted) {
+        if (first != NULL) {
+            *first = NULL;
+        }
+        return 0;
+    }
+    int lo = env_lower_bound(prefix, n);
+    int hi = lo;
+    while (hi < env_count && !strncmp(env_vars[hi].name, prefix, n)) {
+        hi++;
+    }
+    if (first != NULL) {
+        *first = (lo < hi) ? &env_vars[lo] : NULL;
+    }
+    return hi - lo;
+}
+
+// 字符交给框架, 同时更新行副本
+static void env_feed(uint8_t c){
+    if (c == '\b' || c == 0x7F) {
+        if (env_line_len > 0) {
+            env_line_len--;
+        }
+    } else if (c >= ' ' && c < 0x7F && env_line_len < ENV_LINE_MAX - 1) {
+        env_line[env_line_len++] = (char)c;
+    }
+    BIE_UART(c, &Shell_Sysfpoint, &Shell, env_hit, &STM32F103C8T6_Device);
+}
+
+// 行首的词即命令名, 二分查找后放入env_hit, 框架分派时只比较这一项;
+// 查不到时env_hit为空表, 由框架处理内置命令或提示未知命令
+static void env_line_lookup(void){
+    char name[ENV_LINE_MAX];
+    const char *p = env_line;
+    size_t n;
+
+    env_line[env_line_len] = '\0';
+    while (*p == ' ') {
+        p++;
+    }
+    n = strcspn(p, " ");
+    memcpy(name, p, n);
+    name[n] = '\0';
+
+    EnvVar *e = env_find(name);
+    memset(env_hit, 0, sizeof(env_hit));
+    if (e != NULL) {
+        env_hit[0] = *e;
+    }
+}
+
+// Tab补全命令名: 补到所有候选的共同前缀, 唯一候选时再补一个空格
+static void env_tab(void){
+    EnvVar *first;
+    const char *match = NULL;
+    size_t len = env_line_len, common = 0;
+
+    env_line[len] = '\0';
+    if (strchr(env_line, ' ') != NULL) {
+        return; // 只补全命令名, 不补参数
+    }
+    // 有序区间首尾两项的共同前缀就是整个区间的共同前缀
+    int n = env_complete(env_line, &first);
+    if (n > 0) {
+        const char *last = first[n - 1].name;
+        match = first->name;
+        while (match[common] != '\0' && match[common] == last[common]) {
+            common++;
+        }
+    }
+    for (unsigned i = 0; i < sizeof(sys_cmds) / sizeof(sys_cmds[0]); i++) {
+        const char *name = sys_cmds[i].name;
+        if (strncmp(name, env_line, len) != 0) {
+            continue;
+        }
+        if (match == NULL) {
+            match = name;
+            common = strlen(name);
+        } else {
+            size_t k = len;
+            while (k < common && match[k] == name[k]) {
+                k++;
+            }
+            common = k;
+        }
+        n++;
+    }
+    if (match == NULL) {
+        return;
+    }
+    for (size_t k = len; k < common; k++) {
+        env_feed((uint8_t)match[k]);
+    }
+    if (n == 1) {
+        env_feed(' ');
+    }
+}
+
+void env_uart_input(uint8_t c){
+    if (c == '\t') {
+        env_tab(); // 框架不认识Tab, 不转交
+        return;
+    }
+    // 回车换行成对出现时第二个字符遇到的是空行, 保留上一次的查找结果
+    if ((c == '\r' || c == '\n') && env_line_len > 0) {
+        env_line_lookup();
+        env_line_len = 0;
+    }
+    env_feed(c);
 }
 
 void _ls(int argc, void **argv){
     // 列出所有环境变量
-    extern EnvVar env_vars[];
     for (int i = 0; env_vars[i].name != NULL; i++) {
         printf("%s\n", env_vars[i].name);
     }
@@ -35,16 +226,14 @@ void _poweroff(int argc, void **argv){
 }
 
 void _help(int argc, void **argv){
-    // 列出所有可用命令
+    // 列出所有可用命令, 内容来自命令表
     printf("Available commands:\n");
-    printf("- hello\n");
-    printf("- reset\n");
-    printf("- poweroff\n");
-    printf("- help\n");
-    printf("- exit\n");
-    printf("- clear\n");
-    printf("- test\n");
-    printf("- ls\n");
+    for (unsigned i = 0; i < sizeof(sys_cmds) / sizeof(sys_cmds[0]); i++) {
+        printf("- %s\n", sys_cmds[i].name);
+    }
+    for (int i = 0; i < env_count; i++) {
+        printf("- %s\n", env_vars[i].name);
+    }
 }
 
 void _clear(int argc, void **argv){
@@ -61,10 +250,13 @@ void _test(int argc, void **argv){
 void stop(int argc, void **argv){
     // 停止系统运行
     printf("System is stopping...\n");
+    motor_arm = 0;
     pwm_set_all(0,0,0,0);
 
 }
 
+ENV_EXPORT(stop, stop);
+
 void pwm_set (int argc, void **argv){
     if(argc <= 1){
         printf("Usage: pwm_set <pe13> <pd14> <pb7> <pe6>\n");
@@ -76,9 +268,39 @@ void pwm_set (int argc, void **argv){
         printf("PWM set all to %d\n", arg_value);
         return;
     }
+    if(!strcmp(argv[0],"sync")){
+        if(pwm_sync_enable(!strcmp((char *)argv[1], "on")) != 0)
+            printf("PWM sync needs pwm protocol and a timebase TIM4/TIM9/TIM3 can match\n");
+        printf("PWM sync %s\n", pwm_sync_state() ? "on" : "off");
+        return;
+    }
+    if(!strcmp(argv[0],"proto")){
+        static const char *proto_names[] = {"pwm", "oneshot125", "multishot"};
+        for(int i = 0; i < 3; i++){
+            if(!strcmp((char *)argv[1], proto_names[i])){
+                pwm_set_protocol((pwm_proto_t)i);
+                printf("PWM protocol %s\n", proto_names[i]);
+                return;
+            }
+        }
+        printf("Usage: pwm proto <pwm|oneshot125|multishot>\n");
+        return;
+    }
+    if(!strcmp(argv[0],"freq")){
+        uint32_t freq = (uint32_t)atoi((char *)argv[1]);
+        if(pwm_set_freq(NULL, freq) != 0){
+            printf("Invalid frequency: 1~%d Hz, pwm protocol only\n", PWM_FREQ_MAX);
+            return;
+        }
+        printf("PWM freq %u Hz, TIM1 %u steps, TIM4 %u steps\n", (unsigned)freq,
+               (unsigned)pwm_get_resolution(TIM1), (unsigned)pwm_get_resolution(TIM4));
+        return;
+    }
     
 }
 
+ENV_EXPORT(pwm, pwm_set);
+
 void env_printf(int argc, void **argv){
     if(argc < 1){
         printf("Usage: printf <format> [args...]\n");
@@ -106,4 +328,6 @@ void env_printf(int argc, void **argv){
             printf("Too many arguments for printf command.\n");
             break;
     }
-}
\ No newline at end of file
+}
+
+ENV_EXPORT(printf, env_printf);
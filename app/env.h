@@ -4,6 +4,10 @@
 
 #include <shell/shell.h>
 void Sys_cmd_Init();
+void env_table_init(void);
+EnvVar *env_find(const char *name);
+int env_complete(const char *prefix, EnvVar **first);
+void env_uart_input(uint8_t c);
 void _ls(int argc, void **argv);
 void _reset(int argc, void **argv);
 void _poweroff(int argc, void **argv);
@@ -11,7 +15,7 @@ void _help(int argc, void **argv);
 void _clear(int argc, void **argv);
 void _test(int argc, void **argv);
 
-void stop(int argc, void **argv);
-void pwm_set (int argc, void **argv);
 void env_printf(int argc, void **argv);
+void pwm_set (int argc, void **argv);
+void stop(int argc, void **argv);
 #endif
\ No newline at end of file
@@ -39,81 +39,37 @@ DeviceFamily STM32F103C8T6_Device = {
 /*                              设备池                                        */
 /*===========================================================================*/
 
-dev_info_t Dev_info_poor[] = {
-    /* USART1 - 调试串口 */
-    {
-        .name = DEBUG_UART_NAME,
-        .init = usart1_init,
-        .enable = usart1_start,
-        .disable = usart1_stop,
-        .arg.ptr = (void *)&debug},
-
-    /* USART3 - 通用串口 (PB10-TX, PB11-RX) */
-    {
-        .name = USART3_NAME,
-        .init = usart3_init,
-        .enable = usart3_start,
-        .disable = usart3_stop,
-        .arg.ptr = (void *)&uart3},
-
-    /* I2C1 */
-    {
-        .name = "I2C1",
-        .init = I2C1_Init,
-        .enable = NULL,
-        .disable = NULL,
-        .arg.ptr = NULL},
-
-    /* PWM */
-    {
-        .name = "PWM",
-        .init = pwm_init,
-        .enable = NULL,
-        .disable = NULL,
-        .arg.ptr = NULL},
-
-    /* NVIC */
-    {
-        .name = "NVIC",
-        .init = nvic_init,
-        .enable = NULL,
-        .disable = NULL,
-        .arg.ptr = NULL},
+/* 各驱动在自身源文件中通过DEV_EXPORT注册 (序号即初始化顺序):
+ *   10 USART1   11 USART3   15 PARAM  16 RC     20 I2C1
+ *   25 OLED     30 PWM      40 NVIC   50 LED    60 ADC1   70 TIM2
+ */
 
-    /* 板载LED */
-    {
-        .name = ONBOARD_LED_NAME,
-        .init = led_init,
-        .enable = led_on,
-        .disable = led_off,
-        .arg.ptr = NULL},
+/* TIM2 定时器 - 控制周期10ms, 周期属于应用配置, 在此注册
+ * 参数表为const, 与设备表一起放在Flash; 复合字面量会被放进RAM并在启动时拷贝 */
+static void *const tim2_argv[] = {TIM2, (void *)10};
 
-    /* TIM2 定时器 */
-    {
-        .name = "TIM2",
-        .init = TIM_Init,
-        .enable = NULL,
-        .disable = NULL,
-        .arg.argv = (void *[]){TIM2, (void *)10}},
+DEV_EXPORT(70, tim2) {
+    .name = "TIM2",
+    .init = TIM_Init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.argv = (void **)tim2_argv}; /* TIM_Init只读不写 */
 
-    /* 设备池结束标志 */
-    DEV_INFO_END};
+/* 设备池结束标志 */
+DEV_EXPORT(99, end) DEV_INFO_END;
 
 /*===========================================================================*/
 /*                              环境变量                                      */
 /*===========================================================================*/
 
-EnvVar env_vars[] = {
-    {.name = "stop", .callback = stop},
-    {.name = "pwm", .callback = pwm_set},
-    {.name = "printf", .callback = env_printf},
-    {NULL} /* 环境变量列表结束标志 */
-};
+/* 命令通过ENV_EXPORT注册, 链接器按命令名排序; '~'排在所有命令名之后 */
+const EnvVar __env_end SECTION_USED("env_table.~") = {NULL}; /* 环境变量列表结束标志 */
 
 /*===========================================================================*/
 /*                              全局变量                                      */
 /*===========================================================================*/
 
-float pitch, roll, yaw;
-float hmc_heading;
-float altitude;
\ No newline at end of file
+/* 姿态估计结果, 放在CCM */
+CCM_STATE float pitch, roll, yaw;
+CCM_STATE float hmc_heading;
+CCM_STATE float altitude;
\ No newline at end of file
@@ -1,23 +1,91 @@
 #include <main.h>
 #include <shell/shell.h>
 #include <irq/df_irq.h>
+#include <env.h>
 #include <mpu6050/inv_mpu.h>
 #include <hmc588/hmc588.h>
 #include <bmp280/bmp280.h>
+#include "sensor.h"
+#include "blackbox.h"
+#include "scope.h"
+#include <string.h>
 
 int Serial_1_IRQHandlerCallback(int argc,void *argv[]){
     (void)argc;
     (void)argv;
-    BIE_UART(Shell.Data_Receive(NULL,NULL), &Shell_Sysfpoint, &Shell, env_vars, &STM32F103C8T6_Device);
+    env_uart_input(Shell.Data_Receive(NULL,NULL)); // 命令名二分查找和Tab补全, 再交给BIE_UART
     return 0;
 }
 
+volatile uint8_t motor_arm; // arm命令置位, 控制节拍只在置位时驱动电机
+
 int Time_2_IRQHandlerCallback(int argc,void *argv[]){
     (void)argc;
     (void)argv;
-    mpu_dmp_get_data(&pitch, &roll, &yaw); // 获取姿态数据
-    hmc_heading = HMC5883L_GetHeading(); // 获取航向数据
-    uart3.printf("Pitch: %.2f, Roll: %.2f, Yaw: %.2f, Heading: %.2f, Altitude: %.2f m\n",
-                    pitch, roll, yaw, hmc_heading, altitude);
+    static sensor_record_t rec;
+    static control_input_t in;
+    static control_output_t out;
+    static rc_frame_t rc;
+    static adc1_sample_t adc;
+    sensor_update(&rec); // 获取姿态和航向数据 (实时/录制/回放)
+    int rc_ok = (rc_get(&rc) == 0);
+    sensor_to_control(&rec, 0.01f, &in);
+    if (rc_ok) {
+        rc_to_control(&rc, &in); // 遥控有效时取摇杆目标值, 失控时保持水平、油门为0
+    }
+    static uint8_t driving;
+    if (!rc_ok) {
+        motor_arm = 0;               // 失控立即上锁
+    }
+    if (motor_arm && !driving) {
+        control_reset();             // 解锁时积分从零开始
+    }
+    control_step(&in, &out);
+    if (motor_arm) {
+        uint16_t d[CONTROL_MOTOR_NUM];
+        for (int m = 0; m < CONTROL_MOTOR_NUM; m++) {
+            d[m] = (uint16_t)(out.motor[m] * PWM_MAX_DUTY); // 上限由pwm_set_all按PARAM_PWM_MAX限制
+        }
+        pwm_set_all(d[0], d[1], d[2], d[3]);
+        driving = 1;
+    } else if (driving) {
+        pwm_set_all(0, 0, 0, 0);     // 上锁后停转一次, 之后不再覆盖手动设置的占空比
+        driving = 0;
+    }
+    // PWM同步采样时记下输出所在的PWM周期和最近一次采样, 两者周期号同源, 可直接对齐
+    if (adc1_get_sample(&adc) == 0) {
+        out.pwm_period = adc1_period_count();
+    } else {
+        memset(&adc, 0, sizeof(adc));
+        out.pwm_period = 0;
+    }
+    if (rc_ok) {
+        rc_output_mark(&rc);     // 统计摇杆帧到输出的延迟
+    }
+    blackbox_log(&rec, &in, &out, &adc);
+    scope_sample();              // 本拍的结果都已算完, 各通道是同一时刻的值
     return 0;
-}
\ No newline at end of file
+}
+
+// arm: 遥控有效且油门在低位时解锁; disarm: 上锁, 下一拍电机停转
+void arm_cmd(int argc, void **argv){
+    (void)argc;
+    (void)argv;
+    rc_frame_t rc;
+    if (rc_get(&rc) != 0 || rc.ch[RC_CH_THROTTLE] > RC_RAW_MIN + (RC_RAW_MAX - RC_RAW_MIN) / 20) {
+        printf("arm: need rc signal and throttle low\n");
+        return;
+    }
+    motor_arm = 1;
+    printf("armed\n");
+}
+
+void disarm_cmd(int argc, void **argv){
+    (void)argc;
+    (void)argv;
+    motor_arm = 0;
+    printf("disarmed\n");
+}
+
+ENV_EXPORT(arm, arm_cmd);
+ENV_EXPORT(disarm, disarm_cmd);
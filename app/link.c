@@ -0,0 +1,239 @@
+#include "link.h"
+#include <string.h>
+
+// 遥测链路协商, 协议见link.h
+// 状态机只处理收到的字节和时间, 要发的控制帧放在tx中由调用者取走,
+// 要切换的波特率放在pending中, 调用者在控制帧发完后切换并调用link_baud_done.
+
+static const char *link_state_names[] = {"safe", "switching", "verify", "fast"};
+
+static void link_put32(uint8_t *p, uint32_t v){
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t link_get32(const uint8_t *p){
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// CRC8 DVB-S2, 多项式0xD5, 覆盖类型和负载
+uint8_t link_crc8(const uint8_t *d, uint32_t len){
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *d++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xD5) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// 组一帧, 返回帧长 (负载 + 4)
+uint32_t link_frame(uint8_t *p, uint8_t type, const uint8_t *payload, uint8_t len){
+    p[0] = LINK_ADDR;
+    p[1] = len + 2;
+    p[2] = type;
+    memcpy(&p[3], payload, len);
+    p[3 + len] = link_crc8(&p[2], len + 1);
+    return len + 4;
+}
+
+const char *link_state_name(uint8_t state){
+    return (state <= LINK_FAST) ? link_state_names[state] : "?";
+}
+
+// 上一条应答还没被取走时放不下就丢弃, 主机会重发请求
+static void link_reply(link_t *l, uint8_t type, const uint8_t *payload, uint8_t len){
+    if ((uint32_t)l->tx_len + len + 4 > sizeof(l->tx)) {
+        return;
+    }
+    l->tx_len += link_frame(&l->tx[l->tx_len], type, payload, len);
+}
+
+// 供app回调应答, 与控制帧一起排在下一块最前面; 放不下返回-1
+int link_send(link_t *l, uint8_t type, const uint8_t *payload, uint8_t len){
+    if ((uint32_t)l->tx_len + len + 4 > sizeof(l->tx)) {
+        return -1;
+    }
+    link_reply(l, type, payload, len);
+    return 0;
+}
+
+static void link_reply32(link_t *l, uint8_t type, uint32_t v){
+    uint8_t p[4];
+    link_put32(p, v);
+    link_reply(l, type, p, 4);
+}
+
+static void link_enter(link_t *l, uint8_t state, uint32_t now){
+    l->state = state;
+    l->t_state = now;
+    l->pings = 0;
+}
+
+static int link_supported(const link_t *l, uint32_t baud){
+    if (baud == LINK_SAFE_BAUD) {
+        return 1;
+    }
+    for (uint8_t i = 0; i < l->rate_num; i++) {
+        if (l->rates[i] == baud) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// rates: 本端支持的高速速率, 由高到低
+void link_init(link_t *l, const uint32_t *rates, uint8_t n, uint32_t now){
+    memset(l, 0, sizeof(*l));
+    if (n > LINK_RATE_MAX) {
+        n = LINK_RATE_MAX;
+    }
+    memcpy(l->rates, rates, n * sizeof(rates[0]));
+    l->rate_num = n;
+    l->baud = LINK_SAFE_BAUD;
+    l->t_rx = l->t_win = now;
+    link_enter(l, LINK_SAFE, now);
+}
+
+static void link_handle(link_t *l, uint8_t type, const uint8_t *p, uint8_t len, uint32_t now){
+    uint32_t v = (len >= 4) ? link_get32(p) : 0;
+
+    l->rx_frames++;
+    l->t_rx = now;
+    switch (type) {
+    case LINK_HELLO: {
+        uint8_t caps[1 + LINK_RATE_MAX * 4];
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < l->rate_num; i++) {
+            if (l->rates[i] <= v) {
+                link_put32(&caps[1 + n * 4], l->rates[i]);
+                n++;
+            }
+        }
+        caps[0] = n;
+        link_reply(l, LINK_CAPS, caps, 1 + n * 4);
+        break;
+    }
+    case LINK_SWITCH:
+        // 切换中或验证中不接受新的切换, 主机会等到超时回退
+        if (l->state != LINK_SAFE && l->state != LINK_FAST) {
+            break;
+        }
+        if (!link_supported(l, v)) {
+            link_reply32(l, LINK_SWITCH_ACK, 0);
+            break;
+        }
+        link_reply32(l, LINK_SWITCH_ACK, v);
+        l->pending = v;
+        link_enter(l, LINK_SWITCHING, now);
+        break;
+    case LINK_PING:
+        if (l->state == LINK_VERIFY) {
+            l->pings++;
+        }
+        link_reply32(l, LINK_PONG, v);
+        break;
+    case LINK_COMMIT:
+        // 验证期间出现过CRC或接收错误就不确认, 主机重发COMMIT直到超时回退
+        if (l->state == LINK_VERIFY && l->pings >= LINK_PING_NUM && l->win_errors == 0 && v == l->baud) {
+            link_enter(l, LINK_FAST, now);
+        }
+        if (l->state == LINK_FAST && v == l->baud) {
+            link_reply32(l, LINK_COMMIT_ACK, v); // 应答丢失时主机重发COMMIT, 再回一次
+        }
+        break;
+    default:
+        if (l->app != NULL) {
+            l->app(l, type, p, len);
+        }
+        break;
+    }
+}
+
+// 输入收到的字节
+void link_input(link_t *l, const uint8_t *d, uint32_t n, uint32_t now){
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t b = d[i];
+
+        if (l->pos == 0 && b != LINK_ADDR) {
+            l->sync_errors++;
+            continue;
+        }
+        l->buf[l->pos++] = b;
+        if (l->pos == 2) {
+            if (b < 2 || b > 62) {
+                l->sync_errors++;
+                l->pos = 0;
+                continue;
+            }
+            l->len = b + 2;
+        }
+        if (l->pos < 2 || l->pos < l->len) {
+            continue;
+        }
+        l->pos = 0;
+        if (link_crc8(&l->buf[2], l->len - 3) != l->buf[l->len - 1]) {
+            l->crc_errors++;
+            l->win_errors++;
+            continue;
+        }
+        link_handle(l, l->buf[2], &l->buf[3], l->len - 4, now);
+    }
+}
+
+// 硬件接收错误 (帧错误、噪声、溢出), 与CRC错误一起计入回退判断
+void link_rx_error(link_t *l, uint32_t n){
+    l->win_errors += n;
+}
+
+// 回到安全速率; 丢弃未发的应答, 切换由调用者完成
+void link_fallback(link_t *l, uint32_t now){
+    if (l->state == LINK_SAFE || (l->state == LINK_SWITCHING && l->pending == LINK_SAFE_BAUD)) {
+        return;
+    }
+    l->fallbacks++;
+    l->tx_len = 0;
+    l->pending = LINK_SAFE_BAUD;
+    link_enter(l, LINK_SWITCHING, now);
+}
+
+// 超时和错误率检查, 周期调用
+void link_tick(link_t *l, uint32_t now){
+    if (l->state == LINK_VERIFY && (now - l->t_state > LINK_VERIFY_MS || l->win_errors > LINK_ERR_MAX)) {
+        link_fallback(l, now);
+    } else if (l->state == LINK_FAST && (now - l->t_rx > LINK_KEEPALIVE_MS || l->win_errors > LINK_ERR_MAX)) {
+        link_fallback(l, now);
+    }
+    // 验证期间的错误从切换完成起累计, 不按一秒窗口清零
+    if (l->state != LINK_VERIFY && now - l->t_win >= 1000) {
+        l->t_win = now;
+        l->win_errors = 0;
+    }
+}
+
+// 取出待发的控制帧, 放不下时一个字节也不取
+uint32_t link_take_tx(link_t *l, uint8_t *dst, uint32_t max){
+    uint32_t n = l->tx_len;
+    if (n == 0 || n > max) {
+        return 0;
+    }
+    memcpy(dst, l->tx, n);
+    l->tx_len = 0;
+    return n;
+}
+
+// 调用者已把串口切换到pending
+void link_baud_done(link_t *l, uint32_t now){
+    l->baud = l->pending;
+    l->pending = 0;
+    l->pos = 0;
+    l->win_errors = 0;
+    l->t_rx = l->t_win = now;
+    if (l->baud != LINK_SAFE_BAUD) {
+        l->switches++;
+    }
+    link_enter(l, (l->baud == LINK_SAFE_BAUD) ? LINK_SAFE : LINK_VERIFY, now);
+}
@@ -0,0 +1,92 @@
+#ifndef __LINK_H
+#define __LINK_H
+
+#include <stdint.h>
+
+// 遥测链路波特率协商, 飞控端状态机. 不访问硬件, 主机上的模拟程序
+// (tools/link_sim.c) 直接编译本文件; 硬件相关部分在telem.c.
+//
+// 控制帧与遥测帧格式相同: 0xC8 | 长度 | 类型 | 负载 (大端) | CRC8
+//   0xB0 HELLO       主机 -> 飞控  主机支持的最高波特率 u32
+//   0xB1 CAPS        飞控 -> 主机  速率个数 u8, 各速率 u32 (不超过主机上限, 由高到低)
+//   0xB2 SWITCH      主机 -> 飞控  目标波特率 u32
+//   0xB3 SWITCH_ACK  飞控 -> 主机  目标波特率 u32, 0为拒绝
+//   0xB4 PING        主机 -> 飞控  序号 u32
+//   0xB5 PONG        飞控 -> 主机  序号 u32
+//   0xB6 COMMIT      主机 -> 飞控  波特率 u32
+//   0xB7 COMMIT_ACK  飞控 -> 主机  波特率 u32
+//
+// 流程:
+//   1. 双方以LINK_SAFE_BAUD启动, 主机发HELLO, 飞控回CAPS
+//   2. 主机选一个双方都支持的速率发SWITCH, 飞控回ACK, ACK发完后切换 (SWITCHING)
+//   3. 主机收到ACK后切换, 在新速率下发PING; 飞控回PONG (VERIFY)
+//   4. 往返成功LINK_PING_NUM次后主机发COMMIT; 切换以来没有CRC/接收错误时飞控回ACK, 进入FAST
+//   5. LINK_VERIFY_MS内没有完成验证, 或验证中错误超过LINK_ERR_MAX次, 回到安全速率;
+//      主机同样超时回退后重新协商
+//   6. FAST状态下主机每隔不到LINK_KEEPALIVE_MS发一次PING保活;
+//      超时未收到主机帧, 或一秒内CRC/接收错误超过LINK_ERR_MAX次, 回到安全速率
+//
+// 其他类型的帧交给app回调 (如scope.h的配置帧), 回调用link_send应答.
+
+#define LINK_SAFE_BAUD    250000
+#define LINK_PING_NUM     3
+#define LINK_VERIFY_MS    500
+#define LINK_KEEPALIVE_MS 2000
+#define LINK_ERR_MAX      3
+#define LINK_RATE_MAX     6 // 本端支持的高速速率个数上限
+
+#define LINK_ADDR       0xC8
+#define LINK_HELLO      0xB0
+#define LINK_CAPS       0xB1
+#define LINK_SWITCH     0xB2
+#define LINK_SWITCH_ACK 0xB3
+#define LINK_PING       0xB4
+#define LINK_PONG       0xB5
+#define LINK_COMMIT     0xB6
+#define LINK_COMMIT_ACK 0xB7
+
+typedef enum {
+    LINK_SAFE = 0,  // 安全速率
+    LINK_SWITCHING, // 等应答发完后切换波特率
+    LINK_VERIFY,    // 新速率下等待主机验证
+    LINK_FAST       // 已确认的高速率
+} link_state_t;
+
+typedef struct link link_t;
+
+struct link {
+    uint8_t state;
+    uint32_t baud;      // 当前波特率
+    uint32_t pending;   // 应答发完后要切换到的波特率, 0为没有
+    uint32_t t_state;   // 进入当前状态的时刻 (ms)
+    uint32_t t_rx;      // 最近收到合法帧的时刻
+    uint32_t pings;     // 本次验证已完成的往返
+    uint32_t rates[LINK_RATE_MAX];
+    uint8_t rate_num;
+    // 接收解析
+    uint8_t buf[64];
+    uint8_t pos, len;
+    // 待发的控制帧
+    uint8_t tx[48];
+    uint8_t tx_len;
+    // 统计
+    uint32_t rx_frames, crc_errors, sync_errors;
+    uint32_t switches, fallbacks;
+    uint32_t t_win, win_errors;
+    // 非协商帧的处理函数, link_init之后设置, 为NULL时忽略
+    void (*app)(link_t *l, uint8_t type, const uint8_t *p, uint8_t len);
+};
+
+void link_init(link_t *l, const uint32_t *rates, uint8_t n, uint32_t now);
+void link_input(link_t *l, const uint8_t *d, uint32_t n, uint32_t now);
+void link_rx_error(link_t *l, uint32_t n);
+void link_tick(link_t *l, uint32_t now);
+uint32_t link_take_tx(link_t *l, uint8_t *dst, uint32_t max);
+void link_baud_done(link_t *l, uint32_t now);
+void link_fallback(link_t *l, uint32_t now);
+int link_send(link_t *l, uint8_t type, const uint8_t *payload, uint8_t len);
+uint32_t link_frame(uint8_t *p, uint8_t type, const uint8_t *payload, uint8_t len);
+uint8_t link_crc8(const uint8_t *d, uint32_t len);
+const char *link_state_name(uint8_t state);
+
+#endif
@@ -5,14 +5,18 @@
 #include <bmp280/bmp280.h>
 #include <config.h>
 #include <env.h>
+#include "blackbox.h"
+#include "telem.h"
 
 int main()
 {
+    section_zero_init();                // GNU ld下DMA/CCM段为NOLOAD, 先清零
     Device_Registration(Dev_info_poor); // 初始化设备模型
     MCU_Shell_Init(&Shell,&STM32F103C8T6_Device); // 初始化Shell
     Sys_cmd_Init();                     // 初始化系统命令
     mpu_dmp_init();                     // 初始化MPU6050 DMP功能
     HMC5883L_Init();                    // 初始化HMC5883L磁力计
+    blackbox_init();                    // 定位飞行记录的写入位置
     // printf("%d\n", BMP280_Init());                     // 初始化BMP280气压计
     // printf("BMP280 Chip ID: 0x%02X\n", BMP280_ReadChipID());
     // altitude = BMP280_ReadPressure();
@@ -22,6 +26,14 @@ int main()
     {
         Task_Switch_Tick_Handler(&Shell_Sysfpoint); // 任务切换处理
         irq_handle_runner(irq_handles); // 中断处理函数运行
+        flash_poll();                   // 推进Flash后台擦写 (解锁时只允许记录器编程)
+        param_poll();                   // 后台保存参数
+        blackbox_poll();                // 飞行记录写入Flash
+        dlog_poll();                    // 输出延迟日志
+        rc_poll();                      // PPM/PWM接收机每帧解码一次
+        oled_poll();                    // 屏幕后台刷新, 每次不超过几百微秒
+        telem_poll();                   // 遥测按带宽调度, 拼块后经USART3 DMA发送
+        console_poll();                 // 提交putchar攒下的不满一行的输出
     }
     return 0;
 }
@@ -17,9 +17,7 @@
 
 extern shell Shell; // Shell协议结构体实例
 extern Sysfpoint Shell_Sysfpoint; // 系统函数指针结构体实例
-extern EnvVar env_vars[]; // 环境变量数组
 extern DeviceFamily STM32F103C8T6_Device; // 设备信息结构体实例
-extern dev_info_t Dev_info_poor[];
 extern irq_handle_t irq_handles[];
 extern Cmd_PointerTypeDef Cmd;
 extern Ut debug;
@@ -32,4 +30,5 @@ extern LCD_Handler_t lcd_sh1106;
 extern float pitch, roll, yaw;
 extern float hmc_heading;
 extern float altitude;
+extern volatile uint8_t motor_arm; // 由arm/disarm命令切换, 见irq.c
 #endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "main.h"
+#include "scope.h"
+#include <string.h>
+
+// 变量示波, 协议见scope.h
+// scope_sample在TIM2节拍中生产, scope_pack在主循环中消费 (由telem.c拼进遥测块);
+// 环形缓冲区同blackbox.c, head只由生产者修改, tail只由消费者修改.
+// 配置在主循环中收到, 关中断整体替换, 节拍中不会看到一半的配置.
+
+#define SCOPE_PAYLOAD_MAX 60 // 帧长字节上限62, 减去类型和CRC
+#define SCOPE_HEAD        3  // 标签 + 序号
+
+#define SCOPE_CCM_BASE  0x10000000u
+#define SCOPE_CCM_SIZE  0x10000u
+#define SCOPE_SRAM_BASE 0x20000000u
+#define SCOPE_SRAM_SIZE 0x20000u
+
+typedef struct {
+    uint32_t addr;
+    uint8_t type;
+} scope_ch_t;
+
+static const uint8_t scope_sizes[SCOPE_TYPE_NUM] = {1, 1, 2, 2, 4, 4, 4};
+static const char *scope_type_names[SCOPE_TYPE_NUM] = {"u8", "i8", "u16", "i16", "u32", "i32", "f32"};
+
+static scope_ch_t scope_ch[SCOPE_CH_MAX];
+static uint8_t scope_ch_num, scope_width, scope_tag, scope_decim;
+static uint8_t scope_on;
+static uint32_t scope_div;     // 距上次采样的节拍数
+static uint16_t scope_seq;     // 下一个样本的序号, 丢弃的样本也占序号
+static CCM_LOG uint8_t scope_ring[SCOPE_RING][SCOPE_CH_MAX * 4]; // 样本已按大端排好
+static CCM_LOG uint16_t scope_ring_seq[SCOPE_RING];
+static volatile uint32_t scope_head, scope_tail; // 自由递增, 取模后为下标
+static uint32_t scope_samples, scope_dropped, scope_frames;
+
+// 在控制节拍末尾调用, 所有通道在同一拍读出
+void scope_sample(void){
+    if (!scope_on || ++scope_div < scope_decim) {
+        return;
+    }
+    scope_div = 0;
+
+    uint16_t seq = scope_seq++;
+    uint32_t head = scope_head;
+    if (head - scope_tail >= SCOPE_RING) {
+        scope_dropped++;
+        return;
+    }
+    uint8_t *p = scope_ring[head & (SCOPE_RING - 1)];
+    for (uint8_t i = 0; i < scope_ch_num; i++) {
+        const scope_ch_t *c = &scope_ch[i];
+        uint32_t v;
+
+        switch (scope_sizes[c->type]) {
+        case 1:
+            *p++ = *(volatile const uint8_t *)(uintptr_t)c->addr;
+            break;
+        case 2:
+            v = *(volatile const uint16_t *)(uintptr_t)c->addr;
+            *p++ = (uint8_t)(v >> 8);
+            *p++ = (uint8_t)v;
+            break;
+        default:
+            v = *(volatile const uint32_t *)(uintptr_t)c->addr;
+            *p++ = (uint8_t)(v >> 24);
+            *p++ = (uint8_t)(v >> 16);
+            *p++ = (uint8_t)(v >> 8);
+            *p++ = (uint8_t)v;
+            break;
+        }
+    }
+    scope_ring_seq[head & (SCOPE_RING - 1)] = seq;
+    scope_head = head + 1;
+    scope_samples++;
+}
+
+// 把缓冲区中序号连续的样本打成一帧, 帧长不超过max; 没有样本或放不下返回0
+uint32_t scope_pack(uint8_t *dst, uint32_t max){
+    uint32_t tail = scope_tail;
+    uint32_t avail = scope_head - tail;
+
+    if (avail == 0 || max < SCOPE_HEAD + scope_width + 4u) {
+        return 0;
+    }
+    uint32_t room = (max - 4 < SCOPE_PAYLOAD_MAX) ? max - 4 : SCOPE_PAYLOAD_MAX;
+    uint32_t k = (room - SCOPE_HEAD) / scope_width;
+    uint16_t first = scope_ring_seq[tail & (SCOPE_RING - 1)];
+    uint8_t payload[SCOPE_PAYLOAD_MAX];
+    uint32_t n = 0;
+
+    payload[0] = scope_tag;
+    payload[1] = (uint8_t)(first >> 8);
+    payload[2] = (uint8_t)first;
+    while (n < k && n < avail) {
+        uint32_t slot = (tail + n) & (SCOPE_RING - 1);
+        if (scope_ring_seq[slot] != (uint16_t)(first + n)) {
+            break;
+        }
+        memcpy(&payload[SCOPE_HEAD + n * scope_width], scope_ring[slot], scope_width);
+        n++;
+    }
+    scope_tail = tail + n;
+    scope_frames++;
+    return link_frame(dst, SCOPE_DATA, payload, (uint8_t)(SCOPE_HEAD + n * scope_width));
+}
+
+static int scope_addr_ok(uint32_t addr, uint32_t size){
+    if (addr & (size - 1)) {
+        return 0;
+    }
+    return (addr >= SCOPE_CCM_BASE && addr + size <= SCOPE_CCM_BASE + SCOPE_CCM_SIZE) ||
+           (addr >= SCOPE_SRAM_BASE && addr + size <= SCOPE_SRAM_BASE + SCOPE_SRAM_SIZE);
+}
+
+// 校验后整体替换配置并清空缓冲区; 返回SCOPE_ACK的结果码
+static uint8_t scope_config(uint8_t tag, uint8_t decim, uint8_t n, const uint8_t *p, uint32_t len){
+    scope_ch_t ch[SCOPE_CH_MAX];
+    uint8_t width = 0;
+
+    if (n > SCOPE_CH_MAX || len < n * 5u || (n > 0 && decim == 0)) {
+        return 2;
+    }
+    for (uint8_t i = 0; i < n; i++, p += 5) {
+        ch[i].addr = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        ch[i].type = p[4];
+        if (ch[i].type >= SCOPE_TYPE_NUM || !scope_addr_ok(ch[i].addr, scope_sizes[ch[i].type])) {
+            return 1;
+        }
+        width += scope_sizes[ch[i].type];
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(scope_ch, ch, n * sizeof(ch[0]));
+    scope_ch_num = n;
+    scope_width = width;
+    scope_tag = tag;
+    scope_decim = decim;
+    scope_div = 0;
+    scope_seq = 0;
+    scope_head = scope_tail = 0;
+    scope_on = (n > 0);
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+// 遥测链路收到的非协商帧 (link.h)
+void scope_link_frame(link_t *l, uint8_t type, const uint8_t *p, uint8_t len){
+    if (type != SCOPE_SET || len < 3) {
+        return;
+    }
+    uint8_t ret = scope_config(p[0], p[1], p[2], &p[3], len - 3u);
+    uint32_t us = (ret == 0) ? (uint32_t)SCOPE_TICK_US * scope_decim : 0;
+    uint8_t ack[7] = {p[0], ret, scope_width, (uint8_t)(us >> 24), (uint8_t)(us >> 16), (uint8_t)(us >> 8),
+                      (uint8_t)us};
+
+    link_send(l, SCOPE_ACK, ack, sizeof(ack)); // 放不下时主机会重发配置
+}
+
+void scope_cmd(int argc, void **argv){
+    if (argc >= 1 && !strcmp(argv[0], "off")) {
+        scope_config(scope_tag, 0, 0, NULL, 0);
+    }
+    if (!scope_on) {
+        printf("scope off\n");
+    } else {
+        printf("scope tag %u, every %u ticks (%lu us), %u bytes/sample\n", scope_tag, scope_decim,
+               (unsigned long)SCOPE_TICK_US * scope_decim, scope_width);
+        for (uint8_t i = 0; i < scope_ch_num; i++) {
+            printf("  %u: 0x%08lX %s\n", i, (unsigned long)scope_ch[i].addr, scope_type_names[scope_ch[i].type]);
+        }
+    }
+    printf("samples %lu, dropped %lu, frames %lu, ring %lu/%d\n", (unsigned long)scope_samples,
+           (unsigned long)scope_dropped, (unsigned long)scope_frames, (unsigned long)(scope_head - scope_tail),
+           SCOPE_RING);
+    if (argc < 1) {
+        printf("Usage: scope [off], channels are set by tools/scope over the telemetry link\n");
+    }
+}
+
+ENV_EXPORT(scope, scope_cmd);
@@ -0,0 +1,46 @@
+#ifndef __SCOPE_H
+#define __SCOPE_H
+
+#include <stdint.h>
+#include "link.h"
+
+// 变量示波: 主机按地址和类型选最多SCOPE_CH_MAX个RAM变量, 控制节拍中每decim拍
+// 同步采一次 (同一拍内的各通道取自同一时刻), 样本经遥测链路 (telem.h) 发给主机.
+// 主机端见tools/scope.c, 由ELF符号表解析变量名.
+//
+// 配置帧走遥测链路, 任何波特率状态下都可以收发:
+//   0xB8 SCOPE_SET  主机 -> 飞控  标签 u8, 抽取 u8, 通道数 u8, 各通道 地址 u32 + 类型 u8
+//                                  通道数为0即停止
+//   0xB9 SCOPE_ACK  飞控 -> 主机  标签 u8, 结果 u8 (0成功, 1地址或类型不对, 2参数不对),
+//                                  样本字节数 u8, 采样周期 (us) u32
+// 数据帧:
+//   0xA2 SCOPE      飞控 -> 主机  标签 u8, 首个样本序号 u16, 连续序号的样本若干个
+//                                  (各通道按配置顺序, 大端); 序号不连续即中间有样本丢失
+//
+// 地址只接受CCM和SRAM, 且须按类型对齐; 变量按类型宽度一次读出, 不会读到半个值.
+// 节拍中只把样本放进环形缓冲区, 打包在主循环中进行; 链路带宽不够时缓冲区满了丢新样本.
+
+#define SCOPE_SET  0xB8
+#define SCOPE_ACK  0xB9
+#define SCOPE_DATA 0xA2
+
+#define SCOPE_CH_MAX  8
+#define SCOPE_RING    64    // 样本缓冲区个数, 必须是2的幂
+#define SCOPE_TICK_US 10000 // 采样节拍 (us), 与TIM2周期一致
+
+typedef enum {
+    SCOPE_U8 = 0,
+    SCOPE_I8,
+    SCOPE_U16,
+    SCOPE_I16,
+    SCOPE_U32,
+    SCOPE_I32,
+    SCOPE_F32,
+    SCOPE_TYPE_NUM
+} scope_type_t;
+
+void scope_sample(void);
+uint32_t scope_pack(uint8_t *dst, uint32_t max);
+void scope_link_frame(link_t *l, uint8_t type, const uint8_t *p, uint8_t len);
+
+#endif
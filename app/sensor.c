@@ -0,0 +1,206 @@
+#include "main.h"
+#include "sensor.h"
+#include "control.h"
+#include <mpu6050/inv_mpu.h>
+#include <hmc588/hmc588.h>
+#include <string.h>
+
+// 传感器采集、录制与回放
+// 录制: 每次sensor_update把编码后的记录追加到CCM中的缓冲区, 满了自动停止
+// 回放: sensor_update按顺序返回缓冲区中的记录, 不再读传感器, 放完回到实时
+// sensor bench 在同一份数据上离线运行control_step, 给出每步周期数和输出CRC,
+// 修改估计/控制代码前后各跑一次即可对比
+
+// 摇杆满行程对应的目标值
+PARAM_FLOAT(PARAM_RC_MAX_ANGLE, rc_max_angle, 5.0f, 60.0f, 30.0f);        // roll/pitch (deg)
+PARAM_FLOAT(PARAM_RC_MAX_YAW_RATE, rc_max_yaw_rate, 30.0f, 720.0f, 180.0f); // yaw (deg/s)
+
+static CCM_LOG sensor_record_t sensor_log[SENSOR_LOG_LEN];
+static uint32_t sensor_log_count; // 已录制记录数
+static uint32_t sensor_play_pos;  // 回放位置
+static uint8_t sensor_mode = SENSOR_LIVE;
+static uint32_t sensor_time_us;   // 由DWT周期数累加得到的时间戳
+static uint32_t sensor_last_cyc;
+
+static int16_t sensor_cdeg(float deg){
+    return (int16_t)(deg * 100.0f + (deg >= 0.0f ? 0.5f : -0.5f));
+}
+
+static uint32_t sensor_now_us(void){
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    uint32_t cyc = DWT->CYCCNT;
+    uint32_t mhz = SystemCoreClock / 1000000;
+    // 两次调用间隔远小于计数器回绕周期 (168MHz下约25s), 差值不会溢出
+    uint32_t elapsed = cyc - sensor_last_cyc;
+    sensor_time_us += elapsed / mhz;
+    sensor_last_cyc = cyc - elapsed % mhz;
+    return sensor_time_us;
+}
+
+// 读取实际传感器并编码为记录
+static void sensor_read_live(sensor_record_t *rec){
+    float p, r, y;
+    short raw[3];
+    unsigned long ts;
+
+    rec->t_us = sensor_now_us();
+    if (mpu_dmp_get_data(&p, &r, &y) == 0) {
+        rec->angle[0] = sensor_cdeg(r);
+        rec->angle[1] = sensor_cdeg(p);
+        rec->angle[2] = sensor_cdeg(y);
+    }
+    if (mpu_get_gyro_reg(raw, &ts) == 0) {
+        memcpy(rec->gyro, raw, sizeof(rec->gyro));
+    }
+    if (mpu_get_accel_reg(raw, &ts) == 0) {
+        memcpy(rec->accel, raw, sizeof(rec->accel));
+    }
+    rec->heading = sensor_cdeg(HMC5883L_GetHeading());
+    rec->alt_cm = (int32_t)(altitude * 100.0f);
+}
+
+// 遥控摇杆 -1~1 (油门0~1), 超出标称范围的部分截掉
+static float rc_norm(uint16_t raw){
+    float v = ((float)raw - RC_RAW_MID) / (RC_RAW_MAX - RC_RAW_MID);
+    return v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+}
+
+// 用遥控通道覆盖目标值和油门 (AETR): roll/pitch摇杆对应目标角度, yaw摇杆对应目标角速度
+void rc_to_control(const rc_frame_t *f, control_input_t *in){
+    float thr = ((float)f->ch[RC_CH_THROTTLE] - RC_RAW_MIN) / (RC_RAW_MAX - RC_RAW_MIN);
+
+    in->setpoint[0] = rc_norm(f->ch[RC_CH_ROLL]) * param_get_f(PARAM_RC_MAX_ANGLE);
+    in->setpoint[1] = rc_norm(f->ch[RC_CH_PITCH]) * param_get_f(PARAM_RC_MAX_ANGLE);
+    in->setpoint[2] = rc_norm(f->ch[RC_CH_YAW]) * param_get_f(PARAM_RC_MAX_YAW_RATE);
+    in->throttle = thr > 1.0f ? 1.0f : (thr < 0.0f ? 0.0f : thr);
+}
+
+// 获取一次采样 (实时、录制或回放), 并更新姿态全局变量
+// 读取失败的字段保留rec中原有的值
+int sensor_update(sensor_record_t *rec){
+    if (sensor_mode == SENSOR_REPLAY) {
+        if (sensor_play_pos >= sensor_log_count) {
+            sensor_mode = SENSOR_LIVE;
+            DLOG("sensor replay done\n");
+        } else {
+            *rec = sensor_log[sensor_play_pos++];
+        }
+    }
+    if (sensor_mode != SENSOR_REPLAY) {
+        sensor_read_live(rec);
+    }
+    if (sensor_mode == SENSOR_RECORD) {
+        sensor_log[sensor_log_count++] = *rec;
+        if (sensor_log_count >= SENSOR_LOG_LEN) {
+            sensor_mode = SENSOR_LIVE;
+        }
+    }
+
+    // 应用层只看解码后的记录, 保证回放逐位一致
+    roll = rec->angle[0] * 0.01f;
+    pitch = rec->angle[1] * 0.01f;
+    yaw = rec->angle[2] * 0.01f;
+    hmc_heading = rec->heading * 0.01f;
+    return 0;
+}
+
+sensor_mode_t sensor_get_mode(void){
+    return (sensor_mode_t)sensor_mode;
+}
+
+// 把记录转换成控制输入, 目标和油门清零, 由调用者填写
+void sensor_to_control(const sensor_record_t *rec, float dt, control_input_t *in){
+    for (int i = 0; i < 3; i++) {
+        in->angle[i] = rec->angle[i] * 0.01f;
+        in->gyro[i] = rec->gyro[i] / SENSOR_GYRO_LSB;
+        in->setpoint[i] = 0.0f;
+    }
+    in->throttle = 0.0f;
+    in->dt = dt;
+}
+
+// 在录制数据上离线运行控制步, 统计周期数并对输出做CRC
+static void sensor_bench(void){
+    control_input_t in;
+    control_output_t out;
+    uint32_t total = 0, worst = 0;
+    uint32_t crc_buf[CONTROL_MOTOR_NUM];
+    uint32_t crc = 0;
+
+    if (sensor_log_count < 2) {
+        printf("sensor bench: record first\n");
+        return;
+    }
+    // 与控制节拍共用控制器状态, 解锁时运行会打乱正在飞行的积分和滤波
+    if (motor_arm || pwm_armed()) {
+        printf("sensor bench: disarm first\n");
+        return;
+    }
+    control_reset();
+    for (uint32_t i = 1; i < sensor_log_count; i++) {
+        float dt = (sensor_log[i].t_us - sensor_log[i - 1].t_us) * 1e-6f;
+        sensor_to_control(&sensor_log[i], dt, &in);
+        in.throttle = 0.5f;
+
+        uint32_t t0 = DWT->CYCCNT;
+        control_step(&in, &out);
+        uint32_t cyc = DWT->CYCCNT - t0;
+
+        total += cyc;
+        if (cyc > worst) {
+            worst = cyc;
+        }
+        // 逐步累积CRC: 上一次CRC与本次输出一起参与计算
+        memcpy(crc_buf, out.motor, sizeof(crc_buf));
+        crc_buf[0] ^= crc;
+        crc = flash_crc32(crc_buf, CONTROL_MOTOR_NUM);
+    }
+    control_reset();
+    printf("sensor bench: %lu steps, avg %lu cycles, max %lu cycles, output crc %08lX\n",
+           (unsigned long)(sensor_log_count - 1), (unsigned long)(total / (sensor_log_count - 1)),
+           (unsigned long)worst, (unsigned long)crc);
+}
+
+// 以十六进制逐条输出记录, 主机端按28字节定长解析
+static void sensor_dump(void){
+    for (uint32_t i = 0; i < sensor_log_count; i++) {
+        const uint8_t *p = (const uint8_t *)&sensor_log[i];
+        for (uint32_t j = 0; j < sizeof(sensor_record_t); j++) {
+            printf("%02X", p[j]);
+        }
+        printf("\n");
+    }
+}
+
+void sensor_cmd(int argc, void **argv){
+    static const char *mode_names[] = {"live", "record", "replay"};
+
+    if (argc < 1) {
+        printf("mode %s, %lu/%d records\n", mode_names[sensor_mode], (unsigned long)sensor_log_count,
+               SENSOR_LOG_LEN);
+        printf("Usage: sensor <rec|stop|play|bench|dump>\n");
+        return;
+    }
+    if (!strcmp(argv[0], "rec")) {
+        sensor_log_count = 0;
+        sensor_mode = SENSOR_RECORD;
+    } else if (!strcmp(argv[0], "stop")) {
+        sensor_mode = SENSOR_LIVE;
+    } else if (!strcmp(argv[0], "play")) {
+        sensor_play_pos = 0;
+        sensor_mode = sensor_log_count ? SENSOR_REPLAY : SENSOR_LIVE;
+    } else if (!strcmp(argv[0], "bench")) {
+        sensor_bench();
+        return;
+    } else if (!strcmp(argv[0], "dump")) {
+        sensor_dump();
+        return;
+    }
+    printf("sensor %s\n", mode_names[sensor_mode]);
+}
+
+ENV_EXPORT(sensor, sensor_cmd);
@@ -0,0 +1,34 @@
+#ifndef __SENSOR_H
+#define __SENSOR_H
+
+#include <stdint.h>
+#include "control.h"
+#include <rc_parse.h>
+
+// 传感器采样记录, 28字节定长; 实时数据同样先编码成记录再使用,
+// 因此回放时估计/控制看到的输入与录制时逐位相同.
+typedef struct {
+    uint32_t t_us;     // 时间戳 (us)
+    int16_t gyro[3];   // 陀螺仪原始值, ±2000dps, 16.4 LSB/(deg/s)
+    int16_t accel[3];  // 加速度计原始值, ±2g, 16384 LSB/g
+    int16_t angle[3];  // DMP姿态 roll/pitch/yaw (0.01deg)
+    int16_t heading;   // 磁航向 (0.01deg)
+    int32_t alt_cm;    // 气压高度 (cm)
+} sensor_record_t;
+
+#define SENSOR_GYRO_LSB  16.4f
+#define SENSOR_ACCEL_LSB 16384.0f
+#define SENSOR_LOG_LEN   256 // 录制缓冲区记录数, 100Hz下约2.5s
+
+typedef enum {
+    SENSOR_LIVE = 0, // 读取实际传感器
+    SENSOR_RECORD,   // 读取实际传感器并录制
+    SENSOR_REPLAY    // 按顺序回放录制的数据
+} sensor_mode_t;
+
+int sensor_update(sensor_record_t *rec);
+sensor_mode_t sensor_get_mode(void);
+void sensor_to_control(const sensor_record_t *rec, float dt, control_input_t *in);
+void rc_to_control(const rc_frame_t *f, control_input_t *in);
+
+#endif
@@ -0,0 +1,361 @@
+#include "main.h"
+#include "telem.h"
+#include "link.h"
+#include "scope.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 遥测调度, 格式见telem.h
+// telem_poll在主循环中运行: 补充令牌, 上一块发完后把到期的帧拼成新的一块交给DMA;
+// 同时统计主循环频率和最长一圈耗时, 由循环流发出.
+// 链路协商 (link.c) 的控制帧排在每块最前面; 要切换波特率时停发遥测,
+// 等应答发完再切换. 变量示波 (scope.c) 的样本排在所有流之后, 用剩下的链路带宽.
+
+PARAM_U32(PARAM_TELEM_RATE_HZ, telem_rate_hz, 0, 200, 50); // 姿态流频率 (Hz), 0为关闭
+PARAM_U32(PARAM_TELEM_BATT_HZ, telem_batt_hz, 0, 50, 5);   // 电池流
+PARAM_U32(PARAM_TELEM_LOOP_HZ, telem_loop_hz, 0, 50, 1);   // 循环统计流
+PARAM_U32(PARAM_TELEM_RC_HZ, telem_rc_hz, 0, 100, 10);     // 遥控状态流
+PARAM_FLOAT(PARAM_VBAT_SCALE, vbat_scale, 0.0f, 100.0f, 2.2156f); // 电池电压 (mV/计数), 11:1分压, 14位结果
+PARAM_FLOAT(PARAM_CURR_SCALE, curr_scale, 0.0f, 1000.0f, 0.0f);   // 电流 (mA/计数), 0为未接电流计
+
+#define TELEM_OVERHEAD 4 // 地址 + 长度 + 类型 + CRC
+#define TELEM_RX_SIZE  64
+
+typedef struct {
+    const char *name;
+    uint16_t rate_id;     // 频率参数
+    uint8_t type;
+    uint8_t len;          // 负载字节数
+    void (*encode)(uint8_t *p);
+} telem_stream_t;
+
+typedef struct {
+    float tokens;         // 字节
+    float overflow;       // 桶满后溢出的字节, 满一帧记一次丢弃
+    uint32_t sent, dropped;
+    uint32_t win_bytes, bps;
+} telem_state_t;
+
+static void telem_attitude(uint8_t *p);
+static void telem_battery(uint8_t *p);
+static void telem_loop(uint8_t *p);
+static void telem_rc(uint8_t *p);
+
+// 按优先级从高到低排列
+static const telem_stream_t telem_streams[] = {
+    {"att", PARAM_TELEM_RATE_HZ, 0x1E, 6, telem_attitude},
+    {"rc", PARAM_TELEM_RC_HZ, 0xA1, 12, telem_rc},
+    {"batt", PARAM_TELEM_BATT_HZ, 0x08, 8, telem_battery},
+    {"loop", PARAM_TELEM_LOOP_HZ, 0xA0, 7, telem_loop},
+};
+#define TELEM_STREAM_NUM (sizeof(telem_streams) / sizeof(telem_streams[0]))
+
+static telem_state_t telem_state[TELEM_STREAM_NUM];
+static DMA_BUFFER uint8_t telem_buf[TELEM_BUF_SIZE];
+static float telem_link_tokens;
+static uint8_t telem_started;
+static uint32_t telem_last_cyc, telem_win_cyc;
+static uint32_t telem_win_bytes, telem_load_pct, telem_blocks;
+static uint32_t telem_loops, telem_loop_hz_now, telem_gap_max_us, telem_loop_max_us;
+static uint64_t telem_charge;      // 已用电量 (mA*us)
+static uint32_t telem_ms, telem_us_frac; // 由DWT累加的毫秒时间
+static link_t telem_link;
+static uint8_t telem_rx_buf[TELEM_RX_SIZE];
+static uint32_t telem_rx_err_seen;
+
+// 协商时提供的高速速率, 当前APB时钟下误差超过1%的不提供
+static const uint32_t telem_rate_candidates[] = {4000000, 3000000, 2000000, 1000000};
+
+static void telem_be16(uint8_t *p, uint32_t v){
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static int16_t telem_rad4(float deg){
+    float v = deg * (3.14159265f / 180.0f) * 10000.0f;
+    return (int16_t)(v + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+static uint32_t telem_current_ma(void){
+    return (uint32_t)(adc1_read(ADC1_CH_CURRENT) * param_get_f(PARAM_CURR_SCALE));
+}
+
+static void telem_attitude(uint8_t *p){
+    telem_be16(&p[0], (uint16_t)telem_rad4(pitch));
+    telem_be16(&p[2], (uint16_t)telem_rad4(roll));
+    telem_be16(&p[4], (uint16_t)telem_rad4(yaw));
+}
+
+static void telem_battery(uint8_t *p){
+    uint32_t mv = (uint32_t)(adc1_read(ADC1_CH_VBAT) * param_get_f(PARAM_VBAT_SCALE));
+    uint32_t mah = (uint32_t)(telem_charge / 3600000000ULL);
+
+    telem_be16(&p[0], mv / 100);
+    telem_be16(&p[2], telem_current_ma() / 100);
+    p[4] = (uint8_t)(mah >> 16);
+    p[5] = (uint8_t)(mah >> 8);
+    p[6] = (uint8_t)mah;
+    p[7] = 0;                      // 未配置电池容量
+}
+
+static void telem_loop(uint8_t *p){
+    p[0] = (uint8_t)(telem_loop_hz_now >> 24);
+    p[1] = (uint8_t)(telem_loop_hz_now >> 16);
+    telem_be16(&p[2], telem_loop_hz_now);
+    telem_be16(&p[4], telem_loop_max_us > 0xFFFF ? 0xFFFF : telem_loop_max_us);
+    p[6] = (uint8_t)telem_load_pct;
+}
+
+static void telem_rc(uint8_t *p){
+    rc_frame_t f;
+    int ok = (rc_get(&f) == 0);
+    uint32_t age = f.seq ? (DWT->CYCCNT - f.t_cyc) / (SystemCoreClock / 1000) : 0xFFFF;
+
+    p[0] = ok ? 1 : 0;
+    p[1] = f.lq;
+    telem_be16(&p[2], age > 0xFFFF ? 0xFFFF : age);
+    for (int i = 0; i < 4; i++) {
+        telem_be16(&p[4 + i * 2], f.seq ? f.ch[i] : 0);
+    }
+}
+
+// 按经过的时间补充各令牌桶, 并更新循环和电量统计
+static void telem_refill(uint32_t us){
+    float dt = us * 1e-6f;
+    float link = uart3.BaudRate / 10 * (TELEM_LINK_PCT / 100.0f);
+
+    telem_link_tokens += link * dt;
+    if (telem_link_tokens > TELEM_BUF_SIZE) {
+        telem_link_tokens = TELEM_BUF_SIZE;
+    }
+
+    for (uint32_t i = 0; i < TELEM_STREAM_NUM; i++) {
+        telem_state_t *s = &telem_state[i];
+        float flen = telem_streams[i].len + TELEM_OVERHEAD;
+        uint32_t hz = param_get_u(telem_streams[i].rate_id);
+
+        if (hz == 0) {
+            s->tokens = 0.0f;
+            continue;
+        }
+        s->tokens += hz * flen * dt;
+        if (s->tokens > TELEM_BURST * flen) {
+            s->overflow += s->tokens - TELEM_BURST * flen;
+            s->tokens = TELEM_BURST * flen;
+            while (s->overflow >= flen) {
+                s->overflow -= flen;
+                s->dropped++;
+            }
+        }
+    }
+
+    telem_charge += (uint64_t)telem_current_ma() * us;
+}
+
+// 把到期的帧接在n字节之后拼成一块, 返回总字节数
+static uint32_t telem_pack(uint32_t n){
+
+    for (uint32_t i = 0; i < TELEM_STREAM_NUM; i++) {
+        const telem_stream_t *st = &telem_streams[i];
+        telem_state_t *s = &telem_state[i];
+        uint32_t flen = st->len + TELEM_OVERHEAD;
+
+        if (s->tokens < flen) {
+            continue;
+        }
+        // 链路带宽不够时不跳过去发低优先级的帧, 等下一轮
+        if (telem_link_tokens < flen || n + flen > TELEM_BUF_SIZE) {
+            return n;
+        }
+        uint8_t payload[16];
+        st->encode(payload);
+        n += link_frame(&telem_buf[n], st->type, payload, st->len);
+        s->tokens -= flen;
+        s->sent++;
+        s->win_bytes += flen;
+        telem_link_tokens -= flen;
+    }
+
+    uint32_t m;
+    do {
+        uint32_t max = (telem_link_tokens > 0.0f) ? (uint32_t)telem_link_tokens : 0; // 控制帧可能把令牌扣成负数
+        if (max > TELEM_BUF_SIZE - n) {
+            max = TELEM_BUF_SIZE - n;
+        }
+        m = scope_pack(&telem_buf[n], max);
+        n += m;
+        telem_link_tokens -= m;
+    } while (m > 0);
+    return n;
+}
+
+static void telem_link_init(void){
+    uint32_t rates[LINK_RATE_MAX];
+    uint8_t n = 0;
+
+    for (uint32_t i = 0; i < sizeof(telem_rate_candidates) / sizeof(telem_rate_candidates[0]); i++) {
+        uint32_t want = telem_rate_candidates[i];
+        uint32_t real = uart_calc_baud(UART_PORT_3, want);
+        uint32_t err = (real > want) ? real - want : want - real;
+        if (real != 0 && err * 100 <= want && n < LINK_RATE_MAX) {
+            rates[n++] = want;
+        }
+    }
+    link_init(&telem_link, rates, n, telem_ms);
+    telem_link.app = scope_link_frame;
+    if (uart3.UART_Init_Flag) {
+        uart_rx_start(UART_PORT_3, telem_rx_buf, TELEM_RX_SIZE, 1);
+    }
+}
+
+// 处理主机发来的字节, 检查超时和错误率
+static void telem_link_poll(void){
+    uint8_t d[16];
+    uint32_t n;
+
+    while ((n = uart_read(UART_PORT_3, d, sizeof(d))) > 0) {
+        link_input(&telem_link, d, n, telem_ms);
+    }
+    uint32_t err = uart_rx_errors(UART_PORT_3);
+    link_rx_error(&telem_link, err - telem_rx_err_seen);
+    telem_rx_err_seen = err;
+
+    uint8_t state = telem_link.state;
+    link_tick(&telem_link, telem_ms);
+    if (telem_link.state != state && telem_link.pending == LINK_SAFE_BAUD) {
+        DLOG("telem link fallback from %u baud\n", telem_link.baud);
+    }
+}
+
+// 主循环中调用; 返回1表示有一块正在发送
+int telem_poll(void){
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    uint32_t mhz = SystemCoreClock / 1000000;
+    uint32_t cyc = DWT->CYCCNT;
+    if (!telem_started) {
+        telem_started = 1;
+        telem_last_cyc = telem_win_cyc = cyc;
+        telem_link_init();
+    }
+    uint32_t us = (cyc - telem_last_cyc) / mhz;
+    telem_last_cyc = cyc - (cyc - telem_last_cyc) % mhz;
+    telem_us_frac += us;
+    telem_ms += telem_us_frac / 1000;
+    telem_us_frac %= 1000;
+
+    telem_loops++;
+    if (us > telem_gap_max_us) {
+        telem_gap_max_us = us;
+    }
+    if (cyc - telem_win_cyc >= SystemCoreClock) {
+        uint32_t link = uart3.BaudRate / 10;
+        telem_win_cyc += SystemCoreClock;
+        telem_loop_hz_now = telem_loops;
+        telem_loop_max_us = telem_gap_max_us;
+        telem_load_pct = link ? telem_win_bytes * 100 / link : 0;
+        telem_loops = telem_gap_max_us = telem_win_bytes = 0;
+        for (uint32_t i = 0; i < TELEM_STREAM_NUM; i++) {
+            telem_state[i].bps = telem_state[i].win_bytes;
+            telem_state[i].win_bytes = 0;
+        }
+    }
+
+    telem_refill(us);
+    if (!uart3.UART_Init_Flag) {
+        return 0;
+    }
+    telem_link_poll();
+
+    if (uart_dma_busy(UART_PORT_3)) {
+        return 1;
+    }
+    // 应答已发完, 切换波特率 (等最后一个字节移出)
+    if (telem_link.pending && telem_link.tx_len == 0) {
+        if (uart_set_baud(UART_PORT_3, telem_link.pending) == 0) {
+            uart3.BaudRate = telem_link.pending;
+            link_baud_done(&telem_link, telem_ms);
+            DLOG("telem link %u baud\n", uart3.BaudRate);
+        }
+        return 0;
+    }
+    uint32_t n = link_take_tx(&telem_link, telem_buf, TELEM_BUF_SIZE);
+    telem_link_tokens -= n;
+    if (!telem_link.pending) {
+        n = telem_pack(n);
+    }
+    if (n == 0) {
+        return 0;
+    }
+    uart_dma_send(UART_PORT_3, telem_buf, (uint16_t)n);
+    telem_win_bytes += n;
+    telem_blocks++;
+    return 1;
+}
+
+static const telem_stream_t *telem_find(const char *name, uint32_t *idx){
+    for (uint32_t i = 0; i < TELEM_STREAM_NUM; i++) {
+        if (!strcmp(telem_streams[i].name, name)) {
+            *idx = i;
+            return &telem_streams[i];
+        }
+    }
+    return NULL;
+}
+
+void telem_cmd(int argc, void **argv){
+    uint32_t idx;
+
+    if (argc >= 2) {
+        const telem_stream_t *st = telem_find(argv[0], &idx);
+        param_value_t v = {.u = (uint32_t)atoi((char *)argv[1])};
+        if (st == NULL || param_set(st->rate_id, v) != 0) {
+            printf("telem: bad stream or rate\n");
+            return;
+        }
+        telem_state[idx].tokens = 0.0f;
+        telem_state[idx].overflow = 0.0f;
+    }
+
+    printf("telem link %lu B/s (%d%% usable), load %lu%%, blocks %lu, loop %lu Hz, worst %lu us\n",
+           (unsigned long)(uart3.BaudRate / 10), TELEM_LINK_PCT, (unsigned long)telem_load_pct,
+           (unsigned long)telem_blocks, (unsigned long)telem_loop_hz_now, (unsigned long)telem_loop_max_us);
+    for (uint32_t i = 0; i < TELEM_STREAM_NUM; i++) {
+        const telem_stream_t *st = &telem_streams[i];
+        const telem_state_t *s = &telem_state[i];
+        printf("  %-5s %3lu Hz  %5lu B/s  sent %lu  dropped %lu\n", st->name,
+               (unsigned long)param_get_u(st->rate_id), (unsigned long)s->bps, (unsigned long)s->sent,
+               (unsigned long)s->dropped);
+    }
+    if (argc < 2) {
+        printf("Usage: telem <att|rc|batt|loop> <hz>\n");
+    }
+}
+
+ENV_EXPORT(telem, telem_cmd);
+
+void link_cmd(int argc, void **argv){
+    const link_t *l = &telem_link;
+
+    if (argc >= 1 && !strcmp(argv[0], "safe")) {
+        link_fallback(&telem_link, telem_ms);
+    }
+    printf("link %s, %lu baud (actual %lu), load %lu%% of %lu B/s\n", link_state_name(l->state),
+           (unsigned long)l->baud, (unsigned long)uart_get_baud(UART_PORT_3), (unsigned long)telem_load_pct,
+           (unsigned long)(uart3.BaudRate / 10));
+    printf("rx frames %lu, crc errors %lu, sync errors %lu, uart errors %lu\n", (unsigned long)l->rx_frames,
+           (unsigned long)l->crc_errors, (unsigned long)l->sync_errors, (unsigned long)telem_rx_err_seen);
+    printf("switches %lu, fallbacks %lu, rates", (unsigned long)l->switches, (unsigned long)l->fallbacks);
+    for (uint8_t i = 0; i < l->rate_num; i++) {
+        printf(" %lu", (unsigned long)l->rates[i]);
+    }
+    printf("\n");
+    if (argc < 1) {
+        printf("Usage: link [safe]\n");
+    }
+}
+
+ENV_EXPORT(link, link_cmd);
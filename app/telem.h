@@ -0,0 +1,31 @@
+#ifndef __TELEM_H
+#define __TELEM_H
+
+#include <stdint.h>
+
+// 遥测下行: USART3按CRSF帧格式发送多个数据流, 各流发送频率由参数配置.
+//
+// 带宽调度:
+//   - 每个流一个令牌桶, 按 频率 x 帧长 累积字节, 攒够一帧即到期, 最多攒TELEM_BURST帧,
+//     溢出的部分记为丢弃 (链路忙或带宽不足时旧数据不补发, 下次发的是最新值)
+//   - 链路一个令牌桶, 按波特率/10的TELEM_LINK_PCT%累积, 上限为一个DMA块,
+//     所有流的总发送量不会超过链路能力
+//   - 流按优先级排列, 最高优先级的到期流链路令牌不够时整轮停止, 低优先级流不会抢占它的带宽
+//   - 同一轮到期的帧首尾相接拼成一块, 上一块发完后由DMA整块发送
+//   - 波特率由主机协商 (link.h), 链路令牌按当前波特率累积
+//
+// 帧格式 (主机端解码见tools/telem_decode.c):
+//   0xC8 | 长度 (类型+负载+CRC) | 类型 | 负载 (大端) | CRC8 (多项式0xD5, 覆盖类型和负载)
+//   0x1E 姿态   pitch, roll, yaw         int16, rad x 10000
+//   0x08 电池   电压 (0.1V) u16, 电流 (0.1A) u16, 已用容量 (mAh) u24, 剩余 (%) u8 (未测量为0)
+//   0xA0 循环   主循环频率 (Hz) u32, 最长一圈 (us) u16, 链路占用 (%) u8       (自定义)
+//   0xA1 遥控   标志 (bit0有效) u8, LQ (%) u8, 帧龄 (ms) u16, 前4通道原始值 u16 x 4 (自定义)
+//   0xA2 示波   见scope.h, 不按频率发送, 有样本且链路有余量就发                    (自定义)
+
+#define TELEM_BUF_SIZE 128 // DMA块字节数
+#define TELEM_BURST    2   // 每个流最多积攒的帧数
+#define TELEM_LINK_PCT 90  // 调度占用的链路带宽比例 (%)
+
+int telem_poll(void);
+
+#endif
@@ -1,5 +1,7 @@
 #include "driver.h"
 #include "df_adc.h"
+#include <stdlib.h>
+#include <string.h>
 
 extern At adc1;
 
@@ -7,25 +9,133 @@ extern At adc1;
  * STM32F407 ADC1驱动程序
  *
  * 硬件配置:
- *   - GPIO引脚: PB1
- *   - ADC通道: ADC1_IN9 / ADC2_IN9 (此处使用ADC1)
- *   - 转换模式: 连续转换模式 (Continuous Conversion Mode)
- *   - 中断: 不使用中断，采用轮询方式读取
- *   - 分辨率: 12位 (0-4095)
- *   - 采样时间: 480个ADC时钟周期 (最高精度)
+ *   - GPIO引脚: PB1 (电池电压), PB0 (电流), PC1 (备用)
+ *   - ADC通道: ADC1_IN9, ADC1_IN8, ADC1_IN11
+ *   - 转换模式: 扫描 + 连续转换模式 (默认), PWM同步采样时为扫描 + TIM1触发
+ *   - 数据传输: DMA2 Stream0 Channel0, 循环模式, 半传输/传输完成中断
+ *   - 分辨率: 12位 (0-4095), 过采样后为 12 + ADC_OVERSAMPLE_SHIFT 位
+ *   - 采样时间: 连续转换时480个ADC时钟周期 (最高精度), PWM同步采样时56个
+ *   - ADC时钟: APB2 / 4 = 21MHz (不超过36MHz上限)
+ *
+ * 双缓冲:
+ *   - DMA缓冲区分为前后两半, 每半包含 ADC_OVERSAMPLE 轮完整扫描
+ *   - DMA写后一半时CPU处理前一半 (半传输中断), 反之亦然 (传输完成中断)
+ *   - 每半缓冲区对每个通道求和后抽取为一个结果, CPU直接读取无需轮询
+ *
+ * PWM同步采样 (adc1_set_trigger):
+ *   - 关闭连续转换, 由TIM1_CC1事件 (EXTSEL=0000) 上升沿触发一次完整扫描
+ *   - 每个PWM周期恰好一次扫描, DMA位置即可换算出周期号, 无需逐周期中断
+ *   - 采样时间改为56周期, 3通道扫描约9.7us, 32kHz PWM下仍可在一个周期内完成
+ *   - 上电时按参数PARAM_ADC_PHASE选择 (0为连续转换), 也可用 adc sync 命令切换
+ *
+ * 溢出恢复:
+ *   - DMA没来得及取走DR时ADC置OVR并停止DMA请求, 不处理则结果永久冻结
+ *   - OVR中断 (及DMA传输错误) 中重新装载DMA再重启转换, 周期号跳到下一轮,
+ *     保持单调, 中间丢失的周期不会被误认为新样本
  *
  * ADC通道与GPIO映射关系 (STM32F407):
- *   - ADC123_IN9: PB1
- *   - ADC12表示该通道同时属于ADC1和ADC2
+ *   - ADC12_IN8: PB0
+ *   - ADC12_IN9: PB1
+ *   - ADC123_IN11: PC1
  ******************************************************************************/
 
 /* ADC通道定义 */
-#define ADC_CHANNEL_9 9    /* PB1对应的ADC通道号 */
+#define ADC_CHANNEL_8  8   /* PB0对应的ADC通道号 */
+#define ADC_CHANNEL_9  9   /* PB1对应的ADC通道号 */
+#define ADC_CHANNEL_11 11  /* PC1对应的ADC通道号 */
 #define ADC_SAMPLE_480 0x7 /* 480个周期采样时间 (最高精度) */
+#define ADC_SAMPLE_56  0x3 /* 56个周期采样时间 (PWM同步采样) */
+
+/* 外部触发配置 (CR2) */
+#define ADC_EXTSEL_TIM1_CC1 (0x0 << 24) /* 规则组触发源: TIM1_CC1 */
+#define ADC_EXTEN_RISING    (0x1 << 28) /* 上升沿触发 */
+
+#define ADC_PHASE_DEFAULT (PWM_MAX_DUTY / 4) /* 默认采样相位: 25%油门导通段中点附近 */
+
+/* 过采样/抽取配置
+ * - ADC_OVERSAMPLE: 每个输出结果累加的原始样本数
+ * - ADC_OVERSAMPLE_SHIFT: 累加和右移位数, 移位数小于log2(ADC_OVERSAMPLE)时
+ *   保留额外分辨率 (每4倍过采样可多得1位)
+ */
+#define ADC_OVERSAMPLE       16
+#define ADC_OVERSAMPLE_SHIFT 2 /* 16次累加右移2位 = 14位结果 */
+
+#define ADC_HALF_LEN (ADC1_CH_NUM * ADC_OVERSAMPLE) /* 半缓冲区长度 */
+
+/* 扫描序列: 下标即 adc1_ch_t */
+static const uint8_t adc1_seq[ADC1_CH_NUM] = {
+    ADC_CHANNEL_9,  /* ADC1_CH_VBAT */
+    ADC_CHANNEL_8,  /* ADC1_CH_CURRENT */
+    ADC_CHANNEL_11, /* ADC1_CH_SPARE */
+};
+
+static DMA_BUFFER uint16_t adc1_dma_buf[2 * ADC_HALF_LEN]; /* DMA双缓冲, 须在SRAM1 */
+static CCM_FILTER volatile uint16_t adc1_result[ADC1_CH_NUM];
+static volatile uint32_t adc1_update_cnt;
+
+static uint8_t adc1_pwm_sync = 0;        /* PWM同步采样标志 */
+static volatile uint32_t adc1_wraps;     /* DMA缓冲区回绕次数 */
+static CCM_FILTER volatile adc1_sample_t adc1_last; /* 最近一个PWM周期的样本 */
+static volatile uint32_t adc1_power;     /* 半缓冲区内 V*I 的平均值 (原始值乘积) */
+static volatile uint32_t adc1_overruns;  /* OVR/DMA错误恢复次数 */
+
+PARAM_U32(PARAM_ADC_PHASE, adc_phase, 0, PWM_MAX_DUTY - 1, 0); /* PWM同步采样相位 (占空比单位), 0为连续转换 */
+
+/**
+ * @brief  设置通道采样时间
+ * @param  ch: ADC通道号 (0-18)
+ * @param  smp: 采样时间编码 (0-7)
+ */
+static void ADC1_Set_Sample_Time(uint8_t ch, uint32_t smp)
+{
+    /* SMPR2控制通道0-9, SMPR1控制通道10-18, 每通道3位 */
+    if (ch < 10)
+    {
+        ADC1->SMPR2 &= ~(0x7 << (ch * 3));
+        ADC1->SMPR2 |= (smp << (ch * 3));
+    }
+    else
+    {
+        ADC1->SMPR1 &= ~(0x7 << ((ch - 10) * 3));
+        ADC1->SMPR1 |= (smp << ((ch - 10) * 3));
+    }
+}
+
+/**
+ * @brief  DMA2 Stream0初始化
+ * @note   外设到存储器, 半字, 存储器地址递增, 循环模式
+ * @note   每次重新初始化都从缓冲区起点开始, 周期号随之清零
+ */
+static void ADC1_DMA_Init(void)
+{
+    adc1_wraps = 0;
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN)
+        ; /* 等待数据流真正关闭 */
+
+    /* 清除Stream0全部标志 */
+    DMA2->LIFCR = DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+
+    DMA2_Stream0->PAR = (uint32_t)(uintptr_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)(uintptr_t)adc1_dma_buf;
+    DMA2_Stream0->NDTR = 2 * ADC_HALF_LEN;
+
+    /* CHSEL=0 (ADC1), PSIZE/MSIZE=16位, MINC, CIRC, HT/TC中断, 高优先级 */
+    DMA2_Stream0->CR = DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 | DMA_SxCR_MINC |
+                       DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE |
+                       DMA_SxCR_PL_1;
+    DMA2_Stream0->FCR = 0; /* 直接模式 */
+
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+}
 
 /**
  * @brief  ADC1初始化函数
- * @note   配置PB1为模拟输入，ADC1通道9，连续转换模式
+ * @note   配置扫描序列, DMA循环传输, 初始化完成后立即开始转换
  * @param  arg: 设备参数 (未使用)
  * @retval 0: 成功
  */
@@ -36,81 +146,67 @@ int adc1_init(dev_arg_t arg)
     /***************************************************************************
      * 步骤1: 使能时钟
      * - ADC1挂载在APB2总线上，需要使能APB2上的ADC1时钟
-     * - PB1属于GPIOB，需要使能AHB1总线上的GPIOB时钟
+     * - PB0/PB1属于GPIOB, PC1属于GPIOC
      ***************************************************************************/
-    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;  /* 使能ADC1时钟 */
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN; /* 使能GPIOB时钟 */
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;                         /* 使能ADC1时钟 */
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN | RCC_AHB1ENR_GPIOCEN; /* 使能GPIO时钟 */
 
     /***************************************************************************
-     * 步骤2: 配置GPIO - PB1为模拟输入模式
-     * - MODER寄存器每2位控制一个引脚
-     * - PB1对应MODER[3:2]
-     * - 模拟模式值为0x3 (11b)
-     * - 模拟输入模式下，不需要配置上下拉电阻
+     * 步骤2: 配置GPIO为模拟输入模式 (MODER = 11b)
      ***************************************************************************/
-    GPIOB->MODER &= ~(0x3 << (1 * 2)); /* 先清除PB1的MODER位 */
-    GPIOB->MODER |= (0x3 << (1 * 2));  /* 设置PB1为模拟模式 (0x3 = 11b) */
+    GPIOB->MODER |= (0x3 << (0 * 2)) | (0x3 << (1 * 2)); /* PB0, PB1 */
+    GPIOC->MODER |= (0x3 << (1 * 2));                    /* PC1 */
 
     /***************************************************************************
      * 步骤3: 配置ADC1
      ***************************************************************************/
 
     /* 3.1 关闭ADC以便进行配置 (ADON = 0) */
-    ADC1->CR2 &= ~ADC_CR2_ADON;
+    ADC1->CR2 &= ~(ADC_CR2_ADON | ADC_CR2_DMA | ADC_CR2_DDS);
 
-    /* 3.2 配置ADC分辨率为12位 (RES[1:0] = 00)
-     * - 00: 12位分辨率 (15个ADC时钟周期)
-     * - 01: 10位分辨率 (13个ADC时钟周期)
-     * - 10: 8位分辨率  (11个ADC时钟周期)
-     * - 11: 6位分辨率  (9个ADC时钟周期)
-     */
-    ADC1->CR1 &= ~ADC_CR1_RES; /* 清除RES位，设置12位分辨率 */
+    /* 3.2 ADC时钟4分频: 84MHz / 4 = 21MHz */
+    ADC->CCR &= ~ADC_CCR_ADCPRE;
+    ADC->CCR |= ADC_CCR_ADCPRE_0;
 
-    /* 3.3 配置为连续转换模式 (CONT = 1)
-     * - CONT = 0: 单次转换模式，每次触发只转换一次
-     * - CONT = 1: 连续转换模式，转换完成后自动开始下一次转换
-     * 连续转换模式下，只需触发一次，ADC会持续不断地进行转换
-     */
-    ADC1->CR2 |= ADC_CR2_CONT; /* 使能连续转换模式 */
+    /* 3.3 12位分辨率, 扫描模式, 溢出中断 */
+    ADC1->CR1 &= ~ADC_CR1_RES;
+    ADC1->CR1 |= ADC_CR1_SCAN | ADC_CR1_OVRIE;
 
-    /* 3.4 配置数据对齐方式为右对齐 (ALIGN = 0)
-     * - ALIGN = 0: 右对齐 (常用)
-     * - ALIGN = 1: 左对齐
-     */
-    ADC1->CR2 &= ~ADC_CR2_ALIGN; /* 右对齐 */
-
-    /* 3.5 配置ADC通道9的采样时间
-     * - SMPR1寄存器控制通道10-18
-     * - SMPR2寄存器控制通道0-9
-     * - 通道9在SMPR2中，位置为SMP9[2:0]，即bit[29:27]
-     * - 采样时间值: 0x7 = 480个周期 (最高精度，适合高阻抗信号源)
-     *
-     * 采样时间选择说明:
-     *   000: 3个周期    001: 15个周期   010: 28个周期   011: 56个周期
-     *   100: 84个周期   101: 112个周期  110: 144个周期  111: 480个周期
-     */
-    ADC1->SMPR2 &= ~(0x7 << (ADC_CHANNEL_9 * 3));           /* 清除通道9采样时间位 */
-    ADC1->SMPR2 |= (ADC_SAMPLE_480 << (ADC_CHANNEL_9 * 3)); /* 设置480周期采样 */
+    /* 3.4 连续转换, 右对齐 */
+    ADC1->CR2 |= ADC_CR2_CONT;
+    ADC1->CR2 &= ~ADC_CR2_ALIGN;
 
-    /* 3.6 配置规则通道转换序列
-     * - SQR1的L[3:0]位 (bit[23:20]) 设置转换序列长度
-     * - L = 0 表示1次转换，L = 1 表示2次转换，以此类推
-     * - SQR3的SQ1[4:0]位 (bit[4:0]) 设置第1个转换的通道号
+    /* 3.5 各通道采样时间和规则序列
+     * - SQR1的L[3:0]为序列长度-1
+     * - SQR3依次存放SQ1~SQ6, 每个5位
      */
-    ADC1->SQR1 &= ~ADC_SQR1_L;  /* 清除L位，设置转换序列长度为1 */
-    ADC1->SQR3 = ADC_CHANNEL_9; /* 第1个转换序列设置为通道9 */
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR1 |= (ADC1_CH_NUM - 1) << 20;
+    ADC1->SQR3 = 0;
+    for (uint8_t i = 0; i < ADC1_CH_NUM; i++)
+    {
+        ADC1_Set_Sample_Time(adc1_seq[i], ADC_SAMPLE_480);
+        ADC1->SQR3 |= (uint32_t)adc1_seq[i] << (i * 5);
+    }
+
+    /* 3.6 DMA: 每次转换产生DMA请求, DDS=1使最后一次传输后继续请求 */
+    ADC1_DMA_Init();
+    ADC1->CR2 |= ADC_CR2_DMA | ADC_CR2_DDS;
 
     /***************************************************************************
      * 步骤4: 启动ADC
-     * - 设置ADON位为1，打开ADC电源
-     * - 注意: 首次设置ADON后需等待稳定时间 (约1us)
      ***************************************************************************/
     ADC1->CR2 |= ADC_CR2_ADON; /* 使能ADC1 */
 
     /* 更新初始化标志 */
     adc1.ADC_Init_Flag = true;
 
-    return 0;
+    /* PWM已在此前初始化, 可直接切到TIM1_CC1触发 */
+    if (param_get_u(PARAM_ADC_PHASE) != 0)
+    {
+        return adc1_set_trigger(1, (uint16_t)param_get_u(PARAM_ADC_PHASE));
+    }
+    return adc1_enable(arg);
 }
 
 /**
@@ -127,15 +223,19 @@ int adc1_enable(dev_arg_t arg)
      * - SWSTART位为1时触发转换
      * - 在连续模式下，此触发后ADC会持续进行转换
      * - 该位由硬件自动清零
+     * - PWM同步模式下由TIM1_CC1触发, 不需要软件启动
      */
-    ADC1->CR2 |= ADC_CR2_SWSTART;
+    if (!adc1_pwm_sync)
+    {
+        ADC1->CR2 |= ADC_CR2_SWSTART;
+    }
 
     return 0;
 }
 
 /**
  * @brief  停止并关闭ADC1
- * @note   清除ADON位关闭ADC电源
+ * @note   清除ADON位关闭ADC电源, 同时关闭DMA数据流
  * @param  arg: 设备参数 (未使用)
  * @retval 0: 成功
  */
@@ -145,6 +245,7 @@ int adc1_disable(dev_arg_t arg)
 
     /* 关闭ADC1电源 */
     ADC1->CR2 &= ~ADC_CR2_ADON;
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
 
     /* 更新初始化标志 */
     adc1.ADC_Init_Flag = false;
@@ -153,35 +254,242 @@ int adc1_disable(dev_arg_t arg)
 }
 
 /**
- * @brief  获取ADC1转换值 (轮询方式)
- * @note   连续转换模式下，直接读取DR寄存器即可获取最新值
- *         读取DR寄存器会自动清除EOC标志
- * @param  arg: 设备参数，用于返回ADC值
- *              arg.us32 将被设置为ADC转换结果 (0-4095)
+ * @brief  抽取半个缓冲区
+ * @param  half: 0-前半, 1-后半
+ * @note   PWM同步模式下同时计算逐周期功率并记录最后一次扫描的周期号
+ */
+static void ADC1_Decimate(uint8_t half)
+{
+    const uint16_t *buf = &adc1_dma_buf[half * ADC_HALF_LEN];
+    uint32_t sum[ADC1_CH_NUM] = {0};
+    uint32_t power = 0;
+
+    for (uint16_t n = 0; n < ADC_HALF_LEN; n += ADC1_CH_NUM)
+    {
+        for (uint8_t ch = 0; ch < ADC1_CH_NUM; ch++)
+        {
+            sum[ch] += buf[n + ch];
+        }
+        power += (uint32_t)buf[n + ADC1_CH_VBAT] * buf[n + ADC1_CH_CURRENT] / ADC_OVERSAMPLE;
+    }
+    for (uint8_t ch = 0; ch < ADC1_CH_NUM; ch++)
+    {
+        adc1_result[ch] = (uint16_t)(sum[ch] >> ADC_OVERSAMPLE_SHIFT);
+    }
+
+    if (adc1_pwm_sync)
+    {
+        const uint16_t *last = &buf[ADC_HALF_LEN - ADC1_CH_NUM];
+        adc1_last.period = adc1_wraps * (2 * ADC_OVERSAMPLE) + (half + 1) * ADC_OVERSAMPLE - 1;
+        for (uint8_t ch = 0; ch < ADC1_CH_NUM; ch++)
+        {
+            adc1_last.value[ch] = last[ch];
+        }
+        adc1_power = power;
+    }
+    adc1_update_cnt++;
+}
+
+/**
+ * @brief  OVR或DMA错误后重启采集
+ * @note   ADC置OVR后不再发DMA请求, 须重新装载DMA, 清OVR, 再重置DMA位;
+ *         周期号跳到下一轮起点, 与丢失前的样本保持先后顺序
+ */
+static void ADC1_Recover(void)
+{
+    uint32_t wraps = adc1_wraps + 1;
+
+    ADC1->CR2 &= ~ADC_CR2_DMA;
+    ADC1_DMA_Init();
+    adc1_wraps = wraps;
+    ADC1->SR = ~ADC_SR_OVR;
+    ADC1->CR2 |= ADC_CR2_DMA;
+    adc1_overruns++;
+    adc1_enable(arg_ptr(NULL));
+}
+
+/**
+ * @brief  ADC中断处理 (OVR)
+ */
+void adc1_isr(void)
+{
+    if (ADC1->SR & ADC_SR_OVR)
+    {
+        ADC1_Recover();
+    }
+}
+
+/**
+ * @brief  DMA2 Stream0中断处理
+ * @note   半传输: 前半可读; 传输完成: 后半可读
+ */
+void adc1_dma_isr(void)
+{
+    uint32_t isr = DMA2->LISR;
+
+    if (isr & DMA_LISR_HTIF0)
+    {
+        DMA2->LIFCR = DMA_LIFCR_CHTIF0;
+        ADC1_Decimate(0);
+    }
+    if (isr & DMA_LISR_TCIF0)
+    {
+        DMA2->LIFCR = DMA_LIFCR_CTCIF0;
+        ADC1_Decimate(1);
+        adc1_wraps++;
+    }
+    if (isr & DMA_LISR_TEIF0)
+    {
+        DMA2->LIFCR = DMA_LIFCR_CTEIF0;
+        ADC1_Recover(); /* 传输错误时数据流已被硬件关闭 */
+    }
+}
+
+/**
+ * @brief  读取通道最新的抽取结果
+ * @param  ch: 通道 (adc1_ch_t)
+ * @return 过采样结果 (12 + ADC_OVERSAMPLE_SHIFT 位), 通道非法时返回0
+ */
+uint16_t adc1_read(adc1_ch_t ch)
+{
+    if (ch >= ADC1_CH_NUM)
+    {
+        return 0;
+    }
+    return adc1_result[ch];
+}
+
+/**
+ * @brief  抽取结果更新计数
+ * @note   调用方可比较前后两次计数判断是否有新数据
+ */
+uint32_t adc1_update_count(void)
+{
+    return adc1_update_cnt;
+}
+
+/**
+ * @brief  切换ADC1触发方式
+ * @param  pwm_sync: 1-由TIM1_CC1逐PWM周期触发扫描, 0-软件启动连续转换
+ * @param  phase: PWM周期内的采样相位 (占空比单位, 见pwm_adc_trigger)
  * @retval 0: 成功, -1: ADC未初始化
+ * @note   切换时重新装载DMA, 周期号从0开始计数
  */
-int adc1_get_value(dev_arg_t arg)
+int adc1_set_trigger(uint8_t pwm_sync, uint16_t phase)
 {
-    /* 检查ADC是否已初始化 */
     if (!adc1.ADC_Init_Flag)
     {
         return -1;
     }
 
-    /* 等待转换完成 (轮询方式)
-     * - EOC (End of Conversion) 位在每次转换完成时被硬件置1
-     * - 读取DR寄存器后，EOC位会被自动清除
-     * - 在连续转换模式下，EOC位会周期性地被置位
-     */
-    while (!(ADC1->SR & ADC_SR_EOC))
-        ; /* 等待EOC标志置位 */
+    /* 停止转换后才能修改触发和连续模式 */
+    ADC1->CR2 &= ~(ADC_CR2_ADON | ADC_CR2_DMA);
+    ADC1->SR = 0;
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_EXTEN | ADC_CR2_EXTSEL);
 
-    /* 读取转换结果
-     * - DR寄存器存储12位转换结果 (0-4095)
-     * - 右对齐模式下，有效数据在低12位
-     * - 读取DR会自动清除EOC标志
-     */
-    arg.us32 = ADC1->DR;
+    for (uint8_t i = 0; i < ADC1_CH_NUM; i++)
+    {
+        ADC1_Set_Sample_Time(adc1_seq[i], pwm_sync ? ADC_SAMPLE_56 : ADC_SAMPLE_480);
+    }
+
+    adc1_pwm_sync = pwm_sync ? 1 : 0;
+    ADC1_DMA_Init();
+
+    if (adc1_pwm_sync)
+    {
+        ADC1->CR2 |= ADC_EXTSEL_TIM1_CC1 | ADC_EXTEN_RISING;
+        ADC1->CR2 |= ADC_CR2_DMA | ADC_CR2_ADON;
+        pwm_adc_trigger(1, phase);
+    }
+    else
+    {
+        pwm_adc_trigger(0, 0);
+        ADC1->CR2 |= ADC_CR2_CONT;
+        ADC1->CR2 |= ADC_CR2_DMA | ADC_CR2_ADON;
+        adc1_enable(arg_ptr(NULL));
+    }
+    return 0;
+}
+
+/**
+ * @brief  当前PWM周期号
+ * @note   PWM同步模式下每周期一次扫描, 由DMA剩余计数换算, 无需周期中断;
+ *         控制环在pwm_set_all时记录该值即可与采样结果对齐
+ */
+uint32_t adc1_period_count(void)
+{
+    uint32_t wraps, ndtr, tc;
+
+    do
+    {
+        wraps = adc1_wraps;
+        ndtr = DMA2_Stream0->NDTR;
+        tc = DMA2->LISR & DMA_LISR_TCIF0;
+    } while (wraps != adc1_wraps);
+
+    /* 已回绕但中断尚未处理: NDTR已重装而wraps未加 */
+    if (tc && ndtr > ADC_HALF_LEN)
+    {
+        wraps++;
+    }
+
+    return wraps * (2 * ADC_OVERSAMPLE) + (2 * ADC_HALF_LEN - ndtr) / ADC1_CH_NUM;
+}
+
+/**
+ * @brief  读取最近一个PWM周期的样本
+ * @param  sample: 输出, period为样本所属PWM周期号
+ * @retval 0: 成功, -1: 未工作在PWM同步模式
+ */
+int adc1_get_sample(adc1_sample_t *sample)
+{
+    if (!adc1_pwm_sync || sample == NULL)
+    {
+        return -1;
+    }
+
+    /* 与DMA中断互斥, 保证周期号和数据属于同一次扫描 */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *sample = adc1_last;
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+/**
+ * @brief  最近半缓冲区的平均功率
+ * @return 逐周期 V*I 原始值乘积的平均 (24位), 由调用方乘以分压和分流系数
+ */
+uint32_t adc1_read_power(void)
+{
+    return adc1_power;
+}
+
+/**
+ * @brief  OVR/DMA错误恢复次数
+ */
+uint32_t adc1_overrun_count(void)
+{
+    return adc1_overruns;
+}
+
+/**
+ * @brief  获取ADC1转换值 (电池电压通道)
+ * @note   直接返回最近一次抽取结果, 不等待转换
+ * @param  arg: arg.ptr 指向 uint32_t, 用于返回结果
+ * @retval 0: 成功, -1: ADC未初始化或参数为空
+ */
+int adc1_get_value(dev_arg_t arg)
+{
+    uint32_t *value = (uint32_t *)arg.ptr;
+
+    /* 检查ADC是否已初始化 */
+    if (!adc1.ADC_Init_Flag || value == NULL)
+    {
+        return -1;
+    }
+
+    *value = adc1_result[ADC1_CH_VBAT];
 
     return 0;
 }
@@ -197,3 +505,49 @@ At adc1 = {
     .init = adc1_init,
     .deinit = adc1_disable,
     .get_value = adc1_get_value};
+
+/* ADC1 - 电池电压/电流 (DMA扫描) */
+DEV_EXPORT(60, adc1) {
+    .name = ADC1_NAME,
+    .init = adc1_init,
+    .enable = adc1_enable,
+    .disable = adc1_disable,
+    .arg.ptr = NULL};
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  adc [sync <phase>|free]: 查看采样结果, 切换PWM同步采样或连续转换
+ */
+void adc1_cmd(int argc, void **argv)
+{
+    adc1_sample_t smp;
+
+    if (argc >= 1 && !strcmp(argv[0], "sync"))
+    {
+        uint16_t phase = argc >= 2 ? (uint16_t)atoi(argv[1]) : ADC_PHASE_DEFAULT;
+        if (phase == 0 || phase >= PWM_MAX_DUTY || adc1_set_trigger(1, phase) != 0)
+        {
+            printf("Usage: adc sync <1~%d>, adc not ready or phase out of range\n", PWM_MAX_DUTY - 1);
+            return;
+        }
+    }
+    else if (argc >= 1 && !strcmp(argv[0], "free"))
+    {
+        adc1_set_trigger(0, 0);
+    }
+
+    printf("adc %s, vbat %u, current %u, spare %u, overruns %lu\n", adc1_pwm_sync ? "pwm sync" : "free",
+           adc1_read(ADC1_CH_VBAT), adc1_read(ADC1_CH_CURRENT), adc1_read(ADC1_CH_SPARE),
+           (unsigned long)adc1_overruns);
+    if (adc1_get_sample(&smp) == 0)
+    {
+        printf("period %lu, sample of period %lu: %u %u %u, power %lu\n", (unsigned long)adc1_period_count(),
+               (unsigned long)smp.period, smp.value[ADC1_CH_VBAT], smp.value[ADC1_CH_CURRENT],
+               smp.value[ADC1_CH_SPARE], (unsigned long)adc1_read_power());
+    }
+}
+
+ENV_EXPORT(adc, adc1_cmd);
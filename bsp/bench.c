@@ -0,0 +1,241 @@
+/**
+ * @file    bench.c
+ * @brief   微基准测试框架
+ * @details 计时、统计和shell命令, 被测函数在各自模块中通过BENCH_EXPORT注册
+ *
+ * 测量方法:
+ *   - 先执行BENCH_WARMUP次不计时, 再逐次计时N次, 每次结果单独保存
+ *   - 采样时不关中断, P99/最大值反映中断带来的抖动
+ *   - 每个样本扣除空函数调用的最小开销
+ *
+ * 计时源按编译环境选择, 统计与输出代码相同; 目标板上通过bench命令运行
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <time.h>
+#else
+#include "driver.h"
+#endif
+
+/*===========================================================================*/
+/*                              计时源                                        */
+/*===========================================================================*/
+
+#if defined(__linux__)
+
+static void Bench_Clock_Init(void)
+{
+}
+
+static inline uint32_t Bench_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+const char *bench_unit(void)
+{
+    return "ns";
+}
+
+#else
+
+static void Bench_Clock_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t Bench_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+const char *bench_unit(void)
+{
+    return "cycles";
+}
+
+#endif
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+static uint32_t bench_samples[BENCH_ITER_MAX];
+
+static void Bench_Empty(void)
+{
+}
+
+/* 经函数指针调用, 与被测函数的调用方式一致 */
+static void (*volatile bench_empty_fn)(void) = Bench_Empty;
+
+/**
+ * @brief  采样n次, 结果存入bench_samples并升序排列
+ */
+static void Bench_Sample(void (*fn)(void), uint32_t n)
+{
+    for (uint32_t i = 0; i < BENCH_WARMUP; i++)
+        fn();
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t t0 = Bench_Now();
+        fn();
+        bench_samples[i] = Bench_Now() - t0;
+    }
+
+    /* 插入排序, n不超过256 */
+    for (uint32_t i = 1; i < n; i++)
+    {
+        uint32_t v = bench_samples[i];
+        uint32_t j = i;
+        while (j > 0 && bench_samples[j - 1] > v)
+        {
+            bench_samples[j] = bench_samples[j - 1];
+            j--;
+        }
+        bench_samples[j] = v;
+    }
+}
+
+static const bench_t *Bench_Table(uint32_t *count)
+{
+    const bench_t *t = (const bench_t *)BENCH_TABLE_BEGIN;
+    *count = (const bench_t *)BENCH_TABLE_END - t;
+    return t;
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  运行一项基准测试
+ * @param  b: 测试项
+ * @param  iter: 采样次数 (1~BENCH_ITER_MAX)
+ * @param  r: 输出统计结果
+ * @retval 0-成功, -1-参数无效
+ */
+int bench_run(const bench_t *b, uint32_t iter, bench_result_t *r)
+{
+    if (b == NULL || r == NULL || iter == 0 || iter > BENCH_ITER_MAX)
+        return -1;
+
+    Bench_Clock_Init();
+
+    /* 调用开销取空函数的最小值 */
+    Bench_Sample(bench_empty_fn, iter);
+    uint32_t overhead = bench_samples[0];
+
+    Bench_Sample(b->fn, iter);
+    for (uint32_t i = 0; i < iter; i++)
+        bench_samples[i] = (bench_samples[i] > overhead) ? bench_samples[i] - overhead : 0;
+
+    r->n = iter;
+    r->min = bench_samples[0];
+    r->median = bench_samples[iter / 2];
+    r->p99 = bench_samples[(iter * 99) / 100];
+    r->max = bench_samples[iter - 1];
+    return 0;
+}
+
+/**
+ * @brief  按名称查找测试项
+ */
+const bench_t *bench_find(const char *name)
+{
+    uint32_t n;
+    const bench_t *t = Bench_Table(&n);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (!strcmp(t[i].name, name))
+            return &t[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief  以一行JSON输出结果, 便于主机端脚本收集
+ */
+void bench_print_json(const bench_t *b, const bench_result_t *r)
+{
+    printf("{\"name\":\"%s\",\"unit\":\"%s\",\"n\":%lu,\"min\":%lu,\"median\":%lu,\"p99\":%lu,\"max\":%lu}\n",
+           b->name, bench_unit(), (unsigned long)r->n, (unsigned long)r->min, (unsigned long)r->median,
+           (unsigned long)r->p99, (unsigned long)r->max);
+}
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+#if !defined(__linux__)
+
+static void Bench_Print(const bench_t *b, const bench_result_t *r)
+{
+    printf("%-16s n=%-4lu min %-8lu median %-8lu p99 %-8lu max %lu %s\n", b->name, (unsigned long)r->n,
+           (unsigned long)r->min, (unsigned long)r->median, (unsigned long)r->p99, (unsigned long)r->max,
+           bench_unit());
+}
+
+/**
+ * @brief  bench list | all [n] | json [n] | <名称> [n]
+ * @note   会调用pwm_set_all(0,...)等操作, 电机有输出时拒绝运行
+ */
+void bench_cmd(int argc, void **argv)
+{
+    uint32_t n;
+    const bench_t *t = Bench_Table(&n);
+    uint32_t iter = (argc >= 2) ? (uint32_t)atoi((char *)argv[1]) : BENCH_ITER_DEF;
+    bench_result_t r;
+
+    if (argc < 1 || !strcmp(argv[0], "list"))
+    {
+        for (uint32_t i = 0; i < n; i++)
+            printf("%s\n", t[i].name);
+        printf("Usage: bench <list|all|json|name> [iterations<=%d]\n", BENCH_ITER_MAX);
+        return;
+    }
+    if (pwm_armed())
+    {
+        printf("bench: disarm first\n");
+        return;
+    }
+    if (iter == 0 || iter > BENCH_ITER_MAX)
+        iter = BENCH_ITER_DEF;
+
+    if (!strcmp(argv[0], "all") || !strcmp(argv[0], "json"))
+    {
+        uint8_t json = !strcmp(argv[0], "json");
+        for (uint32_t i = 0; i < n; i++)
+        {
+            bench_run(&t[i], iter, &r);
+            if (json)
+                bench_print_json(&t[i], &r);
+            else
+                Bench_Print(&t[i], &r);
+        }
+        return;
+    }
+
+    const bench_t *b = bench_find((char *)argv[0]);
+    if (b == NULL)
+    {
+        printf("Unknown benchmark: %s\n", (char *)argv[0]);
+        return;
+    }
+    bench_run(b, iter, &r);
+    Bench_Print(b, &r);
+}
+
+ENV_EXPORT(bench, bench_cmd);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file    bench.h
+ * @brief   微基准测试框架
+ * @details 被测函数通过BENCH_EXPORT注册到bench_table段, 先预热再采样N次,
+ *          统计最小值/中位数/P99/最大值
+ *
+ * 计时源:
+ *   目标板  DWT->CYCCNT, 单位CPU周期
+ *   Linux   clock_gettime(CLOCK_MONOTONIC), 单位ns
+ *
+ * 结果已扣除空函数调用的开销
+ *
+ * 本文件和bench.c不依赖硬件和框架, 主机上由tools/bench_host运行同一张表,
+ * 表的边界由tools/mock/host.ld提供
+ */
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdint.h>
+#include "section.h"
+
+#define BENCH_WARMUP   8   /* 预热次数, 填充Flash预取和缓存 */
+#define BENCH_ITER_DEF 64  /* 默认采样次数 */
+#define BENCH_ITER_MAX 256 /* 最大采样次数 */
+
+/* 基准测试项, 常量表项 */
+typedef struct
+{
+    const char *name;
+    void (*fn)(void); /* 执行一次被测操作 */
+} bench_t;
+
+/* 统计结果 */
+typedef struct
+{
+    uint32_t n;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+} bench_result_t;
+
+/**
+ * @brief  注册基准测试
+ * @param  bname: 测试名 (不加引号)
+ * @param  bfn: 被测函数 void fn(void)
+ */
+#define BENCH_EXPORT(bname, bfn) \
+    const bench_t __bench_##bname SECTION_USED("bench_table." #bname) = {.name = #bname, .fn = bfn}
+
+int bench_run(const bench_t *b, uint32_t iter, bench_result_t *r);
+const bench_t *bench_find(const char *name);
+const char *bench_unit(void);
+void bench_print_json(const bench_t *b, const bench_result_t *r);
+
+#endif /* __BENCH_H */
@@ -1,6 +1,7 @@
 #include <stm32f4xx.h>
 #include <irq/df_irq.h>
 #include <stdio.h>
+#include <driver.h>
 extern int Serial_1_IRQHandlerCallback(int,void *[]);
 extern int Time_2_IRQHandlerCallback(int,void *[]);
 
@@ -29,4 +30,52 @@ void TIM2_IRQHandler(void)
         TIM2->SR &= ~TIM_SR_UIF;  // 清除中断标志
         irq_handle_loader(&irq_handles, TIM2_IRQn, NULL);
     }
+}
+
+/**
+ * @brief  DMA2 Stream0中断服务函数 (ADC1扫描结果)
+ */
+void DMA2_Stream0_IRQHandler(void)
+{
+    adc1_dma_isr();
+}
+
+/**
+ * @brief  ADC中断服务函数 (ADC1溢出恢复)
+ */
+void ADC_IRQHandler(void)
+{
+    adc1_isr();
+}
+
+/**
+ * @brief  DMA2 Stream7中断服务函数 (USART1发送队列)
+ */
+void DMA2_Stream7_IRQHandler(void)
+{
+    console_dma_isr();
+}
+
+/**
+ * @brief  USART2中断服务函数 (遥控接收, 线路空闲)
+ */
+void USART2_IRQHandler(void)
+{
+    rc_uart_isr();
+}
+
+/**
+ * @brief  USART3中断服务函数 (遥测链路接收)
+ */
+void USART3_IRQHandler(void)
+{
+    uart_rx_isr(UART_PORT_3);
+}
+
+/**
+ * @brief  DMA1 Stream5中断服务函数 (遥控接收)
+ */
+void DMA1_Stream5_IRQHandler(void)
+{
+    rc_dma_isr();
 }
\ No newline at end of file
@@ -0,0 +1,278 @@
+/**
+ * @file    console.c
+ * @brief   USART1发送队列
+ * @details 多生产者/单消费者的无锁发送队列, printf等输出只写队列不等待串口,
+ *          由DMA2 Stream7 (Channel4, USART1_TX) 在后台逐槽发送
+ *
+ * 队列结构:
+ *   - CONSOLE_SLOT_NUM个定长槽, 每槽CONSOLE_SLOT_SIZE字节, 在SRAM1 (DMA可见)
+ *   - con_len[i]是第i槽的就绪标志兼长度: 0表示空闲或尚未提交
+ *
+ * 生产者 (主循环或任意优先级中断):
+ *   1. CAS推进con_head, 一次预留一条消息需要的全部槽
+ *   2. 拷贝数据, 逐槽以release语义写con_len提交
+ *   3. 挂起DMA2 Stream7中断, 由中断启动发送
+ *   同一条消息的槽连续, 不会被其他生产者插入; 同一生产者的消息按调用顺序输出
+ *
+ * 消费者 (只有DMA2 Stream7中断):
+ *   传输完成后清con_len、推进con_tail, 再检查con_tail槽是否就绪并启动下一次DMA.
+ *   DMA寄存器只在该中断中访问, 不需要关中断
+ *
+ * 逐字符输出 (putchar/fputc):
+ *   线程模式下先攒在con_line, 遇到换行、攒满一槽或再有整块输出时才提交,
+ *   不满一行的部分由主循环的console_poll提交; 中断中仍逐字符提交
+ *
+ * 队列满:
+ *   线程模式 (且未关中断) 下等待DMA腾出空间, 大量输出 (param list, dump等) 不丢;
+ *   中断中或关中断时直接丢弃整条消息并计数
+ *
+ * 初始化前 (usart1_init之前) 直接轮询TXE发送
+ */
+
+#include "driver.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define CONSOLE_SLOT_NUM  64 /* 槽数, 必须是2的幂 */
+#define CONSOLE_SLOT_SIZE 32
+#define CONSOLE_MSG_SLOTS 8  /* 单次预留的最大槽数, 更长的消息分多次预留 */
+#define CONSOLE_MASK      (CONSOLE_SLOT_NUM - 1)
+#define CONSOLE_IRQ_PRIO  5  /* 低于TIM2/USART1, 发送不抢占控制节拍 */
+
+#define CONSOLE_HIFCR_ALL7 \
+    (DMA_HIFCR_CTCIF7 | DMA_HIFCR_CHTIF7 | DMA_HIFCR_CTEIF7 | DMA_HIFCR_CDMEIF7 | DMA_HIFCR_CFEIF7)
+
+/*===========================================================================*/
+/*                              内部变量                                      */
+/*===========================================================================*/
+
+static DMA_BUFFER uint8_t con_data[CONSOLE_SLOT_NUM][CONSOLE_SLOT_SIZE];
+static volatile uint8_t con_len[CONSOLE_SLOT_NUM];
+static uint32_t con_head;    /* 生产者预留位置 (槽), 自由递增 */
+static uint32_t con_tail;    /* 正在发送或下一个要发送的槽 */
+static uint8_t con_busy;     /* DMA正在发送con_tail槽, 只在中断中修改 */
+static uint8_t con_ready;    /* DMA已配置 */
+static uint32_t con_bytes;   /* 已提交字节数 */
+static uint32_t con_dropped; /* 丢弃的消息数 */
+static uint32_t con_waits;   /* 线程模式下因队列满等待的次数 */
+static uint32_t con_errors;  /* DMA传输错误次数 */
+
+/* 线程模式逐字符输出的暂存, 只在线程模式访问 */
+static char con_line[CONSOLE_SLOT_SIZE];
+static uint32_t con_line_len;
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+/* 线程模式且未关中断时可以等待DMA腾出空间 */
+static inline uint8_t Console_Can_Wait(void)
+{
+    return __get_IPSR() == 0 && __get_PRIMASK() == 0;
+}
+
+/**
+ * @brief  预留k个连续槽
+ * @retval 0-成功, head为起始槽; -1-队列满且不能等待
+ */
+static int Console_Reserve(uint32_t k, uint32_t *head)
+{
+    uint32_t h = __atomic_load_n(&con_head, __ATOMIC_RELAXED);
+    uint8_t waited = 0;
+
+    for (;;)
+    {
+        uint32_t used = h - __atomic_load_n(&con_tail, __ATOMIC_ACQUIRE);
+        if (CONSOLE_SLOT_NUM - used < k)
+        {
+            if (!Console_Can_Wait())
+                return -1;
+            if (!waited)
+                __atomic_fetch_add(&con_waits, 1, __ATOMIC_RELAXED);
+            waited = 1;
+            NVIC_SetPendingIRQ(DMA2_Stream7_IRQn);
+            h = __atomic_load_n(&con_head, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&con_head, &h, h + k, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            *head = h;
+            return 0;
+        }
+    }
+}
+
+/* 整块写入队列, 超过CONSOLE_MSG_SLOTS槽的部分分多次预留 */
+static int Console_Enqueue(const char *data, uint32_t len)
+{
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        uint32_t n = len - done;
+        if (n > CONSOLE_MSG_SLOTS * CONSOLE_SLOT_SIZE)
+            n = CONSOLE_MSG_SLOTS * CONSOLE_SLOT_SIZE;
+        uint32_t k = (n + CONSOLE_SLOT_SIZE - 1) / CONSOLE_SLOT_SIZE;
+        uint32_t head;
+
+        if (Console_Reserve(k, &head) != 0)
+        {
+            __atomic_fetch_add(&con_dropped, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        for (uint32_t i = 0; i < k; i++)
+        {
+            uint32_t off = i * CONSOLE_SLOT_SIZE;
+            uint32_t m = (n - off < CONSOLE_SLOT_SIZE) ? n - off : CONSOLE_SLOT_SIZE;
+            uint32_t slot = (head + i) & CONSOLE_MASK;
+            memcpy(con_data[slot], data + done + off, m);
+            __atomic_store_n(&con_len[slot], (uint8_t)m, __ATOMIC_RELEASE);
+        }
+        done += n;
+        __atomic_fetch_add(&con_bytes, n, __ATOMIC_RELAXED);
+        NVIC_SetPendingIRQ(DMA2_Stream7_IRQn);
+    }
+    return done;
+}
+
+/* 提交线程模式暂存的字符, 只在线程模式调用 */
+static void Console_Line_Flush(void)
+{
+    uint32_t n = con_line_len;
+
+    con_line_len = 0;
+    if (n != 0)
+        Console_Enqueue(con_line, n);
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  配置USART1发送DMA, usart1_init中调用
+ */
+void console_init(void)
+{
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+    DMA2_Stream7->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream7->CR & DMA_SxCR_EN)
+        ;
+    DMA2->HIFCR = CONSOLE_HIFCR_ALL7;
+
+    /* Channel4, 存储器到外设, 字节宽度, 存储器地址递增 */
+    DMA2_Stream7->PAR = (uint32_t)(uintptr_t)&USART1->DR;
+    DMA2_Stream7->CR = DMA_SxCR_CHSEL_2 | DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    DMA2_Stream7->FCR = 0; /* 直接模式 */
+    USART1->CR3 |= USART_CR3_DMAT;
+
+    NVIC_SetPriority(DMA2_Stream7_IRQn, CONSOLE_IRQ_PRIO);
+    NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+    con_ready = 1;
+}
+
+/**
+ * @brief  写入发送队列
+ * @param  data: 数据
+ * @param  len: 字节数
+ * @retval 写入的字节数, 队列满丢弃时小于len
+ * @note   可重入, 中断中可调用
+ */
+int console_write(const char *data, uint32_t len)
+{
+    if (!con_ready)
+    {
+        for (uint32_t i = 0; i < len; i++)
+            uart_putc(UART_PORT_1, (uint8_t)data[i]);
+        return len;
+    }
+
+    /* 线程模式先提交暂存的字符, 保持输出顺序 */
+    if (__get_IPSR() == 0)
+        Console_Line_Flush();
+    return Console_Enqueue(data, len);
+}
+
+/**
+ * @brief  写入一个字符, putchar/fputc使用
+ * @note   线程模式下攒到换行或一槽再提交; 中断中直接提交
+ */
+int console_putc(char c)
+{
+    if (!con_ready || __get_IPSR() != 0)
+        return console_write(&c, 1);
+
+    con_line[con_line_len++] = c;
+    if (c == '\n' || con_line_len == sizeof(con_line))
+        Console_Line_Flush();
+    return 1;
+}
+
+/**
+ * @brief  提交不满一行的逐字符输出, 主循环中调用
+ */
+void console_poll(void)
+{
+    if (__get_IPSR() == 0)
+        Console_Line_Flush();
+}
+
+/**
+ * @brief  DMA2 Stream7中断处理, 队列唯一的消费者
+ * @note   生产者提交后挂起本中断启动发送
+ */
+void console_dma_isr(void)
+{
+    uint32_t isr = DMA2->HISR;
+
+    if (isr & (DMA_HISR_TCIF7 | DMA_HISR_TEIF7))
+    {
+        DMA2->HIFCR = CONSOLE_HIFCR_ALL7;
+        if (isr & DMA_HISR_TEIF7)
+            con_errors++;
+        if (con_busy)
+        {
+            con_len[con_tail & CONSOLE_MASK] = 0;
+            __atomic_store_n(&con_tail, con_tail + 1, __ATOMIC_RELEASE);
+            con_busy = 0;
+        }
+    }
+
+    if (con_busy)
+        return;
+
+    uint32_t slot = con_tail & CONSOLE_MASK;
+    uint8_t n = __atomic_load_n(&con_len[slot], __ATOMIC_ACQUIRE);
+    if (n == 0)
+        return; /* 队列空, 或下一槽已预留但未提交 (提交后会再次挂起本中断) */
+
+    DMA2_Stream7->M0AR = (uint32_t)(uintptr_t)con_data[slot];
+    DMA2_Stream7->NDTR = n;
+    USART1->SR = ~USART_SR_TC; /* 只清TC; 读改写会把期间到达的RXNE一起清掉 */
+    DMA2_Stream7->CR |= DMA_SxCR_EN;
+    con_busy = 1;
+}
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  console: 查看发送队列统计
+ */
+void console_cmd(int argc, void **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("console %s, queued %lu/%d slots\n", con_ready ? "dma" : "polling",
+           (unsigned long)(con_head - con_tail), CONSOLE_SLOT_NUM);
+    printf("bytes %lu, dropped %lu msgs, waits %lu, dma errors %lu\n", (unsigned long)con_bytes,
+           (unsigned long)con_dropped, (unsigned long)con_waits, (unsigned long)con_errors);
+}
+
+ENV_EXPORT(console, console_cmd);
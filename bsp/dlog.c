@@ -0,0 +1,153 @@
+/**
+ * @file    dlog.c
+ * @brief   延迟二进制日志
+ * @details 无锁多生产者环形缓冲区和输出, 格式见dlog.h
+ *
+ * 并发:
+ *   - 生产者用LDREX/STREX (__atomic_compare_exchange) 推进写索引, 预留整条记录
+ *   - 预留后写时间戳和参数, 最后以release语义写hdr, hdr的DLOG_VALID位即提交标志
+ *   - 消费者 (主循环) 遇到未提交的hdr就停下, 下次再取, 记录按预留顺序输出
+ *   - 消费后把各字清零, 任何位置都可能成为下一条记录的hdr
+ */
+
+#include "driver.h"
+#include "dlog.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              内部变量                                      */
+/*===========================================================================*/
+
+#define DLOG_MASK (DLOG_RING_WORDS - 1)
+
+static CCM_LOG uint32_t dlog_ring[DLOG_RING_WORDS];
+static uint32_t dlog_head;    /* 生产者预留位置, 自由递增 */
+static uint32_t dlog_tail;    /* 消费者读取位置, 自由递增 */
+static uint32_t dlog_written; /* 已提交条数 */
+static uint32_t dlog_dropped; /* 缓冲区满丢弃的条数 */
+static uint32_t dlog_peak;    /* 最大占用字数 */
+static uint8_t dlog_output = 1;
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  写入一条记录, 一般通过DLOG宏调用
+ * @param  id: 格式串ID
+ * @param  nargs: 参数个数 (0~DLOG_ARG_MAX)
+ * @param  args: 参数原值
+ * @retval 0-成功, -1-缓冲区满或参数过多
+ * @note   可重入, 中断中可调用
+ */
+int dlog_write(uint32_t id, uint32_t nargs, const uint32_t *args)
+{
+    uint32_t len = nargs + 2;
+    uint32_t head;
+
+    if (nargs > DLOG_ARG_MAX)
+        return -1;
+
+    head = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED);
+    do
+    {
+        uint32_t used = head - __atomic_load_n(&dlog_tail, __ATOMIC_ACQUIRE);
+        if (DLOG_RING_WORDS - used < len)
+        {
+            __atomic_fetch_add(&dlog_dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&dlog_head, &head, head + len, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    dlog_ring[(head + 1) & DLOG_MASK] = DWT->CYCCNT;
+    for (uint32_t i = 0; i < nargs; i++)
+        dlog_ring[(head + 2 + i) & DLOG_MASK] = args[i];
+    __atomic_store_n(&dlog_ring[head & DLOG_MASK], (id << 8) | (nargs << 4) | DLOG_VALID, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&dlog_written, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * @brief  输出已提交的记录, 主循环中调用
+ * @retval 本次输出的条数
+ */
+int dlog_poll(void)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    char line[2 + (DLOG_ARG_MAX + 2) * 9];
+    uint32_t tail = dlog_tail;
+    uint32_t used = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED) - tail;
+    int count = 0;
+
+    if (used > dlog_peak)
+        dlog_peak = used;
+
+    while (tail != __atomic_load_n(&dlog_head, __ATOMIC_RELAXED))
+    {
+        uint32_t hdr = __atomic_load_n(&dlog_ring[tail & DLOG_MASK], __ATOMIC_ACQUIRE);
+        if (!(hdr & DLOG_VALID))
+            break; /* 已预留但尚未提交 */
+
+        uint32_t len = ((hdr >> 4) & 0xF) + 2;
+        char *p = line;
+        *p++ = '@';
+        for (uint32_t i = 0; i < len; i++)
+        {
+            uint32_t w = dlog_ring[(tail + i) & DLOG_MASK];
+            dlog_ring[(tail + i) & DLOG_MASK] = 0;
+            for (int s = 28; s >= 0; s -= 4)
+                *p++ = hex[(w >> s) & 0xF];
+            *p++ = (i + 1 < len) ? ' ' : '\n';
+        }
+        *p = '\0';
+        tail += len;
+        __atomic_store_n(&dlog_tail, tail, __ATOMIC_RELEASE);
+
+        if (dlog_output)
+            printf("%s", line);
+        count++;
+    }
+    return count;
+}
+
+/*===========================================================================*/
+/*                              基准测试                                      */
+/*===========================================================================*/
+
+static volatile float dlog_bench_f = 1.5f;
+
+/* 写一条两个参数的记录, 随后直接丢弃, 含丢弃的开销;
+ * bench命令在主循环中运行, 此时缓冲区已被dlog_poll取空 */
+static void Dlog_Bench_Write(void)
+{
+    uint32_t head = dlog_head;
+
+    DLOG("bench %d %f\n", 42, dlog_bench_f);
+    for (uint32_t i = 0; i < 4; i++)
+        dlog_ring[(head + i) & DLOG_MASK] = 0;
+    __atomic_store_n(&dlog_tail, dlog_head, __ATOMIC_RELEASE);
+}
+
+BENCH_EXPORT(dlog_write, Dlog_Bench_Write);
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  dlog [on|off|test]: 查看统计, 开关输出, 写一条测试记录
+ */
+void dlog_cmd(int argc, void **argv)
+{
+    if (argc >= 1 && !strcmp(argv[0], "on"))
+        dlog_output = 1;
+    else if (argc >= 1 && !strcmp(argv[0], "off"))
+        dlog_output = 0;
+    else if (argc >= 1 && !strcmp(argv[0], "test"))
+        DLOG("dlog test: %u records, cpu %lu Hz, pi %.3f\n", dlog_written, SystemCoreClock, 3.14159f);
+
+    printf("dlog output %s, written %lu, dropped %lu, peak %lu/%d words\n", dlog_output ? "on" : "off",
+           (unsigned long)dlog_written, (unsigned long)dlog_dropped, (unsigned long)dlog_peak, DLOG_RING_WORDS);
+}
+
+ENV_EXPORT(dlog, dlog_cmd);
@@ -0,0 +1,104 @@
+/**
+ * @file    dlog.h
+ * @brief   延迟二进制日志
+ * @details 调用处不格式化文本: 格式串放在dlog_fmt段, 只把格式串ID、时间戳和
+ *          参数原值写入环形缓冲区, 主循环中dlog_poll输出, 主机端工具
+ *          tools/dlog_decode.c 从ELF读取格式串还原文本
+ *
+ * 记录格式 (32位字):
+ *   hdr | cycles | arg[0] ... arg[n-1]
+ *   hdr = (格式串ID << 8) | (参数个数 << 4) | DLOG_VALID
+ *   cycles为DWT->CYCCNT
+ *
+ * 参数:
+ *   - 整型按32位原值, float/double按float位模式保存, 由格式串决定如何显示
+ *   - 不支持%s和64位整数; 最多DLOG_ARG_MAX个参数
+ *
+ * 多生产者: 主循环和任意优先级的中断都可以调用, 用CAS预留空间, 写完参数后
+ * 最后写hdr提交; 缓冲区满时丢弃本条并计数, 不会阻塞
+ *
+ * 输出: 每条记录一行, '@'开头后跟各字的十六进制, 与shell文本混在同一串口,
+ *       解码工具原样转发其他行
+ */
+
+#ifndef __DLOG_H
+#define __DLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "section.h"
+
+#define DLOG_RING_WORDS 512 /* 环形缓冲区字数, 必须是2的幂 */
+#define DLOG_ARG_MAX    8
+#define DLOG_VALID      0x1
+
+/* 格式串ID: 相对dlog_fmt段首的偏移 */
+static inline uint32_t dlog_id(const char *fmt)
+{
+    return (uint32_t)(fmt - DLOG_FMT_BEGIN);
+}
+
+static inline uint32_t dlog_u32(uint32_t v)
+{
+    return v;
+}
+
+static inline uint32_t dlog_f32(float v)
+{
+    union { float f; uint32_t u; } x = {.f = v};
+    return x.u;
+}
+
+static inline uint32_t dlog_f64(double v)
+{
+    return dlog_f32((float)v);
+}
+
+/* 按类型取参数原值 */
+#define DLOG_ARG(x) _Generic((x), float: dlog_f32, double: dlog_f64, default: dlog_u32)(x)
+
+/* 格式串放入dlog_fmt段, 取其ID */
+#define DLOG_ID(fmt)                                                       \
+    ({                                                                     \
+        static const char __dlog_fmt[] SECTION_USED("dlog_fmt") = fmt;     \
+        dlog_id(__dlog_fmt);                                               \
+    })
+
+/* 参数个数 (不含格式串) */
+#define DLOG_NARG(...)                                        DLOG_NARG_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARG_(f, a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+#define DLOG_CAT(a, b)                                        DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b)                                       a##b
+
+#define DLOG_0(f)          dlog_write(DLOG_ID(f), 0, NULL)
+#define DLOG_1(f, a)       dlog_write(DLOG_ID(f), 1, (const uint32_t[]){DLOG_ARG(a)})
+#define DLOG_2(f, a, b)    dlog_write(DLOG_ID(f), 2, (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b)})
+#define DLOG_3(f, a, b, c) dlog_write(DLOG_ID(f), 3, (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c)})
+#define DLOG_4(f, a, b, c, d)                                                                                   \
+    dlog_write(DLOG_ID(f), 4, (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d)})
+#define DLOG_5(f, a, b, c, d, e)                                                                                \
+    dlog_write(DLOG_ID(f), 5,                                                                                   \
+               (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d), DLOG_ARG(e)})
+#define DLOG_6(f, a, b, c, d, e, g)                                                                             \
+    dlog_write(DLOG_ID(f), 6,                                                                                   \
+               (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d), DLOG_ARG(e), DLOG_ARG(g)})
+#define DLOG_7(f, a, b, c, d, e, g, h)                                                                          \
+    dlog_write(DLOG_ID(f), 7,                                                                                   \
+               (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d), DLOG_ARG(e), DLOG_ARG(g), \
+                                  DLOG_ARG(h)})
+#define DLOG_8(f, a, b, c, d, e, g, h, i)                                                                       \
+    dlog_write(DLOG_ID(f), 8,                                                                                   \
+               (const uint32_t[]){DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d), DLOG_ARG(e), DLOG_ARG(g), \
+                                  DLOG_ARG(h), DLOG_ARG(i)})
+
+/**
+ * @brief  记录一条日志
+ * @note   用法同printf: DLOG("param saved to sector %u\n", sector);
+ *         格式串必须是字符串字面量
+ */
+#define DLOG(...) DLOG_CAT(DLOG_, DLOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+int dlog_write(uint32_t id, uint32_t nargs, const uint32_t *args);
+int dlog_poll(void);
+
+#endif /* __DLOG_H */
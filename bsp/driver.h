@@ -15,8 +15,15 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <dev_frame.h>
+#include <shell/shell.h>
 #include <misc.h>
+#include "section.h"
 #include "pwm.h"
+#include "param.h"
+#include "bench.h"
+#include "dlog.h"
+#include "oled.h"
+#include "rc.h"
 
 /*===========================================================================*/
 /*                              设备名称定义                                  */
@@ -57,30 +64,59 @@ int led_on(dev_arg_t arg);
 int led_off(dev_arg_t arg);
 
 /*===========================================================================*/
-/*                              USART1 驱动                                  */
-/*===========================================================================*/
-
-void USART1_Init(uint32_t BaudRate);
-void USART1_SendChar(char ch);
-void USART1_SendString(char *str);
+/*                              串口驱动                                      */
+/*===========================================================================*/
+
+/* 串口编号, 描述表 (usart.c) 的下标 */
+typedef enum
+{
+    UART_PORT_1 = 0, /* USART1 PA9/PA10,  APB2, 调试串口 */
+    UART_PORT_2,     /* USART2 PA2/PA3,   APB1, 遥控接收 */
+    UART_PORT_3,     /* USART3 PB10/PB11, APB1, 遥测 */
+    UART_PORT_4,     /* UART4  PC10/PC11, APB1 */
+    UART_PORT_5,     /* UART5  PC12/PD2,  APB1 */
+    UART_PORT_6,     /* USART6 PC6/PC7,   APB2 */
+    UART_PORT_NUM
+} uart_port_t;
+
+/* uart_open的mode */
+#define UART_MODE_TX     0x01 /* 使能发送 */
+#define UART_MODE_RX     0x02 /* 使能接收 */
+#define UART_MODE_8E2    0x04 /* 8位数据, 偶校验, 2停止位 (SBUS); 默认8N1 */
+#define UART_MODE_DMA_TX 0x08 /* 配置发送DMA, 供uart_dma_send使用 */
+
+int uart_open(uart_port_t port, uint32_t baud, uint32_t mode);
+int uart_set_baud(uart_port_t port, uint32_t baud);
+uint32_t uart_get_baud(uart_port_t port);
+uint32_t uart_calc_baud(uart_port_t port, uint32_t baud);
+USART_TypeDef *uart_instance(uart_port_t port);
+void uart_putc(uart_port_t port, uint8_t ch);
+void uart_write(uart_port_t port, const uint8_t *data, uint32_t len);
+int uart_getc(uart_port_t port);
+int uart_dma_send(uart_port_t port, const uint8_t *data, uint16_t len);
+uint8_t uart_dma_busy(uart_port_t port);
+int uart_rx_start(uart_port_t port, uint8_t *buf, uint32_t size, uint8_t prio);
+void uart_rx_isr(uart_port_t port);
+uint32_t uart_read(uart_port_t port, uint8_t *dst, uint32_t max);
+uint32_t uart_rx_errors(uart_port_t port);
+
+/* USART1 调试串口 */
 uint8_t USART1_ReceiveChar(void *None, uint8_t *data);
 
+/* 发送队列 (console.c) */
+void console_init(void);
+int console_write(const char *data, uint32_t len);
+int console_putc(char c);
+void console_poll(void);
+void console_dma_isr(void);
+
 int usart1_init(dev_arg_t arg);
 int usart1_send(dev_arg_t arg);
 int usart1_receive(dev_arg_t arg);
 int usart1_start(dev_arg_t arg);
 int usart1_stop(dev_arg_t arg);
 
-/*===========================================================================*/
-/*                              USART3 驱动                                  */
-/*===========================================================================*/
-
-void USART3_Init(uint32_t BaudRate);
-void USART3_SendChar(char ch);
-void USART3_SendString(char *str);
-void USART3_SendData(uint8_t *data, uint16_t len);
-uint8_t USART3_ReceiveChar(void *None, uint8_t *data);
-uint8_t USART3_Available(void);
+/* USART3 通用串口 */
 int u3_printf(const char *format, ...);
 
 int usart3_init(dev_arg_t arg);
@@ -93,10 +129,35 @@ int usart3_stop(dev_arg_t arg);
 /*                              ADC 驱动                                     */
 /*===========================================================================*/
 
+/* ADC1扫描通道 (DMA缓冲区中的顺序) */
+typedef enum
+{
+    ADC1_CH_VBAT = 0, /* PB1 - 电池电压 */
+    ADC1_CH_CURRENT,  /* PB0 - 电流 */
+    ADC1_CH_SPARE,    /* PC1 - 备用 */
+    ADC1_CH_NUM
+} adc1_ch_t;
+
+/* PWM同步采样样本 */
+typedef struct
+{
+    uint32_t period;             /* 所属PWM周期号 */
+    uint16_t value[ADC1_CH_NUM]; /* 各通道原始值 */
+} adc1_sample_t;
+
 void ADC1_Init(void);
 int adc1_init(dev_arg_t arg);
 int adc1_enable(dev_arg_t arg);
 int adc1_disable(dev_arg_t arg);
+uint16_t adc1_read(adc1_ch_t ch);
+uint32_t adc1_update_count(void);
+void adc1_dma_isr(void);
+int adc1_set_trigger(uint8_t pwm_sync, uint16_t phase);
+uint32_t adc1_period_count(void);
+int adc1_get_sample(adc1_sample_t *sample);
+uint32_t adc1_read_power(void);
+uint32_t adc1_overrun_count(void);
+void adc1_isr(void);
 
 /*===========================================================================*/
 /*                              延时函数                                      */
@@ -118,5 +179,42 @@ int ssd1306_dev_init(dev_arg_t arg);
 /*===========================================================================*/
 
 int TIM_Init(dev_arg_t arg);
+uint32_t tim_get_clock(TIM_TypeDef *TIMx);
+
+/* 输入捕获边沿 */
+#define TIM_CAPTURE_RISING 0
+#define TIM_CAPTURE_BOTH   1
+
+int tim_capture_init(TIM_TypeDef *TIMx, uint32_t ch, uint32_t edge, uint32_t tick_hz,
+                     DMA_Stream_TypeDef *stream, uint32_t chsel, volatile uint32_t *buf, uint32_t len);
+
+/*===========================================================================*/
+/*                              Flash 驱动                                   */
+/*===========================================================================*/
+
+/* Flash后台引擎的使用者, 各自的任务结果分开保存 */
+typedef enum
+{
+    FLASH_OWNER_PARAM = 0, /* 参数存储 */
+    FLASH_OWNER_BLACKBOX,  /* 飞行记录器, 解锁时也允许编程 */
+    FLASH_OWNER_NUM
+} flash_owner_t;
+
+uintptr_t flash_sector_addr(uint8_t sector);
+uint32_t flash_sector_size(uint8_t sector);
+uint8_t flash_is_blank(uintptr_t addr, uint32_t words);
+int flash_erase_start(uint8_t sector, flash_owner_t owner);
+int flash_program_start(uintptr_t addr, const uint32_t *data, uint32_t words, flash_owner_t owner);
+int flash_poll(void);
+int flash_status(flash_owner_t owner);
+uint32_t flash_stall_max_us(uint8_t erase);
+uint32_t flash_crc32(const void *data, uint32_t words);
+
+/*===========================================================================*/
+/*                              参数存储                                     */
+/*===========================================================================*/
+
+/* 访问接口见param.h (不依赖框架, 主机上可直接使用) */
+int param_init(dev_arg_t arg);
 
 #endif /* __DRIVER_H */
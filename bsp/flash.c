@@ -0,0 +1,393 @@
+/**
+ * @file    flash.c
+ * @brief   片内Flash擦写驱动
+ * @details 后台擦写引擎、硬件CRC32
+ *
+ * 扇区布局 (STM32F407VE, 512KB):
+ *   0~3  16KB   0x08000000 0x08004000 0x08008000 0x0800C000
+ *   4    64KB   0x08010000
+ *   5~7  128KB  0x08020000 0x08040000 0x08060000
+ *
+ * 后台擦写:
+ *   - flash_erase_start/flash_program_start提交任务, 主循环调用flash_poll推进
+ *   - 每次flash_poll最多执行一步: 一次扇区擦除或FLASH_PROGRAM_CHUNK个字的编程,
+ *     两步之间主循环照常处理TIM2控制节拍
+ *   - 电机有输出 (pwm_armed) 时擦除任务挂起; 编程任务只有FLASH_OWNER_BLACKBOX
+ *     可以继续, 且每步只写1个字, 写入的是预先擦除好的日志扇区
+ *   - 每个使用者 (flash_owner_t) 一个任务槽, 结果分别保存, 用flash_status查询;
+ *     自己的上一个任务未完成时start返回-1, 下次再提交. 各槽轮流执行,
+ *     解锁时挂起的参数任务不会挡住飞行记录器的编程
+ *
+ * 总线阻塞:
+ *   F407只有一个Flash bank, 擦写期间任何取指和读Flash都会被挂起.
+ *   擦除等待循环放在RAM (RAMFUNC) 中, 等待期间CPU不访问Flash; 但中断
+ *   向量和服务函数仍在Flash中, 会被推迟到擦除结束, 因此擦除只在未解锁时进行.
+ *   每步的阻塞时间用DWT周期计数器测量, 最坏值可通过flash命令查看.
+ */
+
+#include "driver.h"
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define FLASH_KEY1 0x45670123
+#define FLASH_KEY2 0xCDEF89AB
+
+#define FLASH_PSIZE_WORD (0x2 << 8)           /* 编程宽度x32 */
+#define FLASH_SNB(n)     ((uint32_t)(n) << 3) /* 扇区号 */
+#define FLASH_SR_ERRORS  (FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+#define FLASH_SECTOR_NUM    8
+#define FLASH_PROGRAM_CHUNK 8 /* 每步编程字数, 单字约16us */
+
+/* 扇区相对FLASH_BASE的偏移 (主机模拟时FLASH_BASE指向模拟存储区) */
+static const uint32_t flash_sectors[FLASH_SECTOR_NUM + 1] = {
+    0x00000, 0x04000, 0x08000, 0x0C000,
+    0x10000, 0x20000, 0x40000, 0x60000,
+    0x80000, /* Flash结束 */
+};
+
+/* 后台任务 */
+typedef enum
+{
+    FLASH_JOB_IDLE = 0,
+    FLASH_JOB_ERASE,
+    FLASH_JOB_PROGRAM
+} flash_job_kind_t;
+
+typedef struct
+{
+    uint8_t kind;         /* flash_job_kind_t */
+    uint8_t owner;        /* flash_owner_t */
+    uint8_t sector;       /* 擦除扇区 */
+    uintptr_t addr;       /* 编程地址 */
+    const uint32_t *data; /* 编程数据, 任务完成前须保持有效 */
+    uint32_t words;       /* 编程总字数 */
+    uint32_t done;        /* 已编程字数 */
+} flash_job_t;
+
+static flash_job_t flash_jobs[FLASH_OWNER_NUM]; /* 按使用者索引 */
+static uint8_t flash_next;                      /* 轮询起点, 各使用者轮流执行 */
+static int flash_result[FLASH_OWNER_NUM];       /* 各使用者最近一次任务结果 */
+static uint32_t flash_stall_max[3];       /* 各类步骤最长阻塞 (CPU周期), 按任务类型索引 */
+static uint32_t flash_steps;              /* 累计执行步数 */
+static uint32_t flash_deferred;           /* 因解锁被推迟的次数 */
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+static void FLASH_Unlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+static void FLASH_Lock(void)
+{
+    FLASH->CR |= FLASH_CR_LOCK;
+}
+
+/**
+ * @brief  等待操作完成并检查错误标志
+ * @retval 0-成功, -1-编程或写保护错误
+ */
+static int FLASH_Wait(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY)
+        ;
+    uint32_t err = FLASH->SR & FLASH_SR_ERRORS;
+    FLASH->SR = err | FLASH_SR_EOP; /* 写1清除 */
+    return err ? -1 : 0;
+}
+
+/**
+ * @brief  复位数据缓存, 擦写后丢弃缓存中的旧内容
+ */
+static void FLASH_Flush_DCache(void)
+{
+    if (FLASH->ACR & FLASH_ACR_DCEN)
+    {
+        FLASH->ACR &= ~FLASH_ACR_DCEN;
+        FLASH->ACR |= FLASH_ACR_DCRST;
+        FLASH->ACR &= ~FLASH_ACR_DCRST;
+        FLASH->ACR |= FLASH_ACR_DCEN;
+    }
+}
+
+/**
+ * @brief  擦除扇区并等待完成 (在RAM中执行)
+ * @note   只访问外设寄存器, 不能调用任何Flash中的函数
+ * @retval FLASH_SR中的错误标志
+ */
+static RAMFUNC uint32_t FLASH_Erase_Ram(uint32_t cr)
+{
+    FLASH->CR = cr;
+    FLASH->CR = cr | FLASH_CR_STRT;
+    while (FLASH->SR & FLASH_SR_BSY)
+        ;
+    return FLASH->SR & FLASH_SR_ERRORS;
+}
+
+/**
+ * @brief  DWT周期计数器, 用于测量阻塞时间
+ */
+static void FLASH_Cycle_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief  执行一步擦除
+ */
+static int FLASH_Step_Erase(flash_job_t *job)
+{
+    FLASH_Unlock();
+    FLASH_Wait();
+    uint32_t err = FLASH_Erase_Ram(FLASH_PSIZE_WORD | FLASH_SNB(job->sector) | FLASH_CR_SER);
+    FLASH->SR = err | FLASH_SR_EOP;
+    FLASH->CR &= ~(FLASH_CR_SER | FLASH_SNB(0xF));
+    FLASH_Lock();
+    FLASH_Flush_DCache();
+    job->kind = FLASH_JOB_IDLE;
+    return err ? -1 : 0;
+}
+
+/**
+ * @brief  执行一步编程 (最多chunk个字)
+ */
+static int FLASH_Step_Program(flash_job_t *job, uint32_t chunk)
+{
+    int ret = 0;
+    uint32_t n = job->words - job->done;
+
+    if (n > chunk)
+        n = chunk;
+
+    FLASH_Unlock();
+    FLASH_Wait();
+    FLASH->CR = FLASH_PSIZE_WORD | FLASH_CR_PG;
+    for (uint32_t i = 0; i < n && ret == 0; i++, job->done++)
+    {
+        *(__IO uint32_t *)(job->addr + job->done * 4) = job->data[job->done];
+        ret = FLASH_Wait();
+    }
+    FLASH->CR &= ~FLASH_CR_PG;
+    FLASH_Lock();
+    FLASH_Flush_DCache();
+
+    if (ret != 0 || job->done >= job->words)
+        job->kind = FLASH_JOB_IDLE;
+    return ret;
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  获取扇区起始地址
+ * @param  sector: 扇区号 (0~7)
+ * @retval 起始地址, 扇区号无效时返回0
+ */
+uintptr_t flash_sector_addr(uint8_t sector)
+{
+    return (sector < FLASH_SECTOR_NUM) ? (uintptr_t)FLASH_BASE + flash_sectors[sector] : 0;
+}
+
+/**
+ * @brief  获取扇区大小
+ * @param  sector: 扇区号 (0~7)
+ * @retval 字节数, 扇区号无效时返回0
+ */
+uint32_t flash_sector_size(uint8_t sector)
+{
+    return (sector < FLASH_SECTOR_NUM) ? flash_sectors[sector + 1] - flash_sectors[sector] : 0;
+}
+
+/**
+ * @brief  检查区域是否已擦除
+ * @param  addr: 起始地址 (4字节对齐)
+ * @param  words: 字数
+ * @retval 1-全为0xFFFFFFFF, 0-否
+ */
+uint8_t flash_is_blank(uintptr_t addr, uint32_t words)
+{
+    const uint32_t *p = (const uint32_t *)addr;
+
+    while (words--)
+    {
+        if (*p++ != 0xFFFFFFFF)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief  提交扇区擦除任务
+ * @param  sector: 扇区号 (0~7)
+ * @param  owner: 使用者
+ * @retval 0-已提交, -1-参数无效或该使用者的上一个任务未完成
+ */
+int flash_erase_start(uint8_t sector, flash_owner_t owner)
+{
+    if (sector >= FLASH_SECTOR_NUM || owner >= FLASH_OWNER_NUM || flash_jobs[owner].kind != FLASH_JOB_IDLE)
+        return -1;
+
+    flash_job_t *job = &flash_jobs[owner];
+    FLASH_Cycle_Init();
+    job->sector = sector;
+    job->owner = owner;
+    flash_result[owner] = 0;
+    job->kind = FLASH_JOB_ERASE;
+    return 0;
+}
+
+/**
+ * @brief  提交编程任务
+ * @param  addr: 目标地址 (4字节对齐, 已擦除)
+ * @param  data: 源数据, 任务完成前不能修改
+ * @param  words: 字数
+ * @param  owner: 使用者
+ * @retval 0-已提交, -1-参数无效或该使用者的上一个任务未完成
+ */
+int flash_program_start(uintptr_t addr, const uint32_t *data, uint32_t words, flash_owner_t owner)
+{
+    if ((addr & 0x3) || words == 0 || owner >= FLASH_OWNER_NUM || flash_jobs[owner].kind != FLASH_JOB_IDLE)
+        return -1;
+
+    flash_job_t *job = &flash_jobs[owner];
+    FLASH_Cycle_Init();
+    job->addr = addr;
+    job->data = data;
+    job->words = words;
+    job->done = 0;
+    job->owner = owner;
+    flash_result[owner] = 0;
+    job->kind = FLASH_JOB_PROGRAM;
+    return 0;
+}
+
+/**
+ * @brief  推进后台任务, 主循环中调用
+ * @note   每次执行一个任务的一步, 从上次执行的下一个使用者开始找可执行的任务
+ * @retval 1-有任务未完成 (包括因解锁挂起的), 0-空闲
+ */
+int flash_poll(void)
+{
+    uint8_t armed = pwm_armed();
+    flash_job_t *job = NULL;
+    uint8_t pending = 0;
+
+    for (uint8_t i = 0; i < FLASH_OWNER_NUM; i++)
+    {
+        flash_job_t *j = &flash_jobs[(flash_next + i) % FLASH_OWNER_NUM];
+        if (j->kind == FLASH_JOB_IDLE)
+            continue;
+        pending = 1;
+        if (armed && (j->kind == FLASH_JOB_ERASE || j->owner != FLASH_OWNER_BLACKBOX))
+            continue;
+        job = j;
+        break;
+    }
+    if (job == NULL)
+    {
+        if (pending)
+            flash_deferred++;
+        return pending;
+    }
+    flash_next = (job->owner + 1) % FLASH_OWNER_NUM;
+
+    uint8_t kind = job->kind;
+    uint32_t t0 = DWT->CYCCNT;
+    /* 解锁时每步只写1个字, 控制节拍最多被推迟约16us */
+    int ret = (kind == FLASH_JOB_ERASE) ? FLASH_Step_Erase(job)
+                                        : FLASH_Step_Program(job, armed ? 1 : FLASH_PROGRAM_CHUNK);
+    uint32_t stall = DWT->CYCCNT - t0;
+
+    if (stall > flash_stall_max[kind])
+        flash_stall_max[kind] = stall;
+    flash_steps++;
+
+    if (ret != 0)
+    {
+        job->kind = FLASH_JOB_IDLE;
+        flash_result[job->owner] = -1;
+    }
+    for (uint8_t i = 0; i < FLASH_OWNER_NUM; i++)
+    {
+        if (flash_jobs[i].kind != FLASH_JOB_IDLE)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  查询使用者最近提交的任务
+ * @param  owner: 使用者
+ * @retval 1-进行中, 0-已完成 (或从未提交), -1-失败
+ */
+int flash_status(flash_owner_t owner)
+{
+    if (owner >= FLASH_OWNER_NUM)
+        return -1;
+    if (flash_jobs[owner].kind != FLASH_JOB_IDLE)
+        return 1;
+    return flash_result[owner];
+}
+
+/**
+ * @brief  获取最长单步阻塞时间
+ * @param  erase: 1-擦除, 0-编程
+ * @retval 微秒
+ */
+uint32_t flash_stall_max_us(uint8_t erase)
+{
+    uint32_t cycles = flash_stall_max[erase ? FLASH_JOB_ERASE : FLASH_JOB_PROGRAM];
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+/**
+ * @brief  硬件CRC32 (多项式0x04C11DB7, 初值0xFFFFFFFF, 按字输入)
+ * @param  data: 数据 (4字节对齐)
+ * @param  words: 字数
+ * @retval CRC值
+ */
+uint32_t flash_crc32(const void *data, uint32_t words)
+{
+    const uint32_t *p = (const uint32_t *)data;
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    CRC->CR = CRC_CR_RESET;
+    while (words--)
+        CRC->DR = *p++;
+    return CRC->DR;
+}
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  flash: 查看后台擦写状态和最坏阻塞时间
+ */
+void flash_cmd(int argc, void **argv)
+{
+    (void)argc;
+    (void)argv;
+    static const char *kind_names[] = {"idle", "erase", "program"};
+    static const char *owner_names[] = {"param", "blackbox"};
+
+    printf("steps %lu, deferred %lu\n", (unsigned long)flash_steps, (unsigned long)flash_deferred);
+    for (uint8_t i = 0; i < FLASH_OWNER_NUM; i++)
+        printf("%s: %s, last result %d\n", owner_names[i], kind_names[flash_jobs[i].kind], flash_result[i]);
+    printf("worst stall: erase %lu us, program %lu us (%d words/step)\n", (unsigned long)flash_stall_max_us(1),
+           (unsigned long)flash_stall_max_us(0), FLASH_PROGRAM_CHUNK);
+}
+
+ENV_EXPORT(flash, flash_cmd);
@@ -95,3 +95,19 @@ int I2C1_Init(dev_arg_t arg)
     Soft_IIC_Init(&i2c1_bus);
     return 0;
 }
+
+DEV_EXPORT(20, i2c1) {
+    .name = "I2C1",
+    .init = I2C1_Init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
+
+/* 基准测试: 读MPU6050 WHO_AM_I, 一次完整的单字节读事务 */
+static void Bench_I2C_Read_Byte(void)
+{
+    uint8_t id;
+    Soft_IIC_Read_Len(&i2c1_bus, 0x68, 0x75, 1, &id);
+}
+
+BENCH_EXPORT(i2c_read_byte, Bench_I2C_Read_Byte);
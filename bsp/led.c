@@ -74,3 +74,10 @@ Lt led = {
     .on = led_on,
     .off = led_off,
     .toggle = led_toggle};
+
+DEV_EXPORT(50, led) {
+    .name = ONBOARD_LED_NAME,
+    .init = led_init,
+    .enable = led_on,
+    .disable = led_off,
+    .arg.ptr = NULL};
@@ -12,9 +12,22 @@ int nvic_init(dev_arg_t arg)
     // 设置USART1中断优先级
     NVIC_SetPriority(USART1_IRQn, 3);
     NVIC_SetPriority(TIM2_IRQn, 2);
+    NVIC_SetPriority(DMA2_Stream0_IRQn, 4);
+    NVIC_SetPriority(ADC_IRQn, 4);
     // 使能TIM2中断
     NVIC_EnableIRQ(TIM2_IRQn);
     // 使能USART1中断
     NVIC_EnableIRQ(USART1_IRQn);
+    // 使能ADC1 DMA中断
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    // 使能ADC中断 (溢出恢复)
+    NVIC_EnableIRQ(ADC_IRQn);
     return 0;
 }
+
+DEV_EXPORT(40, nvic) {
+    .name = "NVIC",
+    .init = nvic_init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
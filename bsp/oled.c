@@ -0,0 +1,543 @@
+/**
+ * @file    oled.c
+ * @brief   OLED帧缓冲
+ * @details 双缓冲、脏区跟踪、字形缓存和分片后台刷新, 说明见oled.h
+ *
+ * 刷新一个脏区段的总线开销:
+ *   命令: 地址 + 控制字节0x00 + 页地址 + 列低4位 + 列高4位 = 5字节
+ *   数据: 每块 地址 + 控制字节0x40 + n字节
+ * 一个区段分多块发送时只在第一块前设置列地址, 后续块依赖控制器的列地址自增;
+ * 块之间总线上可以有MPU6050的事务, 不影响屏幕的列地址
+ */
+
+#include "driver.h"
+#include "i2c/df_iic.h"
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define OLED_CTRL_CMD  0x00
+#define OLED_CTRL_DATA 0x40
+
+#if OLED_CONTROLLER == OLED_SH1106
+#define OLED_COL_OFFSET 2 /* SH1106内部RAM为132列, 屏幕从第2列开始 */
+#else
+#define OLED_COL_OFFSET 0
+#endif
+
+#define OLED_CMD_BYTES   5 /* 设置页/列地址的总线字节数 */
+#define OLED_CHUNK_EXTRA 2 /* 每个数据块的地址和控制字节 */
+#define OLED_FONT_FIRST   0x20
+#define OLED_FONT_NUM     95 /* 0x20~0x7E */
+
+/*===========================================================================*/
+/*                              字库                                          */
+/*===========================================================================*/
+
+/* 5x7 ASCII字库, 每字节一列, bit0在上 */
+static const uint8_t oled_font5x7[OLED_FONT_NUM][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, /*  !" */
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, /* #$% */
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00}, /* &'( */
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08}, /* )*+ */
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, /* ,-. */
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, /* /01 */
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10}, /* 234 */
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03}, /* 567 */
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, /* 89: */
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, /* ;<= */
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E}, /* >?@ */
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, /* ABC */
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01}, /* DEF */
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, /* GHI */
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40}, /* JKL */
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, /* MNO */
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, /* PQR */
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, /* STU */
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63}, /* VWX */
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00}, /* YZ[ */
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, /* \]^ */
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, /* _`a */
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F}, /* bcd */
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C}, /* efg */
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00}, /* hij */
+    {0x00, 0x7F, 0x10, 0x28, 0x44}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, /* klm */
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08}, /* nop */
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20}, /* qrs */
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, /* tuv */
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C}, /* wxy */
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00}, /* z{| */
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08},                                 /* }~  */
+};
+
+/*===========================================================================*/
+/*                              内部变量                                      */
+/*===========================================================================*/
+
+/* 后缓冲: 绘图函数只写这里 */
+static uint8_t oled_back[OLED_PAGES][OLED_WIDTH];
+static uint8_t oled_dirty_lo[OLED_PAGES]; /* 后缓冲脏列范围, lo > hi 表示该页干净 */
+static uint8_t oled_dirty_hi[OLED_PAGES];
+
+/* 前缓冲: 正在发送的一帧, 发送期间内容不变 */
+static uint8_t oled_front[OLED_PAGES][OLED_WIDTH];
+static uint8_t oled_tx_lo[OLED_PAGES]; /* 前缓冲待发送列范围 */
+static uint8_t oled_tx_hi[OLED_PAGES];
+static uint8_t oled_tx_page = OLED_PAGES; /* 正在发送的页, OLED_PAGES表示空闲 */
+static uint8_t oled_tx_cont;              /* 屏幕列地址已指向oled_tx_lo[oled_tx_page] */
+static uint32_t oled_frame_bytes;         /* 当前帧已发送的总线字节数 */
+
+static volatile uint8_t oled_swap_req; /* 有待交换的帧 */
+static uint8_t oled_ok;                /* 初始化时屏幕有应答 */
+static uint32_t oled_chunk_max;        /* 发送一块的最长耗时 (周期), 用于预算判断 */
+static uint32_t oled_slice_max;        /* 最长分片耗时 (周期) */
+static uint32_t oled_win_start;        /* 速率统计窗口起点 */
+static uint32_t oled_win_bytes;
+static oled_stats_t oled_stats;
+
+/* 字形缓存: 6列字形 (含间隔列) 按字对齐存放, 每个字形两个字 */
+static uint32_t oled_glyph[OLED_FONT_NUM][2];
+
+extern SIAS i2c1_bus;
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+/* 干净时 lo=0xFF, hi=0, 标记任意列后范围正好收缩到该列 */
+static inline void OLED_Mark(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    if (x0 < oled_dirty_lo[page])
+        oled_dirty_lo[page] = x0;
+    if (x1 > oled_dirty_hi[page])
+        oled_dirty_hi[page] = x1;
+}
+
+static inline void OLED_Clean(uint8_t page)
+{
+    oled_dirty_lo[page] = 0xFF;
+    oled_dirty_hi[page] = 0;
+}
+
+/* 写一个字节, 内容改变才标记 */
+static inline void OLED_Put(uint8_t page, uint8_t x, uint8_t v)
+{
+    if (oled_back[page][x] != v)
+    {
+        oled_back[page][x] = v;
+        OLED_Mark(page, x, x);
+    }
+}
+
+static int OLED_Cmd(const uint8_t *cmd, uint16_t len)
+{
+    return Soft_IIC_Write_Len(&i2c1_bus, OLED_ADDR, OLED_CTRL_CMD, len, (uint8_t *)cmd) ? -1 : 0;
+}
+
+static void OLED_Font_Cache_Init(void)
+{
+    for (uint32_t c = 0; c < OLED_FONT_NUM; c++)
+    {
+        uint8_t *cell = (uint8_t *)oled_glyph[c];
+        memcpy(cell, oled_font5x7[c], 5);
+        memset(cell + 5, 0, 3); /* 间隔列和填充 */
+    }
+}
+
+/**
+ * @brief  处理交换请求: 把后缓冲的脏区拷到前缓冲, 开始发送新的一帧
+ * @retval 1-开始了新帧, 0-没有请求或没有脏区
+ * @note   只在前缓冲空闲时调用; 后缓冲中干净的列与前缓冲相同, 只拷脏区即可
+ */
+static uint8_t OLED_Swap_In(void)
+{
+    uint8_t any = 0;
+
+    if (!__atomic_exchange_n(&oled_swap_req, 0, __ATOMIC_ACQUIRE))
+        return 0;
+
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+    {
+        uint8_t lo = oled_dirty_lo[p], hi = oled_dirty_hi[p];
+        oled_tx_lo[p] = lo;
+        oled_tx_hi[p] = hi;
+        if (lo > hi)
+            continue;
+        memcpy(&oled_front[p][lo], &oled_back[p][lo], hi - lo + 1);
+        OLED_Clean(p);
+        any = 1;
+    }
+    oled_stats.swaps++;
+    oled_tx_page = 0;
+    oled_tx_cont = 0;
+    oled_frame_bytes = 0;
+    return any;
+}
+
+/* 跳过已发完的页, 整帧发完返回0 */
+static uint8_t OLED_Tx_Next(void)
+{
+    while (oled_tx_page < OLED_PAGES && oled_tx_lo[oled_tx_page] > oled_tx_hi[oled_tx_page])
+    {
+        oled_tx_page++;
+        oled_tx_cont = 0;
+    }
+    return oled_tx_page < OLED_PAGES;
+}
+
+/**
+ * @brief  发送当前页的下一步: 区段开始时先单独发送一次页/列地址,
+ *         之后每步发送一块数据 (最多OLED_CHUNK_BYTES字节)
+ * @param  bytes: 累加本步的总线字节数
+ * @retval 0-成功, -1-无应答 (下次从本块重新设置列地址重发)
+ */
+static int OLED_Tx_Chunk(uint32_t *bytes)
+{
+    uint8_t p = oled_tx_page;
+    uint8_t lo = oled_tx_lo[p], hi = oled_tx_hi[p];
+    uint8_t n = (hi - lo + 1 > OLED_CHUNK_BYTES) ? OLED_CHUNK_BYTES : hi - lo + 1;
+
+    if (!oled_tx_cont)
+    {
+        uint8_t col = lo + OLED_COL_OFFSET;
+        uint8_t cmd[3] = {(uint8_t)(0xB0 | p), (uint8_t)(col & 0x0F), (uint8_t)(0x10 | (col >> 4))};
+        if (OLED_Cmd(cmd, sizeof(cmd)) != 0)
+            return -1;
+        *bytes += OLED_CMD_BYTES;
+        oled_stats.segments++;
+        oled_tx_cont = 1;
+        return 0;
+    }
+
+    if (Soft_IIC_Write_Len(&i2c1_bus, OLED_ADDR, OLED_CTRL_DATA, n, &oled_front[p][lo]))
+    {
+        oled_tx_cont = 0;
+        return -1;
+    }
+    *bytes += n + OLED_CHUNK_EXTRA;
+
+    if (lo + n > hi)
+    {
+        oled_tx_lo[p] = 0xFF;
+        oled_tx_hi[p] = 0;
+        oled_tx_cont = 0;
+    }
+    else
+        oled_tx_lo[p] = lo + n;
+    return 0;
+}
+
+/**
+ * @brief  在预算内尽量多发送, 一帧发完后若有新的交换请求接着发下一帧
+ * @param  budget: 时间预算 (周期); 预计下一块会超出预算时停止, 每次至少发一块
+ * @retval 本次总线字节数, -1-无应答
+ */
+static int OLED_Slice(uint32_t budget)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t bytes = 0;
+    int ret = 0;
+
+    if (oled_tx_page >= OLED_PAGES && !OLED_Swap_In())
+        return 0;
+
+    for (;;)
+    {
+        if (!OLED_Tx_Next())
+        {
+            oled_frame_bytes += bytes;
+            oled_stats.frames++;
+            oled_stats.last_bytes = oled_frame_bytes;
+            oled_stats.bus_bytes += bytes;
+            oled_win_bytes += bytes;
+            bytes = 0;
+            if (!OLED_Swap_In())
+                break;
+            continue;
+        }
+
+        uint32_t c0 = DWT->CYCCNT;
+        if (OLED_Tx_Chunk(&bytes) != 0)
+        {
+            oled_stats.errors++;
+            ret = -1;
+            break;
+        }
+        uint32_t c = DWT->CYCCNT - c0;
+        if (c > oled_chunk_max)
+            oled_chunk_max = c;
+
+        uint32_t elapsed = DWT->CYCCNT - start;
+        if (elapsed >= budget || budget - elapsed < oled_chunk_max)
+            break;
+    }
+
+    oled_frame_bytes += bytes;
+    oled_stats.bus_bytes += bytes;
+    oled_win_bytes += bytes;
+
+    uint32_t t = DWT->CYCCNT - start;
+    oled_stats.slices++;
+    if (t > oled_slice_max)
+    {
+        oled_slice_max = t;
+        oled_stats.slice_max_us = t / (SystemCoreClock / 1000000);
+    }
+    return ret ? ret : (int)bytes;
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  OLED初始化: 发送控制器初始化序列, 清屏
+ * @retval 0-成功, -1-屏幕无应答
+ */
+int oled_init(dev_arg_t arg)
+{
+    (void)arg;
+    static const uint8_t init_seq[] = {
+        0xAE,       /* 关显示 */
+        0xD5, 0x80, /* 时钟分频 */
+        0xA8, 0x3F, /* 64行 */
+        0xD3, 0x00, /* 显示偏移 */
+        0x40,       /* 起始行0 */
+        0xA1,       /* 列重映射 */
+        0xC8,       /* COM逆序扫描 */
+        0xDA, 0x12, /* COM引脚配置 */
+        0x81, 0xCF, /* 对比度 */
+        0xD9, 0xF1, /* 预充电周期 */
+        0xDB, 0x40, /* VCOMH */
+        0xA4,       /* 显示RAM内容 */
+        0xA6,       /* 正常显示 */
+#if OLED_CONTROLLER == OLED_SH1106
+        0xAD, 0x8B, /* DC-DC开 */
+#else
+        0x20, 0x02, /* 页寻址模式 */
+        0x8D, 0x14, /* 电荷泵开 */
+#endif
+        0xAF, /* 开显示 */
+    };
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    OLED_Font_Cache_Init();
+    oled_ok = (OLED_Cmd(init_seq, sizeof(init_seq)) == 0);
+    if (!oled_ok)
+        return -1;
+
+    /* 上电后控制器RAM内容不确定: 两个缓冲置0但整屏标脏, 第一帧全部发送 */
+    memset(oled_back, 0, sizeof(oled_back));
+    memset(oled_front, 0, sizeof(oled_front));
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+    {
+        oled_dirty_lo[p] = 0;
+        oled_dirty_hi[p] = OLED_WIDTH - 1;
+    }
+    oled_tx_page = OLED_PAGES;
+    oled_win_start = DWT->CYCCNT;
+    oled_swap_req = 1;
+    return 0;
+}
+
+uint8_t oled_present(void)
+{
+    return oled_ok;
+}
+
+/**
+ * @brief  清空帧缓冲 (只标记原来非0的列)
+ */
+void oled_clear(void)
+{
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+        oled_fill(p, 0, OLED_WIDTH - 1, 0);
+}
+
+/**
+ * @brief  设置单个像素
+ */
+void oled_pixel(uint8_t x, uint8_t y, uint8_t on)
+{
+    if (x >= OLED_WIDTH || y >= OLED_HEIGHT)
+        return;
+
+    uint8_t page = y >> 3;
+    uint8_t bit = 1 << (y & 7);
+    uint8_t v = on ? (oled_back[page][x] | bit) : (oled_back[page][x] & ~bit);
+    OLED_Put(page, x, v);
+}
+
+/**
+ * @brief  用固定字节填充一页中的列范围
+ * @param  pattern: 每列的8个纵向像素
+ */
+void oled_fill(uint8_t page, uint8_t x0, uint8_t x1, uint8_t pattern)
+{
+    if (page >= OLED_PAGES || x0 >= OLED_WIDTH)
+        return;
+    if (x1 >= OLED_WIDTH)
+        x1 = OLED_WIDTH - 1;
+
+    for (uint8_t x = x0; x <= x1; x++)
+        OLED_Put(page, x, pattern);
+}
+
+/**
+ * @brief  在指定页绘制字符串
+ * @param  x: 起始列
+ * @param  page: 页 (0~7), 即第page*8行
+ * @retval 结束列 (下一个字符的起始列)
+ * @note   不支持的字符显示为空格, 超出屏幕右边的部分被截断
+ */
+uint8_t oled_text(uint8_t x, uint8_t page, const char *s)
+{
+    if (page >= OLED_PAGES)
+        return x;
+
+    while (*s && x + OLED_FONT_W <= OLED_WIDTH)
+    {
+        uint8_t c = (uint8_t)*s++;
+        if (c < OLED_FONT_FIRST || c >= OLED_FONT_FIRST + OLED_FONT_NUM)
+            c = ' ';
+
+        /* 两次字读取取出6列 */
+        uint32_t w0 = oled_glyph[c - OLED_FONT_FIRST][0];
+        uint32_t w1 = oled_glyph[c - OLED_FONT_FIRST][1];
+        uint8_t *dst = &oled_back[page][x];
+        uint8_t x0 = 0xFF, x1 = 0;
+
+        for (uint8_t i = 0; i < OLED_FONT_W; i++)
+        {
+            uint8_t v = (uint8_t)((i < 4 ? w0 >> (i * 8) : w1 >> ((i - 4) * 8)) & 0xFF);
+            if (dst[i] != v)
+            {
+                dst[i] = v;
+                if (x0 == 0xFF)
+                    x0 = x + i;
+                x1 = x + i;
+            }
+        }
+        if (x0 != 0xFF)
+            OLED_Mark(page, x0, x1);
+        x += OLED_FONT_W;
+    }
+    return x;
+}
+
+/**
+ * @brief  格式化后绘制, 一行最多OLED_TEXT_COLS个字符
+ */
+uint8_t oled_printf(uint8_t x, uint8_t page, const char *fmt, ...)
+{
+    char buf[OLED_TEXT_COLS + 1];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return oled_text(x, page, buf);
+}
+
+/**
+ * @brief  请求把后缓冲作为新的一帧显示
+ * @note   只置标志, 可在任意上下文调用; 前一帧还在发送时请求保留,
+ *         其间的绘制合并到同一帧
+ */
+void oled_swap(void)
+{
+    __atomic_store_n(&oled_swap_req, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief  后台刷新, 主循环中调用
+ * @retval 本次总线字节数, -1-屏幕无应答
+ * @note   每次最多占用约OLED_SLICE_US微秒, 与MPU6050共用总线, 不能在中断中调用
+ */
+int oled_poll(void)
+{
+    int ret = 0;
+
+    if (!oled_ok)
+        return 0;
+
+    if (oled_tx_page < OLED_PAGES || oled_swap_req)
+        ret = OLED_Slice(OLED_SLICE_US * (SystemCoreClock / 1000000));
+
+    /* 每秒更新一次总线速率 */
+    uint32_t win = DWT->CYCCNT - oled_win_start;
+    if (win >= SystemCoreClock)
+    {
+        oled_stats.rate_bps = (uint32_t)((uint64_t)oled_win_bytes * SystemCoreClock / win);
+        oled_win_bytes = 0;
+        oled_win_start += win;
+    }
+    return ret;
+}
+
+/**
+ * @brief  交换并立即发送完所有脏区 (阻塞)
+ * @retval 本次总线字节数, -1-屏幕无应答
+ * @note   不受分片预算限制, 只用于shell等不在意阻塞的场合
+ */
+int oled_flush(void)
+{
+    if (!oled_ok)
+        return -1;
+
+    oled_swap();
+    return OLED_Slice(UINT32_MAX);
+}
+
+const oled_stats_t *oled_get_stats(void)
+{
+    return &oled_stats;
+}
+
+DEV_EXPORT(25, oled) {
+    .name = OLED_SH1106_NAME,
+    .init = oled_init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  oled [text <页> <内容> | clear | flush]: 查看传输统计或测试绘制
+ * @note   text/clear只绘制并请求交换, 由主循环后台发送; flush立即阻塞发送
+ */
+void oled_cmd(int argc, void **argv)
+{
+    if (argc >= 3 && !strcmp(argv[0], "text"))
+    {
+        oled_fill(atoi(argv[1]), 0, OLED_WIDTH - 1, 0);
+        oled_text(0, atoi(argv[1]), argv[2]);
+        oled_swap();
+    }
+    else if (argc >= 1 && !strcmp(argv[0], "clear"))
+    {
+        oled_clear();
+        oled_swap();
+    }
+    else if (argc >= 1 && !strcmp(argv[0], "flush"))
+        printf("oled flush: %d bytes\n", oled_flush());
+
+    printf("oled %s, frames %lu/%lu swaps, segments %lu, bus %lu bytes, last frame %lu, errors %lu\n",
+           oled_ok ? "ok" : "absent", (unsigned long)oled_stats.frames, (unsigned long)oled_stats.swaps,
+           (unsigned long)oled_stats.segments, (unsigned long)oled_stats.bus_bytes,
+           (unsigned long)oled_stats.last_bytes, (unsigned long)oled_stats.errors);
+    printf("oled rate %lu B/s, slices %lu, worst slice %lu us (budget %d us)\n", (unsigned long)oled_stats.rate_bps,
+           (unsigned long)oled_stats.slices, (unsigned long)oled_stats.slice_max_us, OLED_SLICE_US);
+    if (argc < 1)
+        printf("Usage: oled <text page str|clear|flush>\n");
+}
+
+ENV_EXPORT(oled, oled_cmd);
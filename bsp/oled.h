@@ -0,0 +1,74 @@
+/**
+ * @file    oled.h
+ * @brief   OLED帧缓冲
+ * @details 128x64单色屏 (SH1106/SSD1306), 软件I2C (i2c1_bus, 与MPU6050共用)
+ *
+ * 帧缓冲按控制器的页格式存放: fb[page][x], 每字节为一列的8个纵向像素, bit0在上.
+ * 绘图函数只在字节内容真的改变时标记脏区, 每页记录一个脏列范围 [lo, hi];
+ * 只发送脏区, 重复绘制相同内容不产生总线流量.
+ *
+ * 双缓冲与后台刷新:
+ *   - 绘图函数写后缓冲, 画完一帧调用oled_swap请求显示 (只置标志)
+ *   - oled_poll在主循环中处理请求: 前缓冲空闲时把后缓冲的脏区拷过去,
+ *     然后按OLED_CHUNK_BYTES分块发送, 每次调用最多占用约OLED_SLICE_US微秒
+ *   - 前一帧未发完时的绘制和交换请求合并到下一帧, 屏幕上不会出现半帧
+ *   - 绘图函数和oled_poll都在主循环中运行, 交换时的拷贝不需要关中断
+ *
+ * 文字按页对齐绘制, 字形为5x7点阵加1列间隔, 初始化时展开到RAM中的字形缓存,
+ * 每个字形占两个对齐的字, 绘制时整字读取
+ */
+
+#ifndef __OLED_H
+#define __OLED_H
+
+#include <stdint.h>
+#include <dev_frame.h>
+
+#define OLED_WIDTH  128
+#define OLED_HEIGHT 64
+#define OLED_PAGES  (OLED_HEIGHT / 8)
+#define OLED_ADDR   0x3C /* 7位地址 */
+
+#define OLED_SH1106  0
+#define OLED_SSD1306 1
+#ifndef OLED_CONTROLLER
+#define OLED_CONTROLLER OLED_SH1106
+#endif
+
+#define OLED_FONT_W     6 /* 字形宽度, 含1列间隔 */
+#define OLED_TEXT_COLS  (OLED_WIDTH / OLED_FONT_W)
+
+/* 后台刷新分片: 块长度决定单次I2C事务的时长, 须小于分片预算;
+ * 软件I2C约45us/字节, 一块4字节数据加地址和控制字节约270us */
+#ifndef OLED_SLICE_US
+#define OLED_SLICE_US 300 /* 每次oled_poll的时间预算 (us) */
+#endif
+#define OLED_CHUNK_BYTES 4 /* 每块数据字节数 */
+
+/* 传输统计 */
+typedef struct
+{
+    uint32_t swaps;        /* 处理的交换请求数 */
+    uint32_t frames;       /* 发送完成的帧数 */
+    uint32_t segments;     /* 发送的脏区段数 */
+    uint32_t bus_bytes;    /* 总线字节数, 含地址、控制字节和页/列命令 */
+    uint32_t last_bytes;   /* 最近一帧的总线字节数 */
+    uint32_t errors;       /* I2C无应答次数 */
+    uint32_t slices;       /* 发送分片数 */
+    uint32_t slice_max_us; /* 最长分片耗时 */
+    uint32_t rate_bps;     /* 最近一秒的总线字节速率 */
+} oled_stats_t;
+
+int oled_init(dev_arg_t arg);
+uint8_t oled_present(void);
+void oled_clear(void);
+void oled_pixel(uint8_t x, uint8_t y, uint8_t on);
+void oled_fill(uint8_t page, uint8_t x0, uint8_t x1, uint8_t pattern);
+uint8_t oled_text(uint8_t x, uint8_t page, const char *s);
+uint8_t oled_printf(uint8_t x, uint8_t page, const char *fmt, ...);
+void oled_swap(void);
+int oled_poll(void);
+int oled_flush(void);
+const oled_stats_t *oled_get_stats(void);
+
+#endif /* __OLED_H */
@@ -0,0 +1,453 @@
+/**
+ * @file    param.c
+ * @brief   运行参数存储
+ * @details 参数表常量放在Flash (param_table段), 运行值在RAM影子数组,
+ *          shell命令 param get/set/save 修改和保存
+ *
+ * Flash镜像 (扇区2/3交替, 双缓冲):
+ *   magic | crc | seq | layout | count | value[count]
+ *   - crc覆盖seq~value, layout为参数表ID/类型的CRC
+ *   - 保存时写入非当前扇区, magic最后写入, 掉电只会丢失本次写入
+ *   - 启动时取seq最大的有效镜像, 一次memcpy载入影子数组
+ *
+ * 后台保存:
+ *   param_save只做快照并提交, 主循环中flash_poll逐步写入, param_poll推进各阶段;
+ *   新镜像校验通过后预擦除旧扇区, 下次保存只需编程, 不再有擦除阻塞
+ *   任何时刻至少有一个有效镜像: 擦除的总是非当前扇区
+ */
+
+#include "driver.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define PARAM_SECTOR_A 2          /* 0x08008000, 16KB */
+#define PARAM_SECTOR_B 3          /* 0x0800C000, 16KB */
+#define PARAM_MAGIC    0x4D524150 /* "PARM" */
+
+/* 镜像中参与CRC计算的字数: seq, layout, count, value[] */
+#define PARAM_CRC_WORDS (3 + PARAM_NUM)
+
+/* 后台保存阶段 */
+typedef enum
+{
+    PARAM_SAVE_IDLE = 0,
+    PARAM_SAVE_ERASE,    /* 擦除目标扇区 (未预擦除时) */
+    PARAM_SAVE_BODY,     /* 写magic之后的内容 */
+    PARAM_SAVE_MAGIC,    /* 写magic, 镜像生效 */
+    PARAM_SAVE_PREERASE  /* 预擦除旧扇区 */
+} param_save_stage_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t seq;    /* 写入序号, 越大越新 */
+    uint32_t layout; /* 参数表布局CRC */
+    uint32_t count;  /* 参数个数 */
+    param_value_t value[PARAM_NUM];
+} param_image_t;
+
+/*===========================================================================*/
+/*                              变量                                          */
+/*===========================================================================*/
+
+CCM_STATE param_value_t param_shadow[PARAM_NUM]; /* 运行值, 按ID-PARAM_ID_BASE索引 */
+
+static const param_info_t *param_table;   /* 参数表 (Flash), 按ID排序 */
+static uint32_t param_count;              /* 参数表条目数 */
+static uint32_t param_layout;             /* 当前参数表布局CRC */
+static uint32_t param_seq;                /* 当前有效镜像序号 */
+static uint8_t param_slot;                /* 当前有效镜像扇区, 0表示无 */
+static param_image_t param_img;           /* 保存时的镜像缓冲区 */
+static uint8_t param_stage;               /* param_save_stage_t */
+static uint8_t param_target;              /* 正在写入的扇区 */
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  计算参数表布局CRC (ID和类型)
+ */
+static uint32_t Param_Layout_Crc(void)
+{
+    uint32_t words[PARAM_NUM];
+
+    for (uint32_t i = 0; i < PARAM_NUM; i++)
+        words[i] = (i < param_count) ? (param_table[i].id | ((uint32_t)param_table[i].type << 16)) : 0;
+    return flash_crc32(words, PARAM_NUM);
+}
+
+/**
+ * @brief  检查扇区中的镜像是否有效
+ * @retval 镜像指针, 无效时返回NULL
+ */
+static const param_image_t *Param_Image_Check(uint8_t sector)
+{
+    const param_image_t *img = (const param_image_t *)flash_sector_addr(sector);
+
+    if (img->magic != PARAM_MAGIC || img->layout != param_layout || img->count != PARAM_NUM)
+        return NULL;
+    if (img->crc != flash_crc32(&img->seq, PARAM_CRC_WORDS))
+        return NULL;
+    return img;
+}
+
+/**
+ * @brief  按字符串解析参数值
+ * @retval 0-成功, -1-格式错误
+ */
+static int Param_Parse(const param_info_t *p, const char *str, param_value_t *v)
+{
+    char *end;
+
+    switch (p->type)
+    {
+    case PARAM_TYPE_U32:
+        v->u = strtoul(str, &end, 0);
+        break;
+    case PARAM_TYPE_I32:
+        v->i = strtol(str, &end, 0);
+        break;
+    default:
+        v->f = strtof(str, &end);
+        break;
+    }
+    return (end == str || *end != '\0') ? -1 : 0;
+}
+
+static void Param_Print(const param_info_t *p)
+{
+    const param_value_t *v = &param_shadow[p->id - PARAM_ID_BASE];
+
+    switch (p->type)
+    {
+    case PARAM_TYPE_U32:
+        printf("%2u %-14s %lu [%lu, %lu]\n", p->id, p->name, (unsigned long)v->u,
+               (unsigned long)p->min.u, (unsigned long)p->max.u);
+        break;
+    case PARAM_TYPE_I32:
+        printf("%2u %-14s %ld [%ld, %ld]\n", p->id, p->name, (long)v->i, (long)p->min.i, (long)p->max.i);
+        break;
+    default:
+        printf("%2u %-14s %.4f [%.4f, %.4f]\n", p->id, p->name, v->f, p->min.f, p->max.f);
+        break;
+    }
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  参数初始化: 校验参数表, 载入Flash镜像或默认值
+ * @retval 0-成功, -1-参数表与PARAM_xxx定义不一致 (仍使用默认值运行)
+ */
+int param_init(dev_arg_t arg)
+{
+    (void)arg;
+    int ret = 0;
+
+    param_table = (const param_info_t *)PARAM_TABLE_BEGIN;
+    param_count = (const param_info_t *)PARAM_TABLE_END - param_table;
+
+    /* 表项须按ID连续排列, 否则下标访问失效 */
+    if (param_count != PARAM_NUM)
+        ret = -1;
+    for (uint32_t i = 0; i < param_count && ret == 0; i++)
+    {
+        if (param_table[i].id != PARAM_ID_BASE + i)
+            ret = -1;
+    }
+    if (ret != 0)
+    {
+        printf("param table mismatch: %lu entries, %d expected\n", (unsigned long)param_count, PARAM_NUM);
+        /* 能对上ID的参数仍给默认值, 其余为0; 禁用按表查找和保存 */
+        for (uint32_t i = 0; i < param_count; i++)
+        {
+            if (param_table[i].id >= PARAM_ID_BASE && param_table[i].id < PARAM_ID_END)
+                param_shadow[param_table[i].id - PARAM_ID_BASE] = param_table[i].def;
+        }
+        param_count = 0;
+        return -1;
+    }
+
+    param_layout = Param_Layout_Crc();
+
+    const param_image_t *a = Param_Image_Check(PARAM_SECTOR_A);
+    const param_image_t *b = Param_Image_Check(PARAM_SECTOR_B);
+    if (a != NULL && b != NULL)
+    {
+        /* 序号回绕时按差值判断新旧 */
+        if ((int32_t)(a->seq - b->seq) < 0)
+            a = NULL;
+        else
+            b = NULL;
+    }
+
+    if (a != NULL || b != NULL)
+    {
+        const param_image_t *img = (a != NULL) ? a : b;
+        memcpy(param_shadow, img->value, sizeof(param_shadow));
+        param_seq = img->seq;
+        param_slot = (a != NULL) ? PARAM_SECTOR_A : PARAM_SECTOR_B;
+    }
+    else
+    {
+        param_reset_default();
+        param_seq = 0;
+        param_slot = 0;
+    }
+
+    /* 备用扇区不是空的就在后台预擦除, 启动阶段电机未解锁 */
+    uint8_t spare = (param_slot == PARAM_SECTOR_A) ? PARAM_SECTOR_B : PARAM_SECTOR_A;
+    if (!flash_is_blank(flash_sector_addr(spare), sizeof(param_image_t) / 4) &&
+        flash_erase_start(spare, FLASH_OWNER_PARAM) == 0)
+        param_stage = PARAM_SAVE_PREERASE;
+    return 0;
+}
+
+/**
+ * @brief  按ID获取参数描述
+ * @retval 描述指针, ID无效时返回NULL
+ */
+const param_info_t *param_info(uint16_t id)
+{
+    if (id < PARAM_ID_BASE || id - PARAM_ID_BASE >= param_count)
+        return NULL;
+    return &param_table[id - PARAM_ID_BASE];
+}
+
+/**
+ * @brief  按名称获取参数描述
+ */
+const param_info_t *param_find(const char *name)
+{
+    for (uint32_t i = 0; i < param_count; i++)
+    {
+        if (!strcmp(param_table[i].name, name))
+            return &param_table[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief  修改参数运行值 (不写Flash)
+ * @retval 0-成功, -1-ID无效或超出范围
+ */
+int param_set(uint16_t id, param_value_t value)
+{
+    const param_info_t *p = param_info(id);
+
+    if (p == NULL)
+        return -1;
+    switch (p->type)
+    {
+    case PARAM_TYPE_U32:
+        if (value.u < p->min.u || value.u > p->max.u)
+            return -1;
+        break;
+    case PARAM_TYPE_I32:
+        if (value.i < p->min.i || value.i > p->max.i)
+            return -1;
+        break;
+    default:
+        if (!(value.f >= p->min.f && value.f <= p->max.f)) /* 同时排除NaN */
+            return -1;
+        break;
+    }
+    param_shadow[id - PARAM_ID_BASE] = value;
+    return 0;
+}
+
+/**
+ * @brief  恢复全部默认值 (不写Flash)
+ */
+void param_reset_default(void)
+{
+    for (uint32_t i = 0; i < param_count; i++)
+        param_shadow[i] = param_table[i].def;
+}
+
+/**
+ * @brief  保存运行值到Flash (后台进行)
+ * @retval 0-已提交, -1-正在保存或参数表无效
+ * @note   提交时对运行值做快照, 之后的修改不影响本次保存
+ */
+int param_save(void)
+{
+    if (param_count != PARAM_NUM || param_stage != PARAM_SAVE_IDLE)
+        return -1;
+
+    param_target = (param_slot == PARAM_SECTOR_A) ? PARAM_SECTOR_B : PARAM_SECTOR_A;
+    uintptr_t addr = flash_sector_addr(param_target);
+
+    param_img.magic = PARAM_MAGIC;
+    param_img.seq = param_seq + 1;
+    param_img.layout = param_layout;
+    param_img.count = PARAM_NUM;
+    memcpy(param_img.value, param_shadow, sizeof(param_shadow));
+    param_img.crc = flash_crc32(&param_img.seq, PARAM_CRC_WORDS);
+
+    if (flash_is_blank(addr, sizeof(param_img) / 4))
+    {
+        /* 先写magic之后的内容, 最后写magic使镜像生效 */
+        if (flash_program_start(addr + 4, (const uint32_t *)&param_img + 1, sizeof(param_img) / 4 - 1,
+                                FLASH_OWNER_PARAM) != 0)
+            return -1;
+        param_stage = PARAM_SAVE_BODY;
+    }
+    else
+    {
+        if (flash_erase_start(param_target, FLASH_OWNER_PARAM) != 0)
+            return -1;
+        param_stage = PARAM_SAVE_ERASE;
+    }
+    return 0;
+}
+
+/**
+ * @brief  推进后台保存, 主循环中调用
+ * @retval 1-保存进行中, 0-空闲
+ */
+int param_poll(void)
+{
+    int ret = flash_status(FLASH_OWNER_PARAM);
+    uintptr_t addr = flash_sector_addr(param_target);
+
+    if (param_stage == PARAM_SAVE_IDLE || ret == 1)
+        return param_stage != PARAM_SAVE_IDLE;
+
+    if (ret != 0)
+    {
+        if (param_stage != PARAM_SAVE_PREERASE)
+            DLOG("param save failed\n");
+        param_stage = PARAM_SAVE_IDLE;
+        return 0;
+    }
+
+    switch (param_stage)
+    {
+    /* 提交失败时保持当前阶段下次重试 */
+    case PARAM_SAVE_ERASE:
+        if (flash_program_start(addr + 4, (const uint32_t *)&param_img + 1, sizeof(param_img) / 4 - 1,
+                                FLASH_OWNER_PARAM) == 0)
+            param_stage = PARAM_SAVE_BODY;
+        break;
+    case PARAM_SAVE_BODY:
+        if (flash_program_start(addr, &param_img.magic, 1, FLASH_OWNER_PARAM) == 0)
+            param_stage = PARAM_SAVE_MAGIC;
+        break;
+    case PARAM_SAVE_MAGIC:
+    {
+        if (Param_Image_Check(param_target) == NULL)
+        {
+            DLOG("param save verify failed\n");
+            param_stage = PARAM_SAVE_IDLE;
+            break;
+        }
+        /* 新镜像已生效, 旧扇区可以擦除 */
+        uint8_t old = param_slot;
+        param_seq = param_img.seq;
+        param_slot = param_target;
+        param_target = old;
+        DLOG("param saved to sector %u, seq %lu\n", param_slot, param_seq);
+        param_stage = (param_target != 0 && flash_erase_start(param_target, FLASH_OWNER_PARAM) == 0)
+                          ? PARAM_SAVE_PREERASE
+                          : PARAM_SAVE_IDLE;
+        break;
+    }
+    default:
+        param_stage = PARAM_SAVE_IDLE;
+        break;
+    }
+    return param_stage != PARAM_SAVE_IDLE;
+}
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  param list | get <名称|ID> | set <名称|ID> <值> | save | default
+ */
+void param_cmd(int argc, void **argv)
+{
+    const param_info_t *p = NULL;
+    param_value_t v;
+
+    if (argc < 1)
+    {
+        printf("Usage: param <list|get|set|save|default> [name|id] [value]\n");
+        return;
+    }
+    if (argc >= 2)
+    {
+        char *key = (char *)argv[1];
+        p = (key[0] >= '0' && key[0] <= '9') ? param_info((uint16_t)atoi(key)) : param_find(key);
+    }
+
+    if (!strcmp(argv[0], "list"))
+    {
+        printf("source: %s, seq %lu%s\n", param_slot ? "flash" : "default", (unsigned long)param_seq,
+               (param_stage == PARAM_SAVE_IDLE || param_stage == PARAM_SAVE_PREERASE) ? "" : ", saving");
+        for (uint32_t i = 0; i < param_count; i++)
+            Param_Print(&param_table[i]);
+        return;
+    }
+    if (!strcmp(argv[0], "save"))
+    {
+        if (param_save() != 0)
+        {
+            printf("param save busy\n");
+            return;
+        }
+        printf("param saving%s\n", pwm_armed() ? ", waiting for disarm" : "");
+        return;
+    }
+    if (!strcmp(argv[0], "default"))
+    {
+        param_reset_default();
+        printf("param reset to default (not saved)\n");
+        return;
+    }
+    if (p == NULL)
+    {
+        printf("Unknown parameter\n");
+        return;
+    }
+    if (!strcmp(argv[0], "get"))
+    {
+        Param_Print(p);
+        return;
+    }
+    if (!strcmp(argv[0], "set") && argc >= 3)
+    {
+        if (Param_Parse(p, (char *)argv[2], &v) != 0 || param_set(p->id, v) != 0)
+        {
+            printf("Invalid value for %s\n", p->name);
+            return;
+        }
+        Param_Print(p);
+        return;
+    }
+    printf("Usage: param <list|get|set|save|default> [name|id] [value]\n");
+}
+
+ENV_EXPORT(param, param_cmd);
+
+/*===========================================================================*/
+/*                              设备注册                                      */
+/*===========================================================================*/
+
+/* 在串口之后、电机输出之前载入, 各驱动初始化时即可读取参数 */
+DEV_EXPORT(15, param) {
+    .name = "PARAM",
+    .init = param_init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
@@ -0,0 +1,139 @@
+/**
+ * @file    param.h
+ * @brief   运行参数表
+ * @details 参数以 (ID, 类型, 范围, 默认值) 在所属模块中通过PARAM_xxx宏注册,
+ *          链接器按ID排序后放入param_table段; 运行值保存在RAM影子数组中,
+ *          热路径按ID直接下标读取
+ *
+ * 参数ID:
+ *   两位数字, 从PARAM_ID_BASE起连续分配, 新参数追加在末尾并更新PARAM_ID_END;
+ *   ID或类型变化后Flash中的旧镜像自动失效, 启动时回到默认值
+ *
+ * 持久化:
+ *   Flash扇区2/3 (各16KB) 交替写入, 带序号和CRC32, 启动取最新的有效镜像
+ */
+
+#ifndef __PARAM_H
+#define __PARAM_H
+
+#include <stdint.h>
+#include "section.h"
+
+/*===========================================================================*/
+/*                              参数ID                                        */
+/*===========================================================================*/
+
+#define PARAM_ID_BASE 10
+
+/* 姿态PID (control.c) */
+#define PARAM_PID_ROLL_P  10
+#define PARAM_PID_ROLL_I  11
+#define PARAM_PID_ROLL_D  12
+#define PARAM_PID_PITCH_P 13
+#define PARAM_PID_PITCH_I 14
+#define PARAM_PID_PITCH_D 15
+#define PARAM_PID_YAW_P   16
+#define PARAM_PID_YAW_I   17
+#define PARAM_PID_YAW_D   18
+
+/* 滤波器截止频率 (control.c) */
+#define PARAM_GYRO_LPF_HZ  19
+#define PARAM_ACCEL_LPF_HZ 20
+
+/* 遥测 (telem.c), PARAM_TELEM_RATE_HZ为姿态流 */
+#define PARAM_TELEM_RATE_HZ 21
+
+/* 电机输出 (pwm.c) */
+#define PARAM_PWM_FREQ 22
+#define PARAM_PWM_MAX  23
+
+/* 遥控输入 (rc.c, sensor.c) */
+#define PARAM_RC_PROTO        24
+#define PARAM_RC_MAX_ANGLE    25
+#define PARAM_RC_MAX_YAW_RATE 26
+
+/* 遥测其他数据流和电池测量 (telem.c) */
+#define PARAM_TELEM_BATT_HZ 27
+#define PARAM_TELEM_LOOP_HZ 28
+#define PARAM_TELEM_RC_HZ   29
+#define PARAM_VBAT_SCALE    30
+#define PARAM_CURR_SCALE    31
+
+/* ADC采样 (adc.c) */
+#define PARAM_ADC_PHASE 32
+
+#define PARAM_ID_END 33
+#define PARAM_NUM    (PARAM_ID_END - PARAM_ID_BASE)
+
+/*===========================================================================*/
+/*                              类型定义                                      */
+/*===========================================================================*/
+
+typedef enum
+{
+    PARAM_TYPE_U32 = 0,
+    PARAM_TYPE_I32,
+    PARAM_TYPE_FLOAT
+} param_type_t;
+
+typedef union
+{
+    uint32_t u;
+    int32_t i;
+    float f;
+} param_value_t;
+
+/* 参数描述, 常量表项 */
+typedef struct
+{
+    uint16_t id;
+    uint16_t type; /* param_type_t */
+    const char *name;
+    param_value_t min;
+    param_value_t max;
+    param_value_t def;
+} param_info_t;
+
+/*===========================================================================*/
+/*                              注册宏                                        */
+/*===========================================================================*/
+
+/* id须为PARAM_xxx宏, 展开后的数字即段名后缀 */
+#define PARAM_EXPORT(pid, var, t, field, lo, hi, d) \
+    const param_info_t __param_##var SECTION_USED("param_table." #pid) = { \
+        .id = pid, .type = t, .name = #var, .min = {.field = lo}, .max = {.field = hi}, .def = {.field = d}}
+
+#define PARAM_U32(pid, var, lo, hi, d)   PARAM_EXPORT(pid, var, PARAM_TYPE_U32, u, lo, hi, d)
+#define PARAM_I32(pid, var, lo, hi, d)   PARAM_EXPORT(pid, var, PARAM_TYPE_I32, i, lo, hi, d)
+#define PARAM_FLOAT(pid, var, lo, hi, d) PARAM_EXPORT(pid, var, PARAM_TYPE_FLOAT, f, lo, hi, d)
+
+/*===========================================================================*/
+/*                              访问接口                                      */
+/*===========================================================================*/
+
+extern param_value_t param_shadow[PARAM_NUM];
+
+/* 热路径读取, ID须为PARAM_xxx常量 */
+static inline uint32_t param_get_u(uint16_t id)
+{
+    return param_shadow[id - PARAM_ID_BASE].u;
+}
+
+static inline int32_t param_get_i(uint16_t id)
+{
+    return param_shadow[id - PARAM_ID_BASE].i;
+}
+
+static inline float param_get_f(uint16_t id)
+{
+    return param_shadow[id - PARAM_ID_BASE].f;
+}
+
+const param_info_t *param_info(uint16_t id);
+const param_info_t *param_find(const char *name);
+int param_set(uint16_t id, param_value_t value);
+void param_reset_default(void);
+int param_save(void);
+int param_poll(void);
+
+#endif /* __PARAM_H */
@@ -9,31 +9,107 @@
  *   PWM通道3: PB7  - TIM4_CH2  (通用定时器)
  *   PWM通道4: PE6  - TIM9_CH2  (基本定时器)
  *
- * 固定参数:
+ * 默认参数:
  *   - 计数模式: 向上计数
  *   - PWM模式: PWM模式1
- *   - PWM频率: 5kHz (固定)
- *   - 占空比: 0~8000 (对应0%~80%)
+ *   - PWM频率: 5kHz (可通过pwm_set_freq修改, 最高32kHz)
+ *   - 占空比: 0~8000 (对应0%~100%), 按各定时器实际ARR缩放
+ *
+ * 频率配置:
+ *   - 定时器输入时钟由RCC分频配置计算 (tim_get_clock)
+ *   - 选取满足频率的最小PSC, 使ARR (即分辨率) 最大
+ *   - 同步模式下先算TIM1, 从定时器由TIM1的周期推出, 周期在时间上完全相等;
+ *     TIM1总计数不能被时钟比整除时把TIM1周期减少几个计数
+ *   - 修改频率时在UDIS锁存下同时写PSC/ARR/CCR, 下一个更新事件一起生效
+ *
+ * 同步输出:
+ *   - TIM1为主定时器, 更新事件作为TRGO
+ *   - TIM4 (ITR0=TIM1) 和 TIM3 (ITR0=TIM1) 工作在复位从模式, 与TIM1同相
+ *   - TIM9无法直接由TIM1触发, 经TIM3中继 (TIM9 ITR1=TIM3)
+ *   - pwm_set_all 通过UDIS锁存, 四路比较值在同一个更新事件生效
+ *   - 放开锁存避开TIM1溢出前的保护窗口, 溢出不会落在逐个放开的间隙里
+ *
+ * ADC同步触发:
+ *   - TIM1_CH1不接引脚, 仅作为ADC1规则组外部触发源 (TIM1_CC1事件)
+ *   - 触发相位以占空比单位给出, 随频率修改自动缩放
+ *
+ * 单脉冲输出 (OneShot125 / Multishot):
+ *   - 定时器工作在OPM + PWM模式2, 计数时钟42MHz
+ *   - 每次pwm_set_all触发一次脉冲, 脉冲末尾对齐, 计数结束后自动停止
  ******************************************************************************/
 
 #include "driver.h"
 
 /*******************************************************************************
- * 宏定义 - 固定参数配置
+ * 宏定义 - 参数配置
  ******************************************************************************/
-#define PWM_FREQ 5000      /* PWM频率: 5kHz (固定) */
-#define PWM_ARR_VALUE 8000 /* 最大占空比值，同时也是ARR值 */
-
-/* 预分频值计算 (基于168MHz和84MHz时钟) */
-#define TIM1_PSC ((168000000 / (PWM_FREQ * PWM_ARR_VALUE)) - 1) /* TIM1预分频 = 3 */
-#define TIM4_PSC ((84000000 / (PWM_FREQ * PWM_ARR_VALUE)) - 1)  /* TIM4预分频 = 1 */
-#define TIM9_PSC ((168000000 / (PWM_FREQ * PWM_ARR_VALUE)) - 1) /* TIM9预分频 = 3 */
+#define PWM_FREQ 5000 /* 默认PWM频率: 5kHz */
 
 /* GPIO复用功能编号 */
 #define GPIO_AF_TIM1 1
 #define GPIO_AF_TIM4 2
 #define GPIO_AF_TIM9 3
 
+/* 从模式配置 (SMCR) */
+#define TIM_TS_ITR0    (0x0 << 4) /* 触发源: 内部触发0 */
+#define TIM_TS_ITR1    (0x1 << 4) /* 触发源: 内部触发1 */
+#define TIM_SMS_RESET  0x4        /* 从模式: 复位模式 */
+#define TIM_MMS_UPDATE (0x2 << 4) /* 主模式: 更新事件作为TRGO */
+
+/* 单脉冲协议参数 (计数时钟42MHz, 即42个计数/us) */
+#define PWM_TICK_PER_US      42
+#define ONESHOT125_MIN_TICKS (125 * PWM_TICK_PER_US) /* 125us */
+#define ONESHOT125_MAX_TICKS (250 * PWM_TICK_PER_US) /* 250us */
+#define MULTISHOT_MIN_TICKS  (5 * PWM_TICK_PER_US)   /* 5us */
+#define MULTISHOT_MAX_TICKS  (25 * PWM_TICK_PER_US)  /* 25us */
+
+/* 放开UDIS锁存 (三个定时器CR1各读改写一次) 所需时间的上限, 内核周期 */
+#define PWM_RELEASE_CYCLES 128
+
+/* 定时器索引 */
+#define PWM_TIM1_IDX 0
+#define PWM_TIM4_IDX 1
+#define PWM_TIM9_IDX 2
+#define PWM_TIM3_IDX 3 /* 同步中继, 无输出 */
+#define PWM_TIM_NUM  4
+
+/* 定时器时基 */
+typedef struct
+{
+    TIM_TypeDef *tim;
+    uint32_t freq;   /* 当前频率 (Hz) */
+    uint16_t psc;    /* 预分频值 */
+    uint32_t period; /* 计数周期 = ARR + 1 (即分辨率) */
+    uint32_t guard;  /* PWM_RELEASE_CYCLES对应的计数值 */
+} pwm_timer_t;
+
+/* 输出通道 */
+typedef struct
+{
+    uint8_t timer;          /* 所属定时器索引 */
+    volatile uint32_t *ccr; /* 比较寄存器 */
+} pwm_channel_t;
+
+static pwm_timer_t pwm_timers[PWM_TIM_NUM] = {
+    {.tim = TIM1},
+    {.tim = TIM4},
+    {.tim = TIM9},
+    {.tim = TIM3}};
+
+static const pwm_channel_t pwm_channels[4] = {
+    {PWM_TIM1_IDX, &TIM1->CCR3}, /* PE13 */
+    {PWM_TIM4_IDX, &TIM4->CCR3}, /* PD14 */
+    {PWM_TIM4_IDX, &TIM4->CCR2}, /* PB7 */
+    {PWM_TIM9_IDX, &TIM9->CCR2}  /* PE6 */
+};
+
+static uint16_t pwm_duty[4];                  /* 各通道逻辑占空比 (0~PWM_MAX_DUTY) */
+static uint16_t pwm_adc_phase;                /* ADC触发相位 (0~PWM_MAX_DUTY) */
+static uint8_t pwm_adc_trig_on = 0;           /* ADC触发使能标志 */
+static uint8_t pwm_sync_on = 0;               /* 同步输出模式标志 */
+static pwm_proto_t pwm_proto = PWM_PROTO_PWM; /* 当前输出协议 */
+static uint16_t pwm_pulse_min, pwm_pulse_max; /* 单脉冲宽度范围 (计数值) */
+
 /*******************************************************************************
  * @brief  GPIO初始化 - 配置PE13, PD14, PB7, PE6为PWM输出
  ******************************************************************************/
@@ -82,9 +158,9 @@ static void PWM_TIM1_Init(void)
 {
     RCC->APB2ENR |= RCC_APB2ENR_TIM1EN; /* 使能TIM1时钟 */
 
-    TIM1->PSC = TIM1_PSC;          /* 预分频 */
-    TIM1->ARR = PWM_ARR_VALUE - 1; /* 自动重载值 */
-    TIM1->CR1 &= ~TIM_CR1_DIR;     /* 向上计数 */
+    TIM1->PSC = pwm_timers[PWM_TIM1_IDX].psc;        /* 预分频 */
+    TIM1->ARR = pwm_timers[PWM_TIM1_IDX].period - 1; /* 自动重载值 */
+    TIM1->CR1 &= ~TIM_CR1_DIR;                       /* 向上计数 */
 
     /* CH3: PWM模式1, 预装载使能 */
     TIM1->CCMR2 &= ~TIM_CCMR2_OC3M;
@@ -107,8 +183,8 @@ static void PWM_TIM4_Init(void)
 {
     RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; /* 使能TIM4时钟 */
 
-    TIM4->PSC = TIM4_PSC;
-    TIM4->ARR = PWM_ARR_VALUE - 1;
+    TIM4->PSC = pwm_timers[PWM_TIM4_IDX].psc;
+    TIM4->ARR = pwm_timers[PWM_TIM4_IDX].period - 1;
     TIM4->CR1 &= ~TIM_CR1_DIR; /* 向上计数 */
 
     /* CH2: PWM模式1 */
@@ -137,8 +213,8 @@ static void PWM_TIM9_Init(void)
 {
     RCC->APB2ENR |= RCC_APB2ENR_TIM9EN; /* 使能TIM9时钟 */
 
-    TIM9->PSC = TIM9_PSC;
-    TIM9->ARR = PWM_ARR_VALUE - 1;
+    TIM9->PSC = pwm_timers[PWM_TIM9_IDX].psc;
+    TIM9->ARR = pwm_timers[PWM_TIM9_IDX].period - 1;
 
     /* CH2: PWM模式1 */
     TIM9->CCMR1 &= ~TIM_CCMR1_OC2M;
@@ -153,20 +229,527 @@ static void PWM_TIM9_Init(void)
     TIM9->CR1 |= TIM_CR1_CEN;
 }
 
+/*******************************************************************************
+ * @brief  TIM3初始化 - 同步中继 (无输出)
+ * @note   TIM3由TIM1复位, 再用自身更新事件复位TIM9
+ ******************************************************************************/
+static void PWM_TIM3_Init(void)
+{
+    RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; /* 使能TIM3时钟 */
+
+    TIM3->PSC = pwm_timers[PWM_TIM3_IDX].psc;
+    TIM3->ARR = pwm_timers[PWM_TIM3_IDX].period - 1;
+    TIM3->CR1 &= ~TIM_CR1_DIR;
+
+    TIM3->CR2 &= ~TIM_CR2_MMS;
+    TIM3->CR2 |= TIM_MMS_UPDATE; /* 更新事件 -> TRGO */
+
+    TIM3->EGR |= TIM_EGR_UG;
+}
+
+/*******************************************************************************
+ * @brief  配置主从链: TIM1 -> TIM4, TIM1 -> TIM3 -> TIM9
+ * @note   从定时器工作在复位模式, 每个TIM1周期都会被重新对齐
+ ******************************************************************************/
+static void PWM_Sync_Config(uint8_t enable)
+{
+    TIM1->CR2 &= ~TIM_CR2_MMS;
+    TIM4->SMCR &= ~(TIM_SMCR_TS | TIM_SMCR_SMS);
+    TIM3->SMCR &= ~(TIM_SMCR_TS | TIM_SMCR_SMS);
+    TIM9->SMCR &= ~(TIM_SMCR_TS | TIM_SMCR_SMS);
+
+    if (enable)
+    {
+        TIM1->CR2 |= TIM_MMS_UPDATE;                /* TIM1更新事件 -> TRGO */
+        TIM4->SMCR |= TIM_TS_ITR0 | TIM_SMS_RESET; /* TIM4 ITR0 = TIM1 */
+        TIM3->SMCR |= TIM_TS_ITR0 | TIM_SMS_RESET; /* TIM3 ITR0 = TIM1 */
+        TIM9->SMCR |= TIM_TS_ITR1 | TIM_SMS_RESET; /* TIM9 ITR1 = TIM3 */
+        TIM3->CR1 |= TIM_CR1_CEN;
+    }
+    else
+    {
+        TIM3->CR1 &= ~TIM_CR1_CEN;
+    }
+    pwm_sync_on = enable;
+}
+
+/* 写入时基, 并按PWM_RELEASE_CYCLES换算出放开UDIS的保护窗口guard (计数值) */
+static void PWM_Timebase_Set(pwm_timer_t *t, uint32_t freq, uint16_t psc, uint32_t period)
+{
+    t->freq = freq;
+    t->psc = psc;
+    t->period = period;
+    t->guard = (uint32_t)((uint64_t)PWM_RELEASE_CYCLES * tim_get_clock(t->tim) / SystemCoreClock / (psc + 1u)) + 1;
+}
+
+/*******************************************************************************
+ * @brief  计算定时器时基
+ * @param  t: 定时器时基
+ * @param  freq: 目标频率 (Hz)
+ * @retval 0: 成功, -1: 频率超出范围
+ ******************************************************************************/
+static int PWM_Timebase_Calc(pwm_timer_t *t, uint32_t freq)
+{
+    uint16_t psc;
+    uint32_t period;
+
+    if (pwm_calc_timebase(tim_get_clock(t->tim), freq, &psc, &period) != 0)
+        return -1;
+    PWM_Timebase_Set(t, freq, psc, period);
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief  计算同步模式下全部定时器的时基
+ * @param  freq: 目标频率 (Hz)
+ * @retval 0: 成功, -1: 频率超出范围或时钟之比无法使周期相等
+ * @note   从定时器单独计算时周期会有取整差异 (如31kHz下TIM1为5419/168MHz,
+ *         TIM4为2709/84MHz), 每个TIM1周期都会多出一次从定时器更新. 这里先算TIM1,
+ *         把TIM1总计数调整为能按时钟比整除, 再为每个从定时器选最小的能整除
+ *         所需总计数的分频, 使ARR最大; 全部成功才写入pwm_timers
+ ******************************************************************************/
+static int PWM_Timebase_Sync(uint32_t freq)
+{
+    uint32_t clk_m = tim_get_clock(TIM1);
+    uint16_t psc[PWM_TIM_NUM];
+    uint32_t period[PWM_TIM_NUM];
+    uint8_t adjust = 0;
+
+    if (pwm_calc_timebase(clk_m, freq, &psc[PWM_TIM1_IDX], &period[PWM_TIM1_IDX]) != 0)
+        return -1;
+
+    /* TIM1总计数 x 从时钟 / 主时钟须为整数, APB分频都是2的幂, 最多差几个计数 */
+    for (uint8_t i = PWM_TIM1_IDX + 1; i < PWM_TIM_NUM; i++)
+    {
+        uint32_t clk_s = tim_get_clock(pwm_timers[i].tim);
+        while ((uint64_t)(psc[PWM_TIM1_IDX] + 1u) * period[PWM_TIM1_IDX] * clk_s % clk_m != 0)
+        {
+            if (++adjust > 16 || period[PWM_TIM1_IDX] <= 2)
+                return -1;
+            period[PWM_TIM1_IDX]--;
+        }
+    }
+
+    for (uint8_t i = PWM_TIM1_IDX + 1; i < PWM_TIM_NUM; i++)
+    {
+        uint64_t ticks = (uint64_t)(psc[PWM_TIM1_IDX] + 1u) * period[PWM_TIM1_IDX] * tim_get_clock(pwm_timers[i].tim) / clk_m;
+        uint32_t div = (uint32_t)((ticks - 1) / 0xFFFF) + 1;
+
+        while (div <= 0x10000 && ticks % div != 0)
+            div++;
+        if (div > 0x10000 || ticks / div < 2)
+            return -1;
+        psc[i] = (uint16_t)(div - 1);
+        period[i] = (uint32_t)(ticks / div);
+    }
+
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+        PWM_Timebase_Set(&pwm_timers[i], freq, psc[i], period[i]);
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief  等待TIM1离开溢出前的保护窗口
+ * @param  arr: TIM1当前生效的ARR
+ * @note   UDIS只能逐个定时器放开, 若TIM1在放开途中溢出, 已放开的从定时器
+ *         自然溢出装载新值, TIM1仍是旧值. 距溢出不足PWM_RELEASE_CYCLES时
+ *         等过这次溢出再放开, 四路推迟到下一个周期一起生效; 调用时须已关中断
+ * @note   主从周期相等时, 被UDIS压下的TIM1溢出不发TRGO, 从定时器在同一时刻
+ *         (TIM3/TIM9经中继稍晚) 自然溢出, 所以溢出后也要再等一个保护窗口
+ * @note   TIM1停止时 (pwm_stop后或单脉冲模式下自动停止) CNT不再走, 不会
+ *         溢出也就没有竞争, 直接返回; 等待中TIM1停下同样立即退出
+ ******************************************************************************/
+static void PWM_Release_Wait(uint32_t arr)
+{
+    uint32_t guard = pwm_timers[PWM_TIM1_IDX].guard;
+    uint32_t cnt = TIM1->CNT;
+
+    if (!(TIM1->CR1 & TIM_CR1_CEN) || arr - cnt >= guard)
+        return;
+    while (TIM1->CNT >= cnt && (TIM1->CR1 & TIM_CR1_CEN))
+        ;
+    while (TIM1->CNT < guard && (TIM1->CR1 & TIM_CR1_CEN))
+        ;
+}
+
+/*******************************************************************************
+ * @brief  占空比转换为比较值
+ * @param  duty: 逻辑占空比 (0~PWM_MAX_DUTY)
+ * @param  period: 所属定时器计数周期
+ * @note   单脉冲模式下输出在CNT>=CCR时有效, 宽度 = ARR - CCR + 1
+ ******************************************************************************/
+static uint16_t PWM_Duty_To_CCR(uint16_t duty, uint32_t period)
+{
+    if (pwm_proto == PWM_PROTO_PWM)
+        return (uint16_t)((uint32_t)duty * period / PWM_MAX_DUTY);
+
+    uint32_t width = pwm_pulse_min + (uint32_t)(pwm_pulse_max - pwm_pulse_min) * duty / PWM_MAX_DUTY;
+    return (uint16_t)(pwm_pulse_max + 1 - width);
+}
+
+/*******************************************************************************
+ * @brief  写通道比较值
+ * @param  ch: 通道索引 (0:PE13 1:PD14 2:PB7 3:PE6)
+ ******************************************************************************/
+static void PWM_Channel_Set(uint8_t ch, uint16_t duty)
+{
+    const pwm_channel_t *c = &pwm_channels[ch];
+    uint16_t max = (uint16_t)param_get_u(PARAM_PWM_MAX);
+
+    if (duty > max)
+        duty = max;
+    pwm_duty[ch] = duty;
+    *c->ccr = PWM_Duty_To_CCR(duty, pwm_timers[c->timer].period);
+}
+
+/*******************************************************************************
+ * @brief  把pwm_timers中的时基写入定时器
+ * @param  sel: 定时器位图 (bit i对应pwm_timers[i])
+ * @param  arr1: 放开锁存前仍生效的TIM1周期-1
+ * @note   写完PSC/ARR/CCR后一起放开UDIS, 避免出现新旧参数混合的周期
+ ******************************************************************************/
+static void PWM_Timebase_Load(uint8_t sel, uint32_t arr1)
+{
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        if (sel & (1 << i))
+            pwm_timers[i].tim->CR1 |= TIM_CR1_UDIS;
+    }
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        if (sel & (1 << i))
+        {
+            pwm_timers[i].tim->PSC = pwm_timers[i].psc;
+            pwm_timers[i].tim->ARR = pwm_timers[i].period - 1;
+        }
+    }
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        if (sel & (1 << pwm_channels[ch].timer))
+            PWM_Channel_Set(ch, pwm_duty[ch]);
+    }
+    if ((sel & (1 << PWM_TIM1_IDX)) && pwm_adc_trig_on)
+        TIM1->CCR1 = (uint32_t)pwm_adc_phase * pwm_timers[PWM_TIM1_IDX].period / PWM_MAX_DUTY;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (pwm_sync_on)
+        PWM_Release_Wait(arr1);
+    for (int8_t i = PWM_TIM_NUM - 1; i >= 0; i--)
+    {
+        if (sel & (1 << i))
+            pwm_timers[i].tim->CR1 &= ~TIM_CR1_UDIS;
+    }
+    __set_PRIMASK(primask);
+}
+
+/*******************************************************************************
+ * @brief  切换输出比较模式和单脉冲模式
+ * @param  oc_mode: 0x6-PWM模式1, 0x7-PWM模式2
+ * @param  opm: 1-单脉冲模式 (计数时钟42MHz), 0-连续模式 (使用pwm_timers时基)
+ * @note   单脉冲模式下关闭比较预装载, 计数器停止时写入立即生效
+ ******************************************************************************/
+static void PWM_Output_Config(uint32_t oc_mode, uint8_t opm)
+{
+    TIM1->CCMR2 = (TIM1->CCMR2 & ~(TIM_CCMR2_OC3M | TIM_CCMR2_OC3PE)) | (oc_mode << 4);
+    TIM4->CCMR1 = (TIM4->CCMR1 & ~(TIM_CCMR1_OC2M | TIM_CCMR1_OC2PE)) | (oc_mode << 12);
+    TIM4->CCMR2 = (TIM4->CCMR2 & ~(TIM_CCMR2_OC3M | TIM_CCMR2_OC3PE)) | (oc_mode << 4);
+    TIM9->CCMR1 = (TIM9->CCMR1 & ~(TIM_CCMR1_OC2M | TIM_CCMR1_OC2PE)) | (oc_mode << 12);
+
+    if (!opm)
+    {
+        TIM1->CCMR2 |= TIM_CCMR2_OC3PE;
+        TIM4->CCMR1 |= TIM_CCMR1_OC2PE;
+        TIM4->CCMR2 |= TIM_CCMR2_OC3PE;
+        TIM9->CCMR1 |= TIM_CCMR1_OC2PE;
+    }
+
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        pwm_timer_t *t = &pwm_timers[i];
+        if (opm)
+        {
+            t->tim->PSC = tim_get_clock(t->tim) / (PWM_TICK_PER_US * 1000000) - 1;
+            t->tim->ARR = pwm_pulse_max;
+        }
+        else
+        {
+            t->tim->PSC = t->psc;
+            t->tim->ARR = t->period - 1;
+        }
+    }
+
+    if (opm)
+    {
+        TIM1->CR1 |= TIM_CR1_OPM;
+        TIM4->CR1 |= TIM_CR1_OPM;
+        TIM9->CR1 |= TIM_CR1_OPM;
+    }
+    else
+    {
+        TIM1->CR1 &= ~TIM_CR1_OPM;
+        TIM4->CR1 &= ~TIM_CR1_OPM;
+        TIM9->CR1 &= ~TIM_CR1_OPM;
+    }
+
+    TIM1->EGR |= TIM_EGR_UG;
+    TIM4->EGR |= TIM_EGR_UG;
+    TIM3->EGR |= TIM_EGR_UG;
+    TIM9->EGR |= TIM_EGR_UG;
+}
+
+/*******************************************************************************
+ * @brief  触发一次单脉冲输出
+ * @note   上一个脉冲未结束时跳过, 保证每个控制周期最多一个脉冲
+ ******************************************************************************/
+static void PWM_OneShot_Fire(void)
+{
+    if ((TIM1->CR1 | TIM4->CR1 | TIM9->CR1) & TIM_CR1_CEN)
+        return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM1->CR1 |= TIM_CR1_CEN;
+    TIM4->CR1 |= TIM_CR1_CEN;
+    TIM9->CR1 |= TIM_CR1_CEN;
+    __set_PRIMASK(primask);
+}
+
 /*******************************************************************************
  * 公共API
  ******************************************************************************/
 
 /**
- * @brief  PWM初始化 (频率5kHz, 占空比范围0~8000)
+ * @brief  PWM初始化 (频率取参数pwm_freq, 默认5kHz, 占空比范围0~8000)
  */
 int pwm_init(dev_arg_t arg)
 {
     (void)arg;
+    if (PWM_Timebase_Sync(param_get_u(PARAM_PWM_FREQ)) != 0 && PWM_Timebase_Sync(PWM_FREQ) != 0)
+        return -1;
     PWM_GPIO_Init();
     PWM_TIM1_Init();
     PWM_TIM4_Init();
     PWM_TIM9_Init();
+    PWM_TIM3_Init();
+    PWM_Sync_Config(1); /* 默认同步输出 */
+    return 0;
+}
+
+/**
+ * @brief  开关同步输出模式
+ * @param  enable: 1-TIM1/TIM4/TIM9同相且同时锁存, 0-各定时器独立运行
+ * @retval 0: 成功, -1: 单脉冲协议下不能开启, 或无法由TIM1推出从定时器时基
+ * @note   开启时从定时器改用由TIM1时基推出的时基 (频率跟随TIM1)
+ */
+int pwm_sync_enable(uint8_t enable)
+{
+    if (!enable)
+    {
+        PWM_Sync_Config(0);
+        return 0;
+    }
+    if (pwm_sync_on)
+        return 0;
+    if (pwm_proto != PWM_PROTO_PWM || PWM_Timebase_Sync(pwm_timers[PWM_TIM1_IDX].freq) != 0)
+        return -1;
+    PWM_Timebase_Load((uint8_t)~(1u << PWM_TIM1_IDX), pwm_timers[PWM_TIM1_IDX].period - 1);
+    PWM_Sync_Config(1);
+    return 0;
+}
+
+/**
+ * @brief  查询同步输出模式
+ */
+uint8_t pwm_sync_state(void)
+{
+    return pwm_sync_on;
+}
+
+/**
+ * @brief  切换输出协议
+ * @param  proto: PWM_PROTO_PWM / PWM_PROTO_ONESHOT125 / PWM_PROTO_MULTISHOT
+ * @retval 0: 成功, -1: 不支持的协议
+ * @note   切换时先停止输出并清零占空比, 单脉冲协议下关闭主从同步
+ */
+int pwm_set_protocol(pwm_proto_t proto)
+{
+    static uint8_t sync_saved = 1;
+
+    if (proto > PWM_PROTO_MULTISHOT)
+        return -1;
+    if (proto == pwm_proto)
+        return 0;
+
+    pwm_stop();
+    if (pwm_proto == PWM_PROTO_PWM)
+        sync_saved = pwm_sync_on;
+
+    pwm_proto = proto;
+    if (proto == PWM_PROTO_PWM)
+    {
+        PWM_Output_Config(0x6, 0);
+        PWM_Sync_Config(sync_saved);
+        pwm_set_all(0, 0, 0, 0);
+        pwm_start();
+        return 0;
+    }
+
+    if (proto == PWM_PROTO_ONESHOT125)
+    {
+        pwm_pulse_min = ONESHOT125_MIN_TICKS;
+        pwm_pulse_max = ONESHOT125_MAX_TICKS;
+    }
+    else
+    {
+        pwm_pulse_min = MULTISHOT_MIN_TICKS;
+        pwm_pulse_max = MULTISHOT_MAX_TICKS;
+    }
+    PWM_Sync_Config(0);
+    PWM_Output_Config(0x7, 1);
+    TIM1->SR = 0;
+    TIM4->SR = 0;
+    TIM9->SR = 0;
+    pwm_set_all(0, 0, 0, 0);
+    return 0;
+}
+
+/**
+ * @brief  查询当前输出协议
+ */
+pwm_proto_t pwm_get_protocol(void)
+{
+    return pwm_proto;
+}
+
+/**
+ * @brief  计算满足频率且分辨率最高的PSC/ARR
+ * @param  clk: 定时器输入时钟 (Hz)
+ * @param  freq: 目标频率 (Hz)
+ * @param  psc: 输出预分频值
+ * @param  period: 输出计数周期 (ARR + 1)
+ * @retval 0: 成功, -1: 无法实现 (频率为0或分辨率不足2级)
+ *
+ * 频率与分辨率对照 (PSC / 计数周期):
+ *   频率      TIM1/TIM9 (168MHz)   TIM4 (84MHz)
+ *   50Hz      51 / 64615           25 / 64615
+ *   400Hz     6  / 60000           3  / 52500
+ *   1kHz      2  / 56000           1  / 42000
+ *   5kHz      0  / 33600           0  / 16800
+ *   8kHz      0  / 21000           0  / 10500
+ *   16kHz     0  / 10500           0  / 5250
+ *   31kHz     0  / 5419 (5418)     0  / 2709
+ *   32kHz     0  / 5250            0  / 2625
+ *   同步模式下从定时器由TIM1推出 (见PWM_Timebase_Sync), 括号内为调整后的TIM1周期
+ */
+int pwm_calc_timebase(uint32_t clk, uint32_t freq, uint16_t *psc, uint32_t *period)
+{
+    if (freq == 0 || clk / freq < 2)
+        return -1;
+
+    /* 最小的PSC使计数周期不超过0xFFFF, 保证CCR=周期时可输出100% */
+    uint32_t div = (clk / freq - 1) / 0xFFFF;
+    if (div > 0xFFFF)
+        return -1;
+
+    *psc = (uint16_t)div;
+    *period = clk / ((div + 1) * freq);
+    return 0;
+}
+
+/**
+ * @brief  设置PWM频率
+ * @param  TIMx: TIM1/TIM4/TIM9, NULL表示全部定时器
+ * @param  freq: 频率 (1Hz~PWM_FREQ_MAX)
+ * @retval 0: 成功, -1: 参数错误或当前为单脉冲协议
+ * @note   各通道保持原逻辑占空比, 比较值按新分辨率缩放后与PSC/ARR同时生效
+ * @note   单独修改某个定时器会关闭同步模式 (主从周期必须一致)
+ * @note   NULL时从定时器时基由TIM1推出, 周期与TIM1完全相等
+ */
+int pwm_set_freq(TIM_TypeDef *TIMx, uint32_t freq)
+{
+    uint8_t sel = 0;
+
+    if (pwm_proto != PWM_PROTO_PWM || freq == 0 || freq > PWM_FREQ_MAX)
+        return -1;
+
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        if (TIMx == NULL || pwm_timers[i].tim == TIMx)
+            sel |= 1 << i;
+    }
+    if (TIMx == TIM3 || sel == 0)
+        return -1;
+    if (TIMx != NULL && pwm_sync_on)
+        PWM_Sync_Config(0);
+
+    uint32_t arr1 = pwm_timers[PWM_TIM1_IDX].period - 1; /* 放开锁存前仍生效的TIM1周期 */
+
+    if (TIMx == NULL && PWM_Timebase_Sync(freq) != 0)
+        return -1;
+    for (uint8_t i = 0; i < PWM_TIM_NUM && TIMx != NULL; i++)
+    {
+        if ((sel & (1 << i)) && PWM_Timebase_Calc(&pwm_timers[i], freq) != 0)
+            return -1;
+    }
+    PWM_Timebase_Load(sel, arr1);
+    return 0;
+}
+
+/**
+ * @brief  配置TIM1_CC1作为ADC触发
+ * @param  enable: 1-使能, 0-关闭
+ * @param  phase: 触发相位, 以占空比单位表示 (0~PWM_MAX_DUTY-1),
+ *                例如在导通中点采样电流应取占空比的一半
+ * @note   CH1使用PWM模式2, OC1REF在CNT=CCR1时产生上升沿;
+ *         单脉冲协议下TIM1不连续计数, 不会产生触发
+ */
+void pwm_adc_trigger(uint8_t enable, uint16_t phase)
+{
+    if (phase >= PWM_MAX_DUTY)
+        phase = PWM_MAX_DUTY - 1;
+    pwm_adc_phase = phase;
+    pwm_adc_trig_on = enable ? 1 : 0;
+
+    if (!enable)
+    {
+        TIM1->CCER &= ~TIM_CCER_CC1E;
+        return;
+    }
+
+    TIM1->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M);
+    TIM1->CCMR1 |= (0x7 << 4) | TIM_CCMR1_OC1PE; /* PWM模式2 */
+    TIM1->CCR1 = (uint32_t)phase * pwm_timers[PWM_TIM1_IDX].period / PWM_MAX_DUTY;
+    TIM1->CCER |= TIM_CCER_CC1E; /* CH1未复用到引脚, 仅内部使用 */
+}
+
+/**
+ * @brief  查询定时器当前频率
+ * @param  TIMx: TIM1/TIM4/TIM9
+ * @retval 频率 (Hz), 0表示不支持的定时器
+ */
+uint32_t pwm_get_freq(TIM_TypeDef *TIMx)
+{
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        if (pwm_timers[i].tim == TIMx)
+            return pwm_timers[i].freq;
+    }
+    return 0;
+}
+
+/**
+ * @brief  查询定时器当前分辨率
+ * @param  TIMx: TIM1/TIM4/TIM9
+ * @retval 一个周期内的计数级数 (ARR + 1), 0表示不支持的定时器
+ */
+uint32_t pwm_get_resolution(TIM_TypeDef *TIMx)
+{
+    for (uint8_t i = 0; i < PWM_TIM_NUM; i++)
+    {
+        if (pwm_timers[i].tim == TIMx)
+            return pwm_timers[i].period;
+    }
     return 0;
 }
 
@@ -175,9 +758,7 @@ int pwm_init(dev_arg_t arg)
  */
 void pwm_set_duty_pe13(uint16_t duty)
 {
-    if (duty > PWM_ARR_VALUE)
-        duty = PWM_ARR_VALUE;
-    TIM1->CCR3 = duty;
+    PWM_Channel_Set(0, duty);
 }
 
 /**
@@ -185,9 +766,7 @@ void pwm_set_duty_pe13(uint16_t duty)
  */
 void pwm_set_duty_pd14(uint16_t duty)
 {
-    if (duty > PWM_ARR_VALUE)
-        duty = PWM_ARR_VALUE;
-    TIM4->CCR3 = duty;
+    PWM_Channel_Set(1, duty);
 }
 
 /**
@@ -195,9 +774,7 @@ void pwm_set_duty_pd14(uint16_t duty)
  */
 void pwm_set_duty_pb7(uint16_t duty)
 {
-    if (duty > PWM_ARR_VALUE)
-        duty = PWM_ARR_VALUE;
-    TIM4->CCR2 = duty;
+    PWM_Channel_Set(2, duty);
 }
 
 /**
@@ -205,20 +782,64 @@ void pwm_set_duty_pb7(uint16_t duty)
  */
 void pwm_set_duty_pe6(uint16_t duty)
 {
-    if (duty > PWM_ARR_VALUE)
-        duty = PWM_ARR_VALUE;
-    TIM9->CCR2 = duty;
+    PWM_Channel_Set(3, duty);
 }
 
 /**
  * @brief  设置所有通道占空比
+ * @note   单脉冲协议下写入后立即触发一次脉冲, 应在混控计算结束时调用
+ * @note   同步模式下先置UDIS阻止影子寄存器装载, 写完四路后
+ *         先放开从定时器再放开TIM1, 四路在同一个更新事件生效;
+ *         TIM1即将溢出时最多等待PWM_RELEASE_CYCLES个周期
  */
 void pwm_set_all(uint16_t pe13, uint16_t pd14, uint16_t pb7, uint16_t pe6)
 {
+    if (pwm_proto != PWM_PROTO_PWM)
+    {
+        pwm_set_duty_pe13(pe13);
+        pwm_set_duty_pd14(pd14);
+        pwm_set_duty_pb7(pb7);
+        pwm_set_duty_pe6(pe6);
+        PWM_OneShot_Fire();
+        return;
+    }
+
+    if (!pwm_sync_on)
+    {
+        pwm_set_duty_pe13(pe13);
+        pwm_set_duty_pd14(pd14);
+        pwm_set_duty_pb7(pb7);
+        pwm_set_duty_pe6(pe6);
+        return;
+    }
+
+    TIM1->CR1 |= TIM_CR1_UDIS;
+    TIM4->CR1 |= TIM_CR1_UDIS;
+    TIM9->CR1 |= TIM_CR1_UDIS;
+
     pwm_set_duty_pe13(pe13);
     pwm_set_duty_pd14(pd14);
     pwm_set_duty_pb7(pb7);
     pwm_set_duty_pe6(pe6);
+
+    /* 放开锁存期间不允许被打断, 避免落在两个更新事件之间 */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    PWM_Release_Wait(pwm_timers[PWM_TIM1_IDX].period - 1);
+    TIM9->CR1 &= ~TIM_CR1_UDIS;
+    TIM4->CR1 &= ~TIM_CR1_UDIS;
+    TIM1->CR1 &= ~TIM_CR1_UDIS;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  查询解锁状态
+ * @retval 1-任一通道占空比非0 (电机可能在转), 0-全部为0
+ * @note   Flash擦写等会阻塞CPU的操作只在返回0时进行
+ */
+uint8_t pwm_armed(void)
+{
+    return (pwm_duty[0] | pwm_duty[1] | pwm_duty[2] | pwm_duty[3]) != 0;
 }
 
 /**
@@ -229,6 +850,7 @@ void pwm_stop(void)
     TIM1->CR1 &= ~TIM_CR1_CEN;
     TIM4->CR1 &= ~TIM_CR1_CEN;
     TIM9->CR1 &= ~TIM_CR1_CEN;
+    TIM3->CR1 &= ~TIM_CR1_CEN;
 }
 
 /**
@@ -236,7 +858,36 @@ void pwm_stop(void)
  */
 void pwm_start(void)
 {
-    TIM1->CR1 |= TIM_CR1_CEN;
-    TIM4->CR1 |= TIM_CR1_CEN;
+    /* 从定时器先启动, TIM1第一次更新时统一对齐 */
+    if (pwm_sync_on)
+        TIM3->CR1 |= TIM_CR1_CEN;
     TIM9->CR1 |= TIM_CR1_CEN;
+    TIM4->CR1 |= TIM_CR1_CEN;
+    TIM1->CR1 |= TIM_CR1_CEN;
 }
+
+/*******************************************************************************
+ * 运行参数
+ ******************************************************************************/
+PARAM_U32(PARAM_PWM_FREQ, pwm_freq, 1, PWM_FREQ_MAX, PWM_FREQ); /* 上电频率 (Hz) */
+PARAM_U32(PARAM_PWM_MAX, pwm_max, 0, PWM_MAX_DUTY, PWM_MAX_DUTY); /* 输出上限 */
+
+/*******************************************************************************
+ * 基准测试 (bench命令只在未解锁时运行, 写0不会改变输出)
+ ******************************************************************************/
+static void Bench_PWM_Set_All(void)
+{
+    pwm_set_all(0, 0, 0, 0);
+}
+
+BENCH_EXPORT(pwm_set_all, Bench_PWM_Set_All);
+
+/*******************************************************************************
+ * PWM设备注册
+ ******************************************************************************/
+DEV_EXPORT(30, pwm) {
+    .name = "PWM",
+    .init = pwm_init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
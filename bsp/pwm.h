@@ -9,9 +9,15 @@
  *   PB7  - TIM4_CH2
  *   PE6  - TIM9_CH2
  *
- * 固定参数:
- *   频率: 5kHz
- *   占空比: 0~8000 (对应0%~100%)
+ * 默认参数:
+ *   频率: 5kHz (pwm_set_freq可按定时器修改, 1Hz~32kHz)
+ *   占空比: 0~8000 (对应0%~100%, 与实际ARR无关)
+ *
+ * 同步模式:
+ *   TIM1主, TIM4/TIM9从 (TIM9经TIM3中继), 四路在同一周期更新
+ *
+ * 单脉冲协议:
+ *   OneShot125/Multishot下每次pwm_set_all输出一个脉冲
  ******************************************************************************/
 
 #ifndef __PWM_H
@@ -19,7 +25,16 @@
 
 #include <stdint.h>
 
-#define PWM_MAX_DUTY 8000 /* 最大占空比值 */
+#define PWM_MAX_DUTY 8000  /* 最大占空比值 */
+#define PWM_FREQ_MAX 32000 /* 最高PWM频率 (有刷电机) */
+
+/* 输出协议 */
+typedef enum
+{
+    PWM_PROTO_PWM = 0,    /* 连续PWM */
+    PWM_PROTO_ONESHOT125, /* 125~250us单脉冲 */
+    PWM_PROTO_MULTISHOT   /* 5~25us单脉冲 */
+} pwm_proto_t;
 
 int pwm_init(dev_arg_t arg);           /* 初始化PWM */
 void pwm_set_duty_pe13(uint16_t duty); /* 设置PE13占空比 */
@@ -27,7 +42,19 @@ void pwm_set_duty_pd14(uint16_t duty); /* 设置PD14占空比 */
 void pwm_set_duty_pb7(uint16_t duty);  /* 设置PB7占空比 */
 void pwm_set_duty_pe6(uint16_t duty);  /* 设置PE6占空比 */
 void pwm_set_all(uint16_t pe13, uint16_t pd14, uint16_t pb7, uint16_t pe6);
-void pwm_stop(void);  /* 停止PWM */
-void pwm_start(void); /* 启动PWM */
+int pwm_sync_enable(uint8_t enable);     /* 开关同步输出模式 */
+uint8_t pwm_sync_state(void);            /* 查询同步输出模式 */
+int pwm_set_protocol(pwm_proto_t proto); /* 切换输出协议 */
+pwm_proto_t pwm_get_protocol(void);      /* 查询输出协议 */
+
+int pwm_set_freq(TIM_TypeDef *TIMx, uint32_t freq); /* 设置频率, TIMx为NULL时设置全部 */
+uint32_t pwm_get_freq(TIM_TypeDef *TIMx);           /* 查询频率 */
+uint32_t pwm_get_resolution(TIM_TypeDef *TIMx);     /* 查询分辨率 (ARR+1) */
+int pwm_calc_timebase(uint32_t clk, uint32_t freq, uint16_t *psc, uint32_t *period);
+void pwm_adc_trigger(uint8_t enable, uint16_t phase); /* TIM1_CC1触发ADC1 */
+
+void pwm_stop(void);     /* 停止PWM */
+void pwm_start(void);    /* 启动PWM */
+uint8_t pwm_armed(void); /* 查询是否有电机输出 */
 
 #endif /* __PWM_H */
@@ -0,0 +1,413 @@
+/**
+ * @file    rc.c
+ * @brief   遥控接收驱动
+ * @details 串行接收机: USART2 (PA3-RX) 经DMA1 Stream5 (Channel4) 循环接收
+ *          PPM/PWM接收机: TIM5输入捕获 (tim_capture_init), DMA1 Channel6各数据流记录边沿
+ *          协议和时间戳见rc.h
+ *
+ * 接收流程:
+ *   - DMA把字节连续写入循环缓冲区, CPU不参与逐字节接收
+ *   - USART2 IDLE中断 (一帧结束) 和DMA半传输/传输完成中断从上次位置取新字节解析,
+ *     两个中断优先级相同, 不会互相打断
+ *   - 解析出的帧以顺序锁发布, 控制节拍 (主循环) 用rc_get读取, 读到一半被中断改写时重读
+ *
+ * SBUS没有校验和, 只靠奇偶校验: 本批字节中出现奇偶/帧/噪声错误时丢弃解析出的帧
+ *
+ * 捕获流程:
+ *   边沿只触发DMA, 不进中断; rc_poll在主循环中查看DMA写入位置,
+ *   PPM在线路静默超过同步间隔后整帧解码, PWM在通道1出现新脉冲时采样全部通道
+ */
+
+#include "driver.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define RC_DMA_SIZE 128 /* 循环缓冲区字节数, 2的幂, 大于两帧 */
+#define RC_DMA_MASK (RC_DMA_SIZE - 1)
+#define RC_IRQ_PRIO 1   /* 高于TIM2, 帧到达后立即解析 */
+
+#define RC_SBUS_BAUD 100000
+#define RC_CRSF_BAUD 420000
+
+#define RC_HIFCR_ALL5 \
+    (DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5 | DMA_HIFCR_CFEIF5)
+#define RC_SR_ERRORS (USART_SR_PE | USART_SR_FE | USART_SR_NE)
+
+#define RC_CAP_SIZE     32 /* 捕获缓冲区 (边沿数), 2的幂; PPM整块使用, PWM每通道一段 */
+#define RC_CAP_MASK     (RC_CAP_SIZE - 1)
+#define RC_PWM_CH       4
+#define RC_PWM_LEN      (RC_CAP_SIZE / RC_PWM_CH)
+#define RC_CAP_TICK_HZ  1000000 /* TIM5计数1MHz, 时间戳单位us */
+#define RC_CAP_DMA_CHAN 6       /* DMA1 Channel6: TIM5捕获请求 */
+
+PARAM_U32(PARAM_RC_PROTO, rc_proto, 0, RC_PROTO_NUM - 1, RC_PROTO_SBUS); /* 0-SBUS 1-CRSF 2-PPM 3-PWM, 重启生效 */
+
+/*===========================================================================*/
+/*                              内部变量                                      */
+/*===========================================================================*/
+
+static DMA_BUFFER uint8_t rc_dma_buf[RC_DMA_SIZE];
+static uint32_t rc_rd;         /* 已解析到的缓冲区位置 */
+static rc_parser_t rc_parser;
+static rc_frame_t rc_work;     /* 正在解析的帧 */
+static uint32_t rc_isr_cyc;    /* 本次中断进入时的DWT周期数 */
+static uint32_t rc_line_drops; /* 因奇偶/帧/噪声错误丢弃的帧 */
+
+static DMA_BUFFER uint32_t rc_cap_buf[RC_CAP_SIZE];
+static uint32_t rc_pwm_last_end; /* 通道1上次采样的脉冲下降沿 */
+
+static rc_frame_t rc_latest;
+static uint32_t rc_lock;        /* 顺序锁, 奇数表示正在写 */
+static uint32_t rc_timeout_seq; /* 已判定超时的帧序号, 防止DWT回绕后误判为新帧 */
+
+/* 延迟统计 (周期), 每帧只在第一次用于输出时计一次 */
+static uint32_t rc_marked_seq;
+static uint32_t rc_lat_min = UINT32_MAX;
+static uint32_t rc_lat_max;
+static uint64_t rc_lat_sum;
+static uint32_t rc_lat_cnt;
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+static void RC_Publish(rc_frame_t *f, uint32_t t_cyc)
+{
+    f->seq = rc_latest.seq + 1;
+    f->t_cyc = t_cyc;
+
+    __atomic_store_n(&rc_lock, rc_lock + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    rc_latest = *f;
+    __atomic_store_n(&rc_lock, rc_lock + 1, __ATOMIC_RELEASE);
+}
+
+/* 解析DMA写入的新字节 */
+static void RC_Drain(void)
+{
+    uint32_t wr = (RC_DMA_SIZE - DMA1_Stream5->NDTR) & RC_DMA_MASK;
+    uint8_t bad = (USART2->SR & RC_SR_ERRORS) != 0;
+
+    while (rc_rd != wr)
+    {
+        if (rc_parse_byte(&rc_parser, rc_dma_buf[rc_rd], &rc_work))
+        {
+            if (bad)
+                rc_line_drops++;
+            else
+                RC_Publish(&rc_work, rc_isr_cyc);
+        }
+        rc_rd = (rc_rd + 1) & RC_DMA_MASK;
+    }
+}
+
+/* TIM5各通道捕获请求所在的DMA1数据流 */
+static DMA_Stream_TypeDef *const rc_cap_stream[RC_PWM_CH] = {DMA1_Stream2, DMA1_Stream4, DMA1_Stream0,
+                                                            DMA1_Stream1};
+
+static void RC_Capture_Init(rc_proto_t proto)
+{
+    uint32_t n = (proto == RC_PROTO_PPM) ? 1 : RC_PWM_CH;
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        /* PA0~PA3复用为TIM5_CH1~4 */
+        GPIOA->MODER &= ~(0x3 << (i * 2));
+        GPIOA->MODER |= (0x2 << (i * 2));
+        GPIOA->PUPDR &= ~(0x3 << (i * 2));
+        GPIOA->AFR[0] &= ~(0xF << (i * 4));
+        GPIOA->AFR[0] |= (0x2 << (i * 4)); /* AF2 = TIM5 */
+
+        if (proto == RC_PROTO_PPM)
+            tim_capture_init(TIM5, 1, TIM_CAPTURE_RISING, RC_CAP_TICK_HZ, rc_cap_stream[0], RC_CAP_DMA_CHAN,
+                             rc_cap_buf, RC_CAP_SIZE);
+        else
+            tim_capture_init(TIM5, i + 1, TIM_CAPTURE_BOTH, RC_CAP_TICK_HZ, rc_cap_stream[i], RC_CAP_DMA_CHAN,
+                             &rc_cap_buf[i * RC_PWM_LEN], RC_PWM_LEN);
+    }
+}
+
+/* 解码结果计数并发布, age为最后一个边沿距今的时间 (us) */
+static int RC_Capture_Publish(int ok, uint32_t age_us)
+{
+    if (!ok)
+    {
+        rc_parser.sync_errors++;
+        return 0;
+    }
+    rc_parser.frames++;
+    RC_Publish(&rc_work, DWT->CYCCNT - age_us * (SystemCoreClock / 1000000));
+    return 1;
+}
+
+/* PPM: 线路静默超过同步间隔后, 把上次之后的全部边沿作为一帧解码 */
+static int RC_Ppm_Poll(void)
+{
+    uint32_t wr = (RC_CAP_SIZE - rc_cap_stream[0]->NDTR) & RC_CAP_MASK;
+    uint32_t e[RC_CAP_SIZE];
+    uint32_t n = 0;
+
+    if (wr == rc_rd)
+        return 0;
+
+    uint32_t age = TIM5->CNT - rc_cap_buf[(wr - 1) & RC_CAP_MASK];
+    if (age < RC_PPM_SYNC_US)
+        return 0; /* 帧未结束 */
+
+    while (rc_rd != wr)
+    {
+        e[n++] = rc_cap_buf[rc_rd];
+        rc_rd = (rc_rd + 1) & RC_CAP_MASK;
+    }
+    return RC_Capture_Publish(rc_ppm_decode(e, n, &rc_work), age);
+}
+
+/*
+ * 取各PWM通道最近的3个边沿 (时间顺序) 和最后一个边沿之后的引脚电平
+ * 引脚变化要经过输入滤波和DMA才进入缓冲区: 读电平后等待2us再确认DMA位置未变,
+ * 否则电平可能已经是一个尚未记录的边沿之后的
+ */
+static void RC_Pwm_Snapshot(uint32_t e[RC_PWM_CH][3], uint8_t level[RC_PWM_CH])
+{
+    uint32_t wr[RC_PWM_CH];
+    uint32_t idr, t0, same;
+
+    do
+    {
+        for (uint32_t k = 0; k < RC_PWM_CH; k++)
+            wr[k] = RC_PWM_LEN - rc_cap_stream[k]->NDTR;
+        idr = GPIOA->IDR;
+        t0 = TIM5->CNT;
+        while (TIM5->CNT - t0 < 2)
+            ;
+        same = 1;
+        for (uint32_t k = 0; k < RC_PWM_CH; k++)
+            same &= (wr[k] == RC_PWM_LEN - rc_cap_stream[k]->NDTR);
+    } while (!same);
+
+    for (uint32_t k = 0; k < RC_PWM_CH; k++)
+    {
+        const uint32_t *buf = &rc_cap_buf[k * RC_PWM_LEN];
+        for (uint32_t i = 0; i < 3; i++)
+            e[k][2 - i] = buf[(wr[k] + RC_PWM_LEN - 1 - i) % RC_PWM_LEN];
+        level[k] = (idr >> k) & 1; /* PA0~PA3 */
+    }
+}
+
+/* PWM: 通道1出现新的完整脉冲时采样全部通道 */
+static int RC_Pwm_Poll(void)
+{
+    uint32_t e[RC_PWM_CH][3], end, end1;
+    uint8_t level[RC_PWM_CH];
+
+    RC_Pwm_Snapshot(e, level);
+    uint32_t now = TIM5->CNT;
+    if (rc_pwm_pulse(e[0], 3, level[0], &end1) == 0 || end1 == rc_pwm_last_end)
+        return 0;
+    rc_pwm_last_end = end1;
+
+    for (uint32_t k = 0; k < RC_CH_NUM; k++)
+        rc_work.ch[k] = RC_RAW_MID;
+    for (uint32_t k = 0; k < RC_PWM_CH; k++)
+    {
+        uint32_t w = rc_pwm_pulse(e[k], 3, level[k], &end);
+        if (w == 0 || now - end > RC_TIMEOUT_MS * 1000)
+            return RC_Capture_Publish(0, 0); /* 某通道没有信号 */
+        rc_work.ch[k] = RC_US_TO_RAW(w);
+    }
+    rc_work.flags = 0;
+    rc_work.lq = 0;
+    return RC_Capture_Publish(1, now - end1);
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+/**
+ * @brief  遥控接收初始化, 协议由参数rc_proto选择
+ * @note   须在参数表之后初始化
+ */
+int rc_init(dev_arg_t arg)
+{
+    (void)arg;
+    rc_proto_t proto = (rc_proto_t)param_get_u(PARAM_RC_PROTO);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    rc_parser_init(&rc_parser, proto);
+    rc_rd = 0;
+    if (proto == RC_PROTO_PPM || proto == RC_PROTO_PWM)
+    {
+        RC_Capture_Init(proto);
+        return 0;
+    }
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+    /* DMA1 Stream5 Channel4: 外设到存储器, 循环模式, 半传输/传输完成中断 */
+    DMA1_Stream5->CR &= ~DMA_SxCR_EN;
+    while (DMA1_Stream5->CR & DMA_SxCR_EN)
+        ;
+    DMA1->HIFCR = RC_HIFCR_ALL5;
+    DMA1_Stream5->PAR = (uint32_t)(uintptr_t)&USART2->DR;
+    DMA1_Stream5->M0AR = (uint32_t)(uintptr_t)rc_dma_buf;
+    DMA1_Stream5->NDTR = RC_DMA_SIZE;
+    DMA1_Stream5->CR = DMA_SxCR_CHSEL_2 | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+    DMA1_Stream5->FCR = 0; /* 直接模式 */
+    DMA1_Stream5->CR |= DMA_SxCR_EN;
+
+    /* USART2只接收, PA3上拉 (SBUS经反相器后空闲为高); SBUS为8E2, CRSF为8N1 */
+    if (proto == RC_PROTO_SBUS)
+    {
+        uart_open(UART_PORT_2, RC_SBUS_BAUD, UART_MODE_RX | UART_MODE_8E2);
+    }
+    else
+    {
+        uart_open(UART_PORT_2, RC_CRSF_BAUD, UART_MODE_RX);
+    }
+    USART2->CR3 = USART_CR3_DMAR;
+    USART2->CR1 |= USART_CR1_IDLEIE;
+
+    NVIC_SetPriority(USART2_IRQn, RC_IRQ_PRIO);
+    NVIC_SetPriority(DMA1_Stream5_IRQn, RC_IRQ_PRIO);
+    NVIC_EnableIRQ(USART2_IRQn);
+    NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+    return 0;
+}
+
+/**
+ * @brief  读取最新一帧
+ * @param  out: 最新一帧 (失控时也写入, 供显示)
+ * @retval 0-有效, -1-从未收到、超时或接收机报告失控
+ */
+int rc_get(rc_frame_t *out)
+{
+    uint32_t s;
+
+    do
+    {
+        s = __atomic_load_n(&rc_lock, __ATOMIC_ACQUIRE);
+        *out = rc_latest;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((s & 1) || s != __atomic_load_n(&rc_lock, __ATOMIC_RELAXED));
+
+    if (out->seq == 0 || out->seq == rc_timeout_seq)
+        return -1;
+    if (DWT->CYCCNT - out->t_cyc > RC_TIMEOUT_MS * (SystemCoreClock / 1000))
+    {
+        rc_timeout_seq = out->seq;
+        DLOG("rc signal lost, last frame %u\n", out->seq);
+        return -1;
+    }
+    return (out->flags & RC_FLAG_FAILSAFE) ? -1 : 0;
+}
+
+/**
+ * @brief  记录一帧被用于计算电机输出, 统计收到到输出的延迟
+ * @note   在控制步算出输出后调用, 同一帧只计第一次
+ */
+void rc_output_mark(const rc_frame_t *f)
+{
+    if (f->seq == 0 || f->seq == rc_marked_seq)
+        return;
+    rc_marked_seq = f->seq;
+
+    uint32_t lat = DWT->CYCCNT - f->t_cyc;
+    if (lat < rc_lat_min)
+        rc_lat_min = lat;
+    if (lat > rc_lat_max)
+        rc_lat_max = lat;
+    rc_lat_sum += lat;
+    rc_lat_cnt++;
+}
+
+/**
+ * @brief  PPM/PWM解码, 主循环中调用; 串行协议在中断中解析, 这里直接返回
+ * @retval 本次发布的帧数
+ */
+int rc_poll(void)
+{
+    if (rc_parser.proto == RC_PROTO_PPM)
+        return RC_Ppm_Poll();
+    if (rc_parser.proto == RC_PROTO_PWM)
+        return RC_Pwm_Poll();
+    return 0;
+}
+
+/**
+ * @brief  USART2中断: 线路空闲即一帧结束
+ */
+void rc_uart_isr(void)
+{
+    rc_isr_cyc = DWT->CYCCNT;
+    if (USART2->SR & USART_SR_IDLE)
+    {
+        RC_Drain();
+        (void)USART2->DR; /* 读SR后读DR, 清除IDLE和错误标志 */
+        rc_parser_idle(&rc_parser);
+    }
+}
+
+/**
+ * @brief  DMA1 Stream5中断: 连续的字节流中途也及时解析
+ */
+void rc_dma_isr(void)
+{
+    rc_isr_cyc = DWT->CYCCNT;
+    DMA1->HIFCR = RC_HIFCR_ALL5;
+    RC_Drain();
+}
+
+DEV_EXPORT(16, rc) {
+    .name = "rc",
+    .init = rc_init,
+    .enable = NULL,
+    .disable = NULL,
+    .arg.ptr = NULL};
+
+/*===========================================================================*/
+/*                              Shell命令                                     */
+/*===========================================================================*/
+
+/**
+ * @brief  rc [reset]: 查看接收状态、通道值和延迟, reset清零延迟统计
+ */
+void rc_cmd(int argc, void **argv)
+{
+    static const char *proto_names[] = {"sbus", "crsf", "ppm", "pwm"};
+    rc_frame_t f;
+    uint32_t mhz = SystemCoreClock / 1000000;
+
+    if (argc >= 1 && !strcmp(argv[0], "reset"))
+    {
+        rc_lat_min = UINT32_MAX;
+        rc_lat_max = 0;
+        rc_lat_sum = 0;
+        rc_lat_cnt = 0;
+    }
+
+    int ok = rc_get(&f);
+    printf("rc %s %s, frames %lu, crc err %lu, sync err %lu, line drops %lu\n", proto_names[rc_parser.proto],
+           ok == 0 ? "ok" : "no signal", (unsigned long)rc_parser.frames, (unsigned long)rc_parser.crc_errors,
+           (unsigned long)rc_parser.sync_errors, (unsigned long)rc_line_drops);
+    if (f.seq != 0)
+    {
+        printf("age %lu ms, flags %02X, lq %u, ch1-8:", (unsigned long)((DWT->CYCCNT - f.t_cyc) / (mhz * 1000)),
+               f.flags, f.lq);
+        for (int i = 0; i < 8; i++)
+            printf(" %u", f.ch[i]);
+        printf("\n");
+    }
+    if (rc_lat_cnt)
+        printf("rx->output latency us: min %lu, avg %lu, max %lu (%lu frames)\n", (unsigned long)(rc_lat_min / mhz),
+               (unsigned long)(rc_lat_sum / rc_lat_cnt / mhz), (unsigned long)(rc_lat_max / mhz),
+               (unsigned long)rc_lat_cnt);
+}
+
+ENV_EXPORT(rc, rc_cmd);
@@ -0,0 +1,34 @@
+/**
+ * @file    rc.h
+ * @brief   遥控接收
+ * @details SBUS/CRSF接收机经USART2 (PA3-RX) 输入, DMA1 Stream5循环接收,
+ *          IDLE中断即一帧结束, 在中断中立即解析并发布, 控制节拍读取最新一帧;
+ *          PPM/PWM接收机经TIM5输入捕获 (PA0~PA3), DMA记录边沿时间戳,
+ *          主循环中rc_poll每帧解码一次
+ *
+ * 协议和帧格式见rc_parse.h; PPM接在PA0 (TIM5_CH1), PWM接在PA0~PA3 (TIM5_CH1~4),
+ * PWM读引脚电平确定最后一个边沿的极性, 通道1每出现一个新脉冲采样一次全部通道
+ *
+ * 时间戳:
+ *   帧的时间戳取IDLE中断时的DWT周期数, 比最后一个字节到达晚约一个字符时间 (IDLE检测);
+ *   控制节拍使用该帧算出电机输出时调用rc_output_mark, 统计从收到到输出的延迟;
+ *   PPM/PWM帧的时间戳换算到最后一个边沿的时刻, PPM须等线路静默RC_PPM_SYNC_US才确认帧结束
+ */
+
+#ifndef __RC_H
+#define __RC_H
+
+#include <stdint.h>
+#include <dev_frame.h>
+#include "rc_parse.h"
+
+#define RC_TIMEOUT_MS 100 /* 超过此时间没有新帧视为失控 */
+
+int rc_init(dev_arg_t arg);
+int rc_get(rc_frame_t *out);
+void rc_output_mark(const rc_frame_t *f);
+int rc_poll(void);
+void rc_uart_isr(void);
+void rc_dma_isr(void);
+
+#endif /* __RC_H */
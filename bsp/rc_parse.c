@@ -0,0 +1,234 @@
+/**
+ * @file    rc_parse.c
+ * @brief   SBUS/CRSF字节流解析, PPM/PWM边沿解码
+ * @details 不访问外设, 可在主机上直接编译运行; 帧格式见rc_parse.h
+ *
+ * 同步:
+ *   - 帧外的字节只在是合法帧头时开始一帧, 其余丢弃
+ *   - 线路空闲 (IDLE) 即帧边界, rc_parser_idle丢弃未收完的帧,
+ *     一个错位的字节最多影响到下一次空闲
+ */
+
+#include "rc_parse.h"
+#include <string.h>
+
+/*===========================================================================*/
+/*                              宏定义                                        */
+/*===========================================================================*/
+
+#define SBUS_FRAME_LEN 25
+#define SBUS_HEADER    0x0F
+#define SBUS_FLAG_LOST 0x04
+#define SBUS_FLAG_FS   0x08
+
+#define CRSF_ADDR_FC       0xC8 /* 接收机发给飞控的帧 */
+#define CRSF_LEN_MIN       2    /* 类型 + CRC */
+#define CRSF_LEN_MAX       62   /* 整帧最长64字节 */
+#define CRSF_TYPE_LINK     0x14
+#define CRSF_TYPE_CHANNELS 0x16
+#define CRSF_CHANNELS_LEN  24 /* 类型 + 22字节通道 + CRC */
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+/* 16个11位通道, 低位在前连续排列 */
+static void RC_Unpack11(const uint8_t *d, uint16_t *ch)
+{
+    uint32_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t k = 0;
+
+    for (uint32_t i = 0; i < 22; i++)
+    {
+        acc |= (uint32_t)d[i] << bits;
+        bits += 8;
+        if (bits >= 11)
+        {
+            ch[k++] = acc & 0x7FF;
+            acc >>= 11;
+            bits -= 11;
+        }
+    }
+}
+
+/* CRC8 DVB-S2, 多项式0xD5 */
+static uint8_t RC_Crc8(const uint8_t *d, uint32_t len)
+{
+    uint8_t crc = 0;
+
+    while (len--)
+    {
+        crc ^= *d++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xD5) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static int RC_Sbus_Frame(rc_parser_t *p, rc_frame_t *out)
+{
+    uint8_t end = p->buf[SBUS_FRAME_LEN - 1];
+
+    /* 结束字节0x00; SBUS2在帧间插入遥测时隙, 结束字节为0x04/0x14/0x24/0x34 */
+    if (end != 0x00 && (end & 0x0F) != 0x04)
+    {
+        p->crc_errors++;
+        return 0;
+    }
+    RC_Unpack11(&p->buf[1], out->ch);
+    out->flags = ((p->buf[23] & SBUS_FLAG_LOST) ? RC_FLAG_LOST : 0) |
+                 ((p->buf[23] & SBUS_FLAG_FS) ? RC_FLAG_FAILSAFE : 0);
+    out->lq = 0;
+    p->frames++;
+    return 1;
+}
+
+static int RC_Crsf_Frame(rc_parser_t *p, rc_frame_t *out)
+{
+    uint8_t len = p->buf[1];
+
+    if (RC_Crc8(&p->buf[2], len - 1) != p->buf[len + 1])
+    {
+        p->crc_errors++;
+        return 0;
+    }
+
+    switch (p->buf[2])
+    {
+    case CRSF_TYPE_CHANNELS:
+        if (len != CRSF_CHANNELS_LEN)
+            return 0;
+        RC_Unpack11(&p->buf[3], out->ch);
+        out->flags = 0;
+        out->lq = p->lq;
+        p->frames++;
+        return 1;
+
+    case CRSF_TYPE_LINK:
+        /* 上行RSSI1, RSSI2, 上行LQ, ... */
+        p->lq = p->buf[5];
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+/*===========================================================================*/
+/*                              公共接口                                      */
+/*===========================================================================*/
+
+void rc_parser_init(rc_parser_t *p, rc_proto_t proto)
+{
+    memset(p, 0, sizeof(*p));
+    p->proto = proto;
+}
+
+/**
+ * @brief  输入一个字节
+ * @param  out: 解析出通道帧时写入 (seq和t_cyc由调用者填写)
+ * @retval 1-解析出一帧通道数据, 0-其他
+ */
+int rc_parse_byte(rc_parser_t *p, uint8_t byte, rc_frame_t *out)
+{
+    if (p->pos == 0)
+    {
+        if (byte != (p->proto == RC_PROTO_SBUS ? SBUS_HEADER : CRSF_ADDR_FC))
+        {
+            p->sync_errors++;
+            return 0;
+        }
+        p->len = (p->proto == RC_PROTO_SBUS) ? SBUS_FRAME_LEN : 0;
+    }
+
+    p->buf[p->pos++] = byte;
+
+    if (p->proto == RC_PROTO_CRSF && p->pos == 2)
+    {
+        if (byte < CRSF_LEN_MIN || byte > CRSF_LEN_MAX)
+        {
+            p->sync_errors++;
+            p->pos = 0;
+            return 0;
+        }
+        p->len = byte + 2;
+    }
+
+    if (p->len == 0 || p->pos < p->len)
+        return 0;
+
+    p->pos = 0;
+    return (p->proto == RC_PROTO_SBUS) ? RC_Sbus_Frame(p, out) : RC_Crsf_Frame(p, out);
+}
+
+/**
+ * @brief  线路空闲, 丢弃未收完的帧
+ */
+void rc_parser_idle(rc_parser_t *p)
+{
+    if (p->pos != 0)
+    {
+        p->sync_errors++;
+        p->pos = 0;
+    }
+}
+
+/**
+ * @brief  PPM: 由一批上升沿时间戳 (us) 解出一帧
+ * @param  edges: 按时间顺序的边沿; 中间出现同步间隔时只取其后的部分
+ * @retval 1-成功, 0-通道数或脉宽不合法
+ */
+int rc_ppm_decode(const uint32_t *edges, uint32_t n, rc_frame_t *out)
+{
+    uint32_t start = 0;
+
+    if (n < 2)
+        return 0;
+    for (uint32_t i = 1; i < n; i++)
+    {
+        if (edges[i] - edges[i - 1] > RC_PPM_SYNC_US)
+            start = i;
+    }
+
+    uint32_t num = n - start - 1;
+    if (num < RC_PPM_CH_MIN || num > RC_CH_NUM)
+        return 0;
+
+    for (uint32_t i = 0; i < RC_CH_NUM; i++)
+    {
+        if (i >= num)
+        {
+            out->ch[i] = RC_RAW_MID;
+            continue;
+        }
+        uint32_t w = edges[start + i + 1] - edges[start + i];
+        if (w < RC_PULSE_MIN || w > RC_PULSE_MAX)
+            return 0;
+        out->ch[i] = RC_US_TO_RAW(w);
+    }
+    out->flags = 0;
+    out->lq = 0;
+    return 1;
+}
+
+/**
+ * @brief  PWM: 从一个通道最近的几个边沿 (时间顺序) 中取最近一个完整的高电平脉冲
+ * @param  level: 最后一个边沿之后的引脚电平, 1表示最后一个边沿是上升沿
+ * @param  end: 脉冲下降沿的时间戳
+ * @retval 脉宽 (us), 0-没有完整脉冲或脉宽不合法
+ * @note   双边沿捕获的时间戳不带极性, 由电平确定下降沿, 不按间隔长短猜测
+ *         (低电平间隔同样可能落在脉宽范围内)
+ */
+uint32_t rc_pwm_pulse(const uint32_t *edges, uint32_t n, uint8_t level, uint32_t *end)
+{
+    if (n < (level ? 3u : 2u))
+        return 0;
+
+    uint32_t fall = level ? n - 2 : n - 1;
+    uint32_t w = edges[fall] - edges[fall - 1];
+    if (w < RC_PULSE_MIN || w > RC_PULSE_MAX)
+        return 0;
+    *end = edges[fall];
+    return w;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file    rc_parse.h
+ * @brief   遥控帧解析: SBUS/CRSF字节流, PPM/PWM边沿
+ * @details 只依赖stdint.h, 不访问外设, 主机上可单独编译和测试 (tools/test_rc_parse.c);
+ *          接收驱动见rc.h
+ *
+ * 协议:
+ *   SBUS  100000bps 8E2, 信号反相 (F407的USART不能反相, 需外部反相器),
+ *         25字节: 0x0F | 16通道x11位 (22字节) | 标志 | 结束字节
+ *   CRSF  420000bps 8N1, 地址 | 长度 | 类型 | 负载 | CRC8 (多项式0xD5, 覆盖类型和负载),
+ *         RC通道帧类型0x16, 负载同样为16通道x11位
+ *   两者通道原始值范围都是172~1811, 中位992
+ *   PPM   上升沿, 相邻边沿间隔为各通道, 大于RC_PPM_SYNC_US的间隔为帧同步
+ *   PWM   双边沿, 每通道取最近一个完整高电平脉冲, 边沿极性由引脚电平给出
+ *   脉宽1000~2000us按CRSF的比例换算为原始值
+ */
+
+#ifndef __RC_PARSE_H
+#define __RC_PARSE_H
+
+#include <stdint.h>
+
+#define RC_CH_NUM  16
+#define RC_RAW_MIN 172
+#define RC_RAW_MID 992
+#define RC_RAW_MAX 1811
+
+/* PPM/PWM脉宽 (us) */
+#define RC_PULSE_MIN     750
+#define RC_PULSE_MAX     2250
+#define RC_PPM_SYNC_US   2700
+#define RC_PPM_CH_MIN    4
+#define RC_US_TO_RAW(us) ((uint16_t)(RC_RAW_MID + (((int32_t)(us) - 1500) * 1639) / 1000))
+
+/* 通道顺序 (AETR) */
+#define RC_CH_ROLL     0
+#define RC_CH_PITCH    1
+#define RC_CH_THROTTLE 2
+#define RC_CH_YAW      3
+
+typedef enum
+{
+    RC_PROTO_SBUS = 0,
+    RC_PROTO_CRSF,
+    RC_PROTO_PPM,
+    RC_PROTO_PWM,
+    RC_PROTO_NUM
+} rc_proto_t;
+
+/* rc_frame_t.flags */
+#define RC_FLAG_LOST     0x01 /* 接收机报告丢帧 (SBUS) */
+#define RC_FLAG_FAILSAFE 0x02 /* 接收机进入失控保护 (SBUS) */
+
+/* 一帧通道数据 */
+typedef struct
+{
+    uint16_t ch[RC_CH_NUM]; /* 原始值 */
+    uint8_t flags;
+    uint8_t lq;     /* 链路质量 (%), 来自CRSF链路统计帧, SBUS为0 */
+    uint32_t seq;   /* 发布序号, 每帧加1 */
+    uint32_t t_cyc; /* 收到时的DWT周期数 */
+} rc_frame_t;
+
+/* 字节流解析器 */
+typedef struct
+{
+    uint8_t proto; /* rc_proto_t */
+    uint8_t pos;   /* 当前帧已收字节数 */
+    uint8_t len;   /* 当前帧总长度 (CRSF由长度字节决定) */
+    uint8_t lq;
+    uint8_t buf[64];
+    uint32_t frames;      /* 解析出的通道帧数 */
+    uint32_t crc_errors;  /* CRC或结束字节错误 */
+    uint32_t sync_errors; /* 帧头错误的字节和被丢弃的不完整帧 */
+} rc_parser_t;
+
+void rc_parser_init(rc_parser_t *p, rc_proto_t proto);
+int rc_parse_byte(rc_parser_t *p, uint8_t byte, rc_frame_t *out);
+void rc_parser_idle(rc_parser_t *p);
+int rc_ppm_decode(const uint32_t *edges, uint32_t n, rc_frame_t *out);
+uint32_t rc_pwm_pulse(const uint32_t *edges, uint32_t n, uint8_t level, uint32_t *end);
+
+#endif /* __RC_PARSE_H */
@@ -0,0 +1,158 @@
+/**
+ * @file    section.h
+ * @brief   链接段注册表
+ * @details 设备、命令、参数通过专用链接段自注册, 链接器按段名字典序
+ *          将同类条目合并为Flash中的连续常量表, 启动时直接遍历, 无RAM拷贝
+ *
+ * 段名约定:
+ *   dev_table.<序号>    设备, 序号两位数字决定初始化顺序, 99保留给结束标志
+ *   env_table.<命令名>  Shell命令, 按命令名排序, 可直接二分查找
+ *   param_table.<序号>  运行参数, 序号即参数ID
+ *   bench_table.<名称>  基准测试 (bench.h)
+ *   dlog_fmt            延迟日志格式串 (dlog.h), 相对段首的偏移即格式串ID
+ *
+ * 链接脚本:
+ *   ARM Compiler: mdk/flyf407.sct, 每类一个执行域, 边界取 Image$$ER_xxx$$Base/Limit
+ *   GNU ld:       mdk/flyf407.ld, 边界取 __xxx_start/__xxx_end
+ *   主机测试:     tools/mock/host.ld, 与flyf407.ld同名的段和边界符号
+ *
+ * 本文件不依赖框架头文件: 边界符号按字节数组声明, 用到设备表/命令表的文件
+ * 自己包含dev_frame.h和shell/shell.h (driver.h已包含), 参数、基准测试等
+ * 与硬件无关的模块可以直接在主机上编译.
+ */
+
+#ifndef __SECTION_H
+#define __SECTION_H
+
+#include <stdint.h>
+
+/*===========================================================================*/
+/*                              段属性                                        */
+/*===========================================================================*/
+
+#define SECTION_USED(name) __attribute__((used, section(name)))
+
+/* 放在RAM中执行的函数, 启动时由分散加载从Flash拷贝到RW区 */
+#define RAMFUNC __attribute__((noinline, section(".ramfunc")))
+
+/*===========================================================================*/
+/*                              RAM分区                                       */
+/*===========================================================================*/
+
+/*
+ * CCM (0x10000000, 64KB): 零等待, 只有CPU能访问, DMA不可见
+ *   RW_CCM_STACK   8KB   主栈 (MSP, 中断与主循环共用)
+ *   RW_CCM_STATE   16KB  姿态估计、控制器状态
+ *   RW_CCM_FILTER  16KB  滤波器延迟线、采样结果
+ *   RW_CCM_LOG     24KB  日志暂存缓冲区
+ * 预算即各执行域的最大长度, 超出时链接报错, map文件列出各域用量.
+ *
+ * SRAM1 (0x20000000): DMA缓冲区用DMA_BUFFER放在单独的RW_DMA执行域 (8KB),
+ * 固定在SRAM1开头; 同一执行域内armlink总是先放RW再放ZI, 不能靠段的书写顺序.
+ * 栈在CCM中, 局部数组不能交给DMA.
+ *
+ * CCM_xxx只能修饰无初值变量 (ZI段): armlink由__main清零, GNU ld下为NOLOAD段,
+ * 由main开头的section_zero_init清零 (DMA_BUFFER同样处理).
+ */
+#define CCM_STATE  __attribute__((section(".bss.ccm.state")))
+#define CCM_FILTER __attribute__((section(".bss.ccm.filter")))
+#define CCM_LOG    __attribute__((section(".bss.ccm.log")))
+#define DMA_BUFFER __attribute__((section(".bss.dma"), aligned(4)))
+
+/*===========================================================================*/
+/*                              表边界                                        */
+/*===========================================================================*/
+
+#if defined(__ARMCC_VERSION)
+
+extern const char Image$$ER_DEV_TABLE$$Base[];
+extern const char Image$$ER_DEV_TABLE$$Limit[];
+extern const char Image$$ER_ENV_TABLE$$Base[];
+extern const char Image$$ER_ENV_TABLE$$Limit[];
+extern const char Image$$ER_PARAM_TABLE$$Base[];
+extern const char Image$$ER_PARAM_TABLE$$Limit[];
+extern const char Image$$ER_BENCH_TABLE$$Base[];
+extern const char Image$$ER_BENCH_TABLE$$Limit[];
+extern const char Image$$ER_DLOG_FMT$$Base[];
+
+#define DEV_TABLE_BEGIN   ((const dev_info_t *)Image$$ER_DEV_TABLE$$Base)
+#define DEV_TABLE_END     ((const dev_info_t *)Image$$ER_DEV_TABLE$$Limit)
+#define ENV_TABLE_BEGIN   ((const EnvVar *)Image$$ER_ENV_TABLE$$Base)
+#define ENV_TABLE_END     ((const EnvVar *)Image$$ER_ENV_TABLE$$Limit)
+#define PARAM_TABLE_BEGIN ((const void *)Image$$ER_PARAM_TABLE$$Base)
+#define PARAM_TABLE_END   ((const void *)Image$$ER_PARAM_TABLE$$Limit)
+#define BENCH_TABLE_BEGIN ((const void *)Image$$ER_BENCH_TABLE$$Base)
+#define BENCH_TABLE_END   ((const void *)Image$$ER_BENCH_TABLE$$Limit)
+#define DLOG_FMT_BEGIN    (Image$$ER_DLOG_FMT$$Base)
+
+#else
+
+extern const char __dev_table_start[];
+extern const char __dev_table_end[];
+extern const char __env_table_start[];
+extern const char __env_table_end[];
+extern const char __param_table_start[];
+extern const char __param_table_end[];
+extern const char __bench_table_start[];
+extern const char __bench_table_end[];
+extern const char __dlog_fmt_start[];
+
+#define DEV_TABLE_BEGIN   ((const dev_info_t *)__dev_table_start)
+#define DEV_TABLE_END     ((const dev_info_t *)__dev_table_end)
+#define ENV_TABLE_BEGIN   ((const EnvVar *)__env_table_start)
+#define ENV_TABLE_END     ((const EnvVar *)__env_table_end)
+#define PARAM_TABLE_BEGIN ((const void *)__param_table_start)
+#define PARAM_TABLE_END   ((const void *)__param_table_end)
+#define BENCH_TABLE_BEGIN ((const void *)__bench_table_start)
+#define BENCH_TABLE_END   ((const void *)__bench_table_end)
+#define DLOG_FMT_BEGIN    (__dlog_fmt_start)
+
+#endif
+
+#if !defined(__ARMCC_VERSION)
+extern uint32_t _sdma[], _edma[];          /* DMA缓冲区起止, 见flyf407.ld */
+extern uint32_t _sccm_state[], _eccm_log[]; /* CCM ZI段起止 */
+#endif
+
+/**
+ * @brief  清零放在NOLOAD段中的ZI变量 (DMA_BUFFER和CCM_xxx)
+ * @note   通用GCC启动文件只清.bss, 须在main开头、使用这些变量之前调用;
+ *         armlink的ZI执行域已由__main清零, 此时为空函数. 主栈不在清零范围内
+ * @note   用volatile指针逐字写, 防止编译器换成memset (libc已被丢弃)
+ */
+static inline void section_zero_init(void)
+{
+#if !defined(__ARMCC_VERSION)
+    for (volatile uint32_t *p = _sdma; p < _edma; p++)
+        *p = 0;
+    for (volatile uint32_t *p = _sccm_state; p < _eccm_log; p++)
+        *p = 0;
+#endif
+}
+
+/* 兼容原有名称: 框架接口需要以结束标志收尾的非const数组指针 */
+#define Dev_info_poor ((dev_info_t *)DEV_TABLE_BEGIN)
+#define env_vars      ((EnvVar *)ENV_TABLE_BEGIN)
+
+/*===========================================================================*/
+/*                              注册宏                                        */
+/*===========================================================================*/
+
+/**
+ * @brief  注册设备
+ * @param  order: 两位数字初始化顺序 (00~98)
+ * @param  var: 条目变量名
+ * @note   用法: DEV_EXPORT(10, usart1) { .name = ..., .init = ... };
+ */
+#define DEV_EXPORT(order, var) \
+    const dev_info_t __dev_##var SECTION_USED("dev_table." #order) =
+
+/**
+ * @brief  注册Shell命令
+ * @param  cmd: 命令名 (不加引号, 同时决定在表中的位置)
+ * @param  cb: 回调函数 void cb(int argc, void **argv)
+ */
+#define ENV_EXPORT(cmd, cb) \
+    const EnvVar __env_##cmd SECTION_USED("env_table." #cmd) = {.name = #cmd, .callback = cb}
+
+#endif /* __SECTION_H */
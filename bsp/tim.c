@@ -2,78 +2,128 @@
 #include <driver.h>
 
 /**
- * @brief  初始化定时器中断
- * @param  TIMx: 定时器基地址 (TIM2-TIM5, TIM9-TIM14)
- * @param  ms: 中断触发时间（毫秒）
- * @retval 无
+ * @brief  获取定时器输入时钟
+ * @param  TIMx: 定时器基地址
+ * @retval 定时器计数时钟 (Hz)
+ * @note   APB预分频为1时等于PCLK, 否则为PCLK的2倍
  */
-int TIM_Init(dev_arg_t arg)
+uint32_t tim_get_clock(TIM_TypeDef *TIMx)
 {
-    TIM_TypeDef *TIMx = (TIM_TypeDef *)arg.argv[0];
-    uint32_t ms = (uint32_t)arg.argv[1];
-    uint32_t psc, arr;
-    uint32_t timer_clk;
-    IRQn_Type irqn;
+    uint32_t ppre;
+
+    if (TIMx == TIM1 || TIMx == TIM8 || TIMx == TIM9 || TIMx == TIM10 || TIMx == TIM11)
+    {
+        ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> 13; // APB2
+    }
+    else
+    {
+        ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> 10; // APB1
+    }
+
+    // PPRE: 0xx不分频, 100/101/110/111 = 2/4/8/16分频
+    if (ppre < 4)
+    {
+        return SystemCoreClock;
+    }
+    return (SystemCoreClock >> (ppre - 3)) * 2;
+}
+
+/**
+ * @brief  使能APB1定时器时钟
+ * @param  irqn: 输出该定时器的中断号, 可为NULL
+ * @retval 0-成功, -1-不支持的定时器
+ */
+static int TIM_Clock_Enable(TIM_TypeDef *TIMx, IRQn_Type *irqn)
+{
+    IRQn_Type n;
 
-    // 使能定时器时钟
     if (TIMx == TIM2)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
-        irqn = TIM2_IRQn;
-        timer_clk = SystemCoreClock / 2; // APB1定时器时钟
+        n = TIM2_IRQn;
     }
     else if (TIMx == TIM3)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
-        irqn = TIM3_IRQn;
-        timer_clk = SystemCoreClock / 2;
+        n = TIM3_IRQn;
     }
     else if (TIMx == TIM4)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM4EN;
-        irqn = TIM4_IRQn;
-        timer_clk = SystemCoreClock / 2;
+        n = TIM4_IRQn;
     }
     else if (TIMx == TIM5)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
-        irqn = TIM5_IRQn;
-        timer_clk = SystemCoreClock / 2;
+        n = TIM5_IRQn;
     }
     else if (TIMx == TIM6)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM6EN;
-        irqn = TIM6_DAC_IRQn;
-        timer_clk = SystemCoreClock / 2;
+        n = TIM6_DAC_IRQn;
     }
     else if (TIMx == TIM7)
     {
         RCC->APB1ENR |= RCC_APB1ENR_TIM7EN;
-        irqn = TIM7_IRQn;
-        timer_clk = SystemCoreClock / 2;
+        n = TIM7_IRQn;
     }
     else
     {
         return -1; // 不支持的定时器
     }
 
+    if (irqn != NULL)
+    {
+        *irqn = n;
+    }
+    return 0;
+}
+
+/**
+ * @brief  初始化定时器中断
+ * @param  TIMx: 定时器基地址 (TIM2-TIM5, TIM9-TIM14)
+ * @param  ms: 中断触发时间（毫秒）
+ * @retval 0-成功, -1-不支持的定时器或定时时间超出范围
+ */
+int TIM_Init(dev_arg_t arg)
+{
+    TIM_TypeDef *TIMx = (TIM_TypeDef *)arg.argv[0];
+    uint32_t ms = (uint32_t)(uintptr_t)arg.argv[1];
+    uint32_t psc, arr, div;
+    uint32_t timer_clk;
+    uint64_t ticks;
+    IRQn_Type irqn;
+
+    // 使能定时器时钟
+    if (TIM_Clock_Enable(TIMx, &irqn) != 0)
+    {
+        return -1;
+    }
+
     // APB1预分频系数不为1时，定时器时钟为APB1时钟的2倍
-    // 假设APB1预分频为4，则timer_clk = SystemCoreClock / 4 * 2 = SystemCoreClock / 2
-    // 这里简化处理，假设timer_clk = 84MHz (168MHz / 2)
-    timer_clk = 84000000;
+    timer_clk = tim_get_clock(TIMx);
+    (void)irqn;
 
     // 计算预分频和自动重装载值
-    // 定时时间 = (PSC + 1) * (ARR + 1) / timer_clk
-    // 设置PSC使得计数频率为1kHz (1ms一次计数)
-    psc = timer_clk / 1000 - 1; // PSC = 83999, 1kHz计数频率
-    arr = ms - 1;               // ARR = ms - 1
-
-    // 如果arr超过16位最大值，需要调整psc
-    while (arr > 0xFFFF && psc < 0xFFFF)
+    // 定时时间 = (PSC + 1) * (ARR + 1) / timer_clk, PSC为16位, ARR按16位计算
+    // 84MHz下1kHz计数需要PSC=83999, 超出16位, 因此从ARR不超过0xFFFF的最小分频开始,
+    // 取第一个能整除总计数的分频, 使周期准确
+    ticks = (uint64_t)timer_clk * ms / 1000;
+    if (ticks == 0 || (ticks - 1) / 0x10000 >= 0x10000)
+    {
+        return -1;
+    }
+    div = (uint32_t)((ticks - 1) / 0x10000) + 1;
+    for (uint32_t d = div; d <= 0x10000; d++)
     {
-        psc = (psc + 1) * 2 - 1;
-        arr = (ms * 1000ULL) / (timer_clk / (psc + 1)) - 1;
+        if (ticks % d == 0)
+        {
+            div = d;
+            break;
+        }
     }
+    psc = div - 1;
+    arr = (uint32_t)(ticks / div) - 1;
 
     // 停止定时器
     TIMx->CR1 &= ~TIM_CR1_CEN;
@@ -100,3 +150,83 @@ int TIM_Init(dev_arg_t arg)
     TIMx->CR1 |= TIM_CR1_CEN;
     return 0;
 }
+
+/**
+ * @brief  清除DMA数据流的全部标志
+ */
+static void TIM_DMA_Clear(DMA_Stream_TypeDef *stream)
+{
+    static const uint8_t shift[4] = {0, 6, 16, 22};
+    DMA_TypeDef *dma = ((uintptr_t)stream < (uintptr_t)DMA2) ? DMA1 : DMA2;
+    uint32_t n = ((uintptr_t)stream - (uintptr_t)dma - 0x10) / 0x18;
+    uint32_t flags = 0x3DUL << shift[n & 3];
+
+    if (n < 4)
+    {
+        dma->LIFCR = flags;
+    }
+    else
+    {
+        dma->HIFCR = flags;
+    }
+}
+
+/**
+ * @brief  配置32位定时器的一个输入捕获通道, 捕获值由DMA循环写入缓冲区
+ * @param  TIMx: TIM2或TIM5 (32位计数器, 时间戳相减不需要处理16位回绕)
+ * @param  ch: 通道 1~4
+ * @param  edge: TIM_CAPTURE_RISING 或 TIM_CAPTURE_BOTH
+ * @param  tick_hz: 计数频率, 定时器未运行时才设置, 同一定时器的各通道共用
+ * @param  stream: 该通道捕获请求所在的DMA数据流
+ * @param  chsel: DMA请求通道号 (0~7)
+ * @param  buf: 时间戳缓冲区, 须为DMA_BUFFER
+ * @param  len: 缓冲区长度 (个)
+ * @retval 0-成功, -1-参数错误
+ * @note   每个边沿只产生一次DMA请求, 不产生中断; 写入位置为 len - NDTR,
+ *         GPIO复用功能由调用者配置
+ */
+int tim_capture_init(TIM_TypeDef *TIMx, uint32_t ch, uint32_t edge, uint32_t tick_hz,
+                     DMA_Stream_TypeDef *stream, uint32_t chsel, volatile uint32_t *buf, uint32_t len)
+{
+    uint32_t idx = ch - 1;
+    volatile uint16_t *ccmr = (idx < 2) ? &TIMx->CCMR1 : &TIMx->CCMR2;
+    uint32_t sh = (idx & 1) * 8;
+
+    if ((TIMx != TIM2 && TIMx != TIM5) || ch < 1 || ch > 4 || len == 0 || len > 0xFFFF)
+    {
+        return -1;
+    }
+    TIM_Clock_Enable(TIMx, NULL);
+    RCC->AHB1ENR |= ((uintptr_t)stream < (uintptr_t)DMA2) ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+
+    // 时基: 自由运行, 计满32位回绕
+    if (!(TIMx->CR1 & TIM_CR1_CEN))
+    {
+        TIMx->PSC = tim_get_clock(TIMx) / tick_hz - 1;
+        TIMx->ARR = 0xFFFFFFFF;
+        TIMx->EGR = TIM_EGR_UG;
+    }
+
+    // CCxS=01映射到TIx, ICxF=0011 (8个定时器时钟的数字滤波), 不分频
+    TIMx->CCER &= ~(0xFUL << (idx * 4));
+    *ccmr &= ~(0xFFUL << sh);
+    *ccmr |= (0x01UL | (0x3UL << 4)) << sh;
+    TIMx->CCER |= ((edge == TIM_CAPTURE_BOTH) ? 0xAUL : 0x0UL) << (idx * 4); // CCxP+CCxNP: 双边沿
+    TIMx->CCER |= 0x1UL << (idx * 4);                                      // CCxE
+
+    // DMA: 外设到存储器, 32位, 循环模式
+    stream->CR &= ~DMA_SxCR_EN;
+    while (stream->CR & DMA_SxCR_EN)
+        ;
+    TIM_DMA_Clear(stream);
+    stream->PAR = (uint32_t)(uintptr_t)(&TIMx->CCR1 + idx);
+    stream->M0AR = (uint32_t)(uintptr_t)buf;
+    stream->NDTR = len;
+    stream->CR = (chsel << 25) | DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1 | DMA_SxCR_MINC | DMA_SxCR_CIRC;
+    stream->FCR = 0; // 直接模式
+    stream->CR |= DMA_SxCR_EN;
+
+    TIMx->DIER |= TIM_DIER_CC1DE << idx;
+    TIMx->CR1 |= TIM_CR1_CEN;
+    return 0;
+}
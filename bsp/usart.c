@@ -1,7 +1,17 @@
 /**
  * @file    usart.c
- * @brief   STM32F4 USART驱动程序
- * @details 支持USART1和USART3的初始化、发送、接收功能
+ * @brief   STM32F4 USART/UART驱动程序
+ * @details 各串口的实例、引脚、复用功能、时钟总线和DMA数据流由常量描述表给出,
+ *          初始化、波特率和收发都按表驱动, 增加一个串口只需在表中加一行;
+ *          USART1的字符串和printf输出经发送队列 (console.c) 由DMA发送,
+ *          USART3的遥测帧经表中的发送数据流整块发送;
+ *          接收可选逐字节中断写入使用者提供的环形缓冲区 (uart_rx_start)
+ *
+ * 波特率:
+ *   APB时钟由HCLK和RCC->CFGR中的PPRE1/PPRE2分频算出, 不假设固定分频;
+ *   USARTDIV = f_pclk / (8 x (2 - OVER8) x baud), BRR低4位 (OVER8时低3位) 为小数,
+ *   取最接近的分频值; f_pclk/baud不足16时改用8倍过采样,
+ *   APB1 (42MHz) 最高5.25Mbaud, APB2 (84MHz) 最高10.5Mbaud
  */
 
 #include "driver.h"
@@ -9,6 +19,7 @@
 #include "main.h"
 #include <lcd/df_lcd.h>
 #include <stdarg.h>
+#include <string.h>
 
 /*===========================================================================*/
 /*                              前向声明                                      */
@@ -60,235 +71,497 @@ Ut uart3 = {
     .send_withDMA = NULL,
     .receive_withDMA = NULL};
 
+/* USART1 - 调试串口 */
+DEV_EXPORT(10, usart_debug) {
+    .name = DEBUG_UART_NAME,
+    .init = usart1_init,
+    .enable = usart1_start,
+    .disable = usart1_stop,
+    .arg.ptr = (void *)&debug};
+
+/* USART3 - 通用串口 (PB10-TX, PB11-RX) */
+DEV_EXPORT(11, usart3) {
+    .name = USART3_NAME,
+    .init = usart3_init,
+    .enable = usart3_start,
+    .disable = usart3_stop,
+    .arg.ptr = (void *)&uart3};
+
 /*===========================================================================*/
-/*                          USART1 驱动实现                                   */
+/*                              串口描述表                                    */
 /*===========================================================================*/
 
-/**
- * @brief  USART1硬件初始化
- * @param  BaudRate: 波特率
- * @note   引脚: PA9(TX), PA10(RX)
- * @note   时钟: APB2 (最高84MHz)
+typedef struct
+{
+    GPIO_TypeDef *gpio;
+    uint8_t pin;
+} uart_pin_t;
+
+typedef struct
+{
+    USART_TypeDef *inst;
+    IRQn_Type irq;
+    uint8_t apb;                /* 所在APB总线, 1或2 */
+    uint8_t af;                 /* 引脚复用功能号 */
+    uint32_t rcc_en;            /* RCC->APBxENR中的时钟使能位 */
+    uart_pin_t tx, rx;
+    DMA_Stream_TypeDef *tx_dma; /* 发送请求所在数据流, NULL为不支持 */
+    uint8_t tx_ch;              /* 发送请求的DMA通道号 */
+    DMA_Stream_TypeDef *rx_dma;
+    uint8_t rx_ch;
+} uart_desc_t;
+
+/*
+ * 引脚选不与其他外设冲突的一组; DMA数据流与其他模块共用时由使用者保证不同时开启:
+ *   DMA2 Stream7  USART1_TX  发送队列 (console.c)
+ *   DMA1 Stream5  USART2_RX  遥控接收 (rc.c)
+ *   DMA1 Stream3  USART3_TX  遥测 (telem.c)
+ *   DMA1 Stream0/1/2/4       PPM/PWM输入捕获 (rc.c), 与UART4/5、USART3_RX冲突
  */
-void USART1_Init(uint32_t BaudRate)
-{
-    /* 1. 使能GPIOA和USART1时钟 */
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
-    RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
-
-    /* 2. 配置PA9为复用功能（TX） */
-    GPIOA->MODER &= ~(0x3 << (9 * 2));
-    GPIOA->MODER |= (0x2 << (9 * 2));   /* 复用功能 */
-    GPIOA->OTYPER &= ~(1 << 9);         /* 推挽输出 */
-    GPIOA->OSPEEDR |= (0x3 << (9 * 2)); /* 高速 */
-    GPIOA->PUPDR &= ~(0x3 << (9 * 2));
-    GPIOA->PUPDR |= (0x1 << (9 * 2)); /* 上拉 */
-    GPIOA->AFR[1] &= ~(0xF << ((9 - 8) * 4));
-    GPIOA->AFR[1] |= (0x7 << ((9 - 8) * 4)); /* AF7 = USART1 */
-
-    /* 3. 配置PA10为复用功能（RX） */
-    GPIOA->MODER &= ~(0x3 << (10 * 2));
-    GPIOA->MODER |= (0x2 << (10 * 2)); /* 复用功能 */
-    GPIOA->PUPDR &= ~(0x3 << (10 * 2));
-    GPIOA->PUPDR |= (0x1 << (10 * 2)); /* 上拉 */
-    GPIOA->AFR[1] &= ~(0xF << ((10 - 8) * 4));
-    GPIOA->AFR[1] |= (0x7 << ((10 - 8) * 4)); /* AF7 = USART1 */
-
-    /* 4. 配置USART1波特率 */
-    uint32_t apb2_clk = SystemCoreClock / 2; /* APB2 = HCLK/2 */
-    USART1->BRR = apb2_clk / BaudRate;
-
-    /* 5. 使能USART, TX, RX */
-    USART1->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
-
-    /* 6. 开启接收中断 */
-    USART1->CR1 |= USART_CR1_RXNEIE;
+static const uart_desc_t uart_desc[UART_PORT_NUM] = {
+    [UART_PORT_1] = {USART1, USART1_IRQn, 2, 7, RCC_APB2ENR_USART1EN, {GPIOA, 9}, {GPIOA, 10}, DMA2_Stream7, 4, DMA2_Stream5, 4},
+    [UART_PORT_2] = {USART2, USART2_IRQn, 1, 7, RCC_APB1ENR_USART2EN, {GPIOA, 2}, {GPIOA, 3}, DMA1_Stream6, 4, DMA1_Stream5, 4},
+    [UART_PORT_3] = {USART3, USART3_IRQn, 1, 7, RCC_APB1ENR_USART3EN, {GPIOB, 10}, {GPIOB, 11}, DMA1_Stream3, 4, DMA1_Stream1, 4},
+    [UART_PORT_4] = {UART4, UART4_IRQn, 1, 8, RCC_APB1ENR_UART4EN, {GPIOC, 10}, {GPIOC, 11}, DMA1_Stream4, 4, DMA1_Stream2, 4},
+    [UART_PORT_5] = {UART5, UART5_IRQn, 1, 8, RCC_APB1ENR_UART5EN, {GPIOC, 12}, {GPIOD, 2}, DMA1_Stream7, 4, DMA1_Stream0, 4},
+    [UART_PORT_6] = {USART6, USART6_IRQn, 2, 8, RCC_APB2ENR_USART6EN, {GPIOC, 6}, {GPIOC, 7}, DMA2_Stream6, 5, DMA2_Stream1, 5},
+};
+
+static uint32_t uart_baud[UART_PORT_NUM]; /* 请求的波特率, 0为未打开 */
+
+/* 中断接收的环形缓冲区, head只由中断修改, tail只由读取者修改 */
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t size; /* 2的幂, 0为未开启 */
+    volatile uint32_t head, tail;
+    uint32_t overflow; /* 缓冲区满丢弃的字节 */
+    uint32_t errors;   /* 溢出、帧错误、噪声和校验错误 */
+} uart_rx_t;
+
+static uart_rx_t uart_rx[UART_PORT_NUM];
+
+/*===========================================================================*/
+/*                              内部函数                                      */
+/*===========================================================================*/
+
+/* 复用推挽, 高速, 上拉 (空闲为高) */
+static void UART_Pin(const uart_pin_t *p, uint8_t af)
+{
+    GPIO_TypeDef *g = p->gpio;
+    uint32_t n = p->pin;
+
+    RCC->AHB1ENR |= 1UL << (((uintptr_t)g - (uintptr_t)GPIOA) / 0x400);
+    g->MODER = (g->MODER & ~(0x3UL << (n * 2))) | (0x2UL << (n * 2));
+    g->OTYPER &= ~(1UL << n);
+    g->OSPEEDR |= 0x3UL << (n * 2);
+    g->PUPDR = (g->PUPDR & ~(0x3UL << (n * 2))) | (0x1UL << (n * 2));
+    g->AFR[n >> 3] = (g->AFR[n >> 3] & ~(0xFUL << ((n & 7) * 4))) | ((uint32_t)af << ((n & 7) * 4));
+}
+
+/* 串口所在APB总线的时钟 */
+static uint32_t UART_Pclk(const uart_desc_t *d)
+{
+    static const uint8_t shift[8] = {0, 0, 0, 0, 1, 2, 3, 4}; /* PPREx: 0xx不分频, 100~111为2~16分频 */
+    uint32_t ppre = (d->apb == 2) ? (RCC->CFGR >> 13) & 0x7 : (RCC->CFGR >> 10) & 0x7;
+    return SystemCoreClock >> shift[ppre];
 }
 
 /**
- * @brief  USART1发送单个字符
- * @param  ch: 要发送的字符
+ * @brief  计算BRR
+ * @param  over8: 返回是否需要8倍过采样, 超出范围时为0
+ * @retval BRR值, 0-波特率超出范围
+ * @note   两种过采样下分频的最小单位都是1/f_pclk, 优先用16倍过采样 (抗噪声更好)
  */
-void USART1_SendChar(char ch)
+static uint32_t UART_Brr(uint32_t pclk, uint32_t baud, uint32_t *over8)
 {
-    while (!(USART1->SR & USART_SR_TXE))
-        ;
-    USART1->DR = ch;
+    *over8 = 0;
+    if (baud == 0)
+    {
+        return 0;
+    }
+    uint32_t div = (pclk + baud / 2) / baud; /* USARTDIV x 16 (OVER8时x 8) */
+    if (div >= 16)
+    {
+        return (div <= 0xFFFF) ? div : 0;
+    }
+    if (div >= 8)
+    {
+        *over8 = 1;
+        return ((div & ~0x7UL) << 1) | (div & 0x7); /* 小数只有3位, BRR[3]须为0 */
+    }
+    return 0;
+}
+
+/* 清除数据流的全部中断标志 */
+static void UART_Dma_Clear(DMA_Stream_TypeDef *stream)
+{
+    static const uint8_t shift[4] = {0, 6, 16, 22};
+    DMA_TypeDef *dma = ((uintptr_t)stream < (uintptr_t)DMA2) ? DMA1 : DMA2;
+    uint32_t n = ((uintptr_t)stream - (uintptr_t)dma - 0x10) / 0x18;
+
+    if (n < 4)
+    {
+        dma->LIFCR = 0x3DUL << shift[n];
+    }
+    else
+    {
+        dma->HIFCR = 0x3DUL << shift[n - 4];
+    }
 }
 
+/*===========================================================================*/
+/*                              串口驱动                                      */
+/*===========================================================================*/
+
 /**
- * @brief  USART1发送字符串
- * @param  str: 要发送的字符串指针
+ * @brief  按描述表初始化串口
+ * @param  port: 串口
+ * @param  baud: 波特率
+ * @param  mode: UART_MODE_xxx组合, 只配置用到的引脚
+ * @retval 0-成功, -1-串口号或波特率不合法
+ * @note   不开中断; 接收中断、接收DMA等由使用者在此之后设置
  */
-void USART1_SendString(char *str)
+int uart_open(uart_port_t port, uint32_t baud, uint32_t mode)
 {
-    while (*str)
+    if (port >= UART_PORT_NUM)
+    {
+        return -1;
+    }
+    const uart_desc_t *d = &uart_desc[port];
+    uint32_t over8;
+    uint32_t brr = UART_Brr(UART_Pclk(d), baud, &over8);
+    if (brr == 0)
+    {
+        return -1;
+    }
+
+    /* 1. 时钟和引脚 */
+    if (d->apb == 2)
     {
-        USART1_SendChar(*str++);
+        RCC->APB2ENR |= d->rcc_en;
     }
+    else
+    {
+        RCC->APB1ENR |= d->rcc_en;
+    }
+    if (mode & UART_MODE_TX)
+    {
+        UART_Pin(&d->tx, d->af);
+    }
+    if (mode & UART_MODE_RX)
+    {
+        UART_Pin(&d->rx, d->af);
+    }
+
+    /* 2. 帧格式和波特率; 8E2时M=1, 9位中含偶校验位 */
+    USART_TypeDef *u = d->inst;
+    u->CR1 = 0;
+    u->BRR = brr;
+    u->CR2 = (mode & UART_MODE_8E2) ? USART_CR2_STOP_1 : 0;
+    u->CR3 = 0;
+
+    /* 3. 发送DMA: 存储器到外设, 字节宽度, 不开中断, 由uart_dma_send启动 */
+    if ((mode & UART_MODE_DMA_TX) && d->tx_dma != NULL)
+    {
+        RCC->AHB1ENR |= (d->tx_dma < DMA2_Stream0) ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+        d->tx_dma->CR &= ~DMA_SxCR_EN;
+        while (d->tx_dma->CR & DMA_SxCR_EN)
+            ;
+        UART_Dma_Clear(d->tx_dma);
+        d->tx_dma->PAR = (uint32_t)(uintptr_t)&u->DR;
+        d->tx_dma->CR = ((uint32_t)d->tx_ch << 25) | DMA_SxCR_DIR_0 | DMA_SxCR_MINC;
+        d->tx_dma->FCR = 0; /* 直接模式 */
+        u->CR3 |= USART_CR3_DMAT;
+    }
+
+    /* 4. 使能 */
+    u->CR1 = (over8 ? USART_CR1_OVER8 : 0) | ((mode & UART_MODE_8E2) ? USART_CR1_M | USART_CR1_PCE : 0) |
+             ((mode & UART_MODE_TX) ? USART_CR1_TE : 0) | ((mode & UART_MODE_RX) ? USART_CR1_RE : 0) |
+             USART_CR1_UE;
+    uart_baud[port] = baud;
+    return 0;
 }
 
 /**
- * @brief  USART1接收单个字符
- * @param  None: 保留参数
- * @param  data: 接收数据的指针
- * @return 接收到的数据或0
+ * @brief  修改已打开串口的波特率
+ * @retval 0-成功, -1-未打开、波特率不合法或DMA发送进行中
+ * @note   等当前字节发完后关闭串口改写BRR, 正在接收的字节会丢失
  */
-uint8_t USART1_ReceiveChar(void *None, uint8_t *data)
+int uart_set_baud(uart_port_t port, uint32_t baud)
 {
-    (void)None;
-    if (data == NULL)
+    if (port >= UART_PORT_NUM || uart_baud[port] == 0 || uart_dma_busy(port))
     {
-        return USART1->DR;
+        return -1;
     }
-    *data = USART1->DR;
+    const uart_desc_t *d = &uart_desc[port];
+    uint32_t over8;
+    uint32_t brr = UART_Brr(UART_Pclk(d), baud, &over8);
+    if (brr == 0)
+    {
+        return -1;
+    }
+
+    USART_TypeDef *u = d->inst;
+    if (u->CR1 & USART_CR1_TE)
+    {
+        while (!(u->SR & USART_SR_TC))
+            ;
+    }
+    uint32_t cr1 = u->CR1 & ~(USART_CR1_UE | USART_CR1_OVER8);
+    u->CR1 = cr1;
+    u->BRR = brr;
+    u->CR1 = cr1 | (over8 ? USART_CR1_OVER8 : 0) | USART_CR1_UE;
+    uart_baud[port] = baud;
     return 0;
 }
 
-/*===========================================================================*/
-/*                          USART3 驱动实现                                   */
-/*===========================================================================*/
+/**
+ * @brief  按当前APB时钟计算某个波特率实际能得到的值, 不改动串口
+ * @retval 实际波特率, 0-超出范围
+ */
+uint32_t uart_calc_baud(uart_port_t port, uint32_t baud)
+{
+    if (port >= UART_PORT_NUM)
+    {
+        return 0;
+    }
+    uint32_t pclk = UART_Pclk(&uart_desc[port]);
+    uint32_t over8;
+    uint32_t brr = UART_Brr(pclk, baud, &over8);
+    uint32_t div = over8 ? ((brr >> 4) << 3) | (brr & 0x7) : brr;
+    return div ? pclk / div : 0;
+}
 
 /**
- * @brief  USART3硬件初始化
- * @param  BaudRate: 波特率
- * @note   引脚: PB10(TX), PB11(RX)
- * @note   时钟: APB1 (最高42MHz)
+ * @brief  实际波特率 (由BRR和当前APB时钟算出)
+ * @retval 波特率, 0-未打开
  */
-void USART3_Init(uint32_t BaudRate)
-{
-    /* 1. 使能GPIOB和USART3时钟 */
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
-    RCC->APB1ENR |= RCC_APB1ENR_USART3EN;
-
-    /* 2. 配置PB10为复用功能（TX） */
-    GPIOB->MODER &= ~(0x3 << (10 * 2));
-    GPIOB->MODER |= (0x2 << (10 * 2));   /* 复用功能 */
-    GPIOB->OTYPER &= ~(1 << 10);         /* 推挽输出 */
-    GPIOB->OSPEEDR |= (0x3 << (10 * 2)); /* 高速 */
-    GPIOB->PUPDR &= ~(0x3 << (10 * 2));
-    GPIOB->PUPDR |= (0x1 << (10 * 2)); /* 上拉 */
-    GPIOB->AFR[1] &= ~(0xF << ((10 - 8) * 4));
-    GPIOB->AFR[1] |= (0x7 << ((10 - 8) * 4)); /* AF7 = USART3 */
-
-    /* 3. 配置PB11为复用功能（RX） */
-    GPIOB->MODER &= ~(0x3 << (11 * 2));
-    GPIOB->MODER |= (0x2 << (11 * 2)); /* 复用功能 */
-    GPIOB->PUPDR &= ~(0x3 << (11 * 2));
-    GPIOB->PUPDR |= (0x1 << (11 * 2)); /* 上拉 */
-    GPIOB->AFR[1] &= ~(0xF << ((11 - 8) * 4));
-    GPIOB->AFR[1] |= (0x7 << ((11 - 8) * 4)); /* AF7 = USART3 */
-
-    /* 4. 配置USART3波特率 */
-    uint32_t apb1_clk = SystemCoreClock / 4; /* APB1 = HCLK/4 */
-    USART3->BRR = apb1_clk / BaudRate;
-
-    /* 5. 使能USART, TX, RX */
-    USART3->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
-
-    /* 6. 开启接收中断 */
-    USART3->CR1 |= USART_CR1_RXNEIE;
+uint32_t uart_get_baud(uart_port_t port)
+{
+    if (port >= UART_PORT_NUM || uart_baud[port] == 0)
+    {
+        return 0;
+    }
+    const uart_desc_t *d = &uart_desc[port];
+    uint32_t brr = d->inst->BRR;
+    uint32_t div = (d->inst->CR1 & USART_CR1_OVER8) ? ((brr >> 4) << 3) | (brr & 0x7) : brr;
+    return div ? UART_Pclk(d) / div : 0;
+}
+
+USART_TypeDef *uart_instance(uart_port_t port)
+{
+    return (port < UART_PORT_NUM) ? uart_desc[port].inst : NULL;
 }
 
 /**
- * @brief  USART3发送单个字符
- * @param  ch: 要发送的字符
+ * @brief  发送单个字节, 等待发送寄存器空
  */
-void USART3_SendChar(char ch)
+void uart_putc(uart_port_t port, uint8_t ch)
 {
-    while (!(USART3->SR & USART_SR_TXE))
+    USART_TypeDef *u = uart_desc[port].inst;
+    while (!(u->SR & USART_SR_TXE))
         ;
-    USART3->DR = ch;
+    u->DR = ch;
 }
 
 /**
- * @brief  USART3发送字符串
- * @param  str: 要发送的字符串指针
+ * @brief  逐字节发送一块数据
  */
-void USART3_SendString(char *str)
+void uart_write(uart_port_t port, const uint8_t *data, uint32_t len)
 {
-    while (*str)
+    for (uint32_t i = 0; i < len; i++)
     {
-        USART3_SendChar(*str++);
+        uart_putc(port, data[i]);
     }
 }
 
 /**
- * @brief  USART3发送指定长度的数据
- * @param  data: 数据指针
- * @param  len: 数据长度
+ * @brief  读取一个已收到的字节
+ * @retval 字节, -1-没有数据
  */
-void USART3_SendData(uint8_t *data, uint16_t len)
+int uart_getc(uart_port_t port)
 {
-    for (uint16_t i = 0; i < len; i++)
+    USART_TypeDef *u = uart_desc[port].inst;
+    return (u->SR & USART_SR_RXNE) ? (int)(u->DR & 0xFF) : -1;
+}
+
+/**
+ * @brief  经发送DMA发送一块数据
+ * @param  data: 数据, 须在DMA_BUFFER中, 发送完成前不能修改
+ * @param  len: 字节数
+ * @retval 0-已启动, -1-未以UART_MODE_DMA_TX打开或上一块还在发送
+ * @note   不用中断, 调用者用uart_dma_busy查询
+ */
+int uart_dma_send(uart_port_t port, const uint8_t *data, uint16_t len)
+{
+    if (port >= UART_PORT_NUM)
+    {
+        return -1;
+    }
+    const uart_desc_t *d = &uart_desc[port];
+    if (d->tx_dma == NULL || !(d->inst->CR3 & USART_CR3_DMAT) || (d->tx_dma->CR & DMA_SxCR_EN))
     {
-        USART3_SendChar(data[i]);
+        return -1;
     }
+    UART_Dma_Clear(d->tx_dma);
+    d->tx_dma->M0AR = (uint32_t)(uintptr_t)data;
+    d->tx_dma->NDTR = len;
+    d->tx_dma->CR |= DMA_SxCR_EN;
+    return 0;
 }
 
 /**
- * @brief  USART3接收单个字符
- * @param  None: 保留参数
- * @param  data: 接收数据的指针
- * @return 接收到的数据或0
+ * @brief  DMA发送是否进行中
+ * @note   传输完成后硬件自动清除EN
  */
-uint8_t USART3_ReceiveChar(void *None, uint8_t *data)
+uint8_t uart_dma_busy(uart_port_t port)
 {
-    (void)None;
-    if (data == NULL)
+    if (port >= UART_PORT_NUM || uart_desc[port].tx_dma == NULL)
     {
-        return USART3->DR;
+        return 0;
     }
-    *data = USART3->DR;
+    return (uart_desc[port].tx_dma->CR & DMA_SxCR_EN) ? 1 : 0;
+}
+
+/**
+ * @brief  开启中断接收
+ * @param  buf: 环形缓冲区
+ * @param  size: 缓冲区字节数, 须为2的幂
+ * @param  prio: 中断优先级
+ * @retval 0-成功, -1-参数不合法
+ * @note   中断服务函数中调用uart_rx_isr
+ */
+int uart_rx_start(uart_port_t port, uint8_t *buf, uint32_t size, uint8_t prio)
+{
+    if (port >= UART_PORT_NUM || buf == NULL || size == 0 || (size & (size - 1)))
+    {
+        return -1;
+    }
+    uart_rx_t *r = &uart_rx[port];
+    r->buf = buf;
+    r->head = r->tail = 0;
+    r->size = size;
+
+    uart_desc[port].inst->CR1 |= USART_CR1_RXNEIE;
+    NVIC_SetPriority(uart_desc[port].irq, prio);
+    NVIC_EnableIRQ(uart_desc[port].irq);
     return 0;
 }
 
 /**
- * @brief  检查USART3是否有数据可读
- * @return 1: 有数据, 0: 无数据
+ * @brief  接收中断处理, 收到的字节写入环形缓冲区
+ * @note   先读SR再读DR, 同时清除溢出、帧错误和噪声标志
  */
-uint8_t USART3_Available(void)
+void uart_rx_isr(uart_port_t port)
 {
-    return (USART3->SR & USART_SR_RXNE) ? 1 : 0;
+    USART_TypeDef *u = uart_desc[port].inst;
+    uart_rx_t *r = &uart_rx[port];
+    uint32_t sr = u->SR;
+
+    if (!(sr & (USART_SR_RXNE | USART_SR_ORE)))
+    {
+        return;
+    }
+    uint8_t b = (uint8_t)u->DR;
+    if (sr & (USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE))
+    {
+        r->errors++;
+    }
+    if (!(sr & USART_SR_RXNE) || r->size == 0)
+    {
+        return;
+    }
+    if (r->head - r->tail >= r->size)
+    {
+        r->overflow++;
+        return;
+    }
+    r->buf[r->head & (r->size - 1)] = b;
+    r->head++;
 }
 
+/**
+ * @brief  从接收缓冲区取数据
+ * @retval 取出的字节数
+ */
+uint32_t uart_read(uart_port_t port, uint8_t *dst, uint32_t max)
+{
+    uart_rx_t *r = &uart_rx[port];
+    uint32_t n = 0;
+    uint32_t tail = r->tail;
+
+    while (n < max && tail != r->head)
+    {
+        dst[n++] = r->buf[tail & (r->size - 1)];
+        tail++;
+    }
+    r->tail = tail;
+    return n;
+}
 
+/**
+ * @brief  接收错误计数 (硬件错误 + 缓冲区满丢弃)
+ */
+uint32_t uart_rx_errors(uart_port_t port)
+{
+    return uart_rx[port].errors + uart_rx[port].overflow;
+}
+
+/**
+ * @brief  USART1接收单个字符, Shell的数据接收函数
+ * @param  None: 保留参数
+ * @param  data: 接收数据的指针
+ * @return 接收到的数据或0
+ */
+uint8_t USART1_ReceiveChar(void *None, uint8_t *data)
+{
+    (void)None;
+    if (data == NULL)
+    {
+        return USART1->DR;
+    }
+    *data = USART1->DR;
+    return 0;
+}
 
 /*===========================================================================*/
 /*                          标准IO重定向                                      */
 /*===========================================================================*/
 
 /**
- * @brief  标准输出字符重定向
+ * @brief  标准输出字符重定向, 线程模式下按行提交 (console_putc)
  */
 int __io_putchar(int ch)
 {
-    USART1_SendChar(ch);
+    console_putc((char)ch);
     return ch;
 }
 
-#ifndef __clang__
-
+/**
+ * @brief  格式化后整条写入发送队列, 不同中断中的printf不会交错
+ * @note   超过缓冲区的部分被截断
+ */
 int printf(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
-    char buffer[50];
+    char buffer[128];
     int len = vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
-    USART1_SendString(buffer);
+    if (len > (int)sizeof(buffer) - 1)
+        len = sizeof(buffer) - 1;
+    if (len > 0)
+        console_write(buffer, len);
     return len;
 }
 
-#else
+#ifdef __clang__
 
 int fputc(int ch, FILE *f)
 {
     (void)f;
-    while (!(USART1->SR & USART_SR_TXE))
-        ;
-    USART1->DR = (uint8_t)ch;
-    return ch;
+    return __io_putchar(ch);
 }
 
 #endif
@@ -300,11 +573,16 @@ int fputc(int ch, FILE *f)
 int usart1_init(dev_arg_t arg)
 {
     Ut *uart = (Ut *)arg.ptr;
-    if (*uart->UART_Name == "")
+    if (uart->UART_Name == NULL || *uart->UART_Name == '\0')
     {
         return -1;
     }
-    USART1_Init(uart->BaudRate);
+    if (uart_open(UART_PORT_1, uart->BaudRate, UART_MODE_TX | UART_MODE_RX) != 0)
+    {
+        return -1;
+    }
+    USART1->CR1 |= USART_CR1_RXNEIE;
+    console_init();
     debug.UART_Init_Flag = true;
     uart->send(arg_ptr(CLEAR_SCREEN));
     uart->send(arg_ptr(CURSOR_HOME));
@@ -314,7 +592,8 @@ int usart1_init(dev_arg_t arg)
 
 int usart1_send(dev_arg_t arg)
 {
-    USART1_SendString((char *)arg.ptr);
+    const char *str = (const char *)arg.ptr;
+    console_write(str, strlen(str));
     return 0;
 }
 
@@ -361,7 +640,11 @@ int usart3_init(dev_arg_t arg)
     {
         return -1;
     }
-    USART3_Init(uart->BaudRate);
+    if (uart_open(UART_PORT_3, uart->BaudRate, UART_MODE_TX | UART_MODE_RX | UART_MODE_DMA_TX) != 0)
+    {
+        return -1;
+    }
+    USART3->CR1 |= USART_CR1_RXNEIE;
     uart3.UART_Init_Flag = true;
     return 0;
 }
@@ -373,7 +656,8 @@ int usart3_init(dev_arg_t arg)
  */
 int usart3_send(dev_arg_t arg)
 {
-    USART3_SendString((char *)arg.ptr);
+    const char *str = (const char *)arg.ptr;
+    uart_write(UART_PORT_3, (const uint8_t *)str, strlen(str));
     return 0;
 }
 
@@ -389,7 +673,7 @@ int usart3_receive(dev_arg_t arg)
     {
         return -1;
     }
-    *data = USART3_ReceiveChar(NULL, data);
+    *data = (uint8_t)USART3->DR;
     return 0;
 }
 
@@ -424,6 +708,52 @@ int u3_printf(const char *format, ...)
     char buffer[100];
     int len = vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
-    USART3_SendString(buffer);
+    if (len > (int)sizeof(buffer) - 1)
+        len = sizeof(buffer) - 1;
+    if (len > 0)
+        uart_write(UART_PORT_3, (const uint8_t *)buffer, len);
     return len;
-}
\ No newline at end of file
+}
+
+/*===========================================================================*/
+/*                          Shell命令                                         */
+/*===========================================================================*/
+
+/* 列出已打开的串口: 请求/实际波特率, 误差和过采样倍数 */
+void uart_cmd(int argc, void **argv)
+{
+    (void)argc;
+    (void)argv;
+    for (uint32_t i = 0; i < UART_PORT_NUM; i++)
+    {
+        if (uart_baud[i] == 0)
+        {
+            continue;
+        }
+        uint32_t real = uart_get_baud((uart_port_t)i);
+        int32_t err = (int32_t)((int64_t)((int32_t)real - (int32_t)uart_baud[i]) * 10000 / (int32_t)uart_baud[i]);
+        printf("uart%lu %lu baud (actual %lu, %ld.%02ld%%), pclk %lu, over%d\n", (unsigned long)(i + 1),
+               (unsigned long)uart_baud[i], (unsigned long)real, (long)(err / 100), (long)((err < 0 ? -err : err) % 100),
+               (unsigned long)UART_Pclk(&uart_desc[i]), (uart_desc[i].inst->CR1 & USART_CR1_OVER8) ? 8 : 16);
+    }
+}
+
+ENV_EXPORT(uart, uart_cmd);
+
+/*===========================================================================*/
+/*                          基准测试                                          */
+/*===========================================================================*/
+
+/* 格式化一个浮点数并发送, 以\r结尾覆盖同一行 */
+static void Bench_Printf(void)
+{
+    printf("%.2f\r", 3.14f);
+}
+
+static void Bench_U3_Printf(void)
+{
+    u3_printf("%.2f\r", 3.14f);
+}
+
+BENCH_EXPORT(printf, Bench_Printf);
+BENCH_EXPORT(u3_printf, Bench_U3_Printf);
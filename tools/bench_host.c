@@ -0,0 +1,75 @@
+// 主机基准测试: 与目标板bench命令同一张测试表、同一套统计 (bsp/bench.c), 每项输出一行JSON
+// 计时源为CLOCK_MONOTONIC (ns); 被测的是固件实际运行的代码, 不是拷贝:
+// app/control.c的PT1滤波、单轴PID和完整控制步 (参数取param_table中的默认值)
+//
+// 编译: cc -std=gnu99 -O2 -Wall -no-pie -I../bsp -I../app -Wl,-T,mock/host.ld -o bench_host
+//          bench_host.c param_host.c ../bsp/bench.c ../app/control.c [其他源文件...]
+//       其他只依赖param.h/bench.h的模块和其中的BENCH_EXPORT直接加在命令行上即可,
+//       例如模板工程的Control/filter.c、pid.c配一个注册BENCH_EXPORT的包装文件
+// 用法: bench_host [-n 次数] [-l] [名称...]
+//       -n 每项采样次数 (1~256, 默认64); -l 只列出名称; 不给名称时运行全部
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "param.h"
+#include "bench.h"
+
+static void usage(void){
+    fprintf(stderr, "usage: bench_host [-n iterations<=%d] [-l] [name...]\n", BENCH_ITER_MAX);
+    exit(2);
+}
+
+int main(int argc, char **argv){
+    const bench_t *first = (const bench_t *)BENCH_TABLE_BEGIN, *last = (const bench_t *)BENCH_TABLE_END;
+    uint32_t iter = BENCH_ITER_DEF;
+    int list = 0, named = 0, ret = 0;
+    bench_result_t r;
+
+    param_reset_default();
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iter = (uint32_t)atoi(argv[++i]);
+            if (iter == 0 || iter > BENCH_ITER_MAX)
+                usage();
+        } else if (!strcmp(argv[i], "-l")) {
+            list = 1;
+        } else if (argv[i][0] == '-') {
+            usage();
+        } else {
+            named = 1;
+        }
+    }
+
+    if (!named) {
+        for (const bench_t *b = first; b < last; b++) {
+            if (list) {
+                printf("%s\n", b->name);
+                continue;
+            }
+            bench_run(b, iter, &r);
+            bench_print_json(b, &r);
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            i += !strcmp(argv[i], "-n");
+            continue;
+        }
+        const bench_t *b = bench_find(argv[i]);
+        if (b == NULL) {
+            fprintf(stderr, "bench_host: unknown benchmark %s\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+        if (list) {
+            printf("%s\n", b->name);
+            continue;
+        }
+        bench_run(b, iter, &r);
+        bench_print_json(b, &r);
+    }
+    return ret;
+}
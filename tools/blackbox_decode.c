@@ -0,0 +1,131 @@
+// 飞行记录解码: 读取 blackbox dump 输出的十六进制文本, 转换为CSV
+// 格式定义见 app/blackbox.h
+//
+// 编译: cc -O2 -o blackbox_decode blackbox_decode.c
+// 用法: blackbox_decode < dump.txt > flight.csv
+//       非十六进制的行 (shell提示符等) 会被跳过, 每个会话以session列区分
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define FIELD_MAX 32
+
+static const char *field_names[] = {
+    "t_us", "gyro_r", "gyro_p", "gyro_y", "sp_r", "sp_p", "sp_y",
+    "p_r", "p_p", "p_y", "i_r", "i_p", "i_y", "d_r", "d_p", "d_y",
+    "m1", "m2", "m3", "m4", "pwm_period", "adc_period", "vbat", "current",
+};
+
+static uint8_t *buf;
+static size_t len, cap;
+
+static int hex_val(int c){
+    if (c >= '0' && c <= '9') return c - '0';
+    c = toupper(c);
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 整行都是十六进制时才读入
+static void load_line(const char *line){
+    size_t n = strcspn(line, "\r\n");
+    if (n == 0 || n % 2) return;
+    for (size_t i = 0; i < n; i++) {
+        if (hex_val(line[i]) < 0) return;
+    }
+    if (len + n / 2 > cap) {
+        cap = (len + n / 2) * 2;
+        buf = realloc(buf, cap);
+        if (buf == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    for (size_t i = 0; i < n; i += 2) {
+        buf[len++] = (uint8_t)(hex_val(line[i]) << 4 | hex_val(line[i + 1]));
+    }
+}
+
+// 读一个varint并做zigzag反变换, 数据不完整时返回-1
+static int get_varint(size_t *pos, int32_t *out){
+    uint32_t z = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) return -1;
+        uint8_t b = buf[(*pos)++];
+        z |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = (int32_t)((z >> 1) ^ (~(z & 1) + 1));
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int main(void){
+    char line[1024];
+    int32_t prev[FIELD_MAX], v[FIELD_MAX];
+    int fields = 0, session = 0, have_prev = 0;
+    size_t pos = 0;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        load_line(line);
+    }
+
+    printf("session,frame");
+    for (size_t i = 0; i < sizeof(field_names) / sizeof(field_names[0]); i++) {
+        printf(",%s", field_names[i]);
+    }
+    printf("\n");
+
+    unsigned long frame = 0;
+    while (pos < len) {
+        uint8_t tag = buf[pos];
+        if (pos + 6 <= len && !memcmp(&buf[pos], "BBX1", 4)) {
+            fields = buf[pos + 4];
+            if (fields > FIELD_MAX) {
+                fprintf(stderr, "bad field count %d at %zu\n", fields, pos);
+                return 1;
+            }
+            pos += 6;
+            session++;
+            frame = 0;
+            have_prev = 0;
+            continue;
+        }
+        if (fields == 0 || tag == 'E' || tag == 0xFF) {
+            pos++; // 会话之间的结束标记和填充
+            continue;
+        }
+        if (tag != 'I' && tag != 'P') {
+            fprintf(stderr, "bad frame tag %02X at %zu\n", tag, pos);
+            return 1;
+        }
+        if (tag == 'P' && !have_prev) {
+            fprintf(stderr, "P frame without I frame at %zu\n", pos);
+            return 1;
+        }
+        pos++;
+        for (int k = 0; k < fields; k++) {
+            if (get_varint(&pos, &v[k]) != 0) {
+                fprintf(stderr, "truncated frame at end of data\n");
+                return 0;
+            }
+            if (tag == 'P') {
+                v[k] = (int32_t)((uint32_t)prev[k] + (uint32_t)v[k]);
+            }
+        }
+        memcpy(prev, v, sizeof(v[0]) * fields);
+        have_prev = 1;
+
+        printf("%d,%lu,%lu", session, frame++, (unsigned long)(uint32_t)v[0]);
+        for (int k = 1; k < fields; k++) {
+            printf(",%ld", (long)v[k]);
+        }
+        printf("\n");
+    }
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,153 @@
+// 延迟日志解码: 从ELF读取dlog_fmt段的格式串, 把串口输出中的'@'记录行还原为文本
+// 记录格式见 bsp/dlog.h, 其他行原样输出
+//
+// 编译: cc -O2 -o dlog_decode dlog_decode.c
+// 用法: dlog_decode <固件.elf/.axf> [CPU频率Hz, 默认168000000] < console.txt
+//       GNU ld输出段名为.dlog_fmt, armlink为ER_DLOG_FMT
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *fmt_data;
+static size_t fmt_size;
+
+static int find_section(const uint8_t *img, size_t size, const char *want){
+    uint64_t shoff;
+    unsigned shnum, shentsize, shstrndx;
+    int is64 = img[EI_CLASS] == ELFCLASS64;
+
+    if (is64) {
+        const Elf64_Ehdr *eh = (const void *)img;
+        shoff = eh->e_shoff, shnum = eh->e_shnum, shentsize = eh->e_shentsize, shstrndx = eh->e_shstrndx;
+    } else {
+        const Elf32_Ehdr *eh = (const void *)img;
+        shoff = eh->e_shoff, shnum = eh->e_shnum, shentsize = eh->e_shentsize, shstrndx = eh->e_shstrndx;
+    }
+    if (shoff + (uint64_t)shnum * shentsize > size || shstrndx >= shnum) return -1;
+
+    // 取第i个段的名字偏移、文件偏移和长度
+#define SH_FIELD(i, f) (is64 ? ((const Elf64_Shdr *)(img + shoff + (i) * shentsize))->f \
+                             : ((const Elf32_Shdr *)(img + shoff + (i) * shentsize))->f)
+    uint64_t strtab = SH_FIELD(shstrndx, sh_offset);
+    for (unsigned i = 0; i < shnum; i++) {
+        const char *name = (const char *)img + strtab + SH_FIELD(i, sh_name);
+        if (strcmp(name, want)) continue;
+        uint64_t off = SH_FIELD(i, sh_offset), len = SH_FIELD(i, sh_size);
+        if (off + len > size) return -1;
+        fmt_data = malloc(len + 1);
+        memcpy(fmt_data, img + off, len);
+        fmt_data[len] = '\0';
+        fmt_size = len;
+        return 0;
+    }
+#undef SH_FIELD
+    return -1;
+}
+
+static int load_elf(const char *path){
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *img = malloc(size);
+    if (fread(img, 1, size, f) != (size_t)size || size < (long)sizeof(Elf32_Ehdr) || memcmp(img, ELFMAG, SELFMAG)) {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    int ret = find_section(img, size, ".dlog_fmt");
+    if (ret != 0) ret = find_section(img, size, "ER_DLOG_FMT");
+    if (ret != 0) fprintf(stderr, "%s: no dlog_fmt section\n", path);
+    free(img);
+    return ret;
+}
+
+// 按格式串渲染参数; 长度修饰符被忽略, 参数一律为32位
+static void render(const char *fmt, const uint32_t *args, unsigned nargs){
+    unsigned a = 0;
+    while (*fmt) {
+        if (*fmt != '%') {
+            putchar(*fmt++);
+            continue;
+        }
+        if (fmt[1] == '%') {
+            putchar('%');
+            fmt += 2;
+            continue;
+        }
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof(spec) - 2) spec[n++] = *fmt++;
+        while (*fmt && strchr("hlzjt", *fmt)) fmt++;
+        char conv = *fmt ? *fmt++ : 'd';
+        spec[n++] = conv;
+        spec[n] = '\0';
+
+        if (conv == 's' || a >= nargs) {
+            printf("<?>");
+            continue;
+        }
+        uint32_t v = args[a++];
+        if (strchr("fFeEgGaA", conv)) {
+            float fv;
+            memcpy(&fv, &v, sizeof(fv));
+            printf(spec, (double)fv);
+        } else if (conv == 'd' || conv == 'i') {
+            printf(spec, (int)(int32_t)v);
+        } else {
+            printf(spec, (unsigned)v);
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    char line[512];
+    double hz = 168e6;
+    uint32_t last_cyc = 0;
+    double t_us = 0;
+    int first = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <firmware.elf> [cpu_hz] < console.txt\n", argv[0]);
+        return 1;
+    }
+    if (load_elf(argv[1]) != 0) return 1;
+    if (argc >= 3) hz = atof(argv[2]);
+
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] != '@') {
+            fputs(line, stdout);
+            continue;
+        }
+        uint32_t w[2 + 16];
+        unsigned n = 0;
+        char *p = line + 1, *end;
+        while (n < sizeof(w) / sizeof(w[0])) {
+            unsigned long v = strtoul(p, &end, 16);
+            if (end == p) break;
+            w[n++] = (uint32_t)v;
+            p = end;
+        }
+        uint32_t id = w[0] >> 8, nargs = (w[0] >> 4) & 0xF;
+        if (n < 2 || !(w[0] & 1) || nargs + 2 != n || id >= fmt_size) {
+            printf("[bad record] %s", line);
+            continue;
+        }
+        // 周期计数器会回绕, 按相邻记录的差值累加时间
+        if (!first) t_us += (uint32_t)(w[1] - last_cyc) / hz * 1e6;
+        first = 0;
+        last_cyc = w[1];
+        printf("[%12.3f ms] ", t_us / 1000.0);
+        render(fmt_data + id, &w[2], nargs);
+    }
+    return 0;
+}
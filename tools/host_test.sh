@@ -0,0 +1,47 @@
+#!/bin/sh
+# 主机测试: 编译并运行tools/下的全部test_*.c, 任一失败时退出码非0
+# 依赖寄存器模拟 (mock/) 的测试只能在x86-64 Linux上运行, 须以-no-pie链接
+#
+# 用法: cd tools && ./host_test.sh [-v]
+#   CC 可由环境变量指定, 默认cc; 产物在 ${OUT:-/tmp/flyf407_host_test}
+
+set -u
+CC=${CC:-cc}
+OUT=${OUT:-/tmp/flyf407_host_test}
+CFLAGS="-std=gnu99 -O1 -g -Wall -no-pie -Imock -I../bsp -I../app"
+mkdir -p "$OUT"
+fail=0
+
+# 名字  源文件...
+run() {
+    name=$1
+    shift
+    if ! $CC $CFLAGS -o "$OUT/$name" "$@"; then
+        echo "$name: BUILD FAILED"
+        fail=1
+        return
+    fi
+    if ! "$OUT/$name" $VERBOSE >"$OUT/$name.log" 2>&1; then
+        cat "$OUT/$name.log"
+        fail=1
+    elif [ -n "$VERBOSE" ]; then
+        cat "$OUT/$name.log"
+    else
+        tail -n 1 "$OUT/$name.log"
+    fi
+}
+
+VERBOSE=
+[ "${1:-}" = "-v" ] && VERBOSE=-v
+
+run test_tim test_tim.c ../bsp/tim.c mock/mock.c
+run test_pwm test_pwm.c ../bsp/pwm.c ../bsp/tim.c mock/mock.c
+run test_i2c_bus test_i2c_bus.c ../bsp/i2c_bus.c mock/mock.c
+run test_usart test_usart.c ../bsp/usart.c mock/mock.c
+run test_console test_console.c ../bsp/console.c mock/mock.c -pthread
+run test_rc_parse test_rc_parse.c ../bsp/rc_parse.c
+run test_link test_link.c ../app/link.c
+run test_param_flash test_param_flash.c ../bsp/param.c ../bsp/flash.c mock/mock.c -Wl,-T,mock/host.ld
+run test_bench test_bench.c param_host.c ../bsp/bench.c ../app/control.c -Wl,-T,mock/host.ld
+
+exit $fail
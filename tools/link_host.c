@@ -0,0 +1,262 @@
+// 遥测链路主机端: 以安全速率连上飞控, 协商到双方都支持的最高速率, 之后每秒输出吞吐和错误
+// 协议见 app/link.h; 验证失败或运行中出错的速率本次不再尝试, 依次降速
+//
+// 编译: cc -O2 -I../app -o link_host link_host.c ../app/link.c
+// 用法: link_host <串口> [最高波特率, 默认3000000] [运行秒数, 默认一直运行]
+//       没有板子时用link_sim提供的伪终端代替串口
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "link.h"
+
+enum { H_HELLO, H_SWITCH, H_VERIFY, H_COMMIT, H_FAST, H_BACKOFF };
+static const char *state_names[] = {"hello", "switch", "verify", "commit", "fast", "backoff"};
+
+static int fd;
+static int state = H_HELLO;
+static uint32_t baud = LINK_SAFE_BAUD, target, max_baud = 3000000;
+static uint32_t t_state, t_sent, t_pong, pings_ok, seq;
+static uint32_t backoff_ms;
+static uint32_t failed[LINK_RATE_MAX * 2];
+static int failed_num;
+
+// 接收解析和统计
+static uint8_t buf[64];
+static unsigned pos, need;
+static unsigned long rx_bytes, rx_frames, crc_errors, win_crc;
+static unsigned long tot_bytes, tot_frames, tot_crc, fallbacks;
+
+static uint32_t now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t get32(const uint8_t *p){
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// 任意波特率 (250000不在标准速率表中), 8N1, 原始模式
+static int set_baud(uint32_t b){
+    struct termios2 t;
+    if (ioctl(fd, TCGETS2, &t) != 0) return -1;
+    ioctl(fd, TCSBRK, 1); // 等已写入的数据发完
+    t.c_iflag = 0;
+    t.c_oflag = 0;
+    t.c_lflag = 0;
+    t.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    t.c_ispeed = t.c_ospeed = b;
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 0;
+    if (ioctl(fd, TCSETS2, &t) != 0) return -1;
+    baud = b;
+    return 0;
+}
+
+static void send32(uint8_t type, uint32_t v){
+    uint8_t p[4] = {v >> 24, v >> 16, v >> 8, v}, f[8];
+    uint32_t n = link_frame(f, type, p, 4);
+    if (write(fd, f, n) != (ssize_t)n) perror("write");
+}
+
+static void enter(int s, uint32_t now){
+    state = s;
+    t_state = now;
+    t_sent = 0;
+    win_crc = 0; // 切换前速率下的错误不算在新状态上
+}
+
+static int is_failed(uint32_t b){
+    for (int i = 0; i < failed_num; i++)
+        if (failed[i] == b) return 1;
+    return 0;
+}
+
+// 放弃当前速率, 回到安全速率等飞控也超时回退后重新协商
+static void give_up(uint32_t now, uint32_t wait_ms, const char *why){
+    printf("%s at %u baud, falling back to %u\n", why, target, LINK_SAFE_BAUD);
+    if (!is_failed(target) && failed_num < (int)(sizeof(failed) / sizeof(failed[0]))) failed[failed_num++] = target;
+    fallbacks++;
+    set_baud(LINK_SAFE_BAUD);
+    backoff_ms = wait_ms;
+    enter(H_BACKOFF, now);
+}
+
+static void on_frame(uint8_t type, const uint8_t *p, unsigned len, uint32_t now){
+    uint32_t v = len >= 4 ? get32(p) : 0;
+
+    switch (type) {
+    case LINK_CAPS:
+        if (state != H_HELLO || len < 1) break;
+        target = 0;
+        for (unsigned i = 0; i < p[0] && 1 + i * 4 + 4 <= len; i++) {
+            uint32_t r = get32(&p[1 + i * 4]);
+            if (r <= max_baud && !is_failed(r) && r > target) target = r;
+        }
+        if (target == 0) {
+            printf("no usable rate, staying at %u\n", baud);
+            enter(H_FAST, now);
+            t_pong = now;
+            break;
+        }
+        printf("caps:");
+        for (unsigned i = 0; i < p[0] && 1 + i * 4 + 4 <= len; i++) printf(" %u", get32(&p[1 + i * 4]));
+        printf(", trying %u\n", target);
+        enter(H_SWITCH, now);
+        break;
+    case LINK_SWITCH_ACK:
+        if (state != H_SWITCH) break;
+        if (v != target) {
+            printf("switch to %u refused\n", target);
+            failed[failed_num++] = target;
+            enter(H_HELLO, now);
+            break;
+        }
+        set_baud(target);
+        pings_ok = 0;
+        enter(H_VERIFY, now);
+        break;
+    case LINK_PONG:
+        t_pong = now;
+        if (state == H_VERIFY && v == seq && ++pings_ok >= LINK_PING_NUM) enter(H_COMMIT, now);
+        break;
+    case LINK_COMMIT_ACK:
+        if (state == H_COMMIT && v == target) {
+            printf("link at %u baud\n", v);
+            t_pong = now;
+            enter(H_FAST, now);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void input(const uint8_t *d, ssize_t n, uint32_t now){
+    rx_bytes += n;
+    for (ssize_t i = 0; i < n; i++) {
+        if (pos == 0 && d[i] != LINK_ADDR) continue;
+        buf[pos++] = d[i];
+        if (pos == 2) {
+            if (d[i] < 2 || d[i] > 62) {
+                pos = 0;
+                continue;
+            }
+            need = d[i] + 2;
+        }
+        if (pos < 2 || pos < need) continue;
+        pos = 0;
+        if (link_crc8(&buf[2], need - 3) != buf[need - 1]) {
+            crc_errors++;
+            win_crc++;
+            continue;
+        }
+        rx_frames++;
+        on_frame(buf[2], &buf[3], need - 4, now);
+    }
+}
+
+// 按状态发请求和检查超时
+static void step(uint32_t now){
+    uint32_t since = now - t_state, since_sent = now - t_sent;
+
+    switch (state) {
+    case H_HELLO:
+        if (t_sent == 0 || since_sent >= 200) {
+            send32(LINK_HELLO, max_baud);
+            t_sent = now;
+        }
+        break;
+    case H_SWITCH:
+        if (since > 1000) {
+            enter(H_HELLO, now);
+        } else if (t_sent == 0 || since_sent >= 200) {
+            send32(LINK_SWITCH, target);
+            t_sent = now;
+        }
+        break;
+    case H_VERIFY:
+        // 第一个PING稍等, 确保飞控已切换; 验证须在飞控超时之前完成
+        if (since > LINK_VERIFY_MS - 100) {
+            give_up(now, 200, "verify failed");
+        } else if (since >= 20 && (t_sent == 0 || since_sent >= 30)) {
+            send32(LINK_PING, ++seq);
+            t_sent = now;
+        }
+        break;
+    case H_COMMIT:
+        if (since > 300) {
+            give_up(now, LINK_KEEPALIVE_MS + 200, "commit failed");
+        } else if (t_sent == 0 || since_sent >= 50) {
+            send32(LINK_COMMIT, target);
+            t_sent = now;
+        }
+        break;
+    case H_FAST:
+        if (baud != LINK_SAFE_BAUD && now - t_pong > LINK_KEEPALIVE_MS * 3 / 4) {
+            give_up(now, LINK_KEEPALIVE_MS + 200, "keepalive lost");
+        } else if (baud != LINK_SAFE_BAUD && win_crc > LINK_ERR_MAX) {
+            give_up(now, LINK_KEEPALIVE_MS + 200, "crc errors");
+        } else if (t_sent == 0 || since_sent >= LINK_KEEPALIVE_MS / 4) {
+            send32(LINK_PING, ++seq);
+            t_sent = now;
+        }
+        break;
+    case H_BACKOFF:
+        if (since >= backoff_ms) enter(H_HELLO, now);
+        break;
+    }
+}
+
+int main(int argc, char **argv){
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <tty> [max_baud] [seconds]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 3) max_baud = strtoul(argv[2], NULL, 0);
+    uint32_t run_ms = argc >= 4 ? strtoul(argv[3], NULL, 0) * 1000 : 0;
+
+    fd = open(argv[1], O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || set_baud(LINK_SAFE_BAUD) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    uint32_t start = now_ms(), t_report = start;
+    enter(H_HELLO, start);
+    for (;;) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        uint8_t d[4096];
+        poll(&pfd, 1, 5);
+        uint32_t now = now_ms();
+        ssize_t n = read(fd, d, sizeof(d));
+        if (n > 0) input(d, n, now);
+        else if (n < 0 && errno != EAGAIN) {
+            perror("read");
+            return 1;
+        }
+        step(now);
+
+        if (now - t_report >= 1000) {
+            printf("%-7s %7u baud  rx %7lu B/s  %5lu frames/s  crc %lu\n", state_names[state], baud, rx_bytes,
+                   rx_frames, crc_errors);
+            fflush(stdout);
+            tot_bytes += rx_bytes, tot_frames += rx_frames, tot_crc += crc_errors;
+            rx_bytes = rx_frames = crc_errors = win_crc = 0;
+            t_report = now;
+        }
+        if (run_ms && now - start >= run_ms) break;
+    }
+    printf("total %lu bytes, %lu frames, %lu crc errors, %lu fallbacks, final %s %u baud\n", tot_bytes, tot_frames,
+           tot_crc, fallbacks, state_names[state], baud);
+    return 0;
+}
@@ -0,0 +1,139 @@
+// 没有板子时的飞控替身: 在伪终端上运行飞控端协商状态机 (app/link.c),
+// 并按当前波特率90%的带宽发送遥测帧, 用来测试link_host和状态机
+//
+// 编译: cc -O2 -I../app -o link_sim link_sim.c ../app/link.c
+// 用法: link_sim [-r 速率表, 逗号分隔, 默认3000000,2000000,1000000] [-b 坏速率] [-e 秒] [-t 运行秒数]
+//   -b  在该波特率下按2%概率破坏收发的字节, 模拟这一速率线路不可靠, 协商应降速
+//   -e  进入高速若干秒后开始破坏字节, 模拟运行中链路变差, 应自动回退
+//   启动后打印伪终端路径, 用 link_host <路径> 连接;
+//   伪终端不受波特率影响, 切换只改变替身自己的发送带宽
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "link.h"
+
+static uint32_t now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void corrupt(uint8_t *d, ssize_t n){
+    for (ssize_t i = 0; i < n; i++)
+        if (rand() % 50 == 0) d[i] ^= 1 << (rand() % 8);
+}
+
+int main(int argc, char **argv){
+    uint32_t rates[LINK_RATE_MAX] = {3000000, 2000000, 1000000};
+    uint8_t rate_num = 3;
+    uint32_t bad_baud = 0, err_after = 0, run_s = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:b:e:t:")) != -1) {
+        if (opt == 'r') {
+            rate_num = 0;
+            for (char *s = strtok(optarg, ","); s && rate_num < LINK_RATE_MAX; s = strtok(NULL, ","))
+                rates[rate_num++] = strtoul(s, NULL, 0);
+        } else if (opt == 'b') bad_baud = strtoul(optarg, NULL, 0);
+        else if (opt == 'e') err_after = strtoul(optarg, NULL, 0);
+        else if (opt == 't') run_s = strtoul(optarg, NULL, 0);
+        else {
+            fprintf(stderr, "usage: %s [-r rates] [-b bad_baud] [-e seconds] [-t seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int m = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m < 0 || grantpt(m) || unlockpt(m)) {
+        perror("pty");
+        return 1;
+    }
+    fcntl(m, F_SETFL, O_NONBLOCK);
+
+    // 从端先设为原始模式并保持打开: 否则主机连上前行规程会把发出的字节回显回来
+    struct termios t;
+    int s = open(ptsname(m), O_RDWR | O_NOCTTY);
+    if (s < 0 || tcgetattr(s, &t) != 0) {
+        perror(ptsname(m));
+        return 1;
+    }
+    cfmakeraw(&t);
+    tcsetattr(s, TCSANOW, &t);
+    printf("%s\n", ptsname(m));
+    fflush(stdout);
+
+    link_t l;
+    uint32_t start = now_ms(), last = start, t_fast = 0, t_report = start;
+    uint8_t out[4096];
+    uint32_t out_len = 0, att = 0;
+    double budget = 0;
+    uint8_t state = LINK_SAFE;
+    link_init(&l, rates, rate_num, start);
+
+    for (;;) {
+        usleep(1000);
+        uint32_t now = now_ms();
+        int bad = (bad_baud && l.baud == bad_baud) || (err_after && t_fast && now - t_fast >= err_after * 1000);
+
+        uint8_t d[256];
+        ssize_t n = read(m, d, sizeof(d));
+        if (n > 0) {
+            if (bad) corrupt(d, n);
+            link_input(&l, d, n, now);
+        }
+        link_tick(&l, now);
+
+        // 控制帧优先; 要切换时停发遥测, 等已排队的字节发完再切换
+        out_len += link_take_tx(&l, &out[out_len], sizeof(out) - out_len);
+        if (l.pending && out_len == 0) {
+            link_baud_done(&l, now);
+            budget = 0;
+        }
+        if (l.state != state) {
+            printf("[%6.3f s] %s %u baud\n", (now - start) / 1000.0, link_state_name(l.state), l.baud);
+            fflush(stdout);
+            state = l.state;
+            t_fast = (state == LINK_FAST) ? now : 0;
+        }
+
+        // 按波特率累积可发字节, 剩余带宽填姿态帧
+        budget += (double)l.baud / 10 * 0.9 * (now - last) / 1000;
+        if (budget > sizeof(out)) budget = sizeof(out);
+        last = now;
+        while (!l.pending && out_len + 10 <= sizeof(out) && budget - out_len >= 10) {
+            uint8_t p[6] = {att >> 8, att, 0, 0, 0, 0};
+            out_len += link_frame(&out[out_len], 0x1E, p, 6);
+            att++;
+        }
+        uint32_t k = out_len < budget ? out_len : (uint32_t)budget;
+        if (k > 0) {
+            if (bad) corrupt(out, k);
+            ssize_t w = write(m, out, k);
+            if (w > 0) {
+                memmove(out, &out[w], out_len - w);
+                out_len -= w;
+                budget -= w;
+            } else if (w < 0 && errno != EAGAIN && errno != EIO) {
+                perror("write");
+                return 1;
+            }
+        }
+
+        if (now - t_report >= 1000) {
+            t_report = now;
+            if (run_s && now - start >= run_s * 1000) break;
+        }
+    }
+    printf("rx frames %u, crc errors %u, sync errors %u, switches %u, fallbacks %u, final %s %u baud\n", l.rx_frames,
+           l.crc_errors, l.sync_errors, l.switches, l.fallbacks, link_state_name(l.state), l.baud);
+    return 0;
+}
@@ -0,0 +1,25 @@
+// 主机测试的断言: 失败时打印位置和说明, 继续执行后面的检查, 最后由check_done给出退出码
+#ifndef __CHECK_H
+#define __CHECK_H
+
+#include <stdio.h>
+
+static int check_failed, check_total;
+
+#define CHECK(cond, ...)                                                     \
+    do {                                                                     \
+        check_total++;                                                       \
+        if (!(cond)) {                                                       \
+            check_failed++;                                                  \
+            fprintf(stderr, "%s:%d: FAIL %s: ", __FILE__, __LINE__, #cond);  \
+            fprintf(stderr, __VA_ARGS__);                                    \
+            fputc('\n', stderr);                                             \
+        }                                                                    \
+    } while (0)
+
+static inline int check_done(const char *name){
+    fprintf(stderr, "%s: %d/%d passed\n", name, check_total - check_failed, check_total);
+    return check_failed != 0;
+}
+
+#endif /* __CHECK_H */
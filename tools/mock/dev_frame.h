@@ -0,0 +1,41 @@
+/**
+ * @file    dev_frame.h
+ * @brief   设备框架 (General_template_Project) 的主机替身
+ * @details 类型布局取自mdk/Objects/flyf407.axf的调试信息, 只声明本仓库用到的接口;
+ *          框架本身不参与主机测试, 需要的函数由测试程序提供
+ */
+
+#ifndef __DEV_FRAME_H
+#define __DEV_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef union
+{
+    int32_t s32;
+    uint32_t us32;
+    void *ptr;
+    void **argv;
+} dev_arg_t;
+
+#define arg_ptr(x) ((dev_arg_t){.ptr = (void *)(x)})
+
+typedef struct Dev_Model_Core_TypeDef
+{
+    int index;
+    char name[20];
+    int status;
+    dev_arg_t arg;
+    int (*init)(dev_arg_t arg);
+    int (*enable)(dev_arg_t arg);
+    int (*disable)(dev_arg_t arg);
+} dev_info_t;
+
+#define DEV_INFO_END {0}
+
+int Device_Registration(dev_info_t *dev);
+int Find_Device(dev_info_t *pool, const char *name, dev_info_t **device, dev_arg_t arg);
+
+#endif /* __DEV_FRAME_H */
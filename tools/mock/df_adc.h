@@ -0,0 +1,21 @@
+/**
+ * @file    df_adc.h
+ * @brief   ADC设备类型的主机替身 (按bsp/adc.c的用法声明)
+ */
+
+#ifndef __DF_ADC_H
+#define __DF_ADC_H
+
+#include <dev_frame.h>
+
+typedef struct
+{
+    bool ADC_Init_Flag;
+    uint8_t ADC_Num;
+    char *ADC_Name;
+    int (*init)(dev_arg_t arg);
+    int (*deinit)(dev_arg_t arg);
+    int (*get_value)(dev_arg_t arg);
+} At;
+
+#endif /* __DF_ADC_H */
@@ -0,0 +1,19 @@
+/**
+ * @file    df_delay.h
+ * @brief   延时设备类型的主机替身, 布局取自flyf407.axf的调试信息
+ */
+
+#ifndef __DF_DELAY_H
+#define __DF_DELAY_H
+
+#include <dev_frame.h>
+
+typedef struct
+{
+    bool Delay_Init_Flag;
+    int (*init)(dev_arg_t arg);
+    void (*ms)(uint32_t ms);
+    void (*us)(uint32_t us);
+} Dt;
+
+#endif /* __DF_DELAY_H */
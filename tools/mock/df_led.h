@@ -0,0 +1,23 @@
+/**
+ * @file    df_led.h
+ * @brief   LED设备类型的主机替身, 布局取自flyf407.axf的调试信息
+ */
+
+#ifndef __DF_LED_H
+#define __DF_LED_H
+
+#include <dev_frame.h>
+
+typedef struct
+{
+    bool LED_Init_Flag;
+    uint8_t LED_Num;
+    bool LED_State;
+    char *LED_Name;
+    int (*init)(dev_arg_t arg);
+    int (*on)(dev_arg_t arg);
+    int (*off)(dev_arg_t arg);
+    int (*toggle)(dev_arg_t arg);
+} Lt;
+
+#endif /* __DF_LED_H */
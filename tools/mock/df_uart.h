@@ -0,0 +1,26 @@
+/**
+ * @file    df_uart.h
+ * @brief   串口设备类型的主机替身, 布局取自flyf407.axf的调试信息
+ */
+
+#ifndef __DF_UART_H
+#define __DF_UART_H
+
+#include <dev_frame.h>
+
+typedef struct
+{
+    bool UART_Init_Flag;
+    int UART_Num;
+    uint32_t BaudRate;
+    char *UART_Name;
+    int (*init)(dev_arg_t arg);
+    int (*deinit)(dev_arg_t arg);
+    int (*send)(dev_arg_t arg);
+    int (*printf)(const char *fmt, ...);
+    int (*receive)(dev_arg_t arg);
+    int (*send_withDMA)(dev_arg_t arg);
+    int (*receive_withDMA)(dev_arg_t arg);
+} Ut;
+
+#endif /* __DF_UART_H */
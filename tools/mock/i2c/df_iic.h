@@ -0,0 +1,37 @@
+/**
+ * @file    df_iic.h
+ * @brief   软件I2C框架的主机替身, 类型和函数原型取自flyf407.axf的调试信息
+ * @note    函数实现由测试程序提供 (见tools/test_i2c_bus.c)
+ */
+
+#ifndef __DF_IIC_H
+#define __DF_IIC_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    void (*Soft_IIC_GPIO_Port_Init)(void);
+    void (*delay_us)(uint32_t us);
+    void (*dealy_ms)(uint32_t ms);
+    void (*Soft_IIC_SCL)(uint8_t state);
+    void (*Soft_IIC_SDA)(uint8_t state);
+    void (*Soft_SDA_IN)(void);
+    void (*Soft_SDA_OUT)(void);
+    uint8_t (*Soft_READ_SDA)(void);
+} SIAS;
+
+void Soft_IIC_Init(SIAS *bus);
+void Soft_IIC_Start(SIAS *bus);
+void Soft_IIC_Stop(SIAS *bus);
+uint8_t Soft_IIC_Wait_Ack(SIAS *bus);
+void Soft_IIC_Ack(SIAS *bus);
+void Soft_IIC_NAck(SIAS *bus);
+void Soft_IIC_Send_Byte(SIAS *bus, uint8_t txd);
+uint8_t Soft_IIC_Receive_Byte(SIAS *bus, unsigned char ack);
+uint8_t Soft_IIC_Write_Byte(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t data);
+uint8_t Soft_IIC_Read_Byte(SIAS *bus, uint8_t addr, uint8_t reg);
+uint8_t Soft_IIC_Write_Len(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t len, uint8_t *buf);
+uint8_t Soft_IIC_Read_Len(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t len, uint8_t *buf);
+
+#endif /* __DF_IIC_H */
@@ -0,0 +1,24 @@
+/**
+ * @file    df_irq.h
+ * @brief   中断分发框架的主机替身 (按bsp/bsp_irq.c和app/irq.c的用法声明)
+ */
+
+#ifndef __DF_IRQ_H
+#define __DF_IRQ_H
+
+#include <stm32f4xx.h>
+
+typedef struct
+{
+    IRQn_Type irqn;
+    uint8_t prio;
+    int (*cb)(int argc, void *argv[]);
+    bool flag;
+} irq_handle_t;
+
+#define IRQ_HANDLE_END {0}
+
+void irq_handle_loader(void *handles, IRQn_Type irqn, void *arg);
+void irq_handle_runner(irq_handle_t *handles);
+
+#endif /* __DF_IRQ_H */
@@ -0,0 +1,11 @@
+/**
+ * @file    df_fonts.h
+ * @brief   框架头文件的主机占位, 本仓库不使用其中的声明
+ */
+
+#ifndef __DF_FONTS_H
+#define __DF_FONTS_H
+
+#include <lcd/df_lcd.h>
+
+#endif /* __DF_FONTS_H */
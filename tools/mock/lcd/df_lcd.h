@@ -0,0 +1,16 @@
+/**
+ * @file    df_lcd.h
+ * @brief   LCD框架的主机替身, 本仓库只引用句柄类型
+ */
+
+#ifndef __DF_LCD_H
+#define __DF_LCD_H
+
+#include <dev_frame.h>
+
+typedef struct
+{
+    void *priv;
+} LCD_Handler_t;
+
+#endif /* __DF_LCD_H */
@@ -0,0 +1,1941 @@
+/**
+ * @file    mock.c
+ * @brief   寄存器级外设模拟, 说明见mock.h
+ *
+ * 访问截获:
+ *   外设区用memfd映射两次: 真实地址处为PROT_NONE, 另一处为可读写的别名 (模型只通过
+ *   别名读写). 驱动访问寄存器时缺页 (SIGSEGV), 处理函数:
+ *     1. 推进虚拟时间, 把所有模型同步到当前时刻, 刷新被访问外设的状态寄存器 (SR/CNT/IDR)
+ *     2. 保存该页的快照, 放开该页, 置EFLAGS.TF后返回, CPU执行这一条访问指令
+ *   单步异常 (SIGTRAP) 中恢复保护, 与快照比较得到写入的字, 交给外设模型处理;
+ *   读访问则执行读的副作用 (读DR清RXNE等).
+ */
+
+#define _GNU_SOURCE
+#include "mock.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error "tools/mock needs x86-64 Linux (page faults + single-step)"
+#endif
+
+#define PAGE_SIZE_ 4096u
+#define EFLAGS_TF  0x100
+
+uint32_t SystemCoreClock = 168000000;
+__thread volatile uint32_t mock_primask;
+__thread volatile uint32_t mock_ipsr;
+
+/*===========================================================================*/
+/*                              映射                                          */
+/*===========================================================================*/
+
+typedef struct
+{
+    uintptr_t base;
+    size_t size;
+    uint8_t *alias;
+    uint32_t *reads;
+    uint32_t *writes;
+    int prot;   /* 空闲时的页属性 */
+    uint8_t nv; /* 非易失 (Flash), mock_reset不清除 */
+} region_t;
+
+static region_t regions[] = {
+    {PERIPH_BASE, 0x80000, NULL, NULL, NULL, PROT_NONE, 0},
+    {0xE0000000UL, 0x100000, NULL, NULL, NULL, PROT_NONE, 0},
+    /* Flash只读映射: 读不缺页、不计数, 写入缺页后交给Flash模型 */
+    {FLASH_BASE, MOCK_FLASH_SIZE, NULL, NULL, NULL, PROT_READ, 1},
+};
+#define REGION_NUM (sizeof(regions) / sizeof(regions[0]))
+
+static uint64_t now_cycles;
+static uint64_t access_total;
+static int mock_ready;
+static int mock_plain; /* mock_init_plain: 外设区是普通内存, 不运行模型 */
+
+static struct
+{
+    int active;
+    int write;
+    region_t *r;
+    uintptr_t page;
+    uintptr_t addr;
+    uint8_t snap[PAGE_SIZE_];
+} step;
+
+static region_t *region_of(uintptr_t a)
+{
+    for (uint32_t i = 0; i < REGION_NUM; i++)
+    {
+        if (a >= regions[i].base && a < regions[i].base + regions[i].size)
+        {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+/* 别名中某个寄存器字的指针 */
+static volatile uint32_t *reg32(uintptr_t a)
+{
+    region_t *r = region_of(a);
+    return (volatile uint32_t *)(r->alias + ((a - r->base) & ~3UL));
+}
+
+#define R(periph, field) (*reg32((uintptr_t) & (periph)->field))
+
+/*===========================================================================*/
+/*                              前置声明                                      */
+/*===========================================================================*/
+
+static void sync_all(void);
+static void pre_access(uintptr_t word);
+static void post_read(uintptr_t word);
+static void post_write(uintptr_t word, uint32_t old, uint32_t val);
+
+/*===========================================================================*/
+/*                              信号处理                                      */
+/*===========================================================================*/
+
+static void die(const char *what, uintptr_t a)
+{
+    char buf[96];
+    int n = snprintf(buf, sizeof(buf), "mock: %s at 0x%08lx\n", what, (unsigned long)a);
+    if (write(2, buf, (size_t)n) < 0)
+    {
+    }
+    signal(SIGSEGV, SIG_DFL);
+    abort();
+}
+
+static void on_segv(int sig, siginfo_t *si, void *ctx)
+{
+    ucontext_t *uc = ctx;
+    uintptr_t a = (uintptr_t)si->si_addr;
+    region_t *r = region_of(a);
+
+    (void)sig;
+    if (r == NULL)
+    {
+        die("segmentation fault", a);
+    }
+    if (step.active)
+    {
+        die("nested register access", a);
+    }
+    now_cycles += MOCK_ACCESS_CYCLES;
+    access_total++;
+
+    step.active = 1;
+    step.r = r;
+    step.addr = a;
+    step.page = a & ~(uintptr_t)(PAGE_SIZE_ - 1);
+    step.write = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+
+    pre_access(a & ~3UL);
+    memcpy(step.snap, r->alias + (step.page - r->base), PAGE_SIZE_);
+    mprotect((void *)step.page, PAGE_SIZE_, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= EFLAGS_TF;
+}
+
+static void on_trap(int sig, siginfo_t *si, void *ctx)
+{
+    ucontext_t *uc = ctx;
+    region_t *r = step.r;
+
+    (void)sig;
+    (void)si;
+    if (!step.active)
+    {
+        return;
+    }
+    uc->uc_mcontext.gregs[REG_EFL] &= ~EFLAGS_TF;
+    mprotect((void *)step.page, PAGE_SIZE_, r->prot);
+
+    uint32_t fault = (uint32_t)((step.addr & ~3UL) - step.page);
+    const uint32_t *snap = (const uint32_t *)step.snap;
+    uint32_t *cur = (uint32_t *)(r->alias + (step.page - r->base));
+    uint32_t idx = (uint32_t)((step.page - r->base) >> 2);
+
+    step.active = 0;
+    if (!step.write)
+    {
+        r->reads[idx + (fault >> 2)]++;
+        post_read(step.addr & ~3UL);
+        return;
+    }
+    /* 先找出这条指令改动的字, 再交给模型: 模型处理时会改写同一页的镜像寄存器 */
+    static uint32_t offs[PAGE_SIZE_ / 4], olds[PAGE_SIZE_ / 4], vals[PAGE_SIZE_ / 4];
+    uint32_t n = 0;
+    for (uint32_t off = 0; off < PAGE_SIZE_; off += 4)
+    {
+        if (off == fault || cur[off >> 2] != snap[off >> 2])
+        {
+            offs[n] = off;
+            olds[n] = snap[off >> 2];
+            vals[n++] = cur[off >> 2];
+        }
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        r->writes[idx + (offs[i] >> 2)]++;
+        post_write(step.page + offs[i], olds[i], vals[i]);
+    }
+}
+
+/*===========================================================================*/
+/*                              外设表                                        */
+/*===========================================================================*/
+
+enum
+{
+    P_NONE = 0,
+    P_USART,
+    P_TIM,
+    P_GPIO,
+    P_DMA,
+    P_FLASH,
+    P_CRC
+};
+
+static uint8_t periph_kind[0x200]; /* 区域0内每1KB一个外设 */
+static uint8_t periph_idx[0x200];
+
+static void periph_add(uintptr_t base, uint8_t kind, uint8_t idx)
+{
+    uint32_t b = (uint32_t)((base - PERIPH_BASE) >> 10);
+    periph_kind[b] = kind;
+    periph_idx[b] = idx;
+}
+
+/*===========================================================================*/
+/*                              时钟                                          */
+/*===========================================================================*/
+
+/* APB分频系数 (HCLK = SystemCoreClock) */
+static uint32_t apb_div(int apb2)
+{
+    uint32_t cfgr = R(RCC, CFGR);
+    uint32_t ppre = apb2 ? (cfgr & RCC_CFGR_PPRE2) >> 13 : (cfgr & RCC_CFGR_PPRE1) >> 10;
+    return (ppre < 4) ? 1 : 1u << (ppre - 3);
+}
+
+/*===========================================================================*/
+/*                              DMA                                           */
+/*===========================================================================*/
+
+/* 只模拟存储器到USART_DR的发送数据流, 其余方向为普通寄存器 */
+typedef struct
+{
+    DMA_Stream_TypeDef *regs;
+    DMA_TypeDef *dma;
+    uint8_t n;
+    IRQn_Type irqn;
+    uint32_t ndtr0;   /* 使能时的NDTR */
+    uint64_t en_time; /* 使能时刻 */
+} dma_stream_t;
+
+static dma_stream_t dma_streams[16];
+static const uint8_t dma_flag_shift[4] = {0, 6, 16, 22};
+static const IRQn_Type dma_irqn[16] = {
+    DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+    DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+    DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+    DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn};
+
+static volatile uint32_t *dma_isr(dma_stream_t *s)
+{
+    return (s->n < 4) ? &R(s->dma, LISR) : &R(s->dma, HISR);
+}
+
+static void dma_set_flag(dma_stream_t *s, uint32_t flag)
+{
+    *dma_isr(s) |= flag << dma_flag_shift[s->n & 3];
+}
+
+static int dma_line(dma_stream_t *s)
+{
+    uint32_t cr = R(s->regs, CR);
+    uint32_t f = (*dma_isr(s) >> dma_flag_shift[s->n & 3]) & 0x3D;
+    return ((cr & DMA_SxCR_TCIE) && (f & 0x20)) || ((cr & DMA_SxCR_HTIE) && (f & 0x10)) ||
+           ((cr & DMA_SxCR_TEIE) && (f & 0x08));
+}
+
+static void dma_write(dma_stream_t *d, uintptr_t word, uint32_t old, uint32_t val)
+{
+    uintptr_t off = word - (uintptr_t)d->dma;
+
+    (void)old;
+    if (off == 0x08 || off == 0x0C) /* LIFCR/HIFCR: 写1清除, 读为0 */
+    {
+        *((off == 0x08) ? &R(d->dma, LISR) : &R(d->dma, HISR)) &= ~val;
+        *reg32(word) = 0;
+        return;
+    }
+    if (off == 0x00 || off == 0x04) /* LISR/HISR只读 */
+    {
+        *reg32(word) = old;
+        return;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        dma_stream_t *s = &dma_streams[i];
+        if (word == (uintptr_t)&s->regs->CR && (val & DMA_SxCR_EN) && !(old & DMA_SxCR_EN))
+        {
+            s->ndtr0 = R(s->regs, NDTR);
+            s->en_time = now_cycles;
+        }
+    }
+}
+
+/*===========================================================================*/
+/*                              USART                                         */
+/*===========================================================================*/
+
+#define UART_RXQ 4096
+
+typedef struct
+{
+    USART_TypeDef *regs;
+    int apb2;
+    IRQn_Type irqn;
+
+    /* 发送 */
+    int tdr_full, shifting;
+    uint16_t tdr, shift;
+    uint64_t shift_end, t_txe;
+    uint8_t log[MOCK_TX_LOG];
+    uint32_t log_head, log_tail;
+
+    /* 接收 */
+    uint16_t rxq[UART_RXQ];
+    uint64_t rxq_t[UART_RXQ];
+    uint32_t rxq_head, rxq_tail;
+    uint64_t rx_free, last_rx;
+    uint16_t rdr;
+    int idle_armed;
+
+    int sr_read;
+    mock_uart_stat_t st;
+} uart_t;
+
+static uart_t uarts[6];
+
+static uart_t *uart_of(USART_TypeDef *u)
+{
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        if (uarts[i].regs == u)
+        {
+            return &uarts[i];
+        }
+    }
+    return NULL;
+}
+
+/* 一帧 (起始位+数据位+停止位) 的内核周期数 */
+static uint64_t uart_frame(uart_t *u)
+{
+    uint32_t brr = R(u->regs, BRR) & 0xFFFF;
+    uint32_t cr1 = R(u->regs, CR1);
+    uint32_t stop = (R(u->regs, CR2) & USART_CR2_STOP) >> 12;
+    static const uint32_t stop_half[4] = {2, 1, 4, 3};
+    uint64_t bit = (cr1 & USART_CR1_OVER8) ? (brr >> 4) * 8 + (brr & 7) : brr;
+    uint64_t half = 2 * (1 + ((cr1 & USART_CR1_M) ? 9 : 8)) + stop_half[stop];
+    uint64_t f = bit * apb_div(u->apb2) * half / 2;
+
+    return f ? f : 1;
+}
+
+static int uart_on(uart_t *u, uint32_t bit)
+{
+    uint32_t cr1 = R(u->regs, CR1);
+    return (cr1 & USART_CR1_UE) && (cr1 & bit);
+}
+
+static void uart_sr_set(uart_t *u, uint32_t bits)
+{
+    R(u->regs, SR) |= bits;
+}
+
+static void uart_sr_clr(uart_t *u, uint32_t bits)
+{
+    R(u->regs, SR) &= ~bits;
+}
+
+/* 数据进入TDR; 移位寄存器空闲时立即开始发送 */
+static void uart_tdr_load(uart_t *u, uint16_t v, uint64_t t)
+{
+    if (u->tdr_full)
+    {
+        u->st.tx_lost++;
+    }
+    u->tdr = v;
+    u->tdr_full = 1;
+    uart_sr_clr(u, USART_SR_TXE);
+    if (!u->shifting)
+    {
+        u->shift = u->tdr;
+        u->tdr_full = 0;
+        u->shifting = 1;
+        u->shift_end = t + uart_frame(u);
+        u->t_txe = t;
+        uart_sr_set(u, USART_SR_TXE);
+    }
+}
+
+static dma_stream_t *uart_dma(uart_t *u)
+{
+    if (!(R(u->regs, CR3) & USART_CR3_DMAT))
+    {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        dma_stream_t *s = &dma_streams[i];
+        uint32_t cr = R(s->regs, CR);
+        if ((cr & DMA_SxCR_EN) && (cr & DMA_SxCR_DIR) == DMA_SxCR_DIR_0 &&
+            R(s->regs, PAR) == (uint32_t)(uintptr_t)&u->regs->DR)
+        {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/* TXE时DMA取下一个字节 (8位, 存储器地址递增) */
+static void uart_dma_feed(uart_t *u)
+{
+    dma_stream_t *s = uart_dma(u);
+
+    while (s != NULL && !u->tdr_full)
+    {
+        uint32_t ndtr = R(s->regs, NDTR) & 0xFFFF;
+        if (ndtr == 0)
+        {
+            break;
+        }
+        uint32_t addr = R(s->regs, M0AR) + ((R(s->regs, CR) & DMA_SxCR_MINC) ? s->ndtr0 - ndtr : 0);
+        uint64_t t = (u->t_txe > s->en_time) ? u->t_txe : s->en_time;
+        uart_tdr_load(u, *(const uint8_t *)(uintptr_t)addr, t);
+        R(s->regs, NDTR) = --ndtr;
+        if (ndtr == s->ndtr0 / 2)
+        {
+            dma_set_flag(s, 0x10);
+        }
+        if (ndtr == 0)
+        {
+            dma_set_flag(s, 0x20);
+            R(s->regs, CR) &= ~DMA_SxCR_EN;
+        }
+    }
+}
+
+static void uart_sync(uart_t *u, uint64_t now)
+{
+    uint64_t frame = uart_frame(u);
+
+    /* 发送 */
+    for (;;)
+    {
+        uart_dma_feed(u);
+        if (!u->shifting || u->shift_end > now)
+        {
+            break;
+        }
+        u->log[u->log_head++ % MOCK_TX_LOG] = (uint8_t)u->shift;
+        u->st.tx_bytes++;
+        u->t_txe = u->shift_end;
+        if (u->tdr_full)
+        {
+            u->shift = u->tdr;
+            u->tdr_full = 0;
+            u->shift_end += frame;
+            uart_sr_set(u, USART_SR_TXE);
+        }
+        else
+        {
+            u->shifting = 0;
+            uart_sr_set(u, USART_SR_TC);
+        }
+    }
+
+    /* 接收: 字节在停止位结束时到达 */
+    while (u->rxq_tail != u->rxq_head && u->rxq_t[u->rxq_tail % UART_RXQ] <= now)
+    {
+        uint32_t i = u->rxq_tail++ % UART_RXQ;
+        if (!uart_on(u, USART_CR1_RE))
+        {
+            continue;
+        }
+        u->last_rx = u->rxq_t[i];
+        u->idle_armed = 1;
+        u->st.rx_bytes++;
+        if (R(u->regs, SR) & USART_SR_RXNE)
+        {
+            uart_sr_set(u, USART_SR_ORE);
+            u->st.rx_overrun++;
+            continue;
+        }
+        u->rdr = u->rxq[i];
+        uart_sr_set(u, USART_SR_RXNE);
+    }
+
+    /* 最后一个字节之后空闲一帧 */
+    if (u->idle_armed && now >= u->last_rx + frame)
+    {
+        int busy = u->rxq_tail != u->rxq_head && u->rxq_t[u->rxq_tail % UART_RXQ] - frame < u->last_rx + frame;
+        if (!busy)
+        {
+            uart_sr_set(u, USART_SR_IDLE);
+            u->idle_armed = 0;
+        }
+    }
+}
+
+static int uart_line(uart_t *u)
+{
+    uint32_t sr = R(u->regs, SR), cr1 = R(u->regs, CR1);
+
+    return ((cr1 & USART_CR1_RXNEIE) && (sr & (USART_SR_RXNE | USART_SR_ORE))) ||
+           ((cr1 & USART_CR1_TXEIE) && (sr & USART_SR_TXE)) || ((cr1 & USART_CR1_TCIE) && (sr & USART_SR_TC)) ||
+           ((cr1 & USART_CR1_IDLEIE) && (sr & USART_SR_IDLE)) || ((cr1 & USART_CR1_PEIE) && (sr & USART_SR_PE));
+}
+
+static void uart_pre(uart_t *u, uintptr_t word)
+{
+    if (word == (uintptr_t)&u->regs->DR)
+    {
+        R(u->regs, DR) = u->rdr;
+    }
+}
+
+static void uart_read(uart_t *u, uintptr_t word)
+{
+    if (word == (uintptr_t)&u->regs->SR)
+    {
+        u->sr_read = 1;
+    }
+    else if (word == (uintptr_t)&u->regs->DR)
+    {
+        u->st.dr_reads++;
+        uart_sr_clr(u, USART_SR_RXNE);
+        if (u->sr_read)
+        {
+            uart_sr_clr(u, USART_SR_PE | USART_SR_FE | USART_SR_NE | USART_SR_ORE | USART_SR_IDLE);
+        }
+        u->sr_read = 0;
+    }
+}
+
+static void uart_write(uart_t *u, uintptr_t word, uint32_t old, uint32_t val)
+{
+    if (word == (uintptr_t)&u->regs->SR)
+    {
+        /* 只有CTS/LBD/TC/RXNE可写0清除, 其余位只读 */
+        const uint32_t w0 = USART_SR_CTS | USART_SR_LBD | USART_SR_TC | USART_SR_RXNE;
+        uint32_t sr = (old & ~w0) | (old & val & w0);
+        if ((old & USART_SR_RXNE) && !(sr & USART_SR_RXNE))
+        {
+            u->st.rxne_cleared_by_write++;
+        }
+        *reg32(word) = sr;
+    }
+    else if (word == (uintptr_t)&u->regs->DR)
+    {
+        *reg32(word) = u->rdr;
+        if (!uart_on(u, USART_CR1_TE))
+        {
+            return;
+        }
+        if (u->sr_read)
+        {
+            uart_sr_clr(u, USART_SR_TC); /* 读SR后写DR清除TC */
+        }
+        u->sr_read = 0;
+        if (!(R(u->regs, SR) & USART_SR_TXE))
+        {
+            u->st.tx_lost++;
+            u->tdr_full = 0; /* TDR中未发出的字节被覆盖 */
+        }
+        uart_tdr_load(u, (uint16_t)(val & 0x1FF), now_cycles);
+    }
+}
+
+/*===========================================================================*/
+/*                              TIM                                           */
+/*===========================================================================*/
+
+#define TIM_NUM 14
+
+enum
+{
+    SRC_OVF = 0,
+    SRC_UG,
+    SRC_SLAVE
+};
+
+typedef struct
+{
+    TIM_TypeDef *regs;
+    int apb2, bits32;
+    IRQn_Type irqn, irqn_cc;
+    int8_t itr[4]; /* ITR0~3连接的主定时器 (tims下标), -1为无 */
+
+    int running;
+    uint32_t psc, arr, ccr[4], limit;
+    uint32_t cnt_frozen;
+    int64_t t_start; /* 本周期计数为0的时刻 */
+    uint64_t cpc;    /* 每个计数的内核周期数 */
+
+    uint32_t updates;
+    uint64_t last_uev;
+    int uev_seen;
+    mock_tim_cb_t cb;
+    void *ctx;
+} tim_t;
+
+static tim_t tims[TIM_NUM];
+
+enum
+{
+    T1 = 0, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14
+};
+
+static tim_t *tim_of(TIM_TypeDef *t)
+{
+    for (uint32_t i = 0; i < TIM_NUM; i++)
+    {
+        if (tims[i].regs == t)
+        {
+            return &tims[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t tim_max(tim_t *t)
+{
+    return t->bits32 ? 0xFFFFFFFFu : 0xFFFFu;
+}
+
+static void tim_clock(tim_t *t)
+{
+    uint32_t div = apb_div(t->apb2);
+    uint64_t per_tick = (div == 1) ? 1 : div / 2; /* 定时器时钟为PCLK的2倍 */
+    t->cpc = (uint64_t)(t->psc + 1) * per_tick;
+}
+
+static uint32_t tim_cnt(tim_t *t, uint64_t now)
+{
+    if (!t->running)
+    {
+        return t->cnt_frozen;
+    }
+    return (uint32_t)(((int64_t)now - t->t_start) / (int64_t)t->cpc);
+}
+
+static int64_t tim_next(tim_t *t)
+{
+    return t->t_start + (int64_t)(((uint64_t)t->limit + 1) * t->cpc);
+}
+
+static void tim_trgo(tim_t *m, uint64_t at);
+
+static void tim_uev(tim_t *t, uint64_t at, int src)
+{
+    uint32_t cr1 = R(t->regs, CR1);
+
+    if (cr1 & TIM_CR1_UDIS)
+    {
+        return;
+    }
+    if (t->uev_seen && t->last_uev == at)
+    {
+        return; /* 同一时刻的溢出和从模式复位只算一次 */
+    }
+    t->psc = R(t->regs, PSC) & 0xFFFF;
+    t->arr = R(t->regs, ARR) & tim_max(t);
+    t->ccr[0] = R(t->regs, CCR1) & tim_max(t);
+    t->ccr[1] = R(t->regs, CCR2) & tim_max(t);
+    t->ccr[2] = R(t->regs, CCR3) & tim_max(t);
+    t->ccr[3] = R(t->regs, CCR4) & tim_max(t);
+    t->limit = t->arr;
+    tim_clock(t);
+    t->updates++;
+    t->last_uev = at;
+    t->uev_seen = 1;
+
+    if (src == SRC_OVF || !(cr1 & TIM_CR1_URS))
+    {
+        R(t->regs, SR) |= TIM_SR_UIF;
+    }
+    if (src == SRC_OVF && (cr1 & TIM_CR1_OPM))
+    {
+        R(t->regs, CR1) &= ~TIM_CR1_CEN;
+        t->running = 0;
+        t->cnt_frozen = 0;
+    }
+    if (t->cb != NULL)
+    {
+        t->cb(t->regs, t->ctx);
+    }
+    if ((R(t->regs, CR2) & TIM_CR2_MMS) == 0x20)
+    {
+        tim_trgo(t, at);
+    }
+}
+
+/* 计数器和预分频器复位 */
+static void tim_reinit(tim_t *t, uint64_t at)
+{
+    t->t_start = (int64_t)at;
+    t->cnt_frozen = 0;
+    t->limit = t->arr;
+}
+
+static void tim_trgo(tim_t *m, uint64_t at)
+{
+    int8_t mi = (int8_t)(m - tims);
+
+    for (uint32_t i = 0; i < TIM_NUM; i++)
+    {
+        tim_t *s = &tims[i];
+        uint32_t smcr = R(s->regs, SMCR);
+        uint32_t ts = (smcr & TIM_SMCR_TS) >> 4;
+        if ((smcr & TIM_SMCR_SMS) == 4 && ts < 4 && s->itr[ts] == mi)
+        {
+            tim_reinit(s, at);
+            tim_uev(s, at, SRC_SLAVE);
+        }
+    }
+}
+
+static void tim_sync(uint64_t now)
+{
+    for (;;)
+    {
+        tim_t *best = NULL;
+        int64_t bt = INT64_MAX;
+        for (uint32_t i = 0; i < TIM_NUM; i++)
+        {
+            tim_t *t = &tims[i];
+            if (t->running && tim_next(t) <= (int64_t)now && tim_next(t) < bt)
+            {
+                best = t;
+                bt = tim_next(t);
+            }
+        }
+        if (best == NULL)
+        {
+            return;
+        }
+        best->t_start = bt;
+        best->limit = best->arr;
+        tim_uev(best, (uint64_t)bt, SRC_OVF);
+    }
+}
+
+static int tim_line(tim_t *t, int cc)
+{
+    uint32_t f = R(t->regs, DIER) & R(t->regs, SR);
+    if (t->irqn_cc == t->irqn)
+    {
+        return (f & 0x5F) != 0;
+    }
+    return cc ? (f & 0x1E) != 0 : (f & TIM_SR_UIF) != 0;
+}
+
+static void tim_pre(tim_t *t, uintptr_t word)
+{
+    if (word == (uintptr_t)&t->regs->CNT)
+    {
+        R(t->regs, CNT) = tim_cnt(t, now_cycles);
+    }
+}
+
+static void tim_write(tim_t *t, uintptr_t word, uint32_t old, uint32_t val)
+{
+    TIM_TypeDef *r = t->regs;
+    uint32_t cr1 = R(r, CR1);
+
+    if (word == (uintptr_t)&r->CR1)
+    {
+        if ((val & TIM_CR1_CEN) && !(old & TIM_CR1_CEN))
+        {
+            tim_clock(t);
+            t->t_start = (int64_t)now_cycles - (int64_t)((uint64_t)t->cnt_frozen * t->cpc);
+            t->running = 1;
+        }
+        else if (!(val & TIM_CR1_CEN) && (old & TIM_CR1_CEN))
+        {
+            t->cnt_frozen = tim_cnt(t, now_cycles);
+            t->running = 0;
+        }
+    }
+    else if (word == (uintptr_t)&r->SR)
+    {
+        *reg32(word) = old & val; /* rc_w0 */
+    }
+    else if (word == (uintptr_t)&r->EGR)
+    {
+        *reg32(word) = 0;
+        if (val & TIM_EGR_UG)
+        {
+            tim_reinit(t, now_cycles);
+            t->uev_seen = 0;
+            tim_uev(t, now_cycles, SRC_UG);
+            t->limit = t->arr;
+            if ((R(r, CR2) & TIM_CR2_MMS) == 0)
+            {
+                tim_trgo(t, now_cycles);
+            }
+        }
+    }
+    else if (word == (uintptr_t)&r->CNT)
+    {
+        uint32_t c = val & tim_max(t);
+        t->cnt_frozen = c;
+        t->t_start = (int64_t)now_cycles - (int64_t)((uint64_t)c * t->cpc);
+        t->limit = (c > t->arr) ? tim_max(t) : t->arr;
+    }
+    else if (word == (uintptr_t)&r->ARR)
+    {
+        if (!(cr1 & TIM_CR1_ARPE))
+        {
+            t->arr = val & tim_max(t);
+            t->limit = (tim_cnt(t, now_cycles) > t->arr) ? tim_max(t) : t->arr;
+        }
+    }
+    else if (word >= (uintptr_t)&r->CCR1 && word <= (uintptr_t)&r->CCR4)
+    {
+        uint32_t ch = (uint32_t)(word - (uintptr_t)&r->CCR1) / 4;
+        uint32_t ccmr = (ch < 2) ? R(r, CCMR1) : R(r, CCMR2);
+        if (!(ccmr & ((ch & 1) ? TIM_CCMR1_OC2PE : TIM_CCMR1_OC1PE)))
+        {
+            t->ccr[ch] = val & tim_max(t);
+        }
+    }
+}
+
+/*===========================================================================*/
+/*                              GPIO                                          */
+/*===========================================================================*/
+
+#define GPIO_NUM      9
+#define GPIO_LISTENER 4
+
+typedef struct
+{
+    GPIO_TypeDef *regs;
+    uint16_t ext_low, ext_pullup, level;
+    uint32_t contention;
+    int notifying;
+    mock_gpio_cb_t cb[GPIO_LISTENER];
+    void *ctx[GPIO_LISTENER];
+} gpio_t;
+
+static gpio_t gpios[GPIO_NUM];
+
+static gpio_t *gpio_of(GPIO_TypeDef *g)
+{
+    for (uint32_t i = 0; i < GPIO_NUM; i++)
+    {
+        if (gpios[i].regs == g)
+        {
+            return &gpios[i];
+        }
+    }
+    return NULL;
+}
+
+static uint16_t gpio_compute(gpio_t *g)
+{
+    GPIO_TypeDef *r = g->regs;
+    uint32_t moder = R(r, MODER), otyper = R(r, OTYPER), pupdr = R(r, PUPDR), odr = R(r, ODR);
+    uint16_t lvl = 0;
+
+    for (uint32_t p = 0; p < 16; p++)
+    {
+        uint32_t mode = (moder >> (p * 2)) & 3;
+        uint32_t pupd = (pupdr >> (p * 2)) & 3;
+        int out = (mode == 1 || mode == 2);
+        int high = (odr >> p) & 1;
+        int ext = (g->ext_low >> p) & 1;
+        int v;
+
+        if (out && !high)
+        {
+            v = 0;
+        }
+        else if (out && !((otyper >> p) & 1))
+        {
+            v = 1; /* 推挽输出高电平 */
+            if (ext)
+            {
+                g->contention++;
+            }
+        }
+        else if (ext)
+        {
+            v = 0;
+        }
+        else if (pupd == 1 || ((g->ext_pullup >> p) & 1))
+        {
+            v = 1;
+        }
+        else if (pupd == 2)
+        {
+            v = 0;
+        }
+        else
+        {
+            v = (g->level >> p) & 1; /* 悬空, 保持 */
+        }
+        lvl |= (uint16_t)(v << p);
+    }
+    return lvl;
+}
+
+static void gpio_update(gpio_t *g)
+{
+    uint16_t old = g->level;
+
+    g->level = gpio_compute(g);
+    R(g->regs, IDR) = g->level;
+    if (g->level == old || g->notifying)
+    {
+        return;
+    }
+    g->notifying = 1;
+    for (uint32_t i = 0; i < GPIO_LISTENER; i++)
+    {
+        if (g->cb[i] != NULL)
+        {
+            g->cb[i](g->regs, old, g->level, g->ctx[i]);
+        }
+    }
+    g->notifying = 0;
+}
+
+static void gpio_write(gpio_t *g, uintptr_t word, uint32_t old, uint32_t val)
+{
+    GPIO_TypeDef *r = g->regs;
+
+    if (word == (uintptr_t)&r->IDR)
+    {
+        *reg32(word) = old;
+        return;
+    }
+    if (word == (uintptr_t)&r->BSRRL)
+    {
+        uint32_t set = val & 0xFFFF, rst = val >> 16;
+        R(r, ODR) = (R(r, ODR) & ~rst) | set;
+        *reg32(word) = 0;
+    }
+    gpio_update(g);
+}
+
+/*===========================================================================*/
+/*                              FLASH / CRC                                   */
+/*===========================================================================*/
+
+#define FLASH_KEY1_ 0x45670123
+#define FLASH_KEY2_ 0xCDEF89AB
+#define FLASH_SR_W1C (FLASH_SR_EOP | FLASH_SR_SOP | FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+static const uint32_t flash_sector_off[9] = {0x00000, 0x04000, 0x08000, 0x0C000, 0x10000,
+                                             0x20000, 0x40000, 0x60000, 0x80000};
+
+static struct
+{
+    mock_flash_cb_t cb;
+    void *ctx;
+    uint8_t key; /* 已写入KEY1 */
+    uint32_t programs, erases;
+} flash;
+
+static uint8_t *flash_mem(uintptr_t a)
+{
+    return regions[2].alias + (a - FLASH_BASE);
+}
+
+static void flash_reg_write(uintptr_t word, uint32_t old, uint32_t val)
+{
+    if (word == (uintptr_t)&FLASH->KEYR)
+    {
+        if (val == FLASH_KEY1_)
+        {
+            flash.key = 1;
+        }
+        else
+        {
+            if (flash.key && val == FLASH_KEY2_)
+            {
+                R(FLASH, CR) &= ~FLASH_CR_LOCK;
+            }
+            flash.key = 0;
+        }
+        R(FLASH, KEYR) = 0;
+    }
+    else if (word == (uintptr_t)&FLASH->SR)
+    {
+        R(FLASH, SR) = old & ~(val & FLASH_SR_W1C);
+    }
+    else if (word == (uintptr_t)&FLASH->CR)
+    {
+        /* 上锁后CR只读, LOCK只能由KEYR清除; 擦除立即完成, BSY不置位 */
+        if (old & FLASH_CR_LOCK)
+        {
+            R(FLASH, CR) = old;
+            return;
+        }
+        R(FLASH, CR) = val & ~FLASH_CR_STRT;
+        if ((val & (FLASH_CR_STRT | FLASH_CR_SER)) == (FLASH_CR_STRT | FLASH_CR_SER))
+        {
+            uint32_t n = (val & FLASH_CR_SNB) >> 3;
+            if (n >= 8 || (val & FLASH_CR_PG))
+            {
+                R(FLASH, SR) |= FLASH_SR_PGSERR;
+                return;
+            }
+            uintptr_t a = FLASH_BASE + flash_sector_off[n];
+            if (flash.cb)
+            {
+                flash.cb(1, a, 0xFFFFFFFF, flash.ctx);
+            }
+            memset(flash_mem(a), 0xFF, flash_sector_off[n + 1] - flash_sector_off[n]);
+            flash.erases++;
+        }
+    }
+}
+
+/* 写Flash存储区: 只有PG置位且未上锁时有效, 编程只能把1变成0 */
+static void flash_mem_write(uintptr_t word, uint32_t old, uint32_t val)
+{
+    uint32_t cr = R(FLASH, CR);
+    volatile uint32_t *p = (volatile uint32_t *)flash_mem(word);
+
+    if ((cr & FLASH_CR_LOCK) || !(cr & FLASH_CR_PG))
+    {
+        *p = old;
+        R(FLASH, SR) |= FLASH_SR_PGSERR;
+        return;
+    }
+    if (flash.cb)
+    {
+        flash.cb(0, word, val, flash.ctx);
+    }
+    *p = old & val;
+    flash.programs++;
+}
+
+/* CRC单元: 多项式0x04C11DB7, 按字输入, 高位在前 */
+static void crc_write(uintptr_t word, uint32_t old, uint32_t val)
+{
+    if (word == (uintptr_t)&CRC->DR)
+    {
+        uint32_t c = old ^ val;
+        for (int i = 0; i < 32; i++)
+        {
+            c = (c & 0x80000000) ? (c << 1) ^ 0x04C11DB7 : c << 1;
+        }
+        R(CRC, DR) = c;
+    }
+    else if (word == (uintptr_t)&CRC->CR)
+    {
+        if (val & CRC_CR_RESET)
+        {
+            R(CRC, DR) = 0xFFFFFFFF;
+        }
+        R(CRC, CR) = val & ~CRC_CR_RESET;
+    }
+}
+
+/*===========================================================================*/
+/*                              内核外设                                      */
+/*===========================================================================*/
+
+static uint32_t nvic_enabled[8], nvic_pending[8];
+static mock_isr_t isr_table[128];
+static uint64_t dwt_base;
+
+static void core_pre(uintptr_t word)
+{
+    if (word == (uintptr_t)&DWT->CYCCNT)
+    {
+        R(DWT, CYCCNT) = (uint32_t)(now_cycles - dwt_base);
+    }
+}
+
+static void core_write(uintptr_t word, uint32_t old, uint32_t val)
+{
+    uintptr_t nv = (uintptr_t)NVIC;
+
+    (void)old;
+    if (word >= nv && word < nv + 0x200)
+    {
+        uint32_t n = (uint32_t)((word - nv) & 0x7F) >> 2;
+        uint32_t which = (uint32_t)(word - nv) >> 7;
+        if (n >= 8)
+        {
+            return;
+        }
+        switch (which)
+        {
+        case 0:
+            nvic_enabled[n] |= val;
+            break;
+        case 1:
+            nvic_enabled[n] &= ~val;
+            break;
+        case 2:
+            nvic_pending[n] |= val;
+            break;
+        case 3:
+            nvic_pending[n] &= ~val;
+            break;
+        }
+        R(NVIC, ISER[n]) = R(NVIC, ICER[n]) = nvic_enabled[n];
+        R(NVIC, ISPR[n]) = R(NVIC, ICPR[n]) = nvic_pending[n];
+    }
+    else if (word == (uintptr_t)&NVIC->STIR)
+    {
+        nvic_pending[(val & 0xFF) >> 5] |= 1u << (val & 0x1F);
+    }
+    else if (word == (uintptr_t)&DWT->CYCCNT)
+    {
+        dwt_base = now_cycles - val;
+    }
+}
+
+/*===========================================================================*/
+/*                              访问分发                                      */
+/*===========================================================================*/
+
+static void sync_all(void)
+{
+    tim_sync(now_cycles);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        uart_sync(&uarts[i], now_cycles);
+    }
+}
+
+static int periph_at(uintptr_t word, uint8_t *idx)
+{
+    if (word < PERIPH_BASE || word >= PERIPH_BASE + 0x80000)
+    {
+        return P_NONE;
+    }
+    uint32_t b = (uint32_t)((word - PERIPH_BASE) >> 10);
+    *idx = periph_idx[b];
+    return periph_kind[b];
+}
+
+static void pre_access(uintptr_t word)
+{
+    uint8_t i;
+
+    sync_all();
+    switch (periph_at(word, &i))
+    {
+    case P_USART:
+        uart_pre(&uarts[i], word);
+        break;
+    case P_TIM:
+        tim_pre(&tims[i], word);
+        break;
+    case P_NONE:
+        core_pre(word);
+        break;
+    }
+}
+
+static void post_read(uintptr_t word)
+{
+    uint8_t i;
+
+    if (periph_at(word, &i) == P_USART)
+    {
+        uart_read(&uarts[i], word);
+    }
+}
+
+static void post_write(uintptr_t word, uint32_t old, uint32_t val)
+{
+    uint8_t i;
+
+    if (word >= FLASH_BASE && word < FLASH_BASE + MOCK_FLASH_SIZE)
+    {
+        flash_mem_write(word, old, val);
+        return;
+    }
+    switch (periph_at(word, &i))
+    {
+    case P_USART:
+        uart_write(&uarts[i], word, old, val);
+        break;
+    case P_TIM:
+        tim_write(&tims[i], word, old, val);
+        break;
+    case P_GPIO:
+        gpio_write(&gpios[i], word, old, val);
+        break;
+    case P_DMA:
+        dma_write(&dma_streams[i * 8], word, old, val);
+        break;
+    case P_FLASH:
+        flash_reg_write(word, old, val);
+        break;
+    case P_CRC:
+        crc_write(word, old, val);
+        break;
+    case P_NONE:
+        core_write(word, old, val);
+        break;
+    }
+    sync_all(); /* 写入可能立即产生事件 (UG、DMA使能) */
+}
+
+/*===========================================================================*/
+/*                              初始化                                        */
+/*===========================================================================*/
+
+static void map_regions(void)
+{
+    for (uint32_t i = 0; i < REGION_NUM; i++)
+    {
+        region_t *r = &regions[i];
+        int fd = memfd_create("mock", 0);
+        if (fd < 0 || ftruncate(fd, (off_t)r->size) != 0)
+        {
+            perror("mock: memfd");
+            exit(2);
+        }
+        void *p = mmap((void *)r->base, r->size, r->prot, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+        if (p != (void *)r->base)
+        {
+            fprintf(stderr, "mock: cannot map 0x%08lx\n", (unsigned long)r->base);
+            exit(2);
+        }
+        r->alias = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        r->reads = calloc(r->size / 4, sizeof(uint32_t));
+        r->writes = calloc(r->size / 4, sizeof(uint32_t));
+        if (r->alias == MAP_FAILED || r->reads == NULL || r->writes == NULL)
+        {
+            perror("mock: alias");
+            exit(2);
+        }
+        if (r->nv)
+        {
+            memset(r->alias, 0xFF, r->size); /* 出厂为擦除状态 */
+        }
+        close(fd);
+    }
+}
+
+static void install_handlers(void)
+{
+    struct sigaction sa;
+    static uint8_t altstack[65536];
+    stack_t ss = {.ss_sp = altstack, .ss_size = sizeof(altstack)};
+
+    sigaltstack(&ss, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_sigaction = on_segv;
+    sigaction(SIGSEGV, &sa, NULL);
+    sa.sa_sigaction = on_trap;
+    sigaction(SIGTRAP, &sa, NULL);
+}
+
+static void periph_table(void)
+{
+    static TIM_TypeDef *const tim_regs[TIM_NUM] = {TIM1, TIM2, TIM3, TIM4, TIM5, TIM6, TIM7,
+                                                   TIM8, TIM9, TIM10, TIM11, TIM12, TIM13, TIM14};
+    static const int8_t itr[TIM_NUM][4] = {
+        [T1] = {T5, T2, T3, T4},   [T2] = {T1, T8, T3, T4},   [T3] = {T1, T2, T5, T4},
+        [T4] = {T1, T2, T3, T8},   [T5] = {T2, T3, T4, T8},   [T6] = {-1, -1, -1, -1},
+        [T7] = {-1, -1, -1, -1},   [T8] = {T1, T2, T4, T5},   [T9] = {T2, T3, -1, -1},
+        [T10] = {-1, -1, -1, -1},  [T11] = {-1, -1, -1, -1},  [T12] = {T4, T5, -1, -1},
+        [T13] = {-1, -1, -1, -1},  [T14] = {-1, -1, -1, -1}};
+    static const IRQn_Type tim_irq[TIM_NUM][2] = {
+        {TIM1_UP_TIM10_IRQn, TIM1_CC_IRQn}, {TIM2_IRQn, TIM2_IRQn}, {TIM3_IRQn, TIM3_IRQn},
+        {TIM4_IRQn, TIM4_IRQn}, {TIM5_IRQn, TIM5_IRQn}, {TIM6_DAC_IRQn, TIM6_DAC_IRQn},
+        {TIM7_IRQn, TIM7_IRQn}, {-100, -100}, {TIM1_BRK_TIM9_IRQn, TIM1_BRK_TIM9_IRQn},
+        {TIM1_UP_TIM10_IRQn, TIM1_UP_TIM10_IRQn}, {TIM1_TRG_COM_TIM11_IRQn, TIM1_TRG_COM_TIM11_IRQn},
+        {-100, -100}, {-100, -100}, {-100, -100}};
+    static USART_TypeDef *const uart_regs[6] = {USART1, USART2, USART3, UART4, UART5, USART6};
+    static const IRQn_Type uart_irq[6] = {USART1_IRQn, USART2_IRQn, USART3_IRQn, UART4_IRQn, UART5_IRQn, USART6_IRQn};
+
+    memset(periph_kind, 0, sizeof(periph_kind));
+    for (uint32_t i = 0; i < TIM_NUM; i++)
+    {
+        memset(&tims[i], 0, sizeof(tims[i]));
+        tims[i].regs = tim_regs[i];
+        tims[i].apb2 = ((uintptr_t)tim_regs[i] >= APB2PERIPH_BASE);
+        tims[i].bits32 = (i == T2 || i == T5);
+        tims[i].irqn = tim_irq[i][0];
+        tims[i].irqn_cc = tim_irq[i][1];
+        memcpy(tims[i].itr, itr[i], sizeof(itr[i]));
+        tims[i].cpc = 1;
+        periph_add((uintptr_t)tim_regs[i], P_TIM, (uint8_t)i);
+    }
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        memset(&uarts[i], 0, sizeof(uarts[i]));
+        uarts[i].regs = uart_regs[i];
+        uarts[i].apb2 = ((uintptr_t)uart_regs[i] >= APB2PERIPH_BASE);
+        uarts[i].irqn = uart_irq[i];
+        periph_add((uintptr_t)uart_regs[i], P_USART, (uint8_t)i);
+    }
+    for (uint32_t i = 0; i < GPIO_NUM; i++)
+    {
+        memset(&gpios[i], 0, sizeof(gpios[i]));
+        gpios[i].regs = (GPIO_TypeDef *)(GPIOA_BASE + i * 0x400);
+        periph_add(GPIOA_BASE + i * 0x400, P_GPIO, (uint8_t)i);
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        dma_stream_t *s = &dma_streams[i];
+        s->dma = (i < 8) ? DMA1 : DMA2;
+        s->n = (uint8_t)(i & 7);
+        s->regs = (DMA_Stream_TypeDef *)((uintptr_t)s->dma + 0x10 + 0x18 * s->n);
+        s->irqn = dma_irqn[i];
+        s->ndtr0 = 0;
+    }
+    periph_add(DMA1_BASE, P_DMA, 0);
+    periph_add(DMA2_BASE, P_DMA, 1);
+    periph_add(FLASH_R_BASE, P_FLASH, 0);
+    periph_add(CRC_BASE, P_CRC, 0);
+    memset(&flash, 0, sizeof(flash));
+}
+
+/* 复位值 (RM0090), 时钟树按system_stm32f4xx.c配置后的状态: 168MHz, APB1 /4, APB2 /2 */
+static void reset_values(void)
+{
+    R(RCC, CR) = 0x03035583;
+    R(RCC, PLLCFGR) = 0x07405408;
+    R(RCC, CFGR) = 0x0000940A;
+    R(GPIOA, MODER) = 0xA8000000;
+    R(GPIOA, PUPDR) = 0x64000000;
+    R(GPIOB, MODER) = 0x00000280;
+    R(GPIOB, OSPEEDR) = 0x000000C0;
+    R(GPIOB, PUPDR) = 0x00000100;
+    R(FLASH, ACR) = 0x00000705;
+    R(FLASH, CR) = FLASH_CR_LOCK;
+    R(CRC, DR) = 0xFFFFFFFF;
+    R(SCB, CPUID) = 0x410FC241;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        R(uarts[i].regs, SR) = USART_SR_TXE | USART_SR_TC;
+    }
+    for (uint32_t i = 0; i < GPIO_NUM; i++)
+    {
+        gpios[i].level = gpio_compute(&gpios[i]);
+        R(gpios[i].regs, IDR) = gpios[i].level;
+    }
+}
+
+void mock_reset(void)
+{
+    for (uint32_t i = 0; i < REGION_NUM; i++)
+    {
+        if (!regions[i].nv)
+        {
+            memset(regions[i].alias, 0, regions[i].size);
+        }
+        memset(regions[i].reads, 0, regions[i].size);
+        memset(regions[i].writes, 0, regions[i].size);
+    }
+    periph_table();
+    memset(nvic_enabled, 0, sizeof(nvic_enabled));
+    memset(nvic_pending, 0, sizeof(nvic_pending));
+    memset(isr_table, 0, sizeof(isr_table));
+    now_cycles = 0;
+    dwt_base = 0;
+    access_total = 0;
+    mock_primask = 0;
+    mock_ipsr = 0;
+    reset_values();
+}
+
+void mock_init(void)
+{
+    if (!mock_ready)
+    {
+        map_regions();
+        install_handlers();
+        mock_ready = 1;
+    }
+    mock_reset();
+}
+
+void mock_init_plain(void)
+{
+    if (!mock_ready)
+    {
+        for (uint32_t i = 0; i < REGION_NUM; i++)
+        {
+            regions[i].prot = PROT_READ | PROT_WRITE;
+        }
+        map_regions();
+        mock_ready = 1;
+        mock_plain = 1;
+    }
+    mock_reset();
+}
+
+void mock_system_reset(void)
+{
+    fprintf(stderr, "mock: NVIC_SystemReset\n");
+    abort();
+}
+
+/*===========================================================================*/
+/*                              引擎接口                                      */
+/*===========================================================================*/
+
+uint64_t mock_now(void)
+{
+    return now_cycles;
+}
+
+void mock_advance(uint64_t cycles)
+{
+    now_cycles += cycles;
+    sync_all();
+}
+
+void mock_run(uint64_t cycles, uint32_t step_cycles)
+{
+    uint64_t end = now_cycles + cycles;
+
+    if (step_cycles == 0)
+    {
+        step_cycles = 1;
+    }
+    while (now_cycles < end)
+    {
+        uint64_t d = end - now_cycles;
+        mock_advance(d < step_cycles ? d : step_cycles);
+        mock_irq_dispatch();
+    }
+}
+
+uint32_t mock_peek(const volatile void *reg)
+{
+    uintptr_t word = (uintptr_t)reg & ~3UL;
+
+    if (region_of(word) == NULL)
+    {
+        return 0;
+    }
+    if (!mock_plain)
+    {
+        pre_access(word);
+    }
+    return *reg32(word);
+}
+
+void mock_poke(volatile void *reg, uint32_t value)
+{
+    *reg32((uintptr_t)reg) = value;
+}
+
+static uint32_t *count_of(const volatile void *reg, int w)
+{
+    uintptr_t a = (uintptr_t)reg;
+    region_t *r = region_of(a);
+    if (r == NULL)
+    {
+        return NULL;
+    }
+    return (w ? r->writes : r->reads) + ((a - r->base) >> 2);
+}
+
+uint32_t mock_reads(const volatile void *reg)
+{
+    uint32_t *c = count_of(reg, 0);
+    return c ? *c : 0;
+}
+
+uint32_t mock_writes(const volatile void *reg)
+{
+    uint32_t *c = count_of(reg, 1);
+    return c ? *c : 0;
+}
+
+uint64_t mock_accesses(void)
+{
+    return access_total;
+}
+
+void mock_count_clear(void)
+{
+    for (uint32_t i = 0; i < REGION_NUM; i++)
+    {
+        memset(regions[i].reads, 0, regions[i].size);
+        memset(regions[i].writes, 0, regions[i].size);
+    }
+    access_total = 0;
+}
+
+/*===========================================================================*/
+/*                              中断接口                                      */
+/*===========================================================================*/
+
+static int irq_line(IRQn_Type irqn)
+{
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        if (uarts[i].irqn == irqn && uart_line(&uarts[i]))
+        {
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < TIM_NUM; i++)
+    {
+        if ((tims[i].irqn == irqn && tim_line(&tims[i], 0)) || (tims[i].irqn_cc == irqn && tim_line(&tims[i], 1)))
+        {
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        if (dma_streams[i].irqn == irqn && dma_line(&dma_streams[i]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void mock_irq_handler(IRQn_Type irqn, mock_isr_t isr)
+{
+    if (irqn >= 0 && irqn < 128)
+    {
+        isr_table[irqn] = isr;
+    }
+}
+
+int mock_irq_enabled(IRQn_Type irqn)
+{
+    return irqn >= 0 && (nvic_enabled[irqn >> 5] >> (irqn & 31)) & 1;
+}
+
+static int irq_pending(IRQn_Type irqn)
+{
+    return irqn >= 0 && (((nvic_pending[irqn >> 5] >> (irqn & 31)) & 1) || irq_line(irqn));
+}
+
+int mock_irq_pending(IRQn_Type irqn)
+{
+    sync_all();
+    return irq_pending(irqn);
+}
+
+/* 按优先级 (IPR, 数值小的优先) 执行已使能且挂起的中断, 返回执行次数 */
+uint32_t mock_irq_dispatch(void)
+{
+    uint32_t n = 0;
+
+    while (!mock_primask && n < 1024)
+    {
+        int best = -1;
+        uint32_t best_prio = 0x100;
+        sync_all();
+        for (int i = 0; i < 128; i++)
+        {
+            uint32_t prio = *((volatile uint8_t *)reg32((uintptr_t)&NVIC->IPR[i]) + (i & 3));
+            if (isr_table[i] != NULL && mock_irq_enabled((IRQn_Type)i) && irq_pending((IRQn_Type)i) &&
+                prio < best_prio)
+            {
+                best = i;
+                best_prio = prio;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        uint32_t ipsr = mock_ipsr;
+        nvic_pending[best >> 5] &= ~(1u << (best & 31));
+        mock_ipsr = (uint32_t)best + 16;
+        isr_table[best]();
+        mock_ipsr = ipsr;
+        n++;
+    }
+    return n;
+}
+
+/*===========================================================================*/
+/*                              USART接口                                     */
+/*===========================================================================*/
+
+void mock_uart_rx(USART_TypeDef *uu, const uint8_t *p, uint32_t n)
+{
+    uart_t *u = uart_of(uu);
+    uint64_t frame = uart_frame(u);
+    uint64_t t = (u->rx_free > now_cycles) ? u->rx_free : now_cycles;
+
+    for (uint32_t i = 0; i < n && u->rxq_head - u->rxq_tail < UART_RXQ; i++)
+    {
+        t += frame;
+        u->rxq[u->rxq_head % UART_RXQ] = p[i];
+        u->rxq_t[u->rxq_head % UART_RXQ] = t;
+        u->rxq_head++;
+    }
+    u->rx_free = t;
+}
+
+void mock_uart_rx_gap(USART_TypeDef *uu, uint64_t cycles)
+{
+    uart_t *u = uart_of(uu);
+    u->rx_free = ((u->rx_free > now_cycles) ? u->rx_free : now_cycles) + cycles;
+}
+
+uint32_t mock_uart_tx(USART_TypeDef *uu, uint8_t *dst, uint32_t max)
+{
+    uart_t *u = uart_of(uu);
+    uint32_t n = 0;
+
+    sync_all();
+    while (n < max && u->log_tail != u->log_head)
+    {
+        dst[n++] = u->log[u->log_tail++ % MOCK_TX_LOG];
+    }
+    return n;
+}
+
+uint64_t mock_uart_byte_cycles(USART_TypeDef *uu)
+{
+    return uart_frame(uart_of(uu));
+}
+
+/* 发送全部完成 (TC) 的时刻; 仍在发送时返回预计时刻 */
+uint64_t mock_uart_tx_done(USART_TypeDef *uu)
+{
+    uart_t *u = uart_of(uu);
+
+    sync_all();
+    if (!u->shifting)
+    {
+        return u->t_txe;
+    }
+    return u->shift_end + (u->tdr_full ? uart_frame(u) : 0);
+}
+
+const mock_uart_stat_t *mock_uart_stat(USART_TypeDef *uu)
+{
+    sync_all();
+    return &uart_of(uu)->st;
+}
+
+int mock_uart_irq(USART_TypeDef *uu)
+{
+    uart_t *u = uart_of(uu);
+
+    sync_all();
+    return mock_irq_enabled(u->irqn) && uart_line(u);
+}
+
+/*===========================================================================*/
+/*                              TIM接口                                       */
+/*===========================================================================*/
+
+void mock_tim_on_update(TIM_TypeDef *t, mock_tim_cb_t cb, void *ctx)
+{
+    tim_t *m = tim_of(t);
+    m->cb = cb;
+    m->ctx = ctx;
+}
+
+uint32_t mock_tim_updates(TIM_TypeDef *t)
+{
+    sync_all();
+    return tim_of(t)->updates;
+}
+
+uint64_t mock_tim_last_update(TIM_TypeDef *t)
+{
+    sync_all();
+    return tim_of(t)->last_uev;
+}
+
+uint32_t mock_tim_arr(TIM_TypeDef *t)
+{
+    sync_all();
+    return tim_of(t)->arr;
+}
+
+uint32_t mock_tim_psc(TIM_TypeDef *t)
+{
+    sync_all();
+    return tim_of(t)->psc;
+}
+
+uint32_t mock_tim_ccr(TIM_TypeDef *t, uint32_t ch)
+{
+    sync_all();
+    return (ch >= 1 && ch <= 4) ? tim_of(t)->ccr[ch - 1] : 0;
+}
+
+uint64_t mock_tim_period(TIM_TypeDef *t)
+{
+    tim_t *m = tim_of(t);
+    sync_all();
+    return ((uint64_t)m->arr + 1) * m->cpc;
+}
+
+/*===========================================================================*/
+/*                              FLASH接口                                     */
+/*===========================================================================*/
+
+void mock_flash_on_op(mock_flash_cb_t cb, void *ctx)
+{
+    flash.cb = cb;
+    flash.ctx = ctx;
+}
+
+uint32_t mock_flash_programs(void)
+{
+    return flash.programs;
+}
+
+uint32_t mock_flash_erases(void)
+{
+    return flash.erases;
+}
+
+void mock_flash_wipe(void)
+{
+    memset(regions[2].alias, 0xFF, MOCK_FLASH_SIZE);
+}
+
+/*===========================================================================*/
+/*                              GPIO接口                                      */
+/*===========================================================================*/
+
+void mock_gpio_listen(GPIO_TypeDef *g, mock_gpio_cb_t cb, void *ctx)
+{
+    gpio_t *m = gpio_of(g);
+    for (uint32_t i = 0; i < GPIO_LISTENER; i++)
+    {
+        if (m->cb[i] == NULL)
+        {
+            m->cb[i] = cb;
+            m->ctx[i] = ctx;
+            return;
+        }
+    }
+}
+
+void mock_gpio_pull_low(GPIO_TypeDef *g, uint32_t pin, int low)
+{
+    gpio_t *m = gpio_of(g);
+    if (low)
+    {
+        m->ext_low |= (uint16_t)(1u << pin);
+    }
+    else
+    {
+        m->ext_low &= (uint16_t) ~(1u << pin);
+    }
+    gpio_update(m);
+}
+
+void mock_gpio_pullup(GPIO_TypeDef *g, uint32_t pin, int on)
+{
+    gpio_t *m = gpio_of(g);
+    if (on)
+    {
+        m->ext_pullup |= (uint16_t)(1u << pin);
+    }
+    else
+    {
+        m->ext_pullup &= (uint16_t) ~(1u << pin);
+    }
+    gpio_update(m);
+}
+
+int mock_gpio_level(GPIO_TypeDef *g, uint32_t pin)
+{
+    return (gpio_of(g)->level >> pin) & 1;
+}
+
+uint32_t mock_gpio_contention(GPIO_TypeDef *g)
+{
+    return gpio_of(g)->contention;
+}
+
+/*===========================================================================*/
+/*                              虚拟I2C从机                                   */
+/*===========================================================================*/
+
+enum
+{
+    I2C_IDLE = 0,
+    I2C_RX,     /* 接收地址或数据位 */
+    I2C_ACK,    /* 从机在第9个时钟拉低SDA */
+    I2C_TX,     /* 从机发送数据位 */
+    I2C_TX_ACK, /* 等待主机应答 */
+    I2C_WAIT    /* 地址不匹配或主机NACK, 等待STOP/重复START */
+};
+
+static void i2c_sda(mock_i2c_slave_t *s, int low)
+{
+    mock_gpio_pull_low(s->port, s->sda, low);
+}
+
+static void i2c_edge(GPIO_TypeDef *g, uint16_t old, uint16_t lvl, void *ctx)
+{
+    mock_i2c_slave_t *s = ctx;
+    int scl = (lvl >> s->scl) & 1, sda = (lvl >> s->sda) & 1;
+    int scl_old = (old >> s->scl) & 1, sda_old = (old >> s->sda) & 1;
+    uint64_t now = now_cycles;
+
+    (void)g;
+    if (scl_old && scl && sda != sda_old)
+    {
+        if (!sda) /* START / 重复START */
+        {
+            s->starts++;
+            s->state = I2C_RX;
+            s->bits = 0;
+            s->shift = 0;
+            s->first = 1;
+        }
+        else /* STOP */
+        {
+            s->stops++;
+            s->state = I2C_IDLE;
+        }
+        i2c_sda(s, 0);
+        return;
+    }
+    if (scl == scl_old)
+    {
+        return;
+    }
+
+    uint64_t phase = now - s->scl_edge;
+    s->scl_edge = now;
+    if (scl) /* 上升沿: 采样 */
+    {
+        if (s->state != I2C_IDLE && (s->scl_low_min == 0 || phase < s->scl_low_min))
+        {
+            s->scl_low_min = phase;
+        }
+        if (s->state == I2C_RX)
+        {
+            s->shift = (uint8_t)((s->shift << 1) | sda);
+            s->bits++;
+        }
+        else if (s->state == I2C_TX_ACK && sda)
+        {
+            s->master_naks++;
+            s->state = I2C_WAIT;
+        }
+        return;
+    }
+
+    /* 下降沿: 改变SDA */
+    if (s->state != I2C_IDLE && (s->scl_high_min == 0 || phase < s->scl_high_min))
+    {
+        s->scl_high_min = phase;
+    }
+    switch (s->state)
+    {
+    case I2C_RX:
+        if (s->bits < 8)
+        {
+            break;
+        }
+        if (s->first)
+        {
+            if ((s->shift >> 1) != s->addr)
+            {
+                s->addr_naks++;
+                s->state = I2C_WAIT;
+                break;
+            }
+            s->addr_acks++;
+            s->rw = s->shift & 1;
+            s->ptr_set = 0;
+        }
+        else if (!s->ptr_set)
+        {
+            s->ptr = s->shift;
+            s->ptr_set = 1;
+        }
+        else
+        {
+            s->regs[s->ptr++] = s->shift;
+            s->bytes_written++;
+        }
+        i2c_sda(s, 1);
+        s->state = I2C_ACK;
+        break;
+    case I2C_ACK:
+        i2c_sda(s, 0);
+        s->bits = 0;
+        s->shift = 0;
+        if (s->rw)
+        {
+            s->state = I2C_TX;
+            s->shift = s->regs[s->ptr];
+            i2c_sda(s, !(s->shift & 0x80));
+            s->bits = 1;
+        }
+        else
+        {
+            s->state = I2C_RX;
+            s->first = 0;
+        }
+        break;
+    case I2C_TX:
+        if (s->bits == 8)
+        {
+            i2c_sda(s, 0);
+            s->bytes_read++;
+            s->ptr++;
+            s->state = I2C_TX_ACK;
+        }
+        else
+        {
+            i2c_sda(s, !((s->shift << s->bits) & 0x80));
+            s->bits++;
+        }
+        break;
+    case I2C_TX_ACK:
+        s->state = I2C_TX;
+        s->shift = s->regs[s->ptr];
+        i2c_sda(s, !(s->shift & 0x80));
+        s->bits = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+void mock_i2c_attach(mock_i2c_slave_t *s, GPIO_TypeDef *port, uint8_t scl, uint8_t sda, uint8_t addr)
+{
+    s->port = port;
+    s->scl = scl;
+    s->sda = sda;
+    s->addr = addr;
+    s->state = I2C_IDLE;
+    mock_gpio_pullup(port, scl, 1);
+    mock_gpio_pullup(port, sda, 1);
+    mock_gpio_listen(port, i2c_edge, s);
+}
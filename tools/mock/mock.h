@@ -0,0 +1,170 @@
+/**
+ * @file    mock.h
+ * @brief   寄存器级外设模拟 (主机测试用)
+ * @details bsp/中的驱动不经修改在Linux上运行: stm32f4xx.h中的外设指针仍是芯片上的
+ *          真实地址, mock_init把外设区 (0x40000000) 和内核外设区 (0xE0000000) 映射
+ *          为不可访问的页, 驱动的每一次寄存器读写都会缺页, 由信号处理函数同步模型
+ *          状态、放开该页并单步执行这一条指令, 然后把写入交给外设模型处理.
+ *
+ * 时间:
+ *   虚拟时间以内核周期 (SystemCoreClock) 为单位, 每次寄存器访问推进MOCK_ACCESS_CYCLES,
+ *   测试用mock_advance/mock_run推进更长的时间. 定时器计数、串口移位、I2C时序都按
+ *   虚拟时间计算, 与主机速度无关, 结果可重复.
+ *
+ * 模型:
+ *   USART  发送移位寄存器和TDR (TXE/TC, 按BRR和帧格式计算字节时间), 接收RXNE/ORE/IDLE,
+ *          SR只有CTS/LBD/TC/RXNE可写0清除, 读SR后读DR清除错误标志
+ *   TIM    预分频和计数器, ARR/PSC/CCR预装载, UEV (UDIS/URS/UG/OPM), 主从模式
+ *          (MMS=000/010输出TRGO, SMS=100复位模式, 按ITR表连接), 多个定时器按时间先后处理
+ *   GPIO   由MODER/OTYPER/PUPDR/ODR和外部开漏器件计算IDR, BSRRL/BSRRH置位复位,
+ *          引脚电平变化通知监听者 (虚拟I2C从机)
+ *   NVIC   ISER/ICER/ISPR/ICPR置位清除语义, 测试调用mock_irq_dispatch执行中断
+ *   DWT    CYCCNT即虚拟时间
+ *   FLASH  存储区映射在FLASH_BASE (只读页, 读不计数), KEYR解锁, PG置位时写入按位与,
+ *          SER+STRT整扇区置0xFF, 操作立即完成; 内容在mock_reset后保留 (掉电测试)
+ *   CRC    DR写入按多项式0x04C11DB7累加, CR.RESET置初值
+ *   其余外设 (RCC/DMA/ADC等) 为普通内存, 访问同样计数
+ *
+ * 限制:
+ *   只支持x86-64 Linux, 单线程; 编译时加-no-pie, 使静态缓冲区地址在4GB以内
+ *   (驱动把缓冲区地址写入32位的DMA寄存器).
+ *   多线程测试改用mock_init_plain: 外设区只是普通内存, 没有模型和计数, 由测试自己
+ *   扮演外设; PRIMASK/IPSR按线程保存, 每个线程可以扮演一个中断或主循环.
+ */
+
+#ifndef __MOCK_H
+#define __MOCK_H
+
+#include <stdint.h>
+#include <stm32f4xx.h>
+
+#define MOCK_ACCESS_CYCLES 4 /* 每次寄存器访问的虚拟周期数 */
+#define MOCK_TX_LOG        4096
+#define MOCK_FLASH_SIZE    0x80000 /* STM32F407VE, 512KB */
+
+/*===========================================================================*/
+/*                              引擎                                          */
+/*===========================================================================*/
+
+void mock_init(void);
+void mock_init_plain(void); /* 外设区映射为普通内存, 不缺页, 可多线程访问 */
+void mock_reset(void);
+
+uint64_t mock_now(void);
+void mock_advance(uint64_t cycles);
+
+/* 推进时间, 期间每step周期执行一次已挂起的中断 */
+void mock_run(uint64_t cycles, uint32_t step);
+
+/* 绕过模拟直接读写寄存器所在的32位字, 不计数、不触发模型 */
+uint32_t mock_peek(const volatile void *reg);
+void mock_poke(volatile void *reg, uint32_t value);
+
+/* 寄存器访问计数, reg为寄存器地址 (按所在32位字统计) */
+uint32_t mock_reads(const volatile void *reg);
+uint32_t mock_writes(const volatile void *reg);
+uint64_t mock_accesses(void);
+void mock_count_clear(void);
+
+/*===========================================================================*/
+/*                              中断                                          */
+/*===========================================================================*/
+
+typedef void (*mock_isr_t)(void);
+
+void mock_irq_handler(IRQn_Type irqn, mock_isr_t isr);
+int mock_irq_enabled(IRQn_Type irqn);
+int mock_irq_pending(IRQn_Type irqn);
+uint32_t mock_irq_dispatch(void);
+
+/*===========================================================================*/
+/*                              USART                                         */
+/*===========================================================================*/
+
+typedef struct
+{
+    uint32_t tx_bytes;
+    uint32_t tx_lost;               /* TXE=0时写DR, TDR中的字节被覆盖 */
+    uint32_t rx_bytes;
+    uint32_t rx_overrun;            /* RXNE未清除时又收到字节 */
+    uint32_t rxne_cleared_by_write; /* 写SR清掉了RXNE */
+    uint32_t dr_reads;
+} mock_uart_stat_t;
+
+void mock_uart_rx(USART_TypeDef *u, const uint8_t *p, uint32_t n);
+void mock_uart_rx_gap(USART_TypeDef *u, uint64_t cycles);
+uint32_t mock_uart_tx(USART_TypeDef *u, uint8_t *dst, uint32_t max);
+uint64_t mock_uart_byte_cycles(USART_TypeDef *u);
+uint64_t mock_uart_tx_done(USART_TypeDef *u);
+const mock_uart_stat_t *mock_uart_stat(USART_TypeDef *u);
+int mock_uart_irq(USART_TypeDef *u);
+
+/*===========================================================================*/
+/*                              TIM                                           */
+/*===========================================================================*/
+
+typedef void (*mock_tim_cb_t)(TIM_TypeDef *t, void *ctx);
+
+void mock_tim_on_update(TIM_TypeDef *t, mock_tim_cb_t cb, void *ctx);
+uint32_t mock_tim_updates(TIM_TypeDef *t);
+uint64_t mock_tim_last_update(TIM_TypeDef *t);
+uint32_t mock_tim_arr(TIM_TypeDef *t);            /* 生效的ARR */
+uint32_t mock_tim_psc(TIM_TypeDef *t);            /* 生效的PSC */
+uint32_t mock_tim_ccr(TIM_TypeDef *t, uint32_t ch); /* 生效的CCRx */
+uint64_t mock_tim_period(TIM_TypeDef *t);         /* 计数周期 (内核周期) */
+
+/*===========================================================================*/
+/*                              FLASH                                         */
+/*===========================================================================*/
+
+/*
+ * 每次编程一个字或擦除一个扇区之前调用, erase=1时addr为扇区首地址、value为0xFFFFFFFF.
+ * 回调返回后操作照常完成; 回调可以用mock_poke改写存储区 (写了一半的字、擦了一半的扇区)
+ * 后直接_exit, 模拟在这一步掉电
+ */
+typedef void (*mock_flash_cb_t)(int erase, uintptr_t addr, uint32_t value, void *ctx);
+
+void mock_flash_on_op(mock_flash_cb_t cb, void *ctx);
+uint32_t mock_flash_programs(void);
+uint32_t mock_flash_erases(void);
+void mock_flash_wipe(void); /* 整片置0xFF */
+
+/*===========================================================================*/
+/*                              GPIO                                          */
+/*===========================================================================*/
+
+typedef void (*mock_gpio_cb_t)(GPIO_TypeDef *g, uint16_t old_level, uint16_t level, void *ctx);
+
+void mock_gpio_listen(GPIO_TypeDef *g, mock_gpio_cb_t cb, void *ctx);
+void mock_gpio_pull_low(GPIO_TypeDef *g, uint32_t pin, int low); /* 外部开漏器件 */
+void mock_gpio_pullup(GPIO_TypeDef *g, uint32_t pin, int on);    /* 外部上拉电阻 */
+int mock_gpio_level(GPIO_TypeDef *g, uint32_t pin);
+uint32_t mock_gpio_contention(GPIO_TypeDef *g);
+
+/*===========================================================================*/
+/*                              虚拟I2C从机                                   */
+/*===========================================================================*/
+
+typedef struct
+{
+    GPIO_TypeDef *port;
+    uint8_t scl, sda;
+    uint8_t addr; /* 7位地址 */
+    uint8_t regs[256];
+
+    /* 统计 */
+    uint32_t starts, stops;
+    uint32_t addr_acks, addr_naks;
+    uint32_t bytes_written, bytes_read;
+    uint32_t master_naks;
+    uint64_t scl_high_min, scl_low_min; /* 观察到的最短SCL高/低电平时间 (周期) */
+
+    /* 内部状态 */
+    int state;
+    uint8_t shift, bits, ptr, rw, first, ptr_set;
+    uint64_t scl_edge;
+} mock_i2c_slave_t;
+
+void mock_i2c_attach(mock_i2c_slave_t *s, GPIO_TypeDef *port, uint8_t scl, uint8_t sda, uint8_t addr);
+
+#endif /* __MOCK_H */
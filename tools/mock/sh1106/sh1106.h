@@ -0,0 +1,11 @@
+/**
+ * @file    sh1106.h
+ * @brief   框架头文件的主机占位, 本仓库不使用其中的声明
+ */
+
+#ifndef __SH1106_H
+#define __SH1106_H
+
+#include <lcd/df_lcd.h>
+
+#endif /* __SH1106_H */
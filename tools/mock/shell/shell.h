@@ -0,0 +1,70 @@
+/**
+ * @file    shell.h
+ * @brief   Shell框架的主机替身, 类型布局取自flyf407.axf的调试信息
+ * @note    EnvVar.callback在框架中声明为 void (*)(int, void *), 本仓库的命令回调都是
+ *          void (*)(int, void **); ARM上两者调用约定相同, 主机替身按仓库的用法声明
+ */
+
+#ifndef __SHELL_H
+#define __SHELL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <dev_frame.h>
+
+#define CLEAR_SCREEN "\033[2J"
+#define CURSOR_HOME  "\033[H"
+
+typedef struct
+{
+    bool Shell_Init;
+    uint8_t c;
+    uint8_t Res_len;
+    uint8_t UART_NOTE;
+    uint8_t RunStae;
+    uint8_t Data[20];
+    uint8_t (*Data_Receive)(void *arg, uint8_t *data);
+} shell;
+
+typedef struct
+{
+    void (*syspfunc)(int argc, void *argv);
+    void **Parameters;
+    int argc;
+} Sysfpoint;
+
+typedef struct
+{
+    char *name;
+    uint8_t RunStae;
+    void **arg;
+    int argc;
+    void (*callback)(int argc, void **argv);
+} EnvVar;
+
+typedef struct
+{
+    void (*ls)(int argc, void **argv);
+    void (*reset)(int argc, void **argv);
+    void (*poweroff)(int argc, void **argv);
+    void (*help)(int argc, void **argv);
+    void (*clear)(int argc, void **argv);
+    void (*test)(int argc, void **argv);
+} Cmd_PointerTypeDef;
+
+typedef struct
+{
+    char *Architecture;
+    char *User;
+    char *Password;
+    char *DeviceName;
+    char *OS;
+    char *Device;
+    char *Version;
+} DeviceFamily;
+
+void MCU_Shell_Init(shell *sh, DeviceFamily *dev);
+void BIE_UART(uint8_t c, Sysfpoint *sys, shell *sh, EnvVar *env, DeviceFamily *dev);
+void Task_Switch_Tick_Handler(Sysfpoint *sys);
+
+#endif /* __SHELL_H */
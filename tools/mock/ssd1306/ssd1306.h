@@ -0,0 +1,11 @@
+/**
+ * @file    ssd1306.h
+ * @brief   框架头文件的主机占位, 本仓库不使用其中的声明
+ */
+
+#ifndef __SSD1306_H
+#define __SSD1306_H
+
+#include <lcd/df_lcd.h>
+
+#endif /* __SSD1306_H */
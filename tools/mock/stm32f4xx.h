@@ -0,0 +1,852 @@
+/**
+ * @file    stm32f4xx.h
+ * @brief   主机测试用的STM32F407寄存器头文件 (tools/mock)
+ * @details 代替General_template_Project/BSP/stm32f4/CORE下的设备头文件, 让bsp/中的
+ *          驱动在Linux上原样编译. 外设结构体布局、基地址、中断号和位定义与标准外设库
+ *          V1.x一致 (USART/GPIO/RCC/FLASH/NVIC/SCB的布局已与mdk/Objects/flyf407.axf
+ *          的调试信息逐项核对), 只收录本仓库用到的外设和位.
+ *
+ * 外设指针就是芯片上的真实地址, mock.c把这些地址映射到进程中并截获每一次访问,
+ * 见mock.h. 内核寄存器 (NVIC/SCB/SysTick/DWT) 同样是真实地址.
+ */
+
+#ifndef __STM32F4xx_H
+#define __STM32F4xx_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STM32F40_41xxx
+
+#define __IO volatile
+#define __I  volatile const
+#define __O  volatile
+#define __IM  volatile const
+#define __OM  volatile
+#define __IOM volatile
+
+#define __STATIC_INLINE static inline
+#define __NO_RETURN     __attribute__((noreturn))
+#define __NVIC_PRIO_BITS 4
+
+/*===========================================================================*/
+/*                              通用类型                                      */
+/*===========================================================================*/
+
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+typedef enum {ERROR = 0, SUCCESS = !ERROR} ErrorStatus;
+
+typedef enum
+{
+    NonMaskableInt_IRQn = -14,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn = -11,
+    UsageFault_IRQn = -10,
+    SVCall_IRQn = -5,
+    DebugMonitor_IRQn = -4,
+    PendSV_IRQn = -2,
+    SysTick_IRQn = -1,
+    WWDG_IRQn = 0,
+    PVD_IRQn = 1,
+    TAMP_STAMP_IRQn = 2,
+    RTC_WKUP_IRQn = 3,
+    FLASH_IRQn = 4,
+    RCC_IRQn = 5,
+    EXTI0_IRQn = 6,
+    EXTI1_IRQn = 7,
+    EXTI2_IRQn = 8,
+    EXTI3_IRQn = 9,
+    EXTI4_IRQn = 10,
+    DMA1_Stream0_IRQn = 11,
+    DMA1_Stream1_IRQn = 12,
+    DMA1_Stream2_IRQn = 13,
+    DMA1_Stream3_IRQn = 14,
+    DMA1_Stream4_IRQn = 15,
+    DMA1_Stream5_IRQn = 16,
+    DMA1_Stream6_IRQn = 17,
+    ADC_IRQn = 18,
+    EXTI9_5_IRQn = 23,
+    TIM1_BRK_TIM9_IRQn = 24,
+    TIM1_UP_TIM10_IRQn = 25,
+    TIM1_TRG_COM_TIM11_IRQn = 26,
+    TIM1_CC_IRQn = 27,
+    TIM2_IRQn = 28,
+    TIM3_IRQn = 29,
+    TIM4_IRQn = 30,
+    I2C1_EV_IRQn = 31,
+    I2C1_ER_IRQn = 32,
+    USART1_IRQn = 37,
+    USART2_IRQn = 38,
+    USART3_IRQn = 39,
+    EXTI15_10_IRQn = 40,
+    DMA1_Stream7_IRQn = 47,
+    TIM5_IRQn = 50,
+    UART4_IRQn = 52,
+    UART5_IRQn = 53,
+    TIM6_DAC_IRQn = 54,
+    TIM7_IRQn = 55,
+    DMA2_Stream0_IRQn = 56,
+    DMA2_Stream1_IRQn = 57,
+    DMA2_Stream2_IRQn = 58,
+    DMA2_Stream3_IRQn = 59,
+    DMA2_Stream4_IRQn = 60,
+    DMA2_Stream5_IRQn = 68,
+    DMA2_Stream6_IRQn = 69,
+    DMA2_Stream7_IRQn = 70,
+    USART6_IRQn = 71,
+    FPU_IRQn = 81
+} IRQn_Type;
+
+/*===========================================================================*/
+/*                              外设寄存器                                    */
+/*===========================================================================*/
+
+typedef struct
+{
+    __IO uint32_t SR;
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t SMPR1;
+    __IO uint32_t SMPR2;
+    __IO uint32_t JOFR1;
+    __IO uint32_t JOFR2;
+    __IO uint32_t JOFR3;
+    __IO uint32_t JOFR4;
+    __IO uint32_t HTR;
+    __IO uint32_t LTR;
+    __IO uint32_t SQR1;
+    __IO uint32_t SQR2;
+    __IO uint32_t SQR3;
+    __IO uint32_t JSQR;
+    __IO uint32_t JDR1;
+    __IO uint32_t JDR2;
+    __IO uint32_t JDR3;
+    __IO uint32_t JDR4;
+    __IO uint32_t DR;
+} ADC_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CSR;
+    __IO uint32_t CCR;
+    __IO uint32_t CDR;
+} ADC_Common_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t DR;
+    __IO uint8_t IDR;
+    uint8_t RESERVED0;
+    uint16_t RESERVED1;
+    __IO uint32_t CR;
+} CRC_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR;
+    __IO uint32_t NDTR;
+    __IO uint32_t PAR;
+    __IO uint32_t M0AR;
+    __IO uint32_t M1AR;
+    __IO uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t LISR;
+    __IO uint32_t HISR;
+    __IO uint32_t LIFCR;
+    __IO uint32_t HIFCR;
+} DMA_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t IMR;
+    __IO uint32_t EMR;
+    __IO uint32_t RTSR;
+    __IO uint32_t FTSR;
+    __IO uint32_t SWIER;
+    __IO uint32_t PR;
+} EXTI_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t ACR;
+    __IO uint32_t KEYR;
+    __IO uint32_t OPTKEYR;
+    __IO uint32_t SR;
+    __IO uint32_t CR;
+    __IO uint32_t OPTCR;
+    __IO uint32_t OPTCR1;
+} FLASH_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t MODER;
+    __IO uint32_t OTYPER;
+    __IO uint32_t OSPEEDR;
+    __IO uint32_t PUPDR;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint16_t BSRRL;
+    __IO uint16_t BSRRH;
+    __IO uint32_t LCKR;
+    __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t MEMRMP;
+    __IO uint32_t PMC;
+    __IO uint32_t EXTICR[4];
+    uint32_t RESERVED[2];
+    __IO uint32_t CMPCR;
+} SYSCFG_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR;
+    __IO uint32_t PLLCFGR;
+    __IO uint32_t CFGR;
+    __IO uint32_t CIR;
+    __IO uint32_t AHB1RSTR;
+    __IO uint32_t AHB2RSTR;
+    __IO uint32_t AHB3RSTR;
+    uint32_t RESERVED0;
+    __IO uint32_t APB1RSTR;
+    __IO uint32_t APB2RSTR;
+    uint32_t RESERVED1[2];
+    __IO uint32_t AHB1ENR;
+    __IO uint32_t AHB2ENR;
+    __IO uint32_t AHB3ENR;
+    uint32_t RESERVED2;
+    __IO uint32_t APB1ENR;
+    __IO uint32_t APB2ENR;
+    uint32_t RESERVED3[2];
+    __IO uint32_t AHB1LPENR;
+    __IO uint32_t AHB2LPENR;
+    __IO uint32_t AHB3LPENR;
+    uint32_t RESERVED4;
+    __IO uint32_t APB1LPENR;
+    __IO uint32_t APB2LPENR;
+    uint32_t RESERVED5[2];
+    __IO uint32_t BDCR;
+    __IO uint32_t CSR;
+    uint32_t RESERVED6[2];
+    __IO uint32_t SSCGR;
+    __IO uint32_t PLLI2SCFGR;
+} RCC_TypeDef;
+
+/* 标准外设库中TIM的16位寄存器各占一个32位槽, 高半字保留 */
+typedef struct
+{
+    __IO uint16_t CR1;
+    uint16_t RESERVED0;
+    __IO uint16_t CR2;
+    uint16_t RESERVED1;
+    __IO uint16_t SMCR;
+    uint16_t RESERVED2;
+    __IO uint16_t DIER;
+    uint16_t RESERVED3;
+    __IO uint16_t SR;
+    uint16_t RESERVED4;
+    __IO uint16_t EGR;
+    uint16_t RESERVED5;
+    __IO uint16_t CCMR1;
+    uint16_t RESERVED6;
+    __IO uint16_t CCMR2;
+    uint16_t RESERVED7;
+    __IO uint16_t CCER;
+    uint16_t RESERVED8;
+    __IO uint32_t CNT;
+    __IO uint16_t PSC;
+    uint16_t RESERVED9;
+    __IO uint32_t ARR;
+    __IO uint16_t RCR;
+    uint16_t RESERVED10;
+    __IO uint32_t CCR1;
+    __IO uint32_t CCR2;
+    __IO uint32_t CCR3;
+    __IO uint32_t CCR4;
+    __IO uint16_t BDTR;
+    uint16_t RESERVED11;
+    __IO uint16_t DCR;
+    uint16_t RESERVED12;
+    __IO uint16_t DMAR;
+    uint16_t RESERVED13;
+    __IO uint16_t OR;
+    uint16_t RESERVED14;
+} TIM_TypeDef;
+
+typedef struct
+{
+    __IO uint16_t SR;
+    uint16_t RESERVED0;
+    __IO uint16_t DR;
+    uint16_t RESERVED1;
+    __IO uint16_t BRR;
+    uint16_t RESERVED2;
+    __IO uint16_t CR1;
+    uint16_t RESERVED3;
+    __IO uint16_t CR2;
+    uint16_t RESERVED4;
+    __IO uint16_t CR3;
+    uint16_t RESERVED5;
+    __IO uint16_t GTPR;
+    uint16_t RESERVED6;
+} USART_TypeDef;
+
+/*===========================================================================*/
+/*                              内核寄存器                                    */
+/*===========================================================================*/
+
+typedef struct
+{
+    __IOM uint32_t ISER[8U];
+    uint32_t RESERVED0[24U];
+    __IOM uint32_t ICER[8U];
+    uint32_t RESERVED1[24U];
+    __IOM uint32_t ISPR[8U];
+    uint32_t RESERVED2[24U];
+    __IOM uint32_t ICPR[8U];
+    uint32_t RESERVED3[24U];
+    __IOM uint32_t IABR[8U];
+    uint32_t RESERVED4[56U];
+    __IOM uint8_t IPR[240U];
+    uint32_t RESERVED5[644U];
+    __OM uint32_t STIR;
+} NVIC_Type;
+
+typedef struct
+{
+    __IM uint32_t CPUID;
+    __IOM uint32_t ICSR;
+    __IOM uint32_t VTOR;
+    __IOM uint32_t AIRCR;
+    __IOM uint32_t SCR;
+    __IOM uint32_t CCR;
+    __IOM uint8_t SHPR[12U];
+    __IOM uint32_t SHCSR;
+    __IOM uint32_t CFSR;
+    __IOM uint32_t HFSR;
+    __IOM uint32_t DFSR;
+    __IOM uint32_t MMFAR;
+    __IOM uint32_t BFAR;
+    __IOM uint32_t AFSR;
+    __IM uint32_t ID_PFR[2U];
+    __IM uint32_t ID_DFR;
+    __IM uint32_t ID_AFR;
+    __IM uint32_t ID_MMFR[4U];
+    __IM uint32_t ID_ISAR[5U];
+    uint32_t RESERVED0[5U];
+    __IOM uint32_t CPACR;
+} SCB_Type;
+
+typedef struct
+{
+    __IOM uint32_t CTRL;
+    __IOM uint32_t LOAD;
+    __IOM uint32_t VAL;
+    __IM uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+    __IOM uint32_t CTRL;
+    __IOM uint32_t CYCCNT;
+    __IOM uint32_t CPICNT;
+    __IOM uint32_t EXCCNT;
+    __IOM uint32_t SLEEPCNT;
+    __IOM uint32_t LSUCNT;
+    __IOM uint32_t FOLDCNT;
+    __IM uint32_t PCSR;
+} DWT_Type;
+
+typedef struct
+{
+    __IOM uint32_t DHCSR;
+    __OM uint32_t DCRSR;
+    __IOM uint32_t DCRDR;
+    __IOM uint32_t DEMCR;
+} CoreDebug_Type;
+
+/*===========================================================================*/
+/*                              地址                                          */
+/*===========================================================================*/
+
+/* 设备头文件中为uint32_t, 主机上改为uintptr_t, 转换为外设指针时不产生64位警告 */
+#define FLASH_BASE      ((uintptr_t)0x08000000)
+#define CCMDATARAM_BASE ((uintptr_t)0x10000000)
+#define SRAM1_BASE      ((uintptr_t)0x20000000)
+#define PERIPH_BASE     ((uintptr_t)0x40000000)
+
+#define APB1PERIPH_BASE PERIPH_BASE
+#define APB2PERIPH_BASE (PERIPH_BASE + 0x00010000)
+#define AHB1PERIPH_BASE (PERIPH_BASE + 0x00020000)
+
+#define TIM2_BASE   (APB1PERIPH_BASE + 0x0000)
+#define TIM3_BASE   (APB1PERIPH_BASE + 0x0400)
+#define TIM4_BASE   (APB1PERIPH_BASE + 0x0800)
+#define TIM5_BASE   (APB1PERIPH_BASE + 0x0C00)
+#define TIM6_BASE   (APB1PERIPH_BASE + 0x1000)
+#define TIM7_BASE   (APB1PERIPH_BASE + 0x1400)
+#define TIM12_BASE  (APB1PERIPH_BASE + 0x1800)
+#define TIM13_BASE  (APB1PERIPH_BASE + 0x1C00)
+#define TIM14_BASE  (APB1PERIPH_BASE + 0x2000)
+#define USART2_BASE (APB1PERIPH_BASE + 0x4400)
+#define USART3_BASE (APB1PERIPH_BASE + 0x4800)
+#define UART4_BASE  (APB1PERIPH_BASE + 0x4C00)
+#define UART5_BASE  (APB1PERIPH_BASE + 0x5000)
+
+#define TIM1_BASE       (APB2PERIPH_BASE + 0x0000)
+#define TIM8_BASE       (APB2PERIPH_BASE + 0x0400)
+#define USART1_BASE     (APB2PERIPH_BASE + 0x1000)
+#define USART6_BASE     (APB2PERIPH_BASE + 0x1400)
+#define ADC1_BASE       (APB2PERIPH_BASE + 0x2000)
+#define ADC_BASE        (APB2PERIPH_BASE + 0x2300)
+#define SYSCFG_BASE     (APB2PERIPH_BASE + 0x3800)
+#define EXTI_BASE       (APB2PERIPH_BASE + 0x3C00)
+#define TIM9_BASE       (APB2PERIPH_BASE + 0x4000)
+#define TIM10_BASE      (APB2PERIPH_BASE + 0x4400)
+#define TIM11_BASE      (APB2PERIPH_BASE + 0x4800)
+
+#define GPIOA_BASE      (AHB1PERIPH_BASE + 0x0000)
+#define GPIOB_BASE      (AHB1PERIPH_BASE + 0x0400)
+#define GPIOC_BASE      (AHB1PERIPH_BASE + 0x0800)
+#define GPIOD_BASE      (AHB1PERIPH_BASE + 0x0C00)
+#define GPIOE_BASE      (AHB1PERIPH_BASE + 0x1000)
+#define CRC_BASE        (AHB1PERIPH_BASE + 0x3000)
+#define RCC_BASE        (AHB1PERIPH_BASE + 0x3800)
+#define FLASH_R_BASE    (AHB1PERIPH_BASE + 0x3C00)
+#define DMA1_BASE       (AHB1PERIPH_BASE + 0x6000)
+#define DMA1_Stream0_BASE (DMA1_BASE + 0x010)
+#define DMA1_Stream1_BASE (DMA1_BASE + 0x028)
+#define DMA1_Stream2_BASE (DMA1_BASE + 0x040)
+#define DMA1_Stream3_BASE (DMA1_BASE + 0x058)
+#define DMA1_Stream4_BASE (DMA1_BASE + 0x070)
+#define DMA1_Stream5_BASE (DMA1_BASE + 0x088)
+#define DMA1_Stream6_BASE (DMA1_BASE + 0x0A0)
+#define DMA1_Stream7_BASE (DMA1_BASE + 0x0B8)
+#define DMA2_BASE       (AHB1PERIPH_BASE + 0x6400)
+#define DMA2_Stream0_BASE (DMA2_BASE + 0x010)
+#define DMA2_Stream1_BASE (DMA2_BASE + 0x028)
+#define DMA2_Stream2_BASE (DMA2_BASE + 0x040)
+#define DMA2_Stream3_BASE (DMA2_BASE + 0x058)
+#define DMA2_Stream4_BASE (DMA2_BASE + 0x070)
+#define DMA2_Stream5_BASE (DMA2_BASE + 0x088)
+#define DMA2_Stream6_BASE (DMA2_BASE + 0x0A0)
+#define DMA2_Stream7_BASE (DMA2_BASE + 0x0B8)
+
+#define SCS_BASE       (0xE000E000UL)
+#define DWT_BASE       (0xE0001000UL)
+#define SysTick_BASE   (SCS_BASE + 0x0010UL)
+#define NVIC_BASE      (SCS_BASE + 0x0100UL)
+#define SCB_BASE       (SCS_BASE + 0x0D00UL)
+#define CoreDebug_BASE (0xE000EDF0UL)
+
+#define TIM1   ((TIM_TypeDef *)TIM1_BASE)
+#define TIM2   ((TIM_TypeDef *)TIM2_BASE)
+#define TIM3   ((TIM_TypeDef *)TIM3_BASE)
+#define TIM4   ((TIM_TypeDef *)TIM4_BASE)
+#define TIM5   ((TIM_TypeDef *)TIM5_BASE)
+#define TIM6   ((TIM_TypeDef *)TIM6_BASE)
+#define TIM7   ((TIM_TypeDef *)TIM7_BASE)
+#define TIM8   ((TIM_TypeDef *)TIM8_BASE)
+#define TIM9   ((TIM_TypeDef *)TIM9_BASE)
+#define TIM10  ((TIM_TypeDef *)TIM10_BASE)
+#define TIM11  ((TIM_TypeDef *)TIM11_BASE)
+#define TIM12  ((TIM_TypeDef *)TIM12_BASE)
+#define TIM13  ((TIM_TypeDef *)TIM13_BASE)
+#define TIM14  ((TIM_TypeDef *)TIM14_BASE)
+#define USART1 ((USART_TypeDef *)USART1_BASE)
+#define USART2 ((USART_TypeDef *)USART2_BASE)
+#define USART3 ((USART_TypeDef *)USART3_BASE)
+#define UART4  ((USART_TypeDef *)UART4_BASE)
+#define UART5  ((USART_TypeDef *)UART5_BASE)
+#define USART6 ((USART_TypeDef *)USART6_BASE)
+#define ADC1   ((ADC_TypeDef *)ADC1_BASE)
+#define ADC    ((ADC_Common_TypeDef *)ADC_BASE)
+#define SYSCFG ((SYSCFG_TypeDef *)SYSCFG_BASE)
+#define EXTI   ((EXTI_TypeDef *)EXTI_BASE)
+#define GPIOA  ((GPIO_TypeDef *)GPIOA_BASE)
+#define GPIOB  ((GPIO_TypeDef *)GPIOB_BASE)
+#define GPIOC  ((GPIO_TypeDef *)GPIOC_BASE)
+#define GPIOD  ((GPIO_TypeDef *)GPIOD_BASE)
+#define GPIOE  ((GPIO_TypeDef *)GPIOE_BASE)
+#define CRC    ((CRC_TypeDef *)CRC_BASE)
+#define RCC    ((RCC_TypeDef *)RCC_BASE)
+#define FLASH  ((FLASH_TypeDef *)FLASH_R_BASE)
+#define DMA1   ((DMA_TypeDef *)DMA1_BASE)
+#define DMA2   ((DMA_TypeDef *)DMA2_BASE)
+#define DMA1_Stream0 ((DMA_Stream_TypeDef *)DMA1_Stream0_BASE)
+#define DMA1_Stream1 ((DMA_Stream_TypeDef *)DMA1_Stream1_BASE)
+#define DMA1_Stream2 ((DMA_Stream_TypeDef *)DMA1_Stream2_BASE)
+#define DMA1_Stream3 ((DMA_Stream_TypeDef *)DMA1_Stream3_BASE)
+#define DMA1_Stream4 ((DMA_Stream_TypeDef *)DMA1_Stream4_BASE)
+#define DMA1_Stream5 ((DMA_Stream_TypeDef *)DMA1_Stream5_BASE)
+#define DMA1_Stream6 ((DMA_Stream_TypeDef *)DMA1_Stream6_BASE)
+#define DMA1_Stream7 ((DMA_Stream_TypeDef *)DMA1_Stream7_BASE)
+#define DMA2_Stream0 ((DMA_Stream_TypeDef *)DMA2_Stream0_BASE)
+#define DMA2_Stream1 ((DMA_Stream_TypeDef *)DMA2_Stream1_BASE)
+#define DMA2_Stream2 ((DMA_Stream_TypeDef *)DMA2_Stream2_BASE)
+#define DMA2_Stream3 ((DMA_Stream_TypeDef *)DMA2_Stream3_BASE)
+#define DMA2_Stream4 ((DMA_Stream_TypeDef *)DMA2_Stream4_BASE)
+#define DMA2_Stream5 ((DMA_Stream_TypeDef *)DMA2_Stream5_BASE)
+#define DMA2_Stream6 ((DMA_Stream_TypeDef *)DMA2_Stream6_BASE)
+#define DMA2_Stream7 ((DMA_Stream_TypeDef *)DMA2_Stream7_BASE)
+
+#define SCB       ((SCB_Type *)SCB_BASE)
+#define SysTick   ((SysTick_Type *)SysTick_BASE)
+#define NVIC      ((NVIC_Type *)NVIC_BASE)
+#define DWT       ((DWT_Type *)DWT_BASE)
+#define CoreDebug ((CoreDebug_Type *)CoreDebug_BASE)
+
+/*===========================================================================*/
+/*                              位定义                                        */
+/*===========================================================================*/
+
+/* ADC */
+#define ADC_SR_EOC       ((uint32_t)0x00000002)
+#define ADC_SR_STRT      ((uint32_t)0x00000010)
+#define ADC_SR_OVR       ((uint32_t)0x00000020)
+#define ADC_CR1_EOCIE    ((uint32_t)0x00000020)
+#define ADC_CR1_SCAN     ((uint32_t)0x00000100)
+#define ADC_CR1_RES      ((uint32_t)0x03000000)
+#define ADC_CR1_OVRIE    ((uint32_t)0x04000000)
+#define ADC_CR2_ADON     ((uint32_t)0x00000001)
+#define ADC_CR2_CONT     ((uint32_t)0x00000002)
+#define ADC_CR2_DMA      ((uint32_t)0x00000100)
+#define ADC_CR2_DDS      ((uint32_t)0x00000200)
+#define ADC_CR2_EOCS     ((uint32_t)0x00000400)
+#define ADC_CR2_ALIGN    ((uint32_t)0x00000800)
+#define ADC_CR2_EXTSEL   ((uint32_t)0x0F000000)
+#define ADC_CR2_EXTSEL_0 ((uint32_t)0x01000000)
+#define ADC_CR2_EXTEN    ((uint32_t)0x30000000)
+#define ADC_CR2_EXTEN_0  ((uint32_t)0x10000000)
+#define ADC_CR2_EXTEN_1  ((uint32_t)0x20000000)
+#define ADC_CR2_SWSTART  ((uint32_t)0x40000000)
+#define ADC_SQR1_L       ((uint32_t)0x00F00000)
+#define ADC_CCR_ADCPRE   ((uint32_t)0x00030000)
+#define ADC_CCR_ADCPRE_0 ((uint32_t)0x00010000)
+#define ADC_CCR_ADCPRE_1 ((uint32_t)0x00020000)
+
+/* CRC */
+#define CRC_CR_RESET ((uint8_t)0x01)
+
+/* DMA */
+#define DMA_SxCR_EN      ((uint32_t)0x00000001)
+#define DMA_SxCR_DMEIE   ((uint32_t)0x00000002)
+#define DMA_SxCR_TEIE    ((uint32_t)0x00000004)
+#define DMA_SxCR_HTIE    ((uint32_t)0x00000008)
+#define DMA_SxCR_TCIE    ((uint32_t)0x00000010)
+#define DMA_SxCR_PFCTRL  ((uint32_t)0x00000020)
+#define DMA_SxCR_DIR     ((uint32_t)0x000000C0)
+#define DMA_SxCR_DIR_0   ((uint32_t)0x00000040)
+#define DMA_SxCR_DIR_1   ((uint32_t)0x00000080)
+#define DMA_SxCR_CIRC    ((uint32_t)0x00000100)
+#define DMA_SxCR_PINC    ((uint32_t)0x00000200)
+#define DMA_SxCR_MINC    ((uint32_t)0x00000400)
+#define DMA_SxCR_PSIZE   ((uint32_t)0x00001800)
+#define DMA_SxCR_PSIZE_0 ((uint32_t)0x00000800)
+#define DMA_SxCR_PSIZE_1 ((uint32_t)0x00001000)
+#define DMA_SxCR_MSIZE   ((uint32_t)0x00006000)
+#define DMA_SxCR_MSIZE_0 ((uint32_t)0x00002000)
+#define DMA_SxCR_MSIZE_1 ((uint32_t)0x00004000)
+#define DMA_SxCR_PL      ((uint32_t)0x00030000)
+#define DMA_SxCR_PL_0    ((uint32_t)0x00010000)
+#define DMA_SxCR_PL_1    ((uint32_t)0x00020000)
+#define DMA_SxCR_CHSEL   ((uint32_t)0x0E000000)
+#define DMA_SxCR_CHSEL_0 ((uint32_t)0x02000000)
+#define DMA_SxCR_CHSEL_1 ((uint32_t)0x04000000)
+#define DMA_SxCR_CHSEL_2 ((uint32_t)0x08000000)
+
+#define DMA_LISR_FEIF0   ((uint32_t)0x00000001)
+#define DMA_LISR_DMEIF0  ((uint32_t)0x00000004)
+#define DMA_LISR_TEIF0   ((uint32_t)0x00000008)
+#define DMA_LISR_HTIF0   ((uint32_t)0x00000010)
+#define DMA_LISR_TCIF0   ((uint32_t)0x00000020)
+#define DMA_LIFCR_CFEIF0  ((uint32_t)0x00000001)
+#define DMA_LIFCR_CDMEIF0 ((uint32_t)0x00000004)
+#define DMA_LIFCR_CTEIF0  ((uint32_t)0x00000008)
+#define DMA_LIFCR_CHTIF0  ((uint32_t)0x00000010)
+#define DMA_LIFCR_CTCIF0  ((uint32_t)0x00000020)
+#define DMA_HISR_TEIF5   ((uint32_t)0x00000200)
+#define DMA_HISR_HTIF5   ((uint32_t)0x00000400)
+#define DMA_HISR_TCIF5   ((uint32_t)0x00000800)
+#define DMA_HISR_TEIF7   ((uint32_t)0x02000000)
+#define DMA_HISR_TCIF7   ((uint32_t)0x08000000)
+#define DMA_HIFCR_CFEIF5  ((uint32_t)0x00000040)
+#define DMA_HIFCR_CDMEIF5 ((uint32_t)0x00000100)
+#define DMA_HIFCR_CTEIF5  ((uint32_t)0x00000200)
+#define DMA_HIFCR_CHTIF5  ((uint32_t)0x00000400)
+#define DMA_HIFCR_CTCIF5  ((uint32_t)0x00000800)
+#define DMA_HIFCR_CFEIF7  ((uint32_t)0x00400000)
+#define DMA_HIFCR_CDMEIF7 ((uint32_t)0x01000000)
+#define DMA_HIFCR_CTEIF7  ((uint32_t)0x02000000)
+#define DMA_HIFCR_CHTIF7  ((uint32_t)0x04000000)
+#define DMA_HIFCR_CTCIF7  ((uint32_t)0x08000000)
+
+/* FLASH */
+#define FLASH_ACR_LATENCY ((uint32_t)0x00000007)
+#define FLASH_ACR_PRFTEN  ((uint32_t)0x00000100)
+#define FLASH_ACR_ICEN    ((uint32_t)0x00000200)
+#define FLASH_ACR_DCEN    ((uint32_t)0x00000400)
+#define FLASH_ACR_ICRST   ((uint32_t)0x00000800)
+#define FLASH_ACR_DCRST   ((uint32_t)0x00001000)
+#define FLASH_SR_EOP      ((uint32_t)0x00000001)
+#define FLASH_SR_SOP      ((uint32_t)0x00000002)
+#define FLASH_SR_WRPERR   ((uint32_t)0x00000010)
+#define FLASH_SR_PGAERR   ((uint32_t)0x00000020)
+#define FLASH_SR_PGPERR   ((uint32_t)0x00000040)
+#define FLASH_SR_PGSERR   ((uint32_t)0x00000080)
+#define FLASH_SR_BSY      ((uint32_t)0x00010000)
+#define FLASH_CR_PG       ((uint32_t)0x00000001)
+#define FLASH_CR_SER      ((uint32_t)0x00000002)
+#define FLASH_CR_MER      ((uint32_t)0x00000004)
+#define FLASH_CR_SNB      ((uint32_t)0x000000F8)
+#define FLASH_CR_PSIZE    ((uint32_t)0x00000300)
+#define FLASH_CR_PSIZE_1  ((uint32_t)0x00000200)
+#define FLASH_CR_STRT     ((uint32_t)0x00010000)
+#define FLASH_CR_EOPIE    ((uint32_t)0x01000000)
+#define FLASH_CR_ERRIE    ((uint32_t)0x02000000)
+#define FLASH_CR_LOCK     ((uint32_t)0x80000000)
+
+/* RCC */
+#define RCC_CFGR_SW        ((uint32_t)0x00000003)
+#define RCC_CFGR_SWS       ((uint32_t)0x0000000C)
+#define RCC_CFGR_HPRE      ((uint32_t)0x000000F0)
+#define RCC_CFGR_PPRE1     ((uint32_t)0x00001C00)
+#define RCC_CFGR_PPRE1_DIV4 ((uint32_t)0x00001400)
+#define RCC_CFGR_PPRE2     ((uint32_t)0x0000E000)
+#define RCC_CFGR_PPRE2_DIV2 ((uint32_t)0x00008000)
+
+#define RCC_AHB1ENR_GPIOAEN ((uint32_t)0x00000001)
+#define RCC_AHB1ENR_GPIOBEN ((uint32_t)0x00000002)
+#define RCC_AHB1ENR_GPIOCEN ((uint32_t)0x00000004)
+#define RCC_AHB1ENR_GPIODEN ((uint32_t)0x00000008)
+#define RCC_AHB1ENR_GPIOEEN ((uint32_t)0x00000010)
+#define RCC_AHB1ENR_CRCEN   ((uint32_t)0x00001000)
+#define RCC_AHB1ENR_DMA1EN  ((uint32_t)0x00200000)
+#define RCC_AHB1ENR_DMA2EN  ((uint32_t)0x00400000)
+
+#define RCC_APB1ENR_TIM2EN   ((uint32_t)0x00000001)
+#define RCC_APB1ENR_TIM3EN   ((uint32_t)0x00000002)
+#define RCC_APB1ENR_TIM4EN   ((uint32_t)0x00000004)
+#define RCC_APB1ENR_TIM5EN   ((uint32_t)0x00000008)
+#define RCC_APB1ENR_TIM6EN   ((uint32_t)0x00000010)
+#define RCC_APB1ENR_TIM7EN   ((uint32_t)0x00000020)
+#define RCC_APB1ENR_USART2EN ((uint32_t)0x00020000)
+#define RCC_APB1ENR_USART3EN ((uint32_t)0x00040000)
+#define RCC_APB1ENR_UART4EN  ((uint32_t)0x00080000)
+#define RCC_APB1ENR_UART5EN  ((uint32_t)0x00100000)
+
+#define RCC_APB2ENR_TIM1EN   ((uint32_t)0x00000001)
+#define RCC_APB2ENR_TIM8EN   ((uint32_t)0x00000002)
+#define RCC_APB2ENR_USART1EN ((uint32_t)0x00000010)
+#define RCC_APB2ENR_USART6EN ((uint32_t)0x00000020)
+#define RCC_APB2ENR_ADC1EN   ((uint32_t)0x00000100)
+#define RCC_APB2ENR_TIM9EN   ((uint32_t)0x00010000)
+#define RCC_APB2ENR_TIM10EN  ((uint32_t)0x00020000)
+#define RCC_APB2ENR_TIM11EN  ((uint32_t)0x00040000)
+
+/* TIM */
+#define TIM_CR1_CEN  ((uint16_t)0x0001)
+#define TIM_CR1_UDIS ((uint16_t)0x0002)
+#define TIM_CR1_URS  ((uint16_t)0x0004)
+#define TIM_CR1_OPM  ((uint16_t)0x0008)
+#define TIM_CR1_DIR  ((uint16_t)0x0010)
+#define TIM_CR1_CMS  ((uint16_t)0x0060)
+#define TIM_CR1_ARPE ((uint16_t)0x0080)
+#define TIM_CR2_MMS  ((uint16_t)0x0070)
+#define TIM_SMCR_SMS ((uint16_t)0x0007)
+#define TIM_SMCR_TS  ((uint16_t)0x0070)
+#define TIM_DIER_UIE   ((uint16_t)0x0001)
+#define TIM_DIER_CC1IE ((uint16_t)0x0002)
+#define TIM_DIER_UDE   ((uint16_t)0x0100)
+#define TIM_DIER_CC1DE ((uint16_t)0x0200)
+#define TIM_SR_UIF   ((uint16_t)0x0001)
+#define TIM_SR_CC1IF ((uint16_t)0x0002)
+#define TIM_SR_CC2IF ((uint16_t)0x0004)
+#define TIM_SR_CC3IF ((uint16_t)0x0008)
+#define TIM_SR_CC4IF ((uint16_t)0x0010)
+#define TIM_SR_TIF   ((uint16_t)0x0040)
+#define TIM_EGR_UG   ((uint16_t)0x0001)
+#define TIM_EGR_CC1G ((uint16_t)0x0002)
+#define TIM_CCMR1_CC1S  ((uint16_t)0x0003)
+#define TIM_CCMR1_OC1PE ((uint16_t)0x0008)
+#define TIM_CCMR1_OC1M  ((uint16_t)0x0070)
+#define TIM_CCMR1_IC1F  ((uint16_t)0x00F0)
+#define TIM_CCMR1_CC2S  ((uint16_t)0x0300)
+#define TIM_CCMR1_OC2PE ((uint16_t)0x0800)
+#define TIM_CCMR1_OC2M  ((uint16_t)0x7000)
+#define TIM_CCMR2_CC3S  ((uint16_t)0x0003)
+#define TIM_CCMR2_OC3PE ((uint16_t)0x0008)
+#define TIM_CCMR2_OC3M  ((uint16_t)0x0070)
+#define TIM_CCMR2_OC4PE ((uint16_t)0x0800)
+#define TIM_CCMR2_OC4M  ((uint16_t)0x7000)
+#define TIM_CCER_CC1E  ((uint16_t)0x0001)
+#define TIM_CCER_CC1P  ((uint16_t)0x0002)
+#define TIM_CCER_CC1NP ((uint16_t)0x0008)
+#define TIM_CCER_CC2E  ((uint16_t)0x0010)
+#define TIM_CCER_CC2P  ((uint16_t)0x0020)
+#define TIM_CCER_CC3E  ((uint16_t)0x0100)
+#define TIM_CCER_CC3P  ((uint16_t)0x0200)
+#define TIM_CCER_CC4E  ((uint16_t)0x1000)
+#define TIM_CCER_CC4P  ((uint16_t)0x2000)
+#define TIM_BDTR_MOE   ((uint16_t)0x8000)
+
+/* USART */
+#define USART_SR_PE   ((uint16_t)0x0001)
+#define USART_SR_FE   ((uint16_t)0x0002)
+#define USART_SR_NE   ((uint16_t)0x0004)
+#define USART_SR_ORE  ((uint16_t)0x0008)
+#define USART_SR_IDLE ((uint16_t)0x0010)
+#define USART_SR_RXNE ((uint16_t)0x0020)
+#define USART_SR_TC   ((uint16_t)0x0040)
+#define USART_SR_TXE  ((uint16_t)0x0080)
+#define USART_SR_LBD  ((uint16_t)0x0100)
+#define USART_SR_CTS  ((uint16_t)0x0200)
+#define USART_CR1_SBK    ((uint16_t)0x0001)
+#define USART_CR1_RWU    ((uint16_t)0x0002)
+#define USART_CR1_RE     ((uint16_t)0x0004)
+#define USART_CR1_TE     ((uint16_t)0x0008)
+#define USART_CR1_IDLEIE ((uint16_t)0x0010)
+#define USART_CR1_RXNEIE ((uint16_t)0x0020)
+#define USART_CR1_TCIE   ((uint16_t)0x0040)
+#define USART_CR1_TXEIE  ((uint16_t)0x0080)
+#define USART_CR1_PEIE   ((uint16_t)0x0100)
+#define USART_CR1_PS     ((uint16_t)0x0200)
+#define USART_CR1_PCE    ((uint16_t)0x0400)
+#define USART_CR1_M      ((uint16_t)0x1000)
+#define USART_CR1_UE     ((uint16_t)0x2000)
+#define USART_CR1_OVER8  ((uint16_t)0x8000)
+#define USART_CR2_STOP   ((uint16_t)0x3000)
+#define USART_CR2_STOP_0 ((uint16_t)0x1000)
+#define USART_CR2_STOP_1 ((uint16_t)0x2000)
+#define USART_CR3_EIE    ((uint16_t)0x0001)
+#define USART_CR3_DMAR   ((uint16_t)0x0040)
+#define USART_CR3_DMAT   ((uint16_t)0x0080)
+
+/* 内核 */
+#define SCB_AIRCR_VECTKEY_Pos     16U
+#define SCB_AIRCR_PRIGROUP_Pos    8U
+#define SCB_AIRCR_PRIGROUP_Msk    (7UL << SCB_AIRCR_PRIGROUP_Pos)
+#define SCB_AIRCR_SYSRESETREQ_Msk (1UL << 2U)
+#define SysTick_CTRL_ENABLE_Msk    (1UL << 0U)
+#define SysTick_CTRL_TICKINT_Msk   (1UL << 1U)
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << 2U)
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL << 16U)
+#define SysTick_LOAD_RELOAD_Msk    (0xFFFFFFUL)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0U)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24U)
+
+/*===========================================================================*/
+/*                              内核函数                                      */
+/*===========================================================================*/
+
+extern uint32_t SystemCoreClock;
+void SystemInit(void);
+void SystemCoreClockUpdate(void);
+
+/* PRIMASK和IPSR由mock.c按线程保存; 中断由测试调用mock_irq_dispatch执行, 期间IPSR为异常号 */
+extern __thread volatile uint32_t mock_primask;
+extern __thread volatile uint32_t mock_ipsr;
+void mock_system_reset(void) __NO_RETURN;
+
+__STATIC_INLINE void __enable_irq(void)
+{
+    mock_primask = 0;
+}
+
+__STATIC_INLINE void __disable_irq(void)
+{
+    mock_primask = 1;
+}
+
+__STATIC_INLINE uint32_t __get_PRIMASK(void)
+{
+    return mock_primask;
+}
+
+__STATIC_INLINE void __set_PRIMASK(uint32_t pri)
+{
+    mock_primask = pri & 1;
+}
+
+__STATIC_INLINE uint32_t __get_IPSR(void)
+{
+    return mock_ipsr;
+}
+
+#define __NOP() __asm__ volatile("nop")
+#define __WFI() __asm__ volatile("" ::: "memory")
+#define __DSB() __sync_synchronize()
+#define __ISB() __sync_synchronize()
+#define __DMB() __sync_synchronize()
+
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        NVIC->ISER[((uint32_t)IRQn) >> 5UL] = (uint32_t)(1UL << (((uint32_t)IRQn) & 0x1FUL));
+    }
+}
+
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        NVIC->ICER[((uint32_t)IRQn) >> 5UL] = (uint32_t)(1UL << (((uint32_t)IRQn) & 0x1FUL));
+    }
+}
+
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        NVIC->ISPR[((uint32_t)IRQn) >> 5UL] = (uint32_t)(1UL << (((uint32_t)IRQn) & 0x1FUL));
+    }
+}
+
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        NVIC->ICPR[((uint32_t)IRQn) >> 5UL] = (uint32_t)(1UL << (((uint32_t)IRQn) & 0x1FUL));
+    }
+}
+
+__STATIC_INLINE void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        NVIC->IPR[((uint32_t)IRQn)] = (uint8_t)((priority << (8U - __NVIC_PRIO_BITS)) & (uint32_t)0xFFUL);
+    }
+    else
+    {
+        SCB->SHPR[(((uint32_t)IRQn) & 0xFUL) - 4UL] = (uint8_t)((priority << (8U - __NVIC_PRIO_BITS)) & (uint32_t)0xFFUL);
+    }
+}
+
+__STATIC_INLINE uint32_t NVIC_GetPriority(IRQn_Type IRQn)
+{
+    if ((int32_t)IRQn >= 0)
+    {
+        return ((uint32_t)NVIC->IPR[((uint32_t)IRQn)] >> (8U - __NVIC_PRIO_BITS));
+    }
+    return ((uint32_t)SCB->SHPR[(((uint32_t)IRQn) & 0xFUL) - 4UL] >> (8U - __NVIC_PRIO_BITS));
+}
+
+__STATIC_INLINE void NVIC_SetPriorityGrouping(uint32_t PriorityGroup)
+{
+    uint32_t reg = SCB->AIRCR & ~((uint32_t)(0xFFFFUL << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_PRIGROUP_Msk);
+    SCB->AIRCR = reg | (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | ((PriorityGroup & 7UL) << SCB_AIRCR_PRIGROUP_Pos);
+}
+
+__STATIC_INLINE void NVIC_SystemReset(void)
+{
+    mock_system_reset();
+}
+
+#endif /* __STM32F4xx_H */
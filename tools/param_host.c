@@ -0,0 +1,70 @@
+// 主机端参数存储: 代替bsp/param.c, 不访问Flash
+// 参数表同样由各模块的PARAM_xxx注册、链接器按ID排序 (mock/host.ld), 运行值只在内存中;
+// 主机程序只链接用到的模块, 表可以不完整, 按ID查找. param_save/param_poll什么也不写
+// 供bench_host、sitl和主机测试链接只依赖param.h的模块 (app/control.c等)
+
+#include <string.h>
+#include "param.h"
+
+param_value_t param_shadow[PARAM_NUM];
+
+static const param_info_t *table_begin(void){
+    return (const param_info_t *)PARAM_TABLE_BEGIN;
+}
+
+static const param_info_t *table_end(void){
+    return (const param_info_t *)PARAM_TABLE_END;
+}
+
+const param_info_t *param_info(uint16_t id){
+    for (const param_info_t *p = table_begin(); p < table_end(); p++)
+        if (p->id == id)
+            return p;
+    return NULL;
+}
+
+const param_info_t *param_find(const char *name){
+    for (const param_info_t *p = table_begin(); p < table_end(); p++)
+        if (!strcmp(p->name, name))
+            return p;
+    return NULL;
+}
+
+int param_set(uint16_t id, param_value_t value){
+    const param_info_t *p = param_info(id);
+
+    if (p == NULL)
+        return -1;
+    switch (p->type) {
+    case PARAM_TYPE_U32:
+        if (value.u < p->min.u || value.u > p->max.u)
+            return -1;
+        break;
+    case PARAM_TYPE_I32:
+        if (value.i < p->min.i || value.i > p->max.i)
+            return -1;
+        break;
+    default:
+        if (!(value.f >= p->min.f && value.f <= p->max.f))
+            return -1;
+        break;
+    }
+    param_shadow[id - PARAM_ID_BASE] = value;
+    return 0;
+}
+
+// 主机程序开始时调用, 未链接的模块的参数保持为0
+void param_reset_default(void){
+    memset(param_shadow, 0, sizeof(param_shadow));
+    for (const param_info_t *p = table_begin(); p < table_end(); p++)
+        if (p->id >= PARAM_ID_BASE && p->id < PARAM_ID_END)
+            param_shadow[p->id - PARAM_ID_BASE] = p->def;
+}
+
+int param_save(void){
+    return 0;
+}
+
+int param_poll(void){
+    return 0;
+}
@@ -0,0 +1,460 @@
+// 变量示波主机端: 从ELF符号表解析变量名, 让飞控按控制节拍同步采样, 样本输出为CSV
+// 协议见 app/scope.h; 启动时先按 app/link.h 协商链路速率, 协商失败就留在安全速率
+//
+// 编译: cc -O2 -I../app -o scope scope.c ../app/link.c
+// 用法: scope [-b 最高波特率, 默认3000000] [-d 抽取, 默认1] [-t 秒] <串口> <固件.elf/.axf> 变量...
+//   变量写法: 名字[+偏移][:类型], 名字[下标][:类型], 或 0x地址:类型
+//   类型: u8 i8 u16 i16 u32 i32 f32; 不写时按符号大小推断, 1字节u8, 2字节i16, 其他f32
+//   函数内的静态变量在ELF中名为"名字.N", 只写名字即可
+//   例: scope /dev/ttyUSB0 fly.axf pitch roll yaw control_pid+12 > scope.csv
+//   输出: t (s), 各变量; 每个样本一行, 丢失的样本只在结束时统计到stderr
+//   画图: gnuplot -e "set datafile separator ','; plot for [i=2:4] 'scope.csv' using 1:i with lines title columnhead"
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "link.h"
+#include "scope.h"
+
+static const char *type_names[SCOPE_TYPE_NUM] = {"u8", "i8", "u16", "i16", "u32", "i32", "f32"};
+static const unsigned type_sizes[SCOPE_TYPE_NUM] = {1, 1, 2, 2, 4, 4, 4};
+
+typedef struct {
+    const char *arg;
+    uint32_t addr;
+    uint8_t type;
+} chan_t;
+
+static chan_t chans[SCOPE_CH_MAX];
+static unsigned chan_num, width;
+
+static int fd;
+static uint32_t baud = LINK_SAFE_BAUD;
+static volatile sig_atomic_t stop;
+
+// 最近收到的各类控制帧
+static uint8_t got[256], got_payload[256][64];
+
+// 样本
+static uint8_t tag;
+static double period_s;
+static int have_seq;
+static uint64_t next_sample, samples, lost;
+static unsigned long frames, crc_errors;
+static uint32_t t_frame;
+
+/*---------------------------------- ELF ----------------------------------*/
+
+static uint8_t *img;
+static size_t img_size;
+static int is64;
+
+static int load_elf(const char *path){
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    img = malloc(size);
+    if (fread(img, 1, size, f) != (size_t)size || size < (long)sizeof(Elf32_Ehdr) || memcmp(img, ELFMAG, SELFMAG)) {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    img_size = size;
+    is64 = img[EI_CLASS] == ELFCLASS64;
+    return 0;
+}
+
+// 在.symtab中找变量, 精确匹配优先, 其次匹配函数内静态变量的"名字.N"
+static int find_symbol(const char *want, uint32_t *addr, uint32_t *size){
+    uint64_t shoff;
+    unsigned shnum, shentsize;
+    int partial = 0;
+
+    if (is64) {
+        const Elf64_Ehdr *eh = (const void *)img;
+        shoff = eh->e_shoff, shnum = eh->e_shnum, shentsize = eh->e_shentsize;
+    } else {
+        const Elf32_Ehdr *eh = (const void *)img;
+        shoff = eh->e_shoff, shnum = eh->e_shnum, shentsize = eh->e_shentsize;
+    }
+    if (shoff + (uint64_t)shnum * shentsize > img_size) return -1;
+
+#define SH_FIELD(i, f) (is64 ? ((const Elf64_Shdr *)(img + shoff + (i) * shentsize))->f \
+                             : ((const Elf32_Shdr *)(img + shoff + (i) * shentsize))->f)
+    for (unsigned s = 0; s < shnum; s++) {
+        if (SH_FIELD(s, sh_type) != SHT_SYMTAB) continue;
+        uint64_t off = SH_FIELD(s, sh_offset), len = SH_FIELD(s, sh_size), ent = SH_FIELD(s, sh_entsize);
+        unsigned link = SH_FIELD(s, sh_link);
+        if (ent == 0 || off + len > img_size || link >= shnum) continue;
+        const char *strtab = (const char *)img + SH_FIELD(link, sh_offset);
+        size_t wlen = strlen(want);
+
+        for (uint64_t i = 0; i < len / ent; i++) {
+            const uint8_t *sym = img + off + i * ent;
+            unsigned name = is64 ? ((const Elf64_Sym *)sym)->st_name : ((const Elf32_Sym *)sym)->st_name;
+            unsigned char info = is64 ? ((const Elf64_Sym *)sym)->st_info : ((const Elf32_Sym *)sym)->st_info;
+            const char *n = strtab + name;
+            int exact = !strcmp(n, want);
+
+            if (ELF32_ST_TYPE(info) != STT_OBJECT) continue;
+            if (!exact && !(strncmp(n, want, wlen) == 0 && n[wlen] == '.' && strspn(n + wlen + 1, "0123456789") > 0))
+                continue;
+            if (!exact && partial) continue; // 同名静态变量有多个时取第一个
+            *addr = (uint32_t)(is64 ? ((const Elf64_Sym *)sym)->st_value : ((const Elf32_Sym *)sym)->st_value);
+            *size = (uint32_t)(is64 ? ((const Elf64_Sym *)sym)->st_size : ((const Elf32_Sym *)sym)->st_size);
+            if (exact) return 0;
+            partial = 1;
+        }
+    }
+#undef SH_FIELD
+    return partial ? 0 : -1;
+}
+
+// 解析 名字[+偏移|[下标]][:类型] 或 0x地址:类型
+static int parse_chan(const char *arg, chan_t *c){
+    char name[128];
+    const char *colon = strchr(arg, ':');
+    size_t n = colon ? (size_t)(colon - arg) : strlen(arg);
+    int type = -1;
+    uint32_t size = 4, off = 0, index = 0;
+    int has_index = 0;
+
+    if (n == 0 || n >= sizeof(name)) return -1;
+    memcpy(name, arg, n);
+    name[n] = '\0';
+    if (colon) {
+        for (int i = 0; i < SCOPE_TYPE_NUM; i++)
+            if (!strcmp(colon + 1, type_names[i])) type = i;
+        if (type < 0) {
+            fprintf(stderr, "%s: unknown type\n", arg);
+            return -1;
+        }
+    }
+
+    char *p = strpbrk(name, "+[");
+    if (p && *p == '+') {
+        off = strtoul(p + 1, NULL, 0);
+        *p = '\0';
+    } else if (p) {
+        index = strtoul(p + 1, NULL, 0);
+        has_index = 1;
+        *p = '\0';
+    }
+
+    if (name[0] == '0' && (name[1] == 'x' || name[1] == 'X')) {
+        if (type < 0) {
+            fprintf(stderr, "%s: raw address needs a type\n", arg);
+            return -1;
+        }
+        c->addr = strtoul(name, NULL, 16);
+    } else if (find_symbol(name, &c->addr, &size) != 0) {
+        fprintf(stderr, "%s: symbol not found\n", name);
+        return -1;
+    }
+    if (type < 0) type = (size == 1) ? SCOPE_U8 : (size == 2) ? SCOPE_I16 : SCOPE_F32;
+    if (has_index) off = index * type_sizes[type];
+    c->addr += off;
+    c->type = (uint8_t)type;
+    c->arg = arg;
+    return 0;
+}
+
+/*--------------------------------- 串口 ---------------------------------*/
+
+static uint32_t now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t get32(const uint8_t *p){
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put32(uint8_t *p, uint32_t v){
+    p[0] = v >> 24, p[1] = v >> 16, p[2] = v >> 8, p[3] = v;
+}
+
+// 任意波特率, 8N1, 原始模式; 切换前等已写入的数据发完
+static int set_baud(uint32_t b){
+    struct termios2 t;
+    if (ioctl(fd, TCGETS2, &t) != 0) return -1;
+    ioctl(fd, TCSBRK, 1);
+    t.c_iflag = 0;
+    t.c_oflag = 0;
+    t.c_lflag = 0;
+    t.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    t.c_ispeed = t.c_ospeed = b;
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 0;
+    if (ioctl(fd, TCSETS2, &t) != 0) return -1;
+    baud = b;
+    return 0;
+}
+
+static void send_frame(uint8_t type, const uint8_t *p, uint8_t len){
+    uint8_t f[64];
+    uint32_t n = link_frame(f, type, p, len);
+    if (write(fd, f, n) != (ssize_t)n) perror("write");
+}
+
+static void send32(uint8_t type, uint32_t v){
+    uint8_t p[4];
+    put32(p, v);
+    send_frame(type, p, 4);
+}
+
+static void print_value(uint8_t type, const uint8_t *p){
+    uint32_t v = 0;
+    float f;
+
+    for (unsigned i = 0; i < type_sizes[type]; i++) v = v << 8 | p[i];
+    switch (type) {
+    case SCOPE_U8:
+    case SCOPE_U16:
+    case SCOPE_U32:
+        printf(",%u", v);
+        break;
+    case SCOPE_I8:
+        printf(",%d", (int8_t)v);
+        break;
+    case SCOPE_I16:
+        printf(",%d", (int16_t)v);
+        break;
+    case SCOPE_I32:
+        printf(",%d", (int32_t)v);
+        break;
+    default:
+        memcpy(&f, &v, sizeof(f));
+        printf(",%.9g", f);
+        break;
+    }
+}
+
+// 样本序号是16位的, 按与上一个的差展开; 跳过的序号记为丢失
+static void on_data(const uint8_t *p, unsigned len){
+    if (len < 3 || p[0] != tag || width == 0 || (len - 3) % width) return;
+    uint16_t seq = (uint16_t)(p[1] << 8 | p[2]);
+    uint64_t s = have_seq ? next_sample + (uint16_t)(seq - (uint16_t)next_sample) : seq;
+
+    if (have_seq) lost += s - next_sample;
+    have_seq = 1;
+    for (const uint8_t *q = p + 3; q < p + len; q += width, s++) {
+        printf("%.6f", s * period_s);
+        const uint8_t *v = q;
+        for (unsigned i = 0; i < chan_num; i++) {
+            print_value(chans[i].type, v);
+            v += type_sizes[chans[i].type];
+        }
+        printf("\n");
+        samples++;
+    }
+    next_sample = s;
+}
+
+// 读取并解析已到达的字节, 最多等ms毫秒
+static void pump(uint32_t ms){
+    static uint8_t buf[64];
+    static unsigned pos, need;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    uint8_t d[4096];
+
+    poll(&pfd, 1, ms);
+    ssize_t n = read(fd, d, sizeof(d));
+    if (n < 0 && errno != EAGAIN) {
+        perror("read");
+        exit(1);
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        if (pos == 0 && d[i] != LINK_ADDR) continue;
+        buf[pos++] = d[i];
+        if (pos == 2) {
+            if (d[i] < 2 || d[i] > 62) {
+                pos = 0;
+                continue;
+            }
+            need = d[i] + 2;
+        }
+        if (pos < 2 || pos < need) continue;
+        pos = 0;
+        if (link_crc8(&buf[2], need - 3) != buf[need - 1]) {
+            crc_errors++;
+            continue;
+        }
+        frames++;
+        t_frame = now_ms();
+        if (buf[2] == SCOPE_DATA) {
+            on_data(&buf[3], need - 4);
+        } else {
+            got[buf[2]] = 1;
+            memcpy(got_payload[buf[2]], &buf[3], need - 4);
+        }
+    }
+}
+
+// 发一帧请求, 等应答; 没等到就重发, 共tries次
+static const uint8_t *request(uint8_t type, const uint8_t *p, uint8_t len, uint8_t reply, uint32_t ms, int tries){
+    while (tries-- > 0 && !stop) {
+        got[reply] = 0;
+        send_frame(type, p, len);
+        for (uint32_t t0 = now_ms(); now_ms() - t0 < ms;) {
+            pump(5);
+            if (got[reply]) return got_payload[reply];
+        }
+    }
+    return NULL;
+}
+
+// 协商到不超过max的最高速率; 切换后验证失败就回到安全速率, 等飞控也超时回退
+static void negotiate(uint32_t max){
+    uint8_t p[4];
+    const uint8_t *r;
+    uint32_t target = 0;
+
+    put32(p, max);
+    if ((r = request(LINK_HELLO, p, 4, LINK_CAPS, 200, 5)) == NULL) {
+        fprintf(stderr, "no reply from flight controller, staying at %u baud\n", baud);
+        return;
+    }
+    for (unsigned i = 0; i < r[0] && i < LINK_RATE_MAX; i++) {
+        uint32_t b = get32(&r[1 + i * 4]);
+        if (b <= max && b > target) target = b;
+    }
+    if (target == 0) return;
+
+    put32(p, target);
+    if ((r = request(LINK_SWITCH, p, 4, LINK_SWITCH_ACK, 200, 5)) == NULL || get32(r) != target) {
+        fprintf(stderr, "switch to %u refused\n", target);
+        return;
+    }
+    set_baud(target);
+    usleep(20000); // 等飞控发完应答后切换
+
+    int ok = 0;
+    for (uint32_t seq = 1; seq <= LINK_PING_NUM * 2 && ok < LINK_PING_NUM; seq++) {
+        put32(p, seq);
+        if ((r = request(LINK_PING, p, 4, LINK_PONG, 30, 1)) != NULL && get32(r) == seq) ok++;
+    }
+    put32(p, target);
+    if (ok < LINK_PING_NUM || (r = request(LINK_COMMIT, p, 4, LINK_COMMIT_ACK, 50, 6)) == NULL || get32(r) != target) {
+        fprintf(stderr, "verify failed at %u baud, staying at %u\n", target, LINK_SAFE_BAUD);
+        set_baud(LINK_SAFE_BAUD);
+        usleep(LINK_KEEPALIVE_MS * 1000 + 200000);
+        return;
+    }
+    fprintf(stderr, "link at %u baud\n", target);
+}
+
+static int configure(uint8_t decim){
+    static const char *errors[] = {"ok", "bad address or type", "bad parameters"};
+    uint8_t p[3 + SCOPE_CH_MAX * 5];
+    const uint8_t *r;
+
+    p[0] = tag, p[1] = decim, p[2] = (uint8_t)chan_num;
+    for (unsigned i = 0; i < chan_num; i++) {
+        put32(&p[3 + i * 5], chans[i].addr);
+        p[3 + i * 5 + 4] = chans[i].type;
+    }
+    for (int i = 0; i < 5; i++) {
+        if ((r = request(SCOPE_SET, p, 3 + chan_num * 5, SCOPE_ACK, 200, 1)) == NULL) {
+            fprintf(stderr, "no reply to scope configuration\n");
+            return -1;
+        }
+        if (r[0] == tag) break; // 之前残留的应答
+    }
+    if (chan_num == 0) return 0;
+    if (r[0] != tag || r[1] != 0 || r[2] != width) {
+        fprintf(stderr, "scope rejected: %s\n", r[1] <= 2 ? errors[r[1]] : "?");
+        return -1;
+    }
+    period_s = get32(&r[3]) / 1e6;
+    return 0;
+}
+
+static void on_signal(int sig){
+    (void)sig;
+    stop = 1;
+}
+
+int main(int argc, char **argv){
+    uint32_t max_baud = 3000000, run_ms = 0;
+    int decim = 1, opt;
+
+    while ((opt = getopt(argc, argv, "b:d:t:")) != -1) {
+        if (opt == 'b') max_baud = strtoul(optarg, NULL, 0);
+        else if (opt == 'd') decim = atoi(optarg);
+        else if (opt == 't') run_ms = strtoul(optarg, NULL, 0) * 1000;
+        else break;
+    }
+    if (argc - optind < 3 || decim < 1 || decim > 255) {
+        fprintf(stderr, "usage: %s [-b max_baud] [-d decim] [-t seconds] <tty> <firmware.elf> var...\n", argv[0]);
+        return 1;
+    }
+    if (argc - optind - 2 > SCOPE_CH_MAX) {
+        fprintf(stderr, "at most %d variables\n", SCOPE_CH_MAX);
+        return 1;
+    }
+    if (load_elf(argv[optind + 1]) != 0) return 1;
+    for (int i = optind + 2; i < argc; i++) {
+        if (parse_chan(argv[i], &chans[chan_num]) != 0) return 1;
+        fprintf(stderr, "%-20s 0x%08X %s\n", argv[i], chans[chan_num].addr, type_names[chans[chan_num].type]);
+        width += type_sizes[chans[chan_num].type];
+        chan_num++;
+    }
+
+    fd = open(argv[optind], O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || set_baud(LINK_SAFE_BAUD) != 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    negotiate(max_baud);
+    tag = (uint8_t)(now_ms() | 1);
+    if (configure((uint8_t)decim) != 0) return 1;
+
+    printf("t");
+    for (unsigned i = 0; i < chan_num; i++) printf(",%s", chans[i].arg);
+    printf("\n");
+
+    // 保活; 高速下一秒收不到合法帧说明飞控已回退, 跟着回到安全速率
+    uint32_t start = now_ms(), t_ping = start;
+    t_frame = start;
+    while (!stop && !(run_ms && now_ms() - start >= run_ms)) {
+        pump(10);
+        uint32_t now = now_ms();
+        if (now - t_ping >= LINK_KEEPALIVE_MS / 4) {
+            send32(LINK_PING, now);
+            t_ping = now;
+        }
+        if (baud != LINK_SAFE_BAUD && now - t_frame > 1000) {
+            fprintf(stderr, "link lost at %u baud, back to %u\n", baud, LINK_SAFE_BAUD);
+            set_baud(LINK_SAFE_BAUD);
+            t_frame = now;
+        }
+    }
+    fflush(stdout);
+
+    chan_num = 0;
+    configure(0);
+    fprintf(stderr, "%llu samples, %llu lost, %lu frames, %lu crc errors, %u baud\n", (unsigned long long)samples,
+            (unsigned long long)lost, frames, crc_errors, baud);
+    return 0;
+}
@@ -0,0 +1,427 @@
+// 软件在环仿真: 固件的app/control.c (同一份源文件, 参数取param_table默认值) 驱动刚体四轴模型
+//
+// 模型:
+//   刚体6自由度, 四元数姿态, 欧拉方程 (含陀螺耦合项), 平动受重力和线性阻力
+//   电机: 转速一阶滞后跟随指令, 推力与转速平方成正比, 反扭矩与推力成正比
+//   扰动: 三轴阵风力矩 (一阶高斯-马尔可夫过程)
+//   传感器: 陀螺 (噪声+零偏, 按16.4 LSB/(deg/s)量化), 加速度计 (噪声), DMP姿态 (噪声, 0.01deg),
+//           磁航向 (噪声), 气压高度 (噪声+随机游走漂移, cm); 量化与sensor_record_t一致
+//   坐标: 机体x向前、y向左、z向上. 与control.c的混控表一致: roll右侧向下为正,
+//         pitch机头向下为正, yaw逆时针 (机头向左) 为正
+//
+// 飞行脚本 (每20s重复): 悬停, roll ±10deg, pitch ±10deg (各1.5s, 中间回到水平), yaw 90deg/s, 悬停;
+// 油门由仿真中的"飞手"根据气压高度做定高, 不属于被测代码
+//
+// 时间:
+//   锁步 (默认): 物理1kHz、控制100Hz (与TIM2节拍相同), 不等待墙钟, 结果只取决于种子
+//   -x 倍速: 按墙钟推进, 控制步的dt取实际间隔, 用于观察调度抖动的影响, 结果不可重复
+// 每次control_step用CLOCK_MONOTONIC计时, 结束时输出每步耗时的分布
+//
+// 编译: cc -std=gnu99 -O2 -Wall -no-pie -I../bsp -I../app -Wl,-T,mock/host.ld -o sitl
+//          sitl.c param_host.c ../app/control.c -lm
+// 用法: sitl [-t 仿真秒数, 默认60] [-s 种子] [-x 倍速] [-o 轨迹.csv] [-v]
+//       姿态发散、跟踪误差超限或出现NaN时退出码为1, 可直接用于CI
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "param.h"
+#include "control.h"
+
+#define PHYS_HZ    1000
+#define CTRL_DIV   10 // 每10个物理步一次控制
+#define SCRIPT_S   20
+#define DEG        (180.0 / M_PI)
+#define G          9.81
+
+// 机体参数: 约330mm轴距、1kg
+#define MASS       1.0
+#define ARM        0.165 // 电机到中心 (m)
+#define IXX        8.0e-3
+#define IYY        8.0e-3
+#define IZZ        1.4e-2
+#define T_MAX      8.0   // 单电机最大推力 (N)
+#define K_YAW      0.016 // 反扭矩/推力 (m)
+#define MOTOR_TAU  0.02  // 电机转速时间常数 (s)
+#define DRAG       0.3   // 平动阻力 (N/(m/s))
+
+// 传感器误差 (1σ)
+#define GYRO_NOISE 0.15  // deg/s
+#define GYRO_BIAS  0.5   // deg/s, 上电时随机
+#define ACC_NOISE  0.02  // g
+#define DMP_NOISE  0.05  // deg
+#define MAG_NOISE  0.5   // deg
+#define BARO_NOISE 0.08  // m
+#define BARO_WALK  0.002 // m/√s
+#define GUST_TORQ  0.004 // Nm
+#define GUST_TAU   0.5   // s
+
+// 判定
+#define LIMIT_ANGLE 60.0 // 任何时刻
+#define LIMIT_ALT   5.0  // 相对目标高度 (m)
+#define LIMIT_RMS   3.0  // 悬停段姿态误差RMS (deg)
+
+typedef struct {
+    double q[4];   // 姿态四元数 w,x,y,z (机体到世界)
+    double w[3];   // 机体角速度 (rad/s)
+    double p[3];   // 位置 (m), z向上
+    double v[3];   // 速度 (m/s)
+    double rpm[4]; // 归一化电机转速 0~1
+} body_t;
+
+static body_t body;
+static double gust[3], gyro_bias[3], baro_drift;
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static int verbose;
+
+// 电机位置 (x, y), 顺序同PWM通道: 右后, 右前, 左后, 左前; 右前和左后顺时针旋转
+static const double motor_xy[CONTROL_MOTOR_NUM][2] = {
+    {-ARM * M_SQRT1_2, -ARM * M_SQRT1_2},
+    {+ARM * M_SQRT1_2, -ARM * M_SQRT1_2},
+    {-ARM * M_SQRT1_2, +ARM * M_SQRT1_2},
+    {+ARM * M_SQRT1_2, +ARM * M_SQRT1_2},
+};
+static const double motor_spin[CONTROL_MOTOR_NUM] = {-1, +1, +1, -1}; // 反扭矩方向
+
+/*---------------------------------------------------------------------------*/
+
+static double urand(void){
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return ((rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double nrand(void){
+    return sqrt(-2.0 * log(urand())) * cos(2.0 * M_PI * urand());
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 机体系向量转到世界系
+static void rotate(const double q[4], const double a[3], double out[3]){
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    out[0] = (1 - 2 * (y * y + z * z)) * a[0] + 2 * (x * y - w * z) * a[1] + 2 * (x * z + w * y) * a[2];
+    out[1] = 2 * (x * y + w * z) * a[0] + (1 - 2 * (x * x + z * z)) * a[1] + 2 * (y * z - w * x) * a[2];
+    out[2] = 2 * (x * z - w * y) * a[0] + 2 * (y * z + w * x) * a[1] + (1 - 2 * (x * x + y * y)) * a[2];
+}
+
+// ZYX欧拉角 (deg)
+static void euler(const double q[4], double e[3]){
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    double s = 2 * (w * y - z * x);
+    e[0] = atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * DEG;
+    e[1] = asin(s > 1 ? 1 : (s < -1 ? -1 : s)) * DEG;
+    e[2] = atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * DEG;
+}
+
+static double wrap180(double a){
+    while (a > 180)
+        a -= 360;
+    while (a < -180)
+        a += 360;
+    return a;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                              刚体模型                                       */
+/*---------------------------------------------------------------------------*/
+
+static void body_init(double hover){
+    memset(&body, 0, sizeof(body));
+    body.q[0] = 1;
+    body.p[2] = 0;
+    for (int m = 0; m < CONTROL_MOTOR_NUM; m++)
+        body.rpm[m] = hover;
+    for (int i = 0; i < 3; i++)
+        gyro_bias[i] = nrand() * GYRO_BIAS;
+}
+
+// 推进dt, cmd为电机指令0~1; 返回机体系比力 (加速度计, m/s^2)
+static void body_step(const float cmd[CONTROL_MOTOR_NUM], double dt, double acc_body[3]){
+    double thrust = 0, tau[3] = {0};
+    static const double inertia[3] = {IXX, IYY, IZZ};
+
+    for (int m = 0; m < CONTROL_MOTOR_NUM; m++) {
+        double c = cmd[m] < 0 ? 0 : (cmd[m] > 1 ? 1 : cmd[m]);
+        body.rpm[m] += (c - body.rpm[m]) * (dt / (MOTOR_TAU + dt));
+        double t = T_MAX * body.rpm[m] * body.rpm[m];
+        thrust += t;
+        tau[0] += motor_xy[m][1] * t;
+        tau[1] -= motor_xy[m][0] * t;
+        tau[2] += motor_spin[m] * K_YAW * t;
+    }
+
+    // 阵风
+    double a = dt / GUST_TAU;
+    for (int i = 0; i < 3; i++) {
+        gust[i] += -gust[i] * a + GUST_TORQ * sqrt(2 * a) * nrand();
+        tau[i] += gust[i];
+    }
+
+    // 欧拉方程: I dw/dt = tau - w x (I w)
+    double *w = body.w;
+    double iw[3] = {IXX * w[0], IYY * w[1], IZZ * w[2]};
+    double cross[3] = {w[1] * iw[2] - w[2] * iw[1], w[2] * iw[0] - w[0] * iw[2], w[0] * iw[1] - w[1] * iw[0]};
+    for (int i = 0; i < 3; i++)
+        w[i] += (tau[i] - cross[i]) / inertia[i] * dt;
+
+    // 四元数积分 dq/dt = q * (0, w) / 2
+    double *q = body.q;
+    double dq[4] = {
+        0.5 * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]),
+        0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]),
+        0.5 * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]),
+        0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0]),
+    };
+    double n = 0;
+    for (int i = 0; i < 4; i++) {
+        q[i] += dq[i] * dt;
+        n += q[i] * q[i];
+    }
+    n = 1 / sqrt(n);
+    for (int i = 0; i < 4; i++)
+        q[i] *= n;
+
+    // 平动, 地面 (z=0) 不能穿过
+    double f_body[3] = {0, 0, thrust}, f[3];
+    rotate(q, f_body, f);
+    for (int i = 0; i < 3; i++) {
+        double acc = (f[i] - DRAG * body.v[i]) / MASS - (i == 2 ? G : 0);
+        body.v[i] += acc * dt;
+        body.p[i] += body.v[i] * dt;
+    }
+    if (body.p[2] < 0) {
+        body.p[2] = 0;
+        body.v[2] = body.v[2] < 0 ? 0 : body.v[2];
+    }
+
+    // 比力 = 推力和阻力产生的加速度, 在机体系表示 (悬停时约+1g)
+    double drag_w[3] = {-DRAG * body.v[0] / MASS, -DRAG * body.v[1] / MASS, -DRAG * body.v[2] / MASS}, drag_b[3];
+    double qc[4] = {q[0], -q[1], -q[2], -q[3]};
+    rotate(qc, drag_w, drag_b);
+    acc_body[0] = drag_b[0];
+    acc_body[1] = drag_b[1];
+    acc_body[2] = thrust / MASS + drag_b[2];
+}
+
+/*---------------------------------------------------------------------------*/
+/*                              传感器                                        */
+/*---------------------------------------------------------------------------*/
+
+static double quant(double v, double lsb){
+    double r = floor(v * lsb + 0.5);
+    r = r > 32767 ? 32767 : (r < -32768 ? -32768 : r);
+    return r / lsb;
+}
+
+// 按sensor_to_control的换算填写控制输入: 姿态0.01deg, 陀螺16.4 LSB/(deg/s);
+// 加速度计 (g, 16384 LSB/g) 控制层不用, 只输出
+static void sensor_read(control_input_t *in, const double acc_body[3], double acc[3], double *heading, double *alt,
+                        double dt){
+    double e[3];
+
+    euler(body.q, e);
+    for (int i = 0; i < 3; i++) {
+        in->angle[i] = (float)quant(wrap180(e[i] + nrand() * DMP_NOISE), 100);
+        in->gyro[i] = (float)quant(body.w[i] * DEG + gyro_bias[i] + nrand() * GYRO_NOISE, 16.4);
+        acc[i] = quant(acc_body[i] / G + nrand() * ACC_NOISE, 16384);
+    }
+    *heading = fmod(e[2] + nrand() * MAG_NOISE + 360, 360);
+    baro_drift += BARO_WALK * sqrt(dt) * nrand();
+    *alt = floor((body.p[2] + baro_drift + nrand() * BARO_NOISE) * 100) / 100;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                              飞行脚本                                      */
+/*---------------------------------------------------------------------------*/
+
+// 返回1表示悬停段 (计入误差统计)
+static int script(double t, control_input_t *in){
+    double s = fmod(t, SCRIPT_S);
+    int level = 0;
+
+    in->setpoint[0] = in->setpoint[1] = in->setpoint[2] = 0;
+    if (s < 4)
+        level = t >= SCRIPT_S; // 第一轮起飞不计
+    else if (s < 5.5)
+        in->setpoint[0] = 10;
+    else if (s >= 7 && s < 8.5)
+        in->setpoint[0] = -10;
+    else if (s >= 10 && s < 11.5)
+        in->setpoint[1] = 10;
+    else if (s >= 13 && s < 14.5)
+        in->setpoint[1] = -10;
+    else if (s >= 15 && s < 17)
+        in->setpoint[2] = 90;
+    else if (s >= 18)
+        level = 1;
+    return level;
+}
+
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void usage(void){
+    fprintf(stderr, "usage: sitl [-t seconds] [-s seed] [-x speed] [-o trace.csv] [-v]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv){
+    double duration = 60, speed = 0;
+    const char *trace_path = NULL;
+    FILE *trace = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            duration = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            rng ^= strtoull(argv[++i], NULL, 0) * 0xD1B54A32D192ED03ULL;
+        else if (!strcmp(argv[i], "-x") && i + 1 < argc)
+            speed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else
+            usage();
+    }
+    if (duration <= 0 || speed < 0)
+        usage();
+    if (trace_path != NULL && (trace = fopen(trace_path, "w")) == NULL) {
+        perror(trace_path);
+        return 2;
+    }
+    if (trace)
+        fprintf(trace, "t,sp_roll,sp_pitch,sp_yawrate,roll,pitch,yaw,gyro_z,alt,m0,m1,m2,m3\n");
+
+    param_reset_default();
+    control_reset();
+
+    double hover = sqrt(MASS * G / (4 * T_MAX));
+    const double target_alt = 2.0, dt = 1.0 / PHYS_HZ;
+    uint64_t steps = (uint64_t)(duration * PHYS_HZ), nctrl = steps / CTRL_DIV + 1;
+    uint64_t *cost = malloc(nctrl * sizeof(*cost));
+    control_input_t in = {0};
+    control_output_t out = {0};
+    double acc_body[3] = {0, 0, G}, acc[3], heading = 0, alt = 0, alt_i = 0, last_ctrl = 0;
+    double err_sq = 0, err_max = 0, alt_err_max = 0, angle_max = 0;
+    uint64_t err_n = 0, n = 0;
+    uint32_t crc = 0;
+    int fail = 0;
+
+    if (cost == NULL)
+        return 2;
+    body_init(0);
+    double wall0 = now_s();
+
+    for (uint64_t k = 0; k < steps && !fail; k++) {
+        double t = k * dt;
+
+        if (k % CTRL_DIV == 0) {
+            sensor_read(&in, acc_body, acc, &heading, &alt, CTRL_DIV * dt);
+            int level = script(t, &in);
+
+            // 飞手: 气压定高, 悬停油门加PI
+            double ae = target_alt - alt;
+            alt_i += ae * CTRL_DIV * dt;
+            alt_i = alt_i > 2 ? 2 : (alt_i < -2 ? -2 : alt_i);
+            double thr = hover + 0.08 * ae + 0.02 * alt_i - 0.1 * body.v[2];
+            in.throttle = (float)(thr < 0 ? 0 : (thr > 1 ? 1 : thr));
+            in.dt = (float)(speed > 0 && n > 0 ? t - last_ctrl : CTRL_DIV * dt);
+            last_ctrl = t;
+
+            uint64_t t0 = now_ns();
+            control_step(&in, &out);
+            cost[n++] = now_ns() - t0;
+
+            for (int m = 0; m < CONTROL_MOTOR_NUM; m++) {
+                uint32_t u;
+                memcpy(&u, &out.motor[m], 4);
+                crc = (crc ^ u) * 0x01000193u;
+            }
+
+            double e[3];
+            euler(body.q, e);
+            for (int i = 0; i < 3; i++) {
+                if (isnan(e[i]) || isnan(out.motor[i])) {
+                    fprintf(stderr, "t=%.2f: NaN\n", t);
+                    fail = 1;
+                }
+            }
+            for (int i = 0; i < 2; i++) {
+                if (fabs(e[i]) > angle_max)
+                    angle_max = fabs(e[i]);
+                if (level) {
+                    double d = e[i] - in.setpoint[i];
+                    err_sq += d * d;
+                    err_n++;
+                    if (fabs(d) > err_max)
+                        err_max = fabs(d);
+                }
+            }
+            if (t > 5 && fabs(body.p[2] - target_alt) > alt_err_max)
+                alt_err_max = fabs(body.p[2] - target_alt);
+            if (angle_max > LIMIT_ANGLE || alt_err_max > LIMIT_ALT) {
+                fprintf(stderr, "t=%.2f: diverged, roll %.1f pitch %.1f alt %.2f\n", t, e[0], e[1], body.p[2]);
+                fail = 1;
+            }
+            if (trace)
+                fprintf(trace, "%.3f,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%.2f,%.3f,%.4f,%.4f,%.4f,%.4f\n", t,
+                        in.setpoint[0], in.setpoint[1], in.setpoint[2], e[0], e[1], e[2], body.w[2] * DEG,
+                        body.p[2], out.motor[0], out.motor[1], out.motor[2], out.motor[3]);
+            if (verbose && k % (PHYS_HZ * SCRIPT_S) == 0)
+                printf("t=%6.0f roll %6.2f pitch %6.2f heading %6.1f alt %5.2f acc z %.2f g\n", t, e[0], e[1],
+                       heading, alt, acc[2]);
+        }
+
+        body_step(out.motor, dt, acc_body);
+
+        if (speed > 0) {
+            double ahead = t / speed - (now_s() - wall0);
+            if (ahead > 0.001) {
+                struct timespec ts = {0, (long)(ahead * 1e9)};
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+
+    double wall = now_s() - wall0;
+    double rms = err_n ? sqrt(err_sq / err_n) : 0;
+    qsort(cost, n, sizeof(*cost), cmp_u64);
+
+    printf("simulated %.0f s in %.2f s wall (%.0fx real time), %s\n", duration, wall, duration / wall,
+           speed > 0 ? "paced" : "lockstep");
+    printf("control_step: %llu calls, min %llu median %llu p99 %llu max %llu ns\n", (unsigned long long)n,
+           (unsigned long long)cost[0], (unsigned long long)cost[n / 2], (unsigned long long)cost[n * 99 / 100],
+           (unsigned long long)cost[n - 1]);
+    printf("level attitude error: rms %.2f max %.2f deg; max angle %.1f deg; max altitude error %.2f m\n", rms,
+           err_max, angle_max, alt_err_max);
+    printf("output crc %08x\n", crc);
+
+    if (rms > LIMIT_RMS) {
+        fprintf(stderr, "level attitude error rms %.2f > %.1f deg\n", rms, LIMIT_RMS);
+        fail = 1;
+    }
+    if (trace)
+        fclose(trace);
+    free(cost);
+    return fail;
+}
@@ -0,0 +1,77 @@
+// 遥测解码: 读取USART3的原始字节流, 按帧输出文本
+// 帧格式见 app/telem.h
+//
+// 编译: cc -O2 -o telem_decode telem_decode.c
+// 用法: telem_decode < telem.bin
+//       先把串口数据录成文件, 如 stty -F /dev/ttyUSB0 250000 raw && cat /dev/ttyUSB0 > telem.bin
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static uint8_t crc8(const uint8_t *d, unsigned len){
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *d++;
+        for (int i = 0; i < 8; i++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xD5) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static unsigned be16(const uint8_t *p){
+    return (unsigned)p[0] << 8 | p[1];
+}
+
+static void print_frame(uint8_t type, const uint8_t *p, unsigned len){
+    switch (type) {
+    case 0x1E:
+        if (len != 6) break;
+        printf("att   pitch %.4f roll %.4f yaw %.4f rad\n", (int16_t)be16(p) / 10000.0,
+               (int16_t)be16(p + 2) / 10000.0, (int16_t)be16(p + 4) / 10000.0);
+        return;
+    case 0x08:
+        if (len != 8) break;
+        printf("batt  %.1f V %.1f A %u mAh %u%%\n", be16(p) / 10.0, be16(p + 2) / 10.0,
+               (unsigned)p[4] << 16 | (unsigned)p[5] << 8 | p[6], p[7]);
+        return;
+    case 0xA0:
+        if (len != 7) break;
+        printf("loop  %u Hz worst %u us link %u%%\n", be16(p) << 16 | be16(p + 2), be16(p + 4), p[6]);
+        return;
+    case 0xA1:
+        if (len != 12) break;
+        printf("rc    %s lq %u%% age %u ms ch %u %u %u %u\n", (p[0] & 1) ? "ok" : "lost", p[1], be16(p + 2),
+               be16(p + 4), be16(p + 6), be16(p + 8), be16(p + 10));
+        return;
+    default:
+        break;
+    }
+    printf("type %02X len %u\n", type, len);
+}
+
+int main(void){
+    static uint8_t data[1 << 24];
+    size_t n = fread(data, 1, sizeof(data), stdin);
+    unsigned long frames = 0, crc_errors = 0, skipped = 0;
+
+    // 在0xC8处尝试取一帧, 长度或CRC不对就后移一个字节重新找帧头
+    for (size_t i = 0; i < n;) {
+        unsigned len = (i + 1 < n) ? data[i + 1] : 0;
+        if (data[i] != 0xC8 || len < 2 || len > 62 || i + len + 2 > n) {
+            skipped++;
+            i++;
+            continue;
+        }
+        if (crc8(&data[i + 2], len - 1) != data[i + len + 1]) {
+            crc_errors++;
+            skipped++;
+            i++;
+            continue;
+        }
+        frames++;
+        print_frame(data[i + 2], &data[i + 3], len - 2);
+        i += len + 2;
+    }
+    fprintf(stderr, "%lu frames, %lu crc errors, %lu bytes skipped\n", frames, crc_errors, skipped);
+    return 0;
+}
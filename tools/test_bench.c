@@ -0,0 +1,74 @@
+// bsp/bench.c 主机测试: 测试表由链接器收集 (mock/host.ld), 统计结果有序,
+// 被测的app/control.c读取的是参数表默认值 (param_host.c)
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -I../app -Wl,-T,mock/host.ld -o test_bench
+//          test_bench.c param_host.c ../bsp/bench.c ../app/control.c
+// 用法: test_bench [-v], 全部通过时退出码为0
+
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+#include "param.h"
+#include "bench.h"
+
+static volatile uint32_t spin_n;
+
+static void bench_spin(void){
+    for (volatile uint32_t i = 0; i < spin_n; i++)
+        ;
+}
+
+BENCH_EXPORT(zz_spin, bench_spin);
+
+static void test_table(void){
+    const bench_t *first = (const bench_t *)BENCH_TABLE_BEGIN, *last = (const bench_t *)BENCH_TABLE_END;
+
+    CHECK(last - first == 4, "%d entries", (int)(last - first));
+    for (const bench_t *b = first; b + 1 < last; b++)
+        CHECK(strcmp(b->name, b[1].name) < 0, "%s before %s", b->name, b[1].name);
+    CHECK(bench_find("control_step") != NULL && bench_find("pid_step") != NULL, "control benchmarks missing");
+    CHECK(bench_find("zz_spin") == last - 1, "zz_spin not last");
+    CHECK(bench_find("nope") == NULL, "unknown name");
+}
+
+static void test_params(void){
+    param_reset_default();
+    CHECK(param_get_u(PARAM_GYRO_LPF_HZ) == 80, "%u", param_get_u(PARAM_GYRO_LPF_HZ));
+    CHECK(param_get_f(PARAM_PID_ROLL_P) == 1.2f, "%f", param_get_f(PARAM_PID_ROLL_P));
+    // 未链接的模块 (pwm.c) 的参数没有表项
+    CHECK(param_info(PARAM_PWM_FREQ) == NULL && param_get_u(PARAM_PWM_FREQ) == 0, "pwm_freq");
+    CHECK(param_set(PARAM_GYRO_LPF_HZ, (param_value_t){.u = 1000}) == -1, "range");
+    CHECK(param_set(PARAM_GYRO_LPF_HZ, (param_value_t){.u = 100}) == 0 && param_get_u(PARAM_GYRO_LPF_HZ) == 100,
+          "set");
+    param_reset_default();
+}
+
+static void test_run(int verbose){
+    bench_result_t r, r2;
+    const bench_t *spin = bench_find("zz_spin");
+
+    CHECK(bench_run(spin, 0, &r) == -1 && bench_run(spin, BENCH_ITER_MAX + 1, &r) == -1, "iteration range");
+    CHECK(bench_run(NULL, 16, &r) == -1, "NULL");
+
+    for (const bench_t *b = (const bench_t *)BENCH_TABLE_BEGIN; b < (const bench_t *)BENCH_TABLE_END; b++) {
+        CHECK(bench_run(b, BENCH_ITER_MAX, &r) == 0, "%s", b->name);
+        CHECK(r.n == BENCH_ITER_MAX && r.min <= r.median && r.median <= r.p99 && r.p99 <= r.max, "%s %u %u %u %u",
+              b->name, r.min, r.median, r.p99, r.max);
+        if (verbose)
+            bench_print_json(b, &r);
+    }
+
+    // 开销已扣除, 工作量大10倍的结果明显更长
+    spin_n = 100;
+    bench_run(spin, 64, &r);
+    spin_n = 1000;
+    bench_run(spin, 64, &r2);
+    CHECK(r2.min > r.min * 3, "spin 100: %u, spin 1000: %u", r.min, r2.min);
+}
+
+int main(int argc, char **argv){
+    test_table();
+    test_params();
+    test_run(argc > 1 && !strcmp(argv[1], "-v"));
+    return check_done("test_bench");
+}
@@ -0,0 +1,285 @@
+// bsp/console.c 多线程压力测试: 主循环和三个不同优先级的中断同时向发送队列写消息,
+// 另一个线程扮演DMA2 Stream7和它的中断 (队列唯一的消费者), 把每次DMA传输的字节拼起来.
+// 核对: 每条消息完整连续, 同一生产者按顺序, 中断中队列满时整条丢弃 (不会只出一半),
+// 主循环的putchar按行提交且与整块输出保持顺序, 总字节数一致.
+//
+// 外设区用mock_init_plain映射为普通内存, 寄存器访问不经过模拟 (模拟只支持单线程);
+// 每个线程的IPSR各自设置, 主循环为0
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -pthread -Imock -I../bsp -I../app
+//          -o test_console test_console.c ../bsp/console.c mock/mock.c
+// 用法: test_console [-v], 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+
+#define ISR_NUM   3
+#define ISR_MSGS  10000 // 每个中断线程的消息数
+#define MAIN_MSGS 10000 // 主循环的消息数 (一半逐字符, 一半整块)
+#define OUT_SIZE  (16 << 20)
+#define CONSOLE_LINE_MAX 32 // 逐字符输出一行的最大长度 (一槽), 不会在行中间提交
+
+static int verbose;
+
+static char *out;               // DMA发出的全部字节
+static uint32_t out_len;
+static uint32_t dma_transfers;
+static volatile int stop;
+
+static uint8_t isr_sent[ISR_NUM][ISR_MSGS]; // 写入成功的消息
+static uint32_t sent_bytes[ISR_NUM + 1];
+// check.h的计数不是线程安全的, 线程中只记录, 由主线程检查
+static uint32_t isr_partial[ISR_NUM]; // 只写入了一部分的消息
+static uint32_t sr_bad;               // 启动传输时SR写错
+
+// console.c在初始化前轮询发送, 本测试不会用到
+void uart_putc(uart_port_t port, uint8_t ch){
+    (void)port;
+    (void)ch;
+}
+
+// 消息: "<tag> <seq> <payload>\n", payload由tag和seq决定, 按len补齐 (len不小于MSG_MIN)
+#define MSG_MIN 16
+static uint32_t msg_make(char *buf, char tag, uint32_t seq, uint32_t len){
+    uint32_t n = (uint32_t)sprintf(buf, "%c %u ", tag, seq);
+    for (; n < len - 1; n++)
+        buf[n] = (char)('a' + (seq + n) % 26);
+    buf[n++] = '\n';
+    return n;
+}
+
+static uint32_t rand_next(uint32_t *s){
+    *s = *s * 1103515245 + 12345;
+    return *s >> 8;
+}
+
+/*---------------------------------------------------------------------------*/
+/* DMA和消费者中断                                                           */
+/*---------------------------------------------------------------------------*/
+
+// 完成正在进行的传输并执行一次中断, 返回是否启动了新的传输
+static int dma_step(uint32_t *seed){
+    if (DMA2_Stream7->CR & DMA_SxCR_EN) {
+        uint32_t n = DMA2_Stream7->NDTR;
+        const char *src = (const char *)(uintptr_t)DMA2_Stream7->M0AR;
+        if (out_len + n <= OUT_SIZE) {
+            memcpy(out + out_len, src, n);
+            out_len += n;
+        }
+        dma_transfers++;
+        // 发送需要时间, 让生产者有机会填满队列
+        for (volatile uint32_t spin = rand_next(seed) % 200; spin; spin--)
+            ;
+        DMA2_Stream7->CR &= ~DMA_SxCR_EN;
+        mock_poke(&DMA2->HISR, DMA_HISR_TCIF7);
+    }
+    mock_poke(&USART1->SR, 0);
+    console_dma_isr();
+    mock_poke(&DMA2->HISR, 0);
+
+    if (!(DMA2_Stream7->CR & DMA_SxCR_EN))
+        return 0;
+    // 启动传输时只写0清TC, 其余可写0清除的位写1 (不动期间到达的RXNE)
+    uint32_t sr = mock_peek(&USART1->SR);
+    sr_bad += (sr & USART_SR_TC) || !(sr & USART_SR_RXNE);
+    return 1;
+}
+
+static void *dma_thread(void *arg){
+    uint32_t seed = 1;
+    (void)arg;
+    mock_ipsr = 16 + DMA2_Stream7_IRQn;
+    for (;;) {
+        int busy = dma_step(&seed);
+        // 生产者全部结束后队列空即停止
+        if (!busy && stop)
+            break;
+        if (!busy)
+            sched_yield();
+    }
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* 生产者                                                                    */
+/*---------------------------------------------------------------------------*/
+
+// 中断: 消息MSG_MIN~256字节, 队列满时丢弃
+static void *isr_thread(void *arg){
+    uint32_t k = (uint32_t)(uintptr_t)arg;
+    uint32_t seed = 100 + k;
+    char buf[256];
+
+    mock_ipsr = 16 + TIM2_IRQn + k;
+    for (uint32_t seq = 0; seq < ISR_MSGS; seq++) {
+        uint32_t len = MSG_MIN + rand_next(&seed) % (sizeof(buf) - MSG_MIN + 1);
+        uint32_t n = msg_make(buf, (char)('0' + k), seq, len);
+        int w = console_write(buf, n);
+        isr_partial[k] += (w != 0 && w != (int)n);
+        if (w == (int)n) {
+            isr_sent[k][seq] = 1;
+            sent_bytes[k] += n;
+        }
+        sched_yield(); // 中断之间有间隔; 单核主机上也让其他线程运行
+    }
+    return NULL;
+}
+
+// 主循环: 逐字符 (每行不超过一槽) 和整块交替, 队列满时等待, 不丢
+static void main_producer(void){
+    uint32_t seed = 7;
+    char buf[256];
+
+    mock_ipsr = 0;
+    for (uint32_t seq = 0; seq < MAIN_MSGS; seq++) {
+        if (seq & 1) {
+            uint32_t n = msg_make(buf, 'W', seq, MSG_MIN + rand_next(&seed) % (sizeof(buf) - MSG_MIN + 1));
+            CHECK(console_write(buf, n) == (int)n, "main write %u dropped", seq);
+            sent_bytes[ISR_NUM] += n;
+        } else {
+            uint32_t n = msg_make(buf, 'M', seq, MSG_MIN + rand_next(&seed) % (CONSOLE_LINE_MAX - MSG_MIN + 1));
+            for (uint32_t i = 0; i < n; i++)
+                console_putc(buf[i]);
+            sent_bytes[ISR_NUM] += n;
+        }
+        // 主循环还有别的事, 给中断留出队列空间
+        for (volatile uint32_t spin = rand_next(&seed) % 1000; spin; spin--)
+            ;
+    }
+    console_poll();
+}
+
+/*---------------------------------------------------------------------------*/
+/* 核对输出                                                                  */
+/*---------------------------------------------------------------------------*/
+
+static void check_output(void){
+    int32_t next[ISR_NUM + 1] = {0};
+    uint32_t lines = 0, bad = 0;
+    char expect[256];
+    char *p = out, *end = out + out_len;
+
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            CHECK(0, "trailing %ld bytes without newline", (long)(end - p));
+            break;
+        }
+        uint32_t n = nl - p + 1;
+        char tag = p[0];
+        unsigned seq = 0;
+        int k = (tag == 'M' || tag == 'W') ? ISR_NUM : tag - '0';
+
+        lines++;
+        if (k < 0 || k > ISR_NUM || sscanf(p + 1, " %u", &seq) != 1 || n > sizeof(expect) ||
+            msg_make(expect, tag, seq, n) != n || memcmp(expect, p, n)) {
+            if (bad++ < 5)
+                CHECK(0, "corrupt line at %ld: %.40s", (long)(p - out), p);
+            p = nl + 1;
+            continue;
+        }
+        if (k < ISR_NUM) {
+            CHECK(seq < ISR_MSGS && isr_sent[k][seq], "isr %d msg %u not sent", k, seq);
+            // 跳过的只能是被丢弃的
+            for (uint32_t s = next[k]; s < seq && s < ISR_MSGS; s++)
+                CHECK(!isr_sent[k][s], "isr %d msg %u lost", k, s);
+        } else {
+            CHECK((int32_t)seq == next[k], "main msg %u, expected %d", seq, next[k]);
+        }
+        CHECK((int32_t)seq >= next[k], "producer %d out of order: %u after %d", k, seq, next[k] - 1);
+        next[k] = seq + 1;
+        p = nl + 1;
+    }
+    CHECK(next[ISR_NUM] == MAIN_MSGS, "main: %d messages", next[ISR_NUM]);
+    for (int k = 0; k < ISR_NUM; k++)
+        for (uint32_t s = next[k]; s < ISR_MSGS; s++)
+            CHECK(!isr_sent[k][s], "isr %d msg %u lost at end", k, s);
+
+    uint32_t total = 0;
+    for (int k = 0; k <= ISR_NUM; k++)
+        total += sent_bytes[k];
+    CHECK(out_len == total, "output %u bytes, sent %u", out_len, total);
+
+    if (verbose) {
+        uint32_t dropped = 0;
+        for (int k = 0; k < ISR_NUM; k++)
+            for (uint32_t s = 0; s < ISR_MSGS; s++)
+                dropped += !isr_sent[k][s];
+        printf("%u lines, %u bytes, %u dma transfers, %u isr messages dropped\n", lines, out_len, dma_transfers,
+               dropped);
+    }
+}
+
+static void test_stress(void){
+    pthread_t dma, isr[ISR_NUM];
+
+    stop = 0;
+    pthread_create(&dma, NULL, dma_thread, NULL);
+    for (uintptr_t k = 0; k < ISR_NUM; k++)
+        pthread_create(&isr[k], NULL, isr_thread, (void *)k);
+    main_producer();
+    for (int k = 0; k < ISR_NUM; k++)
+        pthread_join(isr[k], NULL);
+    stop = 1;
+    pthread_join(dma, NULL);
+    for (int k = 0; k < ISR_NUM; k++)
+        CHECK(isr_partial[k] == 0, "isr %d: %u partial writes", k, isr_partial[k]);
+    CHECK(sr_bad == 0, "SR read-modify-write at %u transfer starts", sr_bad);
+    check_output();
+}
+
+// 逐字符输出按行提交: 一行一次DMA传输, 不满一行的部分由console_poll提交
+static void test_putc_batch(void){
+    static const char line[] = "alt 12.5 m\n";
+    uint32_t seed = 3;
+
+    out_len = 0;
+    dma_transfers = 0;
+    mock_ipsr = 0;
+    for (const char *c = line; *c; c++)
+        console_putc(*c);
+    while (dma_step(&seed))
+        ;
+    CHECK(dma_transfers == 1 && out_len == sizeof(line) - 1 && !memcmp(out, line, out_len),
+          "line: %u transfers, %u bytes", dma_transfers, out_len);
+
+    console_putc('>');
+    console_putc(' ');
+    while (dma_step(&seed))
+        ;
+    CHECK(out_len == sizeof(line) - 1, "prompt sent before poll");
+    console_poll();
+    while (dma_step(&seed))
+        ;
+    CHECK(dma_transfers == 2 && out_len == sizeof(line) + 1 && !memcmp(out + out_len - 2, "> ", 2),
+          "prompt: %u transfers, %u bytes", dma_transfers, out_len);
+
+    // 中断中的putchar不进暂存, 直接提交
+    mock_ipsr = 16 + TIM2_IRQn;
+    console_putc('!');
+    mock_ipsr = 0;
+    while (dma_step(&seed))
+        ;
+    CHECK(dma_transfers == 3 && out[out_len - 1] == '!', "isr putc: %u transfers", dma_transfers);
+}
+
+int main(int argc, char **argv){
+    verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+    setvbuf(stdout, NULL, _IONBF, 0);
+    out = malloc(OUT_SIZE);
+    mock_init_plain();
+    console_init();
+    test_putc_batch();
+    out_len = 0;
+    dma_transfers = 0;
+    test_stress();
+    free(out);
+    return check_done("test_console");
+}
@@ -0,0 +1,283 @@
+// bsp/i2c_bus.c 主机测试: PB8/PB9软件I2C在寄存器模拟上驱动一个虚拟MPU6050 (0x68)
+// 检查引脚配置、单字节/多字节读写、地址NAK后总线释放、SCL时序 (快速模式), 并统计一次事务的寄存器访问次数
+// 软件I2C主机 (Soft_IIC_*) 属于外部框架, 这里按框架的时序 (ALIENTEK风格) 提供一份参考实现,
+// delay_us/delay_ms推进虚拟时间
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -o test_i2c_bus test_i2c_bus.c ../bsp/i2c_bus.c mock/mock.c
+// 用法: test_i2c_bus [-v], -v 打印寄存器访问统计和事务耗时; 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+#include "i2c/df_iic.h"
+
+#define US(n) ((uint64_t)SystemCoreClock / 1000000 * (n))
+
+extern SIAS i2c1_bus;
+
+static int verbose;
+static mock_i2c_slave_t mpu;
+
+/*---------------------------------------------------------------------------*/
+/* 框架替身: 延时推进虚拟时间                                                */
+/*---------------------------------------------------------------------------*/
+
+void delay_us(uint32_t us){
+    mock_advance(US(us));
+}
+
+void delay_ms(uint32_t ms){
+    mock_advance(US(ms) * 1000);
+}
+
+/*---------------------------------------------------------------------------*/
+/* 参考软件I2C主机                                                           */
+/*---------------------------------------------------------------------------*/
+
+void Soft_IIC_Init(SIAS *bus){
+    bus->Soft_IIC_GPIO_Port_Init();
+    bus->Soft_IIC_SCL(1);
+    bus->Soft_IIC_SDA(1);
+}
+
+void Soft_IIC_Start(SIAS *bus){
+    bus->Soft_SDA_OUT();
+    bus->Soft_IIC_SDA(1);
+    bus->Soft_IIC_SCL(1);
+    bus->delay_us(4);
+    bus->Soft_IIC_SDA(0);
+    bus->delay_us(4);
+    bus->Soft_IIC_SCL(0);
+}
+
+void Soft_IIC_Stop(SIAS *bus){
+    bus->Soft_SDA_OUT();
+    bus->Soft_IIC_SCL(0);
+    bus->Soft_IIC_SDA(0);
+    bus->delay_us(4);
+    bus->Soft_IIC_SCL(1);
+    bus->Soft_IIC_SDA(1);
+    bus->delay_us(4);
+}
+
+uint8_t Soft_IIC_Wait_Ack(SIAS *bus){
+    uint8_t t = 0;
+
+    bus->Soft_SDA_IN();
+    bus->Soft_IIC_SDA(1);
+    bus->delay_us(1);
+    bus->Soft_IIC_SCL(1);
+    bus->delay_us(1);
+    while (bus->Soft_READ_SDA()) {
+        if (++t > 250) {
+            Soft_IIC_Stop(bus);
+            return 1;
+        }
+    }
+    bus->Soft_IIC_SCL(0);
+    return 0;
+}
+
+void Soft_IIC_Ack(SIAS *bus){
+    bus->Soft_IIC_SCL(0);
+    bus->Soft_SDA_OUT();
+    bus->Soft_IIC_SDA(0);
+    bus->delay_us(2);
+    bus->Soft_IIC_SCL(1);
+    bus->delay_us(2);
+    bus->Soft_IIC_SCL(0);
+}
+
+void Soft_IIC_NAck(SIAS *bus){
+    bus->Soft_IIC_SCL(0);
+    bus->Soft_SDA_OUT();
+    bus->Soft_IIC_SDA(1);
+    bus->delay_us(2);
+    bus->Soft_IIC_SCL(1);
+    bus->delay_us(2);
+    bus->Soft_IIC_SCL(0);
+}
+
+void Soft_IIC_Send_Byte(SIAS *bus, uint8_t txd){
+    bus->Soft_SDA_OUT();
+    bus->Soft_IIC_SCL(0);
+    for (int i = 0; i < 8; i++) {
+        bus->Soft_IIC_SDA((txd & 0x80) >> 7);
+        txd <<= 1;
+        bus->delay_us(2);
+        bus->Soft_IIC_SCL(1);
+        bus->delay_us(2);
+        bus->Soft_IIC_SCL(0);
+        bus->delay_us(2);
+    }
+}
+
+uint8_t Soft_IIC_Receive_Byte(SIAS *bus, unsigned char ack){
+    uint8_t receive = 0;
+
+    bus->Soft_SDA_IN();
+    for (int i = 0; i < 8; i++) {
+        bus->Soft_IIC_SCL(0);
+        bus->delay_us(2);
+        bus->Soft_IIC_SCL(1);
+        receive <<= 1;
+        if (bus->Soft_READ_SDA())
+            receive++;
+        bus->delay_us(1);
+    }
+    if (ack)
+        Soft_IIC_Ack(bus);
+    else
+        Soft_IIC_NAck(bus);
+    return receive;
+}
+
+uint8_t Soft_IIC_Write_Len(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t len, uint8_t *buf){
+    Soft_IIC_Start(bus);
+    Soft_IIC_Send_Byte(bus, (uint8_t)(addr << 1));
+    if (Soft_IIC_Wait_Ack(bus)) {
+        Soft_IIC_Stop(bus);
+        return 1;
+    }
+    Soft_IIC_Send_Byte(bus, reg);
+    Soft_IIC_Wait_Ack(bus);
+    for (uint8_t i = 0; i < len; i++) {
+        Soft_IIC_Send_Byte(bus, buf[i]);
+        if (Soft_IIC_Wait_Ack(bus)) {
+            Soft_IIC_Stop(bus);
+            return 1;
+        }
+    }
+    Soft_IIC_Stop(bus);
+    return 0;
+}
+
+uint8_t Soft_IIC_Read_Len(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t len, uint8_t *buf){
+    Soft_IIC_Start(bus);
+    Soft_IIC_Send_Byte(bus, (uint8_t)(addr << 1));
+    if (Soft_IIC_Wait_Ack(bus)) {
+        Soft_IIC_Stop(bus);
+        return 1;
+    }
+    Soft_IIC_Send_Byte(bus, reg);
+    Soft_IIC_Wait_Ack(bus);
+    Soft_IIC_Start(bus);
+    Soft_IIC_Send_Byte(bus, (uint8_t)((addr << 1) | 1));
+    Soft_IIC_Wait_Ack(bus);
+    while (len) {
+        *buf++ = Soft_IIC_Receive_Byte(bus, len == 1 ? 0 : 1);
+        len--;
+    }
+    Soft_IIC_Stop(bus);
+    return 0;
+}
+
+uint8_t Soft_IIC_Write_Byte(SIAS *bus, uint8_t addr, uint8_t reg, uint8_t data){
+    return Soft_IIC_Write_Len(bus, addr, reg, 1, &data);
+}
+
+uint8_t Soft_IIC_Read_Byte(SIAS *bus, uint8_t addr, uint8_t reg){
+    uint8_t v = 0;
+    Soft_IIC_Read_Len(bus, addr, reg, 1, &v);
+    return v;
+}
+
+/*---------------------------------------------------------------------------*/
+/* 测试                                                                      */
+/*---------------------------------------------------------------------------*/
+
+static int bus_idle(void){
+    return mock_gpio_level(GPIOB, 8) && mock_gpio_level(GPIOB, 9);
+}
+
+static void test_init(void){
+    CHECK(I2C1_Init((dev_arg_t){.ptr = NULL}) == 0, "init");
+    CHECK(RCC->AHB1ENR & RCC_AHB1ENR_GPIOBEN, "GPIOB clock");
+    CHECK(((GPIOB->MODER >> 16) & 0xF) == 0x5, "PB8/PB9 output: moder %08x", GPIOB->MODER);
+    CHECK(((GPIOB->OTYPER >> 8) & 3) == 3, "open drain");
+    CHECK(((GPIOB->PUPDR >> 16) & 0xF) == 0x5, "pull-up");
+    CHECK(bus_idle(), "bus released after init");
+    CHECK(mock_gpio_contention(GPIOB) == 0, "contention");
+}
+
+static void test_read_whoami(void){
+    uint8_t id = 0;
+    uint32_t starts = mpu.starts, stops = mpu.stops, acks = mpu.addr_acks, naks = mpu.master_naks;
+
+    mock_count_clear();
+    uint64_t t0 = mock_now();
+    CHECK(Soft_IIC_Read_Len(&i2c1_bus, 0x68, 0x75, 1, &id) == 0, "read");
+    uint64_t t = mock_now() - t0;
+    CHECK(id == 0x68, "WHO_AM_I %02x", id);
+    CHECK(mpu.starts - starts == 2 && mpu.stops - stops == 1, "start %u stop %u", mpu.starts - starts,
+          mpu.stops - stops);
+    CHECK(mpu.addr_acks - acks == 2 && mpu.master_naks - naks == 1, "addr acks %u, final nack %u",
+          mpu.addr_acks - acks, mpu.master_naks - naks);
+    CHECK(bus_idle(), "bus released");
+
+    // 三次应答各读一次IDR (从机立即应答), 加8个数据位
+    CHECK(mock_reads(&GPIOB->IDR) == 11, "IDR reads %u", mock_reads(&GPIOB->IDR));
+    if (verbose)
+        printf("Soft_IIC_Read_Len 1 byte: %.1f us, %llu register accesses (BSRR %u, MODER %u, IDR %u)\n",
+               (double)t / US(1), (unsigned long long)mock_accesses(), mock_writes(&GPIOB->BSRRL),
+               mock_writes(&GPIOB->MODER), mock_reads(&GPIOB->IDR));
+}
+
+static void test_write_read_burst(void){
+    uint8_t w[6] = {0x12, 0x34, 0xAB, 0xCD, 0x00, 0xFF}, r[6] = {0};
+
+    CHECK(Soft_IIC_Write_Byte(&i2c1_bus, 0x68, 0x6B, 0x00) == 0, "wake");
+    CHECK(mpu.regs[0x6B] == 0x00, "PWR_MGMT_1 %02x", mpu.regs[0x6B]);
+
+    uint32_t wr = mpu.bytes_written, rd = mpu.bytes_read;
+    CHECK(Soft_IIC_Write_Len(&i2c1_bus, 0x68, 0x3B, 6, w) == 0, "burst write");
+    CHECK(memcmp(&mpu.regs[0x3B], w, 6) == 0, "auto-increment write");
+    CHECK(mpu.bytes_written - wr == 6, "written %u", mpu.bytes_written - wr);
+
+    CHECK(Soft_IIC_Read_Len(&i2c1_bus, 0x68, 0x3B, 6, r) == 0, "burst read");
+    CHECK(memcmp(r, w, 6) == 0, "read back %02x %02x %02x %02x %02x %02x", r[0], r[1], r[2], r[3], r[4], r[5]);
+    CHECK(mpu.bytes_read - rd == 6, "read %u", mpu.bytes_read - rd);
+    CHECK(bus_idle(), "bus released");
+}
+
+static void test_nak(void){
+    uint8_t v = 0x55;
+    uint32_t naks = mpu.addr_naks, stops = mpu.stops;
+
+    CHECK(Soft_IIC_Read_Len(&i2c1_bus, 0x69, 0x75, 1, &v) == 1, "absent device must fail");
+    CHECK(v == 0x55, "buffer touched");
+    CHECK(mpu.addr_naks - naks == 1, "addr naks %u", mpu.addr_naks - naks);
+    CHECK(mpu.stops - stops >= 1, "no stop after nak");
+    CHECK(bus_idle(), "bus released after nak");
+
+    // 之后的事务不受影响
+    CHECK(Soft_IIC_Read_Byte(&i2c1_bus, 0x68, 0x75) == 0x68, "recovered");
+}
+
+static void test_timing(void){
+    // 快速模式 (400kHz) 下限 tHIGH >= 0.6us; tLOW的最小值出现在应答后紧接重复START处,
+    // 由框架的Soft_IIC_Start决定 (先拉高SCL再延时), 只打印不检查
+    CHECK(mpu.scl_high_min >= US(6) / 10, "SCL high %llu cycles", (unsigned long long)mpu.scl_high_min);
+    CHECK(mock_gpio_contention(GPIOB) == 0, "push-pull against the slave");
+    if (verbose)
+        printf("SCL high min %.2f us, low min %.2f us\n", (double)mpu.scl_high_min / US(1),
+               (double)mpu.scl_low_min / US(1));
+}
+
+int main(int argc, char **argv){
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    mock_init();
+    mock_i2c_attach(&mpu, GPIOB, 8, 9, 0x68);
+    mpu.regs[0x75] = 0x68;
+    mpu.regs[0x6B] = 0x40;
+
+    test_init();
+    test_read_whoami();
+    test_write_read_burst();
+    test_nak();
+    test_timing();
+    return check_done("test_i2c_bus");
+}
@@ -0,0 +1,103 @@
+// app/link.c 主机测试: 协商状态机的验证阶段
+// 切换后PING往返够数且没有出错才确认COMMIT; 验证中出现CRC/接收错误时拒绝确认,
+// 错误超过LINK_ERR_MAX次立即回退, 不等LINK_VERIFY_MS; 验证期间一秒窗口不清零错误
+//
+// 编译: cc -std=gnu99 -Wall -Imock -I../app -o test_link test_link.c ../app/link.c
+// 用法: test_link [-v], 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "check.h"
+#include "link.h"
+
+#define FAST_BAUD 3000000
+
+static const uint32_t rates[] = {FAST_BAUD, 1000000};
+
+// 主机发一帧; bad时破坏CRC
+static void host_send(link_t *l, uint8_t type, uint32_t v, int bad, uint32_t now){
+    uint8_t p[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    uint8_t f[8];
+    uint32_t n = link_frame(f, type, p, 4);
+    if (bad)
+        f[n - 1] ^= 0x5A;
+    link_input(l, f, n, now);
+}
+
+// 取走飞控的应答, 返回最后一帧的类型
+static uint8_t host_recv(link_t *l){
+    uint8_t buf[64];
+    uint32_t n = link_take_tx(l, buf, sizeof(buf));
+    uint8_t type = 0;
+    for (uint32_t i = 0; i + 3 < n; i += buf[i + 1] + 2)
+        type = buf[i + 2];
+    return type;
+}
+
+// 从安全速率切换到FAST_BAUD, 进入VERIFY并完成PING往返
+static void to_verify(link_t *l, uint32_t now){
+    link_init(l, rates, 2, now);
+    host_send(l, LINK_SWITCH, FAST_BAUD, 0, now);
+    host_recv(l);
+    link_baud_done(l, now);
+    for (uint32_t i = 0; i < LINK_PING_NUM; i++)
+        host_send(l, LINK_PING, i, 0, now);
+    host_recv(l);
+}
+
+int main(int argc, char **argv){
+    link_t l;
+    uint32_t now = 5000;
+    int verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+
+    // 干净的线路: 确认
+    to_verify(&l, now);
+    CHECK(l.state == LINK_VERIFY && l.baud == FAST_BAUD, "state %s baud %u", link_state_name(l.state), l.baud);
+    host_send(&l, LINK_COMMIT, FAST_BAUD, 0, now);
+    CHECK(l.state == LINK_FAST && host_recv(&l) == LINK_COMMIT_ACK, "clean commit: %s", link_state_name(l.state));
+
+    // 一个CRC错误: PING够数也不确认, 超时回退
+    to_verify(&l, now);
+    host_send(&l, LINK_PING, 99, 1, now);
+    CHECK(l.win_errors == 1, "crc error not counted");
+    host_send(&l, LINK_COMMIT, FAST_BAUD, 0, now + 10);
+    CHECK(l.state == LINK_VERIFY && host_recv(&l) != LINK_COMMIT_ACK, "committed after crc error");
+    // 验证期间跨过一秒窗口, 错误不清零
+    l.t_win = now - 2000;
+    link_tick(&l, now + 20);
+    CHECK(l.win_errors == 1, "verify errors cleared by window");
+    host_send(&l, LINK_COMMIT, FAST_BAUD, 0, now + 30);
+    CHECK(l.state == LINK_VERIFY, "committed after window");
+    link_tick(&l, now + LINK_VERIFY_MS + 1);
+    CHECK(l.state == LINK_SWITCHING && l.pending == LINK_SAFE_BAUD, "no fallback after verify timeout");
+
+    // 接收错误同样拒绝确认
+    to_verify(&l, now);
+    link_rx_error(&l, 1);
+    host_send(&l, LINK_COMMIT, FAST_BAUD, 0, now);
+    CHECK(l.state == LINK_VERIFY, "committed after uart error");
+
+    // 错误超过LINK_ERR_MAX次立即回退
+    to_verify(&l, now);
+    for (uint32_t i = 0; i <= LINK_ERR_MAX; i++)
+        host_send(&l, LINK_PING, i, 1, now);
+    link_tick(&l, now + 1);
+    CHECK(l.state == LINK_SWITCHING && l.pending == LINK_SAFE_BAUD && l.fallbacks == 1, "verify errors: %s",
+          link_state_name(l.state));
+
+    // 回到安全速率后再次切换, 错误计数从零开始
+    link_baud_done(&l, now + 2);
+    CHECK(l.state == LINK_SAFE && l.win_errors == 0, "back to safe: %s", link_state_name(l.state));
+    host_send(&l, LINK_SWITCH, FAST_BAUD, 0, now + 3);
+    host_recv(&l);
+    link_baud_done(&l, now + 3);
+    for (uint32_t i = 0; i < LINK_PING_NUM; i++)
+        host_send(&l, LINK_PING, i, 0, now + 4);
+    host_send(&l, LINK_COMMIT, FAST_BAUD, 0, now + 5);
+    CHECK(l.state == LINK_FAST, "second switch: %s", link_state_name(l.state));
+
+    if (verbose)
+        printf("rx %u frames, %u crc errors, %u fallbacks\n", l.rx_frames, l.crc_errors, l.fallbacks);
+    return check_done("test_link");
+}
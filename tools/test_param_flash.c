@@ -0,0 +1,245 @@
+// bsp/param.c + bsp/flash.c 掉电测试: 参数保存过程中的每一次编程和擦除之前断电
+// 断电点逐个尝试, 每个点再分两种: 这一步没有发生, 和这一步只做了一半
+// (字只写了低16位, 扇区只擦了奇数字). 重新上电后载入的必须正好是旧参数或新参数,
+// 之后的一次完整保存必须成功.
+//
+// Flash内容在模拟器的共享映射里, 每次上电都在fork出的子进程中进行, RAM从零开始,
+// 断电即子进程_exit, 父进程只保存和恢复Flash快照
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -I../app -Wl,-T,mock/host.ld
+//          -o test_param_flash test_param_flash.c ../bsp/param.c ../bsp/flash.c mock/mock.c
+// 用法: test_param_flash [-v], 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+
+#define SAVES    5   // 连续保存次数
+#define CUT_MAX  200 // 一次保存中断电点的上限
+#define AREA     ((uintptr_t)0x08008000) // 扇区2/3
+#define AREA_LEN 0x8000
+
+// 参数表: 全部U32, 默认值为ID
+_Static_assert(PARAM_ID_END == 33, "test param table must cover PARAM_ID_BASE..PARAM_ID_END");
+#define P(n) PARAM_U32(n, p##n, 0, 0xFFFFFFFF, n)
+P(10); P(11); P(12); P(13); P(14); P(15); P(16); P(17); P(18); P(19); P(20); P(21);
+P(22); P(23); P(24); P(25); P(26); P(27); P(28); P(29); P(30); P(31); P(32);
+
+enum { RUN_DONE = 0, RUN_CUT = 3, RUN_BUSY = 4 };
+enum { LOAD_OLD = 0, LOAD_NEW = 1, LOAD_BAD = 2 };
+
+static int verbose;
+static uint8_t armed;
+static uint32_t area_snap[AREA_LEN / 4];
+static param_value_t sets[SAVES + 1][PARAM_NUM];
+
+static struct {
+    int at;   // 第几次操作之前断电, -1不断电
+    int torn; // 这一步做一半
+    int n;
+} cut;
+
+uint8_t pwm_armed(void){
+    return armed;
+}
+
+int dlog_write(uint32_t id, uint32_t nargs, const uint32_t *args){
+    (void)id;
+    (void)nargs;
+    (void)args;
+    return 0;
+}
+
+static void on_op(int erase, uintptr_t addr, uint32_t value, void *ctx){
+    (void)ctx;
+    if (cut.n++ != cut.at)
+        return;
+    if (cut.torn && erase) {
+        // 参数扇区为16KB
+        for (uintptr_t a = addr + 4; a < addr + 0x4000; a += 8)
+            mock_poke((void *)a, 0xFFFFFFFF);
+    } else if (cut.torn) {
+        mock_poke((void *)addr, mock_peek((void *)addr) & (value | 0xFFFF0000));
+    }
+    _exit(RUN_CUT);
+}
+
+static void area_save(void){
+    for (uint32_t i = 0; i < AREA_LEN / 4; i++)
+        area_snap[i] = mock_peek((void *)(AREA + i * 4));
+}
+
+static void area_restore(void){
+    for (uint32_t i = 0; i < AREA_LEN / 4; i++)
+        mock_poke((void *)(AREA + i * 4), area_snap[i]);
+}
+
+// 上电: 载入参数并完成启动时的预擦除
+static void boot(void){
+    mock_reset();
+    mock_flash_on_op(on_op, NULL);
+    param_init((dev_arg_t){0});
+    while (param_poll())
+        flash_poll();
+}
+
+static int child_wait(pid_t pid){
+    int st;
+    if (pid < 0 || waitpid(pid, &st, 0) != pid || !WIFEXITED(st))
+        return -1;
+    return WEXITSTATUS(st);
+}
+
+// 上电后保存set, 在第at次Flash操作之前断电
+static int run_save(const param_value_t *set, int at, int torn){
+    pid_t pid = fork();
+    if (pid == 0) {
+        cut.at = at;
+        cut.torn = torn;
+        boot();
+        memcpy(param_shadow, set, sizeof(param_shadow));
+        if (param_save() != 0)
+            _exit(RUN_BUSY);
+        while (param_poll())
+            flash_poll();
+        _exit(RUN_DONE);
+    }
+    return child_wait(pid);
+}
+
+// 上电, 载入的参数与old/new比较
+static int run_load(const param_value_t *old, const param_value_t *new){
+    pid_t pid = fork();
+    if (pid == 0) {
+        cut.at = -1;
+        boot();
+        if (!memcmp(param_shadow, old, sizeof(param_shadow)))
+            _exit(LOAD_OLD);
+        _exit(memcmp(param_shadow, new, sizeof(param_shadow)) ? LOAD_BAD : LOAD_NEW);
+    }
+    return child_wait(pid);
+}
+
+static void test_crc(void){
+    // 与STM32硬件CRC一致: 初值0xFFFFFFFF, 输入0得0xC704DD7B
+    static const uint32_t zero = 0, seq[2] = {0x12345678, 0x9ABCDEF0};
+    CHECK(flash_crc32(&zero, 1) == 0xC704DD7B, "%08x", flash_crc32(&zero, 1));
+    CHECK(flash_crc32(seq, 2) != flash_crc32(seq, 1), "crc does not chain");
+}
+
+static void test_flash_model(void){
+    volatile uint32_t *w = (volatile uint32_t *)flash_sector_addr(3);
+
+    // 未解锁或未置PG时写入无效
+    *w = 0;
+    CHECK(*w == 0xFFFFFFFF && (FLASH->SR & FLASH_SR_PGSERR), "write without PG");
+    FLASH->SR = FLASH_SR_PGSERR;
+
+    uint32_t data[2] = {0x12345678, 0xFFFF0000};
+    CHECK(flash_program_start((uintptr_t)w, data, 2, FLASH_OWNER_PARAM) == 0, "program start");
+    while (flash_poll())
+        ;
+    CHECK(flash_status(FLASH_OWNER_PARAM) == 0 && w[0] == data[0] && w[1] == data[1], "%08x %08x", w[0], w[1]);
+    CHECK(FLASH->CR & FLASH_CR_LOCK, "left unlocked");
+
+    // 编程只能把1变成0
+    data[0] = 0xFFFFFFFF;
+    flash_program_start((uintptr_t)w, data, 1, FLASH_OWNER_PARAM);
+    while (flash_poll())
+        ;
+    CHECK(w[0] == 0x12345678, "%08x", w[0]);
+
+    CHECK(flash_erase_start(3, FLASH_OWNER_PARAM) == 0, "erase start");
+    while (flash_poll())
+        ;
+    CHECK(flash_is_blank((uintptr_t)w, flash_sector_size(3) / 4), "sector 3 not erased");
+    CHECK(mock_flash_erases() == 1 && mock_flash_programs() == 3, "erases %u programs %u", mock_flash_erases(),
+          mock_flash_programs());
+}
+
+// 解锁时挂起的参数任务不能挡住飞行记录器的编程
+static void test_flash_owners(void){
+    static const uint32_t log[4] = {1, 2, 3, 4};
+    volatile uint32_t *w = (volatile uint32_t *)flash_sector_addr(3);
+    int polls = 0;
+
+    armed = 1;
+    CHECK(flash_erase_start(4, FLASH_OWNER_PARAM) == 0, "param erase start");
+    CHECK(flash_erase_start(4, FLASH_OWNER_PARAM) != 0, "second param job accepted");
+    CHECK(flash_program_start((uintptr_t)w, log, 4, FLASH_OWNER_BLACKBOX) == 0,
+          "blackbox rejected while param pending");
+    while (flash_status(FLASH_OWNER_BLACKBOX) == 1 && polls++ < 100)
+        flash_poll();
+    CHECK(flash_status(FLASH_OWNER_BLACKBOX) == 0 && w[0] == 1 && w[3] == 4, "blackbox not programmed while armed");
+    CHECK(flash_status(FLASH_OWNER_PARAM) == 1 && mock_flash_erases() == 1, "erase ran while armed");
+    CHECK(flash_poll() == 1, "deferred job not reported");
+
+    armed = 0;
+    while (flash_poll())
+        ;
+    CHECK(flash_status(FLASH_OWNER_PARAM) == 0 && mock_flash_erases() == 2, "param erase after disarm");
+}
+
+// 每次保存的每个断电点: 上电后只能是旧参数或新参数, 随后的完整保存必须生效
+static void test_power_cut(void){
+    int points = 0;
+
+    for (uint32_t i = 0; i < PARAM_NUM; i++)
+        sets[0][i].u = PARAM_ID_BASE + i;
+    for (int k = 1; k <= SAVES; k++)
+        for (uint32_t i = 0; i < PARAM_NUM; i++)
+            sets[k][i].u = k * 1000 + i;
+
+    mock_flash_wipe();
+    CHECK(run_load(sets[0], sets[0]) == LOAD_OLD, "blank flash must load defaults");
+
+    for (int k = 1; k <= SAVES; k++) {
+        int ops = -1;
+        area_save();
+        for (int at = 0; at < CUT_MAX && ops < 0; at++) {
+            for (int torn = 0; torn < 2; torn++) {
+                area_restore();
+                int r = run_save(sets[k], at, torn);
+                if (r == RUN_DONE) {
+                    ops = at;
+                    break;
+                }
+                CHECK(r == RUN_CUT, "save %d cut %d: exit %d", k, at, r);
+                points++;
+
+                r = run_load(sets[k - 1], sets[k]);
+                CHECK(r == LOAD_OLD || r == LOAD_NEW, "save %d cut %d%s: load %d", k, at, torn ? " torn" : "", r);
+                // 断电后的下一次保存
+                CHECK(run_save(sets[k], -1, 0) == RUN_DONE, "save %d cut %d: resave", k, at);
+                CHECK(run_load(sets[k], sets[k]) == LOAD_OLD, "save %d cut %d%s: resave not loaded", k, at,
+                      torn ? " torn" : "");
+            }
+        }
+        CHECK(ops > 0, "save %d never completed", k);
+        if (verbose)
+            printf("save %d: %d flash operations\n", k, ops);
+
+        // 完整保存作为下一轮的起点
+        area_restore();
+        CHECK(run_save(sets[k], -1, 0) == RUN_DONE, "save %d", k);
+        CHECK(run_load(sets[k], sets[k]) == LOAD_OLD, "save %d not loaded", k);
+    }
+    if (verbose)
+        printf("%d power cut points\n", points);
+}
+
+int main(int argc, char **argv){
+    verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+    setvbuf(stdout, NULL, _IONBF, 0);
+    mock_init();
+    test_crc();
+    test_flash_model();
+    test_flash_owners();
+    test_power_cut();
+    return check_done("test_param_flash");
+}
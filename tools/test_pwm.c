@@ -0,0 +1,281 @@
+// bsp/pwm.c 主机测试: 驱动不经修改运行在寄存器模拟上 (tools/mock)
+// 检查时基与引脚配置、主从同相、各频率下主从周期相等、pwm_set_all四路同一个更新事件生效 (在更新事件前后
+// 逐周期扫描调用时刻, TIM1停止时不等待)、改频率时占空比按新分辨率缩放、单脉冲协议, 并统计每个API的寄存器访问次数
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -o test_pwm test_pwm.c ../bsp/pwm.c ../bsp/tim.c mock/mock.c
+// 用法: test_pwm [-v], -v 打印寄存器访问统计和频率分辨率表; 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+
+param_value_t param_shadow[PARAM_NUM];
+
+static int verbose;
+
+// 四路输出当前生效的比较值 (PE13 PD14 PB7 PE6)
+static void ccr_now(uint32_t c[4]){
+    c[0] = mock_tim_ccr(TIM1, 3);
+    c[1] = mock_tim_ccr(TIM4, 3);
+    c[2] = mock_tim_ccr(TIM4, 2);
+    c[3] = mock_tim_ccr(TIM9, 2);
+}
+
+// 逻辑占空比在各定时器上的比较值
+static void ccr_want(uint16_t duty, uint32_t c[4]){
+    c[0] = (uint32_t)duty * pwm_get_resolution(TIM1) / PWM_MAX_DUTY;
+    c[1] = c[2] = (uint32_t)duty * pwm_get_resolution(TIM4) / PWM_MAX_DUTY;
+    c[3] = (uint32_t)duty * pwm_get_resolution(TIM9) / PWM_MAX_DUTY;
+}
+
+static int ccr_is(uint16_t duty){
+    uint32_t now[4], want[4];
+    ccr_now(now);
+    ccr_want(duty, want);
+    return memcmp(now, want, sizeof(now)) == 0;
+}
+
+// 推进到下一个TIM1更新事件之后的半个周期
+static void next_mid_period(void){
+    uint64_t p = mock_tim_period(TIM1);
+    uint64_t t = mock_tim_last_update(TIM1) + p + p / 2;
+    while (t <= mock_now())
+        t += p;
+    mock_advance(t - mock_now());
+}
+
+static void setup(uint32_t freq){
+    mock_reset();
+    param_shadow[PARAM_PWM_FREQ - PARAM_ID_BASE].u = freq;
+    param_shadow[PARAM_PWM_MAX - PARAM_ID_BASE].u = PWM_MAX_DUTY;
+    if (pwm_get_protocol() != PWM_PROTO_PWM)
+        pwm_set_protocol(PWM_PROTO_PWM);
+    pwm_init((dev_arg_t){.ptr = NULL});
+}
+
+static void test_init(void){
+    mock_count_clear();
+    setup(5000);
+    if (verbose)
+        printf("pwm_init: %llu register accesses\n", (unsigned long long)mock_accesses());
+
+    CHECK(TIM1->PSC == 0 && TIM1->ARR == 33599, "TIM1 %u/%u", TIM1->PSC, TIM1->ARR);
+    CHECK(TIM9->PSC == 0 && TIM9->ARR == 33599, "TIM9 %u/%u", TIM9->PSC, TIM9->ARR);
+    CHECK(TIM4->PSC == 0 && TIM4->ARR == 16799, "TIM4 %u/%u", TIM4->PSC, TIM4->ARR);
+    CHECK(pwm_get_resolution(TIM1) == 33600 && pwm_get_resolution(TIM4) == 16800, "resolution");
+    CHECK(pwm_get_freq(TIM4) == 5000 && pwm_get_freq(TIM2) == 0, "freq");
+    for (int i = 0; i < 4; i++) {
+        static TIM_TypeDef *const t[4] = {TIM1, TIM4, TIM9, TIM3};
+        CHECK(mock_tim_period(t[i]) == SystemCoreClock / 5000, "tim %d period %llu", i,
+              (unsigned long long)mock_tim_period(t[i]));
+    }
+
+    // 引脚: 复用功能和AF编号
+    CHECK(((GPIOE->MODER >> 26) & 3) == 2 && ((GPIOE->AFR[1] >> 20) & 0xF) == 1, "PE13");
+    CHECK(((GPIOD->MODER >> 28) & 3) == 2 && ((GPIOD->AFR[1] >> 24) & 0xF) == 2, "PD14");
+    CHECK(((GPIOB->MODER >> 14) & 3) == 2 && ((GPIOB->AFR[0] >> 28) & 0xF) == 2, "PB7");
+    CHECK(((GPIOE->MODER >> 12) & 3) == 2 && ((GPIOE->AFR[0] >> 24) & 0xF) == 3, "PE6");
+    CHECK(TIM1->BDTR & TIM_BDTR_MOE, "TIM1 MOE");
+
+    // 主从链
+    CHECK(pwm_sync_state() == 1, "sync default");
+    CHECK((TIM1->CR2 & TIM_CR2_MMS) == 0x20, "TIM1 MMS %x", TIM1->CR2);
+    CHECK((TIM4->SMCR & 0x77) == 0x04 && (TIM3->SMCR & 0x77) == 0x04 && (TIM9->SMCR & 0x77) == 0x14,
+          "SMCR %x %x %x", TIM4->SMCR, TIM3->SMCR, TIM9->SMCR);
+
+    // 运行若干周期后各定时器在同一时刻更新
+    mock_advance(mock_tim_period(TIM1) * 7 + 123);
+    uint64_t t1 = mock_tim_last_update(TIM1);
+    CHECK(mock_tim_last_update(TIM4) == t1 && mock_tim_last_update(TIM3) == t1 && mock_tim_last_update(TIM9) == t1,
+          "phase %llu %llu %llu %llu", (unsigned long long)t1, (unsigned long long)mock_tim_last_update(TIM4),
+          (unsigned long long)mock_tim_last_update(TIM3), (unsigned long long)mock_tim_last_update(TIM9));
+}
+
+// 在TIM1更新事件前后逐个周期位置调用pwm_set_all, 下一个周期里四路必须全是旧值或全是新值
+static void test_set_all_atomic(void){
+    uint16_t duty = 1000;
+    uint32_t mixed = 0, late = 0;
+
+    setup(5000);
+    pwm_set_all(duty, duty, duty, duty);
+    next_mid_period();
+    CHECK(ccr_is(duty), "initial duty");
+
+    for (int32_t off = -400; off <= 40; off++) {
+        uint64_t p = mock_tim_period(TIM1);
+        uint64_t edge = mock_tim_last_update(TIM1) + p;
+        mock_advance(edge + off - mock_now() + p);  // 下一个周期的同一位置
+        uint16_t old = duty;
+        duty = (uint16_t)(duty == 1000 ? 7000 : 1000);
+        pwm_set_all(duty, duty, duty, duty);
+        next_mid_period();
+        if (!ccr_is(old) && !ccr_is(duty))
+            mixed++;
+        next_mid_period();
+        if (!ccr_is(duty))
+            late++;
+    }
+    CHECK(mixed == 0, "%u periods with mixed old/new duties", mixed);
+    CHECK(late == 0, "%u updates not applied one period later", late);
+
+    mock_count_clear();
+    pwm_set_all(10, 20, 30, 40);
+    if (verbose)
+        printf("pwm_set_all (sync): %llu register accesses\n", (unsigned long long)mock_accesses());
+    CHECK(mock_writes(&TIM1->CCR3) == 1 && mock_writes(&TIM4->CCR2) == 1, "one write per CCR");
+
+    pwm_sync_enable(0);
+    mock_count_clear();
+    pwm_set_all(10, 20, 30, 40);
+    if (verbose)
+        printf("pwm_set_all (free): %llu register accesses\n", (unsigned long long)mock_accesses());
+    CHECK(mock_accesses() == 4, "free-running set_all touches only the CCRs: %llu",
+          (unsigned long long)mock_accesses());
+}
+
+// TIM1停在溢出前的保护窗口内时pwm_set_all不能等一个不会到来的溢出
+static void test_set_all_stopped(void){
+    setup(5000);
+    uint64_t p = mock_tim_period(TIM1);
+    mock_advance(mock_tim_last_update(TIM1) + 2 * p - 2 - mock_now());
+    pwm_stop();
+    uint64_t t0 = mock_now();
+    pwm_set_all(3000, 3000, 3000, 3000);
+    CHECK(mock_now() - t0 < p, "set_all on stopped TIM1 waited %llu cycles", (unsigned long long)(mock_now() - t0));
+    CHECK(!(TIM1->CR1 & TIM_CR1_UDIS) && !(TIM4->CR1 & TIM_CR1_UDIS) && !(TIM9->CR1 & TIM_CR1_UDIS),
+          "UDIS left set");
+}
+
+static void test_limits(void){
+    setup(5000);
+    param_shadow[PARAM_PWM_MAX - PARAM_ID_BASE].u = 6000;
+    pwm_set_duty_pe13(8000);
+    next_mid_period();
+    CHECK(mock_tim_ccr(TIM1, 3) == 6000u * 33600 / 8000, "pwm_max clamp %u", mock_tim_ccr(TIM1, 3));
+    CHECK(pwm_armed(), "armed");
+    pwm_set_all(0, 0, 0, 0);
+    CHECK(!pwm_armed(), "disarmed");
+
+    // 改频率: 逻辑占空比不变, 比较值按新分辨率缩放, 与PSC/ARR同一个更新事件生效
+    param_shadow[PARAM_PWM_MAX - PARAM_ID_BASE].u = PWM_MAX_DUTY;
+    pwm_set_all(4000, 4000, 4000, 4000);
+    next_mid_period();
+    CHECK(pwm_set_freq(NULL, 8000) == 0, "set 8 kHz");
+    next_mid_period();
+    CHECK(pwm_get_resolution(TIM1) == 21000 && mock_tim_arr(TIM1) == 20999, "TIM1 arr %u", mock_tim_arr(TIM1));
+    CHECK(ccr_is(4000), "duty rescaled: %u", mock_tim_ccr(TIM1, 3));
+    CHECK(pwm_set_freq(NULL, 0) == -1 && pwm_set_freq(NULL, PWM_FREQ_MAX + 1) == -1, "range");
+    CHECK(pwm_set_freq(TIM3, 1000) == -1, "TIM3 is the relay");
+
+    // 单独改一个定时器会关闭同步
+    CHECK(pwm_set_freq(TIM9, 1000) == 0 && pwm_sync_state() == 0, "per-timer freq drops sync");
+    next_mid_period();
+    CHECK(mock_tim_period(TIM9) == SystemCoreClock / 1000, "TIM9 period %llu",
+          (unsigned long long)mock_tim_period(TIM9));
+}
+
+// 频率与分辨率对照: 同步模式下从定时器的周期必须与TIM1在时间上完全相等,
+// 否则每隔几个周期从定时器会在TIM1复位它之前自己多溢出一次
+static void test_freq_table(void){
+    static const struct {
+        uint32_t freq, tim1, tim4; // 期望的计数周期
+    } tab[] = {
+        {50, 64615, 64615}, {400, 60000, 52500}, {1000, 56000, 42000}, {5000, 33600, 16800},
+        {8000, 21000, 10500}, {16000, 10500, 5250}, {31000, 5418, 2709}, {32000, 5250, 2625},
+    };
+
+    setup(5000);
+    if (verbose)
+        printf("freq     TIM1 psc/period   TIM4 psc/period   TIM9 psc/period\n");
+    for (uint32_t i = 0; i < sizeof(tab) / sizeof(tab[0]); i++) {
+        uint32_t f = tab[i].freq;
+        CHECK(pwm_set_freq(NULL, f) == 0, "%u Hz", f);
+        // 调用落在溢出前的保护窗口时推迟一个周期生效
+        next_mid_period();
+        next_mid_period();
+        if (verbose)
+            printf("%-8u %5u / %-10u %5u / %-10u %5u / %u\n", f, mock_tim_psc(TIM1), pwm_get_resolution(TIM1),
+                   mock_tim_psc(TIM4), pwm_get_resolution(TIM4), mock_tim_psc(TIM9), pwm_get_resolution(TIM9));
+        CHECK(pwm_get_resolution(TIM1) == tab[i].tim1 && pwm_get_resolution(TIM4) == tab[i].tim4,
+              "%u Hz: TIM1 %u TIM4 %u", f, pwm_get_resolution(TIM1), pwm_get_resolution(TIM4));
+
+        uint64_t p = mock_tim_period(TIM1);
+        CHECK(mock_tim_period(TIM4) == p && mock_tim_period(TIM3) == p && mock_tim_period(TIM9) == p,
+              "%u Hz periods %llu %llu %llu %llu", f, (unsigned long long)p,
+              (unsigned long long)mock_tim_period(TIM4), (unsigned long long)mock_tim_period(TIM3),
+              (unsigned long long)mock_tim_period(TIM9));
+
+        // 主从更新次数相同, 且每次都在同一时刻
+        uint32_t u1 = mock_tim_updates(TIM1), u4 = mock_tim_updates(TIM4), u3 = mock_tim_updates(TIM3);
+        mock_advance(p * 40);
+        CHECK(mock_tim_updates(TIM4) - u4 == mock_tim_updates(TIM1) - u1 &&
+              mock_tim_updates(TIM3) - u3 == mock_tim_updates(TIM1) - u1,
+              "%u Hz updates TIM1 %u TIM4 %u TIM3 %u", f, mock_tim_updates(TIM1) - u1,
+              mock_tim_updates(TIM4) - u4, mock_tim_updates(TIM3) - u3);
+        CHECK(mock_tim_last_update(TIM4) == mock_tim_last_update(TIM1), "%u Hz phase", f);
+    }
+
+    // 单独改过的定时器重新开启同步时, 时基由TIM1重新推出
+    CHECK(pwm_set_freq(TIM4, 1000) == 0 && pwm_sync_state() == 0, "TIM4 alone");
+    CHECK(pwm_sync_enable(1) == 0 && pwm_sync_state() == 1, "sync on");
+    next_mid_period();
+    CHECK(pwm_get_freq(TIM4) == 32000 && pwm_get_resolution(TIM4) == 2625, "TIM4 re-derived %u", pwm_get_resolution(TIM4));
+    uint32_t u1 = mock_tim_updates(TIM1), u4 = mock_tim_updates(TIM4);
+    mock_advance(mock_tim_period(TIM1) * 40);
+    CHECK(mock_tim_updates(TIM4) - u4 == mock_tim_updates(TIM1) - u1, "updates after re-sync");
+
+    CHECK(pwm_set_protocol(PWM_PROTO_ONESHOT125) == 0, "oneshot125");
+    CHECK(pwm_sync_enable(1) == -1, "sync rejected in one-shot");
+    pwm_set_protocol(PWM_PROTO_PWM);
+}
+
+static void test_oneshot(void){
+    setup(5000);
+    CHECK(pwm_set_protocol(PWM_PROTO_ONESHOT125) == 0, "oneshot125");
+    CHECK(pwm_set_freq(NULL, 1000) == -1, "no freq change in one-shot");
+    CHECK(TIM1->CR1 & TIM_CR1_OPM, "OPM");
+    // 切换时输出一个零油门脉冲 (125us), 之后计数器停下
+    mock_advance(SystemCoreClock / 1000000 * 260);
+    CHECK(!(TIM1->CR1 & TIM_CR1_CEN), "idle after the zero-throttle pulse");
+
+    // 占空比一半: 125 + 62.5 = 187.5us, 宽度 = ARR - CCR + 1
+    pwm_set_all(4000, 4000, 4000, 4000);
+    CHECK((TIM1->CR1 & TIM_CR1_CEN) && (TIM4->CR1 & TIM_CR1_CEN) && (TIM9->CR1 & TIM_CR1_CEN), "fired");
+    uint32_t width = mock_tim_arr(TIM1) - mock_tim_ccr(TIM1, 3) + 1;
+    CHECK(width == 7875, "width %u ticks", width);
+    CHECK(mock_tim_arr(TIM4) - mock_tim_ccr(TIM4, 3) + 1 == width, "TIM4 width");
+
+    // 脉冲结束后计数器自己停下, 每次调用只发一个脉冲
+    uint32_t upd = mock_tim_updates(TIM1);
+    mock_advance(SystemCoreClock / 1000000 * 260);
+    CHECK(!(TIM1->CR1 & TIM_CR1_CEN) && !(TIM4->CR1 & TIM_CR1_CEN) && !(TIM9->CR1 & TIM_CR1_CEN), "stopped");
+    CHECK(mock_tim_updates(TIM1) - upd == 1, "pulses %u", mock_tim_updates(TIM1) - upd);
+    mock_advance(SystemCoreClock / 1000);
+    CHECK(mock_tim_updates(TIM1) - upd == 1, "re-fired on its own");
+
+    // 上一个脉冲未结束时不重复触发
+    pwm_set_all(8000, 8000, 8000, 8000);
+    mock_count_clear();
+    pwm_set_all(0, 0, 0, 0);
+    CHECK(mock_writes(&TIM1->CR1) == 0, "fired during a pulse");
+
+    CHECK(pwm_set_protocol(PWM_PROTO_PWM) == 0, "back to pwm");
+    CHECK(pwm_sync_state() == 1 && (TIM1->CR1 & TIM_CR1_CEN) && !(TIM1->CR1 & TIM_CR1_OPM), "pwm restored");
+    next_mid_period();
+    CHECK(mock_tim_period(TIM1) == SystemCoreClock / 5000, "5 kHz restored");
+}
+
+int main(int argc, char **argv){
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    mock_init();
+    test_init();
+    test_set_all_atomic();
+    test_set_all_stopped();
+    test_limits();
+    test_freq_table();
+    test_oneshot();
+    return check_done("test_pwm");
+}
@@ -0,0 +1,294 @@
+// bsp/rc_parse.c 主机测试: 按段回放录制的SBUS/CRSF字节流, 每段之后线路空闲 (rc_parser_idle),
+// 逐段核对解析出的帧数、CRC/结束字节错误、同步错误和最后一帧的内容.
+// 覆盖: 杂散字节后的重新同步, CRC错误, 结束字节错误, 帧被空闲截断, 无空闲的连续帧,
+// 错位一个字节后到空闲为止的恢复, SBUS标志和SBUS2结束字节, CRSF链路统计的LQ.
+// PPM/PWM按录制的边沿时间戳 (us) 解码: 同步间隔, 通道数, 脉宽越界, 计数器回绕,
+// PWM由电平配对边沿 (低电平间隔同样落在脉宽范围内)
+//
+// 编译: cc -std=gnu99 -Wall -I../bsp -Imock -o test_rc_parse test_rc_parse.c ../bsp/rc_parse.c
+// 用法: test_rc_parse [-v], 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "check.h"
+#include "rc_parse.h"
+
+// 录制时接收机发出的三组通道值
+static const uint16_t ch_a[RC_CH_NUM] = {172, 272, 372, 472, 572, 672, 772, 872,
+                                         972, 1072, 1172, 1272, 1372, 1472, 1572, 1672};
+static const uint16_t ch_b[RC_CH_NUM] = {1811, 1714, 1617, 1520, 1423, 1326, 1229, 1132,
+                                         1035, 938, 841, 744, 647, 550, 453, 356};
+static const uint16_t ch_c[RC_CH_NUM] = {992, 992, 172, 992, 992, 992, 992, 992,
+                                         992, 992, 992, 992, 992, 992, 992, 992};
+
+// 前导杂散字节 + 正常帧A (28)
+static const uint8_t sbus_0[] = {
+    0x55, 0x00, 0xAA, 0x0F, 0xAC, 0x80, 0x08, 0x5D, 0xB0, 0xC3, 0x23, 0x50, 0x11, 0x0C, 0x6D, 0xCC, 0x83,
+    0x21, 0x25, 0xF1, 0xC9, 0x55, 0xE0, 0x92, 0x18, 0xD1, 0x00, 0x00,
+};
+// 结束字节错误 (0x55) 的帧B (25)
+static const uint8_t sbus_1[] = {
+    0x0F, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97, 0x36, 0x93, 0x8D, 0x0B, 0x54, 0x5D, 0xD2, 0xD0,
+    0x75, 0x28, 0x13, 0x15, 0x87, 0x2C, 0x00, 0x55,
+};
+// 帧B只收到12字节就空闲 (IDLE截断) (12)
+static const uint8_t sbus_2[] = {
+    0x0F, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97, 0x36, 0x93, 0x8D,
+};
+// 帧C: 丢帧+失控保护标志, SBUS2结束字节0x14 (25)
+static const uint8_t sbus_3[] = {
+    0x0F, 0xE0, 0x03, 0x1F, 0x2B, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0xE0, 0x03, 0x1F, 0xF8, 0xC0,
+    0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0x0C, 0x14,
+};
+// 帧A、帧B连续到达, 中间没有空闲 (50)
+static const uint8_t sbus_4[] = {
+    0x0F, 0xAC, 0x80, 0x08, 0x5D, 0xB0, 0xC3, 0x23, 0x50, 0x11, 0x0C, 0x6D, 0xCC, 0x83, 0x21, 0x25, 0xF1,
+    0xC9, 0x55, 0xE0, 0x92, 0x18, 0xD1, 0x00, 0x00, 0x0F, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97,
+    0x36, 0x93, 0x8D, 0x0B, 0x54, 0x5D, 0xD2, 0xD0, 0x75, 0x28, 0x13, 0x15, 0x87, 0x2C, 0x00, 0x00,
+};
+// 帧A少最后一个字节, 紧接着帧B: 错位到空闲为止 (49)
+static const uint8_t sbus_5[] = {
+    0x0F, 0xAC, 0x80, 0x08, 0x5D, 0xB0, 0xC3, 0x23, 0x50, 0x11, 0x0C, 0x6D, 0xCC, 0x83, 0x21, 0x25, 0xF1,
+    0xC9, 0x55, 0xE0, 0x92, 0x18, 0xD1, 0x00, 0x0F, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97, 0x36,
+    0x93, 0x8D, 0x0B, 0x54, 0x5D, 0xD2, 0xD0, 0x75, 0x28, 0x13, 0x15, 0x87, 0x2C, 0x00, 0x00,
+};
+// 空闲后恢复: 帧C (25)
+static const uint8_t sbus_6[] = {
+    0x0F, 0xE0, 0x03, 0x1F, 0x2B, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0xE0, 0x03, 0x1F, 0xF8, 0xC0,
+    0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0x00, 0x00,
+};
+
+// 前导杂散字节 + 通道帧A (29)
+static const uint8_t crsf_0[] = {
+    0xEE, 0x18, 0x16, 0xC8, 0x18, 0x16, 0xAC, 0x80, 0x08, 0x5D, 0xB0, 0xC3, 0x23, 0x50, 0x11, 0x0C, 0x6D,
+    0xCC, 0x83, 0x21, 0x25, 0xF1, 0xC9, 0x55, 0xE0, 0x92, 0x18, 0xD1, 0x11,
+};
+// 链路统计帧, 上行LQ 87 (14)
+static const uint8_t crsf_1[] = {
+    0xC8, 0x0C, 0x14, 0xB0, 0xB2, 0x57, 0x09, 0x00, 0x02, 0x03, 0xA8, 0x64, 0x07, 0xAC,
+};
+// CRC错误的通道帧B (26)
+static const uint8_t crsf_2[] = {
+    0xC8, 0x18, 0x16, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97, 0x36, 0x93, 0x8D, 0x0B, 0x54, 0x5D,
+    0xD2, 0xD0, 0x75, 0x28, 0x13, 0x15, 0x87, 0x2C, 0x66,
+};
+// 长度字节非法 (0x7F) 的帧, 其后的字节中没有0xC8 (5)
+static const uint8_t crsf_3[] = {
+    0xC8, 0x7F, 0x16, 0x01, 0x02,
+};
+// 通道帧B只收到10字节就空闲 (IDLE截断) (10)
+static const uint8_t crsf_4[] = {
+    0xC8, 0x18, 0x16, 0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58,
+};
+// 通道帧C, 带上一帧链路统计的LQ (26)
+static const uint8_t crsf_5[] = {
+    0xC8, 0x18, 0x16, 0xE0, 0x03, 0x1F, 0x2B, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0xE0, 0x03, 0x1F,
+    0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0xDB,
+};
+// 链路统计 + 通道帧B连续到达 (40)
+static const uint8_t crsf_6[] = {
+    0xC8, 0x0C, 0x14, 0xB0, 0xB2, 0x37, 0x09, 0x00, 0x02, 0x03, 0xA8, 0x64, 0x07, 0x77, 0xC8, 0x18, 0x16,
+    0x13, 0x97, 0x75, 0x94, 0xE1, 0xFB, 0x58, 0x97, 0x36, 0x93, 0x8D, 0x0B, 0x54, 0x5D, 0xD2, 0xD0, 0x75,
+    0x28, 0x13, 0x15, 0x87, 0x2C, 0x3C,
+};
+
+// 一段录制数据和回放后应有的结果
+typedef struct {
+    const char *name;
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t frames, crc_errors, sync_errors; // 本段内的增量
+    const uint16_t *ch;                       // 最后一帧的通道, 没有新帧时为NULL
+    uint8_t flags, lq;
+} segment_t;
+
+#define SEG(name, data, ...) {name, data, sizeof(data), __VA_ARGS__}
+
+static const segment_t sbus_stream[] = {
+    SEG("garbage + A", sbus_0, 1, 0, 3, ch_a, 0, 0),
+    SEG("bad end byte", sbus_1, 0, 1, 0, NULL, 0, 0),
+    SEG("idle cut", sbus_2, 0, 0, 1, NULL, 0, 0),
+    SEG("flags + sbus2 end", sbus_3, 1, 0, 0, ch_c, RC_FLAG_LOST | RC_FLAG_FAILSAFE, 0),
+    SEG("back to back", sbus_4, 2, 0, 0, ch_b, 0, 0),
+    // 帧A缺的字节由帧B的帧头补上, 结束字节错误; 帧B其余字节中没有0x0F, 全部丢弃
+    SEG("one byte short", sbus_5, 0, 1, 24, NULL, 0, 0),
+    SEG("recovered", sbus_6, 1, 0, 0, ch_c, 0, 0),
+};
+
+static const segment_t crsf_stream[] = {
+    SEG("garbage + A", crsf_0, 1, 0, 3, ch_a, 0, 0),
+    SEG("link stats", crsf_1, 0, 0, 0, NULL, 0, 0),
+    SEG("bad crc", crsf_2, 0, 1, 0, NULL, 0, 0),
+    SEG("bad length", crsf_3, 0, 0, 4, NULL, 0, 0),
+    SEG("idle cut", crsf_4, 0, 0, 1, NULL, 0, 0),
+    SEG("lq carried", crsf_5, 1, 0, 0, ch_c, 0, 87),
+    SEG("link + B", crsf_6, 1, 0, 0, ch_b, 0, 55),
+};
+
+static int verbose;
+
+static void replay(const char *proto_name, rc_proto_t proto, const segment_t *seg, uint32_t num){
+    rc_parser_t p;
+    rc_parser_init(&p, proto);
+
+    for (uint32_t i = 0; i < num; i++, seg++) {
+        uint32_t frames = p.frames, crc = p.crc_errors, sync = p.sync_errors;
+        uint32_t got = 0;
+        rc_frame_t f, last;
+
+        memset(&last, 0, sizeof(last));
+        for (uint32_t k = 0; k < seg->len; k++) {
+            memset(&f, 0xA5, sizeof(f));
+            if (rc_parse_byte(&p, seg->data[k], &f)) {
+                got++;
+                last = f;
+            }
+        }
+        rc_parser_idle(&p);
+
+        if (verbose)
+            printf("%s %s: frames %u crc %u sync %u\n", proto_name, seg->name, p.frames - frames,
+                   p.crc_errors - crc, p.sync_errors - sync);
+        CHECK(got == seg->frames && p.frames - frames == seg->frames, "%s %s: frames %u/%u", proto_name,
+              seg->name, got, p.frames - frames);
+        CHECK(p.crc_errors - crc == seg->crc_errors, "%s %s: crc errors %u", proto_name, seg->name,
+              p.crc_errors - crc);
+        CHECK(p.sync_errors - sync == seg->sync_errors, "%s %s: sync errors %u", proto_name, seg->name,
+              p.sync_errors - sync);
+        if (seg->ch == NULL || got == 0)
+            continue;
+        CHECK(!memcmp(last.ch, seg->ch, sizeof(last.ch)), "%s %s: channels %u %u %u %u", proto_name, seg->name,
+              last.ch[0], last.ch[1], last.ch[2], last.ch[3]);
+        CHECK(last.flags == seg->flags && last.lq == seg->lq, "%s %s: flags %02x lq %u", proto_name, seg->name,
+              last.flags, last.lq);
+    }
+}
+
+// 帧在每一个位置被空闲截断, 下一帧都必须完整解析
+static void idle_sweep(const char *proto_name, rc_proto_t proto, const uint8_t *frame, uint32_t len,
+                       const uint16_t *ch){
+    for (uint32_t cut = 1; cut < len; cut++) {
+        rc_parser_t p;
+        rc_frame_t f;
+        int got = 0;
+
+        rc_parser_init(&p, proto);
+        for (uint32_t k = 0; k < cut; k++)
+            got += rc_parse_byte(&p, frame[k], &f);
+        rc_parser_idle(&p);
+        CHECK(got == 0 && p.sync_errors == 1, "%s cut %u: got %d sync %u", proto_name, cut, got, p.sync_errors);
+        for (uint32_t k = 0; k < len; k++)
+            got += rc_parse_byte(&p, frame[k], &f);
+        CHECK(got == 1 && !memcmp(f.ch, ch, sizeof(f.ch)), "%s cut %u: next frame lost", proto_name, cut);
+    }
+}
+
+// PPM接收机8通道, 帧周期22.5ms; 上一帧的尾部, 同步间隔, 本帧9个上升沿
+static const uint32_t ppm_8ch[] = {
+    1000, 2500, 3000,                                                // 上一帧尾部
+    13000, 14000, 15500, 17500, 18750, 19850, 21350, 22600, 24100, // 本帧
+};
+static const uint16_t ppm_8ch_us[] = {1000, 1500, 2000, 1250, 1100, 1500, 1250, 1500};
+
+// 计数器在帧中间回绕
+static const uint32_t ppm_wrap[] = {
+    0xFFFFF000, 0xFFFFF5DC, 0xFFFFFBB8, 0x00000194, 0x00000770, 0x00000D4C,
+};
+
+static void test_ppm(void){
+    rc_frame_t f;
+    uint32_t e[32];
+
+    memset(&f, 0xA5, sizeof(f));
+    CHECK(rc_ppm_decode(ppm_8ch, 12, &f) == 1, "8ch frame");
+    for (uint32_t i = 0; i < 8; i++)
+        CHECK(f.ch[i] == RC_US_TO_RAW(ppm_8ch_us[i]), "ch%u %u", i, f.ch[i]);
+    for (uint32_t i = 8; i < RC_CH_NUM; i++)
+        CHECK(f.ch[i] == RC_RAW_MID, "unused ch%u %u", i, f.ch[i]);
+    CHECK(f.flags == 0 && f.lq == 0, "flags %02x lq %u", f.flags, f.lq);
+
+    // 只从最后一个同步间隔之后解码: 前面的尾部通道越界也不影响, 本帧的通道越界则整帧无效
+    memcpy(e, ppm_8ch, sizeof(ppm_8ch));
+    e[1] = e[0] + 100;
+    CHECK(rc_ppm_decode(e, 12, &f) == 1, "tail before sync must be ignored");
+    e[8] = e[7] + 500;
+    CHECK(rc_ppm_decode(e, 12, &f) == 0, "500us channel accepted");
+
+    CHECK(rc_ppm_decode(ppm_wrap, 6, &f) == 1, "wrap");
+    for (uint32_t i = 0; i < 5; i++)
+        CHECK(f.ch[i] == RC_US_TO_RAW(1500), "wrap ch%u %u", i, f.ch[i]);
+
+    // 通道数: RC_PPM_CH_MIN-1个不够, RC_CH_NUM+1个太多
+    for (uint32_t n = 0; n <= RC_CH_NUM + 2; n++) {
+        for (uint32_t i = 0; i < n; i++)
+            e[i] = 10000 + i * 1500;
+        uint32_t ch = n ? n - 1 : 0;
+        int ok = (ch >= RC_PPM_CH_MIN && ch <= RC_CH_NUM);
+        CHECK(rc_ppm_decode(e, n, &f) == ok, "%u edges", n);
+    }
+
+    // 脉宽边界
+    static const uint32_t widths[][2] = {{RC_PULSE_MIN - 1, 0}, {RC_PULSE_MIN, 1}, {RC_PULSE_MAX, 1},
+                                         {RC_PULSE_MAX + 1, 0}};
+    for (uint32_t k = 0; k < 4; k++) {
+        for (uint32_t i = 0; i < 6; i++)
+            e[i] = 10000 + i * 1500;
+        for (uint32_t i = 3; i < 6; i++)
+            e[i] += widths[k][0] - 1500;
+        CHECK(rc_ppm_decode(e, 6, &f) == (int)widths[k][1], "width %u", widths[k][0]);
+    }
+
+    // 同步间隔正好RC_PPM_SYNC_US不算同步, 按通道越界处理
+    for (uint32_t i = 0; i < 6; i++)
+        e[i] = 10000 + i * 1500;
+    e[1] = e[0] + RC_PPM_SYNC_US;
+    for (uint32_t i = 2; i < 6; i++)
+        e[i] = e[i - 1] + 1500;
+    CHECK(rc_ppm_decode(e, 6, &f) == 0, "gap == sync accepted");
+    e[0]--;
+    CHECK(rc_ppm_decode(e, 6, &f) == 1, "gap > sync rejected");
+}
+
+// 400Hz舵机信号: 高电平1500us, 低电平1000us, 两者都在脉宽范围内
+static const uint32_t pwm_400hz[] = {5000, 6500, 7500, 9000, 10000};
+
+static void test_pwm(void){
+    uint32_t end = 0;
+
+    // 最后一个边沿是上升沿 (电平1): 脉冲为前两个边沿, 而不是最近的低电平间隔
+    CHECK(rc_pwm_pulse(pwm_400hz, 3, 1, &end) == 1500 && end == 6500, "rising last: %u", end);
+    CHECK(rc_pwm_pulse(&pwm_400hz[2], 3, 1, &end) == 1500 && end == 9000, "rising last: %u", end);
+    // 最后一个边沿是下降沿 (电平0)
+    CHECK(rc_pwm_pulse(&pwm_400hz[1], 3, 0, &end) == 1500 && end == 9000, "falling last: %u", end);
+    CHECK(rc_pwm_pulse(pwm_400hz, 2, 0, &end) == 1500 && end == 6500, "two edges");
+    CHECK(rc_pwm_pulse(pwm_400hz, 2, 1, &end) == 0, "two edges, rising last");
+    CHECK(rc_pwm_pulse(pwm_400hz, 1, 0, &end) == 0, "one edge");
+
+    // 50Hz: 低电平约18ms
+    static const uint32_t pwm_50hz[] = {1000, 2100, 21000, 22900};
+    CHECK(rc_pwm_pulse(pwm_50hz, 4, 0, &end) == 1900 && end == 22900, "50hz %u", end);
+    CHECK(rc_pwm_pulse(pwm_50hz, 3, 1, &end) == 1100 && end == 2100, "50hz rising last %u", end);
+
+    // 脉宽越界
+    static const uint32_t pwm_bad[] = {1000, 1000 + RC_PULSE_MIN - 1, 20000, 20000 + RC_PULSE_MAX + 1};
+    end = 7;
+    CHECK(rc_pwm_pulse(pwm_bad, 2, 0, &end) == 0 && end == 7, "short pulse");
+    CHECK(rc_pwm_pulse(&pwm_bad[2], 2, 0, &end) == 0 && end == 7, "long pulse");
+
+    // 计数器回绕
+    static const uint32_t pwm_wrap[] = {0xFFFFFC18, 0x000001F4, 0x00004E20};
+    CHECK(rc_pwm_pulse(pwm_wrap, 3, 1, &end) == 1500 && end == 0x1F4, "wrap");
+}
+
+int main(int argc, char **argv){
+    verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+    setvbuf(stdout, NULL, _IONBF, 0);
+    replay("sbus", RC_PROTO_SBUS, sbus_stream, sizeof(sbus_stream) / sizeof(sbus_stream[0]));
+    replay("crsf", RC_PROTO_CRSF, crsf_stream, sizeof(crsf_stream) / sizeof(crsf_stream[0]));
+    idle_sweep("sbus", RC_PROTO_SBUS, sbus_6, sizeof(sbus_6), ch_c);
+    idle_sweep("crsf", RC_PROTO_CRSF, crsf_5, sizeof(crsf_5), ch_c);
+    test_ppm();
+    test_pwm();
+    return check_done("test_rc_parse");
+}
@@ -0,0 +1,145 @@
+// bsp/tim.c 主机测试: 驱动不经修改运行在寄存器模拟上 (tools/mock)
+// 检查定时器时钟推导、TIM_Init的周期与中断、输入捕获的寄存器和DMA配置
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -o test_tim test_tim.c ../bsp/tim.c mock/mock.c
+// 用法: test_tim, 全部通过时退出码为0
+
+#include <stdio.h>
+#include <stdint.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+
+#define MS(n) ((uint64_t)SystemCoreClock / 1000 * (n))
+
+static uint32_t tim2_irqs;
+
+static void tim2_isr(void){
+    if (TIM2->SR & TIM_SR_UIF) {
+        TIM2->SR = ~TIM_SR_UIF;
+        tim2_irqs++;
+    }
+}
+
+static int tim_init(TIM_TypeDef *t, uint32_t ms){
+    void *argv[2] = {t, (void *)(uintptr_t)ms};
+    dev_arg_t arg = {.argv = argv};
+    return TIM_Init(arg);
+}
+
+static void test_clock(void){
+    uint32_t cfgr = mock_peek(&RCC->CFGR);
+
+    // 复位值: APB1 4分频, APB2 2分频, 定时器时钟为PCLK的2倍
+    CHECK(tim_get_clock(TIM2) == 84000000, "%u", tim_get_clock(TIM2));
+    CHECK(tim_get_clock(TIM5) == 84000000, "%u", tim_get_clock(TIM5));
+    CHECK(tim_get_clock(TIM1) == 168000000, "%u", tim_get_clock(TIM1));
+    CHECK(tim_get_clock(TIM9) == 168000000, "%u", tim_get_clock(TIM9));
+
+    // APB1不分频时定时器时钟等于PCLK
+    mock_poke(&RCC->CFGR, cfgr & ~RCC_CFGR_PPRE1);
+    CHECK(tim_get_clock(TIM2) == 168000000, "%u", tim_get_clock(TIM2));
+    // APB1 16分频
+    mock_poke(&RCC->CFGR, cfgr | RCC_CFGR_PPRE1);
+    CHECK(tim_get_clock(TIM4) == 21000000, "%u", tim_get_clock(TIM4));
+    mock_poke(&RCC->CFGR, cfgr);
+}
+
+static void test_init_period(void){
+    mock_reset();
+    mock_count_clear();
+    CHECK(tim_init(TIM2, 10) == 0, "TIM_Init");
+
+    // PSC是16位寄存器, 周期必须正好10ms
+    CHECK(mock_tim_psc(TIM2) <= 0xFFFF, "psc %u", mock_tim_psc(TIM2));
+    CHECK(mock_tim_period(TIM2) == MS(10), "period %llu", (unsigned long long)mock_tim_period(TIM2));
+    CHECK(mock_writes(&TIM2->PSC) == 1 && mock_writes(&TIM2->ARR) == 1, "PSC/ARR written %u/%u",
+          mock_writes(&TIM2->PSC), mock_writes(&TIM2->ARR));
+    CHECK(RCC->APB1ENR & RCC_APB1ENR_TIM2EN, "clock not enabled");
+    CHECK(TIM2->DIER & TIM_DIER_UIE, "UIE");
+    CHECK(TIM2->CR1 & TIM_CR1_CEN, "CEN");
+    CHECK(!(TIM2->SR & TIM_SR_UIF), "UIF left set by UG");
+
+    // 计数器: 半个周期时计到ARR的一半
+    mock_advance(MS(5));
+    uint32_t cnt = TIM2->CNT, arr = TIM2->ARR;
+    CHECK(cnt >= arr / 2 - 1 && cnt <= arr / 2 + 1, "cnt %u arr %u", cnt, arr);
+
+    // 未使能NVIC时只置UIF
+    mock_advance(MS(5));
+    CHECK(TIM2->SR & TIM_SR_UIF, "UIF after one period");
+    CHECK(!mock_irq_enabled(TIM2_IRQn), "TIM_Init must not enable NVIC");
+
+    // 使能中断后100ms内正好10次
+    TIM2->SR = 0;
+    mock_irq_handler(TIM2_IRQn, tim2_isr);
+    NVIC_EnableIRQ(TIM2_IRQn);
+    uint32_t upd = mock_tim_updates(TIM2);
+    tim2_irqs = 0;
+    mock_run(MS(100), 1000);
+    CHECK(tim2_irqs == 10, "irqs %u", tim2_irqs);
+    CHECK(mock_tim_updates(TIM2) - upd == 10, "updates %u", mock_tim_updates(TIM2) - upd);
+    NVIC_DisableIRQ(TIM2_IRQn);
+}
+
+static void test_init_range(void){
+    static const uint32_t ms[] = {1, 2, 7, 10, 100, 781, 1000, 50000};
+
+    for (uint32_t i = 0; i < sizeof(ms) / sizeof(ms[0]); i++) {
+        mock_reset();
+        CHECK(tim_init(TIM3, ms[i]) == 0, "%u ms", ms[i]);
+        // 误差不超过一个计数
+        uint64_t want = MS(ms[i]), got = mock_tim_period(TIM3);
+        uint64_t tick = (uint64_t)(mock_tim_psc(TIM3) + 1) * 2;
+        CHECK(got + tick > want && got < want + tick, "%u ms: %llu vs %llu", ms[i],
+              (unsigned long long)got, (unsigned long long)want);
+    }
+
+    mock_reset();
+    CHECK(tim_init(TIM1, 10) == -1, "TIM1 is not an APB1 timer");
+    CHECK(tim_init(TIM2, 0) == -1, "0 ms");
+    CHECK(tim_init(TIM2, 200000) == -1, "200 s does not fit 16-bit PSC and ARR");
+}
+
+static void test_capture(void){
+    static volatile uint32_t buf[16];
+
+    mock_reset();
+    mock_count_clear();
+    CHECK(tim_capture_init(TIM5, 1, TIM_CAPTURE_BOTH, 1000000, DMA1_Stream2, 6, buf, 16) == 0, "ch1");
+    CHECK(TIM5->PSC == 83, "psc %u", TIM5->PSC);
+    CHECK(TIM5->ARR == 0xFFFFFFFF, "arr %x", TIM5->ARR);
+    CHECK((TIM5->CCMR1 & 0xFF) == 0x31, "ccmr1 %x", TIM5->CCMR1);
+    CHECK((TIM5->CCER & 0xF) == 0xB, "ccer %x", TIM5->CCER);
+    CHECK(TIM5->DIER & TIM_DIER_CC1DE, "CC1DE");
+    CHECK(TIM5->CR1 & TIM_CR1_CEN, "CEN");
+    CHECK(DMA1_Stream2->PAR == (uint32_t)(uintptr_t)&TIM5->CCR1, "par %x", DMA1_Stream2->PAR);
+    CHECK(DMA1_Stream2->M0AR == (uint32_t)(uintptr_t)buf, "m0ar");
+    CHECK(DMA1_Stream2->NDTR == 16, "ndtr %u", DMA1_Stream2->NDTR);
+    CHECK((DMA1_Stream2->CR >> 25) == 6, "chsel");
+    CHECK(DMA1_Stream2->CR & DMA_SxCR_CIRC && DMA1_Stream2->CR & DMA_SxCR_MINC && DMA1_Stream2->CR & DMA_SxCR_EN,
+          "cr %x", DMA1_Stream2->CR);
+    CHECK(mock_writes(&DMA1->LIFCR) == 1, "flags not cleared");
+
+    // 第二个通道: 定时器已运行, 不重设时基; 通道4在CCMR2高字节, 不碰通道1
+    uint32_t psc_w = mock_writes(&TIM5->PSC);
+    CHECK(tim_capture_init(TIM5, 4, TIM_CAPTURE_RISING, 2000000, DMA1_Stream1, 6, buf, 16) == 0, "ch4");
+    CHECK(mock_writes(&TIM5->PSC) == psc_w, "timebase rewritten while running");
+    CHECK((TIM5->CCMR2 & 0xFF00) == 0x3100, "ccmr2 %x", TIM5->CCMR2);
+    CHECK((TIM5->CCMR1 & 0xFF) == 0x31, "ccmr1 %x", TIM5->CCMR1);
+    CHECK((TIM5->CCER >> 12) == 0x1, "ccer %x", TIM5->CCER);
+    CHECK(DMA1_Stream1->PAR == (uint32_t)(uintptr_t)&TIM5->CCR4, "par %x", DMA1_Stream1->PAR);
+
+    CHECK(tim_capture_init(TIM3, 1, TIM_CAPTURE_BOTH, 1000000, DMA1_Stream4, 5, buf, 16) == -1, "TIM3 is 16-bit");
+    CHECK(tim_capture_init(TIM5, 5, TIM_CAPTURE_BOTH, 1000000, DMA1_Stream2, 6, buf, 16) == -1, "ch5");
+    CHECK(tim_capture_init(TIM5, 1, TIM_CAPTURE_BOTH, 1000000, DMA1_Stream2, 6, buf, 0) == -1, "len 0");
+}
+
+int main(void){
+    mock_init();
+    test_clock();
+    test_init_period();
+    test_init_range();
+    test_capture();
+    return check_done("test_tim");
+}
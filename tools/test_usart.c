@@ -0,0 +1,237 @@
+// bsp/usart.c 主机测试: 驱动不经修改运行在寄存器模拟上 (tools/mock)
+// 检查BRR和过采样选择、帧格式和字节时间、轮询发送按TXE节拍、改波特率等发送完成、
+// 中断接收 (RXNE/ORE/环形缓冲区满)、DMA整块发送, 以及printf整条写入发送队列
+// 发送队列 (console.c) 用替身记录写入的内容
+//
+// 编译: cc -std=gnu99 -Wall -no-pie -Imock -I../bsp -I../app -o test_usart test_usart.c ../bsp/usart.c mock/mock.c
+// 用法: test_usart [-v], -v 打印寄存器访问统计; 全部通过时退出码为0
+// 注意: usart.c定义了printf (写入发送队列), 测试自己的输出一律用fprintf
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "mock.h"
+#include "check.h"
+#include "driver.h"
+#include "df_uart.h"
+
+extern Ut debug;
+
+static int verbose;
+
+/*---------------------------------------------------------------------------*/
+/* 发送队列替身                                                              */
+/*---------------------------------------------------------------------------*/
+
+static char con_buf[1024];
+static uint32_t con_len, con_calls, con_inits;
+
+void console_init(void){
+    con_inits++;
+}
+
+int console_write(const char *data, uint32_t len){
+    con_calls++;
+    if (len > sizeof(con_buf) - con_len)
+        len = sizeof(con_buf) - con_len;
+    memcpy(con_buf + con_len, data, len);
+    con_len += len;
+    return (int)len;
+}
+
+int console_putc(char c){
+    return console_write(&c, 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/* 测试                                                                      */
+/*---------------------------------------------------------------------------*/
+
+static void usart3_isr(void){
+    uart_rx_isr(UART_PORT_3);
+}
+
+static uint32_t tx_take(USART_TypeDef *u, uint8_t *dst, uint32_t max){
+    return mock_uart_tx(u, dst, max);
+}
+
+static void test_open(void){
+    mock_reset();
+    CHECK(uart_open(UART_PORT_3, 115200, UART_MODE_TX | UART_MODE_RX) == 0, "open");
+    CHECK(USART3->BRR == 365, "brr %u", USART3->BRR);
+    CHECK(USART3->CR1 == (USART_CR1_TE | USART_CR1_RE | USART_CR1_UE), "cr1 %x", USART3->CR1);
+    CHECK(RCC->APB1ENR & RCC_APB1ENR_USART3EN, "clock");
+    CHECK(((GPIOB->MODER >> 20) & 0xF) == 0xA, "PB10/PB11 AF mode %08x", GPIOB->MODER);
+    CHECK(((GPIOB->AFR[1] >> 8) & 0xFF) == 0x77, "AF7 %08x", GPIOB->AFR[1]);
+    CHECK(uart_get_baud(UART_PORT_3) == 42000000 / 365, "actual %u", uart_get_baud(UART_PORT_3));
+    // 8N1: 10位, 每位BRR个APB1时钟 (内核时钟4分频)
+    CHECK(mock_uart_byte_cycles(USART3) == 10ull * 365 * 4, "byte %llu cycles",
+          (unsigned long long)mock_uart_byte_cycles(USART3));
+
+    // 3Mbaud: 分频14 < 16, 改用8倍过采样, BRR[3]为0
+    CHECK(uart_set_baud(UART_PORT_3, 3000000) == 0, "3M");
+    CHECK(USART3->CR1 & USART_CR1_OVER8, "over8");
+    CHECK(USART3->BRR == 0x16, "brr %x", USART3->BRR);
+    CHECK(uart_get_baud(UART_PORT_3) == 3000000, "actual %u", uart_get_baud(UART_PORT_3));
+    CHECK(mock_uart_byte_cycles(USART3) == 10ull * 14 * 4, "byte %llu cycles",
+          (unsigned long long)mock_uart_byte_cycles(USART3));
+    CHECK(uart_calc_baud(UART_PORT_3, 6000000) == 0, "6M is out of range on APB1");
+    CHECK(uart_calc_baud(UART_PORT_1, 6000000) == 6000000, "6M on APB2");
+    CHECK(uart_open(UART_PORT_NUM, 115200, UART_MODE_TX) == -1 && uart_open(UART_PORT_3, 0, UART_MODE_TX) == -1,
+          "bad args");
+
+    // SBUS: 100000 8E2, M=1含校验位, 1+9+2 = 12位
+    CHECK(uart_open(UART_PORT_2, 100000, UART_MODE_RX | UART_MODE_8E2) == 0, "sbus");
+    CHECK((USART2->CR1 & (USART_CR1_M | USART_CR1_PCE | USART_CR1_TE)) == (USART_CR1_M | USART_CR1_PCE), "cr1 %x",
+          USART2->CR1);
+    CHECK(USART2->CR2 == USART_CR2_STOP_1, "cr2 %x", USART2->CR2);
+    CHECK(mock_uart_byte_cycles(USART2) == 12ull * 420 * 4, "byte %llu cycles",
+          (unsigned long long)mock_uart_byte_cycles(USART2));
+}
+
+static void test_write(void){
+    static const uint8_t msg[] = "0123456789abcdef";
+    uint8_t out[64];
+    uint32_t n = sizeof(msg) - 1;
+
+    mock_reset();
+    uart_open(UART_PORT_3, 115200, UART_MODE_TX | UART_MODE_RX);
+    uint64_t frame = mock_uart_byte_cycles(USART3), t0 = mock_now();
+    mock_count_clear();
+    uart_write(UART_PORT_3, msg, n);
+    uint64_t dt = mock_now() - t0;
+
+    // 前两个字节直接进移位寄存器和TDR, 之后每个字节等一帧
+    CHECK(dt >= (n - 2) * frame && dt < (n - 1) * frame, "write took %llu cycles, frame %llu",
+          (unsigned long long)dt, (unsigned long long)frame);
+    CHECK(mock_writes(&USART3->DR) == n, "DR writes %u", mock_writes(&USART3->DR));
+    if (verbose)
+        fprintf(stderr, "uart_write %u bytes: %llu register accesses (SR polls %u)\n", n,
+                (unsigned long long)mock_accesses(), mock_reads(&USART3->SR));
+
+    // 改波特率前等TC, 已写入的字节按旧速率发完
+    CHECK(uart_set_baud(UART_PORT_3, 230400) == 0, "set baud");
+    CHECK(mock_now() >= mock_uart_tx_done(USART3), "BRR changed before TC");
+    uint32_t got = tx_take(USART3, out, sizeof(out));
+    CHECK(got == n && memcmp(out, msg, n) == 0, "tx %u bytes", got);
+    CHECK(mock_uart_stat(USART3)->tx_lost == 0, "lost %u", mock_uart_stat(USART3)->tx_lost);
+
+    usart3_send(arg_ptr("AT\r\n"));
+    mock_advance(frame * 10);
+    got = tx_take(USART3, out, sizeof(out));
+    CHECK(got == 4 && memcmp(out, "AT\r\n", 4) == 0, "usart3_send");
+}
+
+static void test_rx_poll(void){
+    mock_reset();
+    uart_open(UART_PORT_3, 115200, UART_MODE_TX | UART_MODE_RX);
+    CHECK(uart_getc(UART_PORT_3) == -1, "empty");
+    mock_uart_rx(USART3, (const uint8_t *)"Z", 1);
+    CHECK(uart_getc(UART_PORT_3) == -1, "byte visible before its stop bit");
+    mock_advance(mock_uart_byte_cycles(USART3));
+    CHECK(uart_getc(UART_PORT_3) == 'Z', "getc");
+    CHECK(uart_getc(UART_PORT_3) == -1, "RXNE cleared by DR read");
+}
+
+static void test_rx_irq(void){
+    static uint8_t ring[16];
+    uint8_t out[32];
+
+    mock_reset();
+    uart_open(UART_PORT_3, 115200, UART_MODE_TX | UART_MODE_RX);
+    mock_irq_handler(USART3_IRQn, usart3_isr);
+    CHECK(uart_rx_start(UART_PORT_3, ring, 12, 5) == -1, "size must be a power of two");
+    CHECK(uart_rx_start(UART_PORT_3, ring, sizeof(ring), 5) == 0, "rx start");
+    CHECK(mock_irq_enabled(USART3_IRQn) && (USART3->CR1 & USART_CR1_RXNEIE), "irq");
+
+    uint64_t frame = mock_uart_byte_cycles(USART3);
+    mock_uart_rx(USART3, (const uint8_t *)"hello", 5);
+    mock_run(frame * 6, (uint32_t)(frame / 4));
+    CHECK(uart_read(UART_PORT_3, out, sizeof(out)) == 5 && memcmp(out, "hello", 5) == 0, "hello");
+    CHECK(uart_rx_errors(UART_PORT_3) == 0, "errors %u", uart_rx_errors(UART_PORT_3));
+
+    // 中断被屏蔽三帧: 第一个字节留在DR, 其后的溢出, ISR读出第一个字节并记一次错误
+    mock_primask = 1;
+    mock_uart_rx(USART3, (const uint8_t *)"abc", 3);
+    mock_advance(frame * 4);
+    mock_primask = 0;
+    mock_run(frame, (uint32_t)(frame / 4));
+    uint32_t n = uart_read(UART_PORT_3, out, sizeof(out));
+    CHECK(n == 1 && out[0] == 'a', "after overrun %u bytes", n);
+    CHECK(uart_rx_errors(UART_PORT_3) == 1, "errors %u", uart_rx_errors(UART_PORT_3));
+    CHECK(mock_uart_stat(USART3)->rx_overrun == 2, "overrun %u", mock_uart_stat(USART3)->rx_overrun);
+    CHECK(!(USART3->SR & USART_SR_ORE), "ORE not cleared");
+
+    // 环形缓冲区满: 多出的字节丢弃并计数
+    uint8_t burst[20];
+    for (int i = 0; i < 20; i++)
+        burst[i] = (uint8_t)i;
+    mock_uart_rx(USART3, burst, 20);
+    mock_run(frame * 21, (uint32_t)(frame / 4));
+    n = uart_read(UART_PORT_3, out, sizeof(out));
+    CHECK(n == 16 && out[15] == 15, "ring %u", n);
+    CHECK(uart_rx_errors(UART_PORT_3) == 1 + 4, "errors %u", uart_rx_errors(UART_PORT_3));
+    CHECK(mock_uart_stat(USART3)->rxne_cleared_by_write == 0, "SR write dropped a byte");
+}
+
+static void test_dma(void){
+    static uint8_t frame_buf[32] = "telemetry frame";
+    uint8_t out[64];
+
+    mock_reset();
+    CHECK(uart_dma_send(UART_PORT_3, frame_buf, 15) == -1, "not opened with DMA");
+    uart_open(UART_PORT_3, 1000000, UART_MODE_TX | UART_MODE_RX | UART_MODE_DMA_TX);
+    CHECK(USART3->CR3 & USART_CR3_DMAT, "DMAT");
+    CHECK(DMA1_Stream3->PAR == (uint32_t)(uintptr_t)&USART3->DR, "par");
+
+    mock_count_clear();
+    CHECK(uart_dma_send(UART_PORT_3, frame_buf, 15) == 0, "send");
+    if (verbose)
+        fprintf(stderr, "uart_dma_send: %llu register accesses\n", (unsigned long long)mock_accesses());
+    CHECK(uart_dma_busy(UART_PORT_3), "busy");
+    CHECK(uart_dma_send(UART_PORT_3, frame_buf, 15) == -1, "second send while busy");
+    CHECK(uart_set_baud(UART_PORT_3, 115200) == -1, "baud change while DMA busy");
+
+    mock_advance(mock_uart_byte_cycles(USART3) * 16);
+    CHECK(!uart_dma_busy(UART_PORT_3), "EN not cleared at end");
+    uint32_t n = tx_take(USART3, out, sizeof(out));
+    CHECK(n == 15 && memcmp(out, frame_buf, 15) == 0, "dma tx %u bytes", n);
+    CHECK(DMA1->LISR & (DMA_LISR_TCIF0 << 22), "TCIF3");
+}
+
+static void test_console(void){
+    char longer[300];
+
+    mock_reset();
+    con_len = con_calls = 0;
+    CHECK(usart1_init((dev_arg_t){.ptr = &debug}) == 0, "usart1 init");
+    CHECK(con_inits == 1 && debug.UART_Init_Flag, "console");
+    CHECK(USART1->CR1 & USART_CR1_RXNEIE, "RXNEIE");
+    CHECK(uart_get_baud(UART_PORT_1) == 250000, "baud %u", uart_get_baud(UART_PORT_1));
+    CHECK(con_len > 0 && strstr(con_buf, "System Start!\r\n") != NULL, "banner");
+
+    // printf: 格式化后一次写入, 超过127字节截断
+    con_len = con_calls = 0;
+    CHECK(printf("%d %s", 42, "ok") == 5, "printf len");
+    CHECK(con_calls == 1 && con_len == 5 && memcmp(con_buf, "42 ok", 5) == 0, "printf one write");
+    memset(longer, 'x', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = '\0';
+    con_len = con_calls = 0;
+    CHECK(printf("%s", longer) == 127 && con_len == 127 && con_calls == 1, "truncated to %u", con_len);
+
+    Ut bad = debug;
+    bad.UART_Name = "";
+    CHECK(usart1_init((dev_arg_t){.ptr = &bad}) == -1, "empty name");
+}
+
+int main(int argc, char **argv){
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    mock_init();
+    test_open();
+    test_write();
+    test_rx_poll();
+    test_rx_irq();
+    test_dma();
+    test_console();
+    return check_done("test_usart");
+}